@@ -0,0 +1,138 @@
+/**************************************************
+ * AsyncTuner.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "AsyncTuner.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "Task.hpp"
+#include "TunerScheduler.hpp"
+#include "Util.hpp"
+
+AsyncTuner::AsyncTuner(RDA5807M& radioParam, TunerScheduler& schedulerParam) :
+        radio(radioParam), scheduler(schedulerParam)
+{
+}
+
+RDA5807M& AsyncTuner::getRadio()
+{
+    return radio;
+}
+
+const RdsDecoder& AsyncTuner::getDecoder() const
+{
+    return decoder;
+}
+
+/**
+ * Tunes to frequency (in the same units as RDA5807MWrapper::setFrequency())
+ * and completes once STC is set. Completes with GENERAL_FAILURE if the
+ * tune doesn't complete in time.
+ */
+Task<RDA5807M::StatusResult> AsyncTuner::tune(uint16_t frequency)
+{
+    RDA5807M::StatusResult result = radio.setChannel(frequency, false);
+    if (result != RDA5807M::StatusResult::SUCCESS)
+    {
+        co_return result;
+    }
+
+    decoder.reset();
+    result = radio.setTune(true);
+    if (result != RDA5807M::StatusResult::SUCCESS)
+    {
+        co_return result;
+    }
+
+    bool complete = co_await waitForStc(TUNE_TIMEOUT_MS);
+    co_return complete ? RDA5807M::StatusResult::SUCCESS : RDA5807M::StatusResult::GENERAL_FAILURE;
+}
+
+/**
+ * Seeks to the next station in direction. Completes with true if a station
+ * was found, false if the seek failed or timed out.
+ */
+Task<bool> AsyncTuner::seek(RDA5807M::SeekDirection direction)
+{
+    decoder.reset();
+    radio.setSeekDirection(direction, false);
+    if (radio.setSeek(true) != RDA5807M::StatusResult::SUCCESS)
+    {
+        co_return false;
+    }
+
+    bool complete = co_await waitForStc(SEEK_TIMEOUT_MS);
+
+    // The chip clears SEEK by itself; keep the local copy in line
+    radio.setSeek(false, false);
+
+    co_return complete && Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A), SF) == 0;
+}
+
+/**
+ * Completes with true and the group once a new RDS group is available, or
+ * with false after timeoutMs.
+ */
+Task<bool> AsyncTuner::nextRdsGroup(RDA5807M::RdsGroup& group, uint32_t timeoutMs)
+{
+    uint64_t deadline = Util::getMonotonicTimeUs() + static_cast<uint64_t>(timeoutMs) * 1000;
+
+    while (!radio.readRdsGroup(group))
+    {
+        if (Util::getMonotonicTimeUs() >= deadline)
+        {
+            co_return false;
+        }
+        co_await scheduler.sleepFor(RDS_POLL_INTERVAL_US);
+    }
+    co_return true;
+}
+
+/**
+ * Decodes RDS until the whole program service name has been received.
+ * Completes with true and the name, or with false after timeoutMs.
+ */
+Task<bool> AsyncTuner::waitForPs(char (&programService)[RdsDecoder::PS_LENGTH + 1], uint32_t timeoutMs)
+{
+    uint64_t deadline = Util::getMonotonicTimeUs() + static_cast<uint64_t>(timeoutMs) * 1000;
+
+    while (!decoder.isProgramServiceComplete())
+    {
+        uint64_t now = Util::getMonotonicTimeUs();
+        if (now >= deadline)
+        {
+            co_return false;
+        }
+
+        RDA5807M::RdsGroup group;
+        if (co_await nextRdsGroup(group, static_cast<uint32_t>((deadline - now) / 1000)))
+        {
+            decoder.processGroup(group);
+        }
+    }
+
+    std::memcpy(programService, decoder.getData().programService, sizeof(programService));
+    co_return true;
+}
+
+Task<bool> AsyncTuner::waitForStc(uint32_t timeoutMs)
+{
+    uint64_t deadline = Util::getMonotonicTimeUs() + static_cast<uint64_t>(timeoutMs) * 1000;
+
+    while (!radio.isStcComplete())
+    {
+        if (Util::getMonotonicTimeUs() >= deadline)
+        {
+            co_return false;
+        }
+        co_await scheduler.sleepFor(STC_POLL_INTERVAL_US);
+    }
+    co_return true;
+}
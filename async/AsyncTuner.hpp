@@ -0,0 +1,69 @@
+/**************************************************
+ * AsyncTuner.hpp - Awaitable tune, seek and RDS operations
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef ASYNCTUNER_HPP
+#define ASYNCTUNER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "Task.hpp"
+#include "TunerScheduler.hpp"
+
+/**
+ * Coroutine versions of the operations that otherwise need a usleep()
+ * polling loop. Each poll is a co_await on the scheduler, so any number of
+ * AsyncTuners can wait at once on a single thread.
+ *
+ * An AsyncTuner must only be used by one task at a time.
+ */
+class AsyncTuner
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t STC_POLL_INTERVAL_US = 5000;
+    static const uint32_t RDS_POLL_INTERVAL_US = 10000;
+    static const uint32_t TUNE_TIMEOUT_MS = 500;
+    static const uint32_t SEEK_TIMEOUT_MS = 5000;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    AsyncTuner(RDA5807M& radioParam, TunerScheduler& schedulerParam);
+
+    Task<RDA5807M::StatusResult> tune(uint16_t frequency);
+
+    Task<bool> seek(RDA5807M::SeekDirection direction);
+
+    Task<bool> nextRdsGroup(RDA5807M::RdsGroup& group, uint32_t timeoutMs);
+
+    Task<bool> waitForPs(char (&programService)[RdsDecoder::PS_LENGTH + 1], uint32_t timeoutMs);
+
+    RDA5807M& getRadio();
+
+    const RdsDecoder& getDecoder() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    Task<bool> waitForStc(uint32_t timeoutMs);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    TunerScheduler& scheduler;
+
+    // Decoded RDS state of the channel tuned by the last tune()/seek()
+    RdsDecoder decoder;
+};
+
+#endif  // ifndef ASYNCTUNER_HPP
@@ -0,0 +1,171 @@
+/**************************************************
+ * Task.hpp - Lazily started coroutine type for the async layer
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TASK_HPP
+#define TASK_HPP
+
+// System includes
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Project includes
+//<none>
+
+/**
+ * A coroutine that doesn't start until it is awaited (or handed to
+ * TunerScheduler::spawn()). When it finishes, control transfers straight
+ * back to the awaiting coroutine, so chains of tasks never grow the stack.
+ * The async layer doesn't use exceptions; an escaping exception terminates.
+ */
+template<typename T>
+class Task
+{
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    // Resumes whoever awaited the task once it completes
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> finished) noexcept
+        {
+            std::coroutine_handle<> continuation = finished.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type
+    {
+        T value;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() { return Task{Handle::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(T result) { value = std::move(result); }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit Task(Handle handleParam) : handle(handleParam) {};
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {};
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return std::move(handle.promise().value); }
+
+    Handle getHandle() const { return handle; }
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    Handle handle;
+};
+
+template<>
+class Task<void>
+{
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() { return Task{Handle::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        Task<bool>::FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit Task(Handle handleParam) : handle(handleParam) {};
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {};
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    void await_resume() {}
+
+    Handle getHandle() const { return handle; }
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    Handle handle;
+};
+
+#endif  // ifndef TASK_HPP
@@ -0,0 +1,98 @@
+/**************************************************
+ * TunerScheduler.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <unistd.h>
+
+// Project includes
+#include "Task.hpp"
+#include "TunerScheduler.hpp"
+#include "Util.hpp"
+
+TunerScheduler::TunerScheduler() : timerSequence(0), stats{0, 0, 0}
+{
+}
+
+/**
+ * Takes ownership of task and schedules it to start on the next pass of
+ * run().
+ */
+void TunerScheduler::spawn(Task<void>&& task)
+{
+    ready.push_back(task.getHandle());
+    tasks.push_back(std::move(task));
+}
+
+/**
+ * Runs until every spawned task (including any spawned along the way) has
+ * completed. Sleeps while nothing is ready.
+ */
+void TunerScheduler::run()
+{
+    while (!ready.empty() || !timers.empty())
+    {
+        while (!ready.empty())
+        {
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            ++stats.resumes;
+            handle.resume();
+        }
+
+        if (timers.empty())
+        {
+            break;
+        }
+
+        uint64_t now = Util::getMonotonicTimeUs();
+        uint64_t nextWake = timers.top().wakeTimeUs;
+        if (nextWake > now)
+        {
+            usleep(static_cast<useconds_t>(nextWake - now));
+            now = Util::getMonotonicTimeUs();
+        }
+
+        while (!timers.empty() && timers.top().wakeTimeUs <= now)
+        {
+            ready.push_back(timers.top().handle);
+            timers.pop();
+        }
+
+        reapCompletedTasks();
+    }
+
+    reapCompletedTasks();
+}
+
+TunerScheduler::SleepAwaiter TunerScheduler::sleepFor(uint32_t us)
+{
+    return SleepAwaiter{*this, Util::getMonotonicTimeUs() + us};
+}
+
+const TunerScheduler::Stats& TunerScheduler::getStats() const
+{
+    return stats;
+}
+
+void TunerScheduler::addTimer(uint64_t wakeTimeUs, std::coroutine_handle<> handle)
+{
+    timers.push(Timer{wakeTimeUs, timerSequence++, handle});
+    stats.peakTimers = std::max(stats.peakTimers, static_cast<uint32_t>(timers.size()));
+}
+
+/**
+ * Destroys spawned tasks that have run to completion
+ */
+void TunerScheduler::reapCompletedTasks()
+{
+    std::vector<Task<void>>::iterator firstDone =
+            std::partition(tasks.begin(), tasks.end(), [](const Task<void>& task) { return !task.getHandle().done(); });
+
+    stats.tasksCompleted += static_cast<uint64_t>(tasks.end() - firstDone);
+    tasks.erase(firstDone, tasks.end());
+}
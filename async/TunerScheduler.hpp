@@ -0,0 +1,99 @@
+/**************************************************
+ * TunerScheduler.hpp - Single-threaded event loop for coroutine tasks
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TUNERSCHEDULER_HPP
+#define TUNERSCHEDULER_HPP
+
+// System includes
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <vector>
+
+// Project includes
+#include "Task.hpp"
+
+/**
+ * Runs any number of Tasks, for any number of tuners, on the calling
+ * thread. Tasks give up the thread whenever they sleep, so a task waiting
+ * on STC or RDS costs a timer entry rather than a blocked thread.
+ */
+class TunerScheduler
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint64_t resumes;
+        uint64_t tasksCompleted;
+        uint32_t peakTimers;
+    };
+
+    // Returned by sleepFor(); suspends the awaiting task until the timer
+    // expires
+    struct SleepAwaiter
+    {
+        TunerScheduler& scheduler;
+        uint64_t wakeTimeUs;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.addTimer(wakeTimeUs, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TunerScheduler();
+
+    void spawn(Task<void>&& task);
+
+    void run();
+
+    SleepAwaiter sleepFor(uint32_t us);
+
+    const Stats& getStats() const;
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Timer
+    {
+        uint64_t wakeTimeUs;
+
+        // Keeps timers with the same wake time in FIFO order
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+
+        bool operator>(const Timer& other) const
+        {
+            return wakeTimeUs != other.wakeTimeUs ? wakeTimeUs > other.wakeTimeUs : sequence > other.sequence;
+        }
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void addTimer(uint64_t wakeTimeUs, std::coroutine_handle<> handle);
+    void reapCompletedTasks();
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::deque<std::coroutine_handle<>> ready;
+
+    // Spawned tasks are owned here until they complete
+    std::vector<Task<void>> tasks;
+
+    uint64_t timerSequence;
+    Stats stats;
+};
+
+#endif  // ifndef TUNERSCHEDULER_HPP
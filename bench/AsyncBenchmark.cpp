@@ -0,0 +1,167 @@
+/**************************************************
+ * AsyncBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "AsyncBenchmark.hpp"
+#include "AsyncTuner.hpp"
+#include "BenchmarkHarness.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "SimulatedBus.hpp"
+#include "Task.hpp"
+#include "TunerScheduler.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    // Stations in SimulatedBus::populateDemoBand() that transmit RDS
+    const uint16_t RDS_STATIONS[] = {881, 897, 925, 949, 973, 985, 1007, 1035, 1043, 1067};
+    const uint32_t RDS_STATION_COUNT = sizeof(RDS_STATIONS) / sizeof(RDS_STATIONS[0]);
+
+    /**
+     * The workflow written the way the wrapper does it today: a blocking
+     * polling loop per wait
+     */
+    bool blockingWorkflow(RDA5807M& radio, uint16_t frequency, uint32_t timeoutMs)
+    {
+        uint64_t deadline = Util::getMonotonicTimeUs() + static_cast<uint64_t>(timeoutMs) * 1000;
+
+        radio.setChannel(frequency, false);
+        radio.setTune(true);
+        while (!radio.isStcComplete())
+        {
+            if (Util::getMonotonicTimeUs() >= deadline)
+            {
+                return false;
+            }
+            usleep(AsyncTuner::STC_POLL_INTERVAL_US);
+        }
+
+        RdsDecoder decoder;
+        while (!decoder.isProgramServiceComplete())
+        {
+            if (Util::getMonotonicTimeUs() >= deadline)
+            {
+                return false;
+            }
+
+            RDA5807M::RdsGroup group;
+            if (radio.readRdsGroup(group))
+            {
+                decoder.processGroup(group);
+            }
+            else
+            {
+                usleep(AsyncTuner::RDS_POLL_INTERVAL_US);
+            }
+        }
+        return true;
+    }
+
+    Task<void> coroutineWorkflow(AsyncTuner& tuner, uint16_t frequency, uint32_t timeoutMs, uint32_t& completed)
+    {
+        if (co_await tuner.tune(frequency) != RDA5807M::StatusResult::SUCCESS)
+        {
+            co_return;
+        }
+
+        char programService[RdsDecoder::PS_LENGTH + 1];
+        if (co_await tuner.waitForPs(programService, timeoutMs))
+        {
+            ++completed;
+        }
+    }
+}
+
+AsyncBenchmark::Result AsyncBenchmark::run(uint32_t workflowCount)
+{
+    Result result = {};
+    result.workflows = workflowCount;
+
+    std::vector<std::unique_ptr<SimulatedBus>> buses;
+    std::vector<std::unique_ptr<RDA5807M>> radios;
+    for (uint32_t idx = 0; idx < workflowCount; ++idx)
+    {
+        buses.emplace_back(new SimulatedBus());
+        buses.back()->populateDemoBand();
+        radios.emplace_back(new RDA5807M(*buses.back()));
+    }
+
+    // One blocking thread per workflow
+    std::atomic<uint32_t> threadCompleted{0};
+    uint64_t wallStart = Util::getMonotonicTimeUs();
+    uint64_t cpuStart = BenchmarkHarness::processCpuTimeUs();
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t idx = 0; idx < workflowCount; ++idx)
+        {
+            threads.emplace_back([&, idx]() {
+                if (blockingWorkflow(*radios[idx], RDS_STATIONS[idx % RDS_STATION_COUNT], PS_TIMEOUT_MS))
+                {
+                    ++threadCompleted;
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    result.threadPerOperation.completed = threadCompleted;
+    result.threadPerOperation.wallTimeUs = Util::getMonotonicTimeUs() - wallStart;
+    result.threadPerOperation.cpuTimeUs = BenchmarkHarness::processCpuTimeUs() - cpuStart;
+
+    // Every workflow on this thread. Use a different station so each
+    // tuner really retunes.
+    TunerScheduler scheduler;
+    std::vector<std::unique_ptr<AsyncTuner>> tuners;
+    uint32_t coroutineCompleted = 0;
+    for (uint32_t idx = 0; idx < workflowCount; ++idx)
+    {
+        tuners.emplace_back(new AsyncTuner(*radios[idx], scheduler));
+        scheduler.spawn(coroutineWorkflow(*tuners.back(), RDS_STATIONS[(idx + 1) % RDS_STATION_COUNT],
+                                          PS_TIMEOUT_MS, coroutineCompleted));
+    }
+
+    wallStart = Util::getMonotonicTimeUs();
+    cpuStart = BenchmarkHarness::processCpuTimeUs();
+    scheduler.run();
+    result.coroutines.completed = coroutineCompleted;
+    result.coroutines.wallTimeUs = Util::getMonotonicTimeUs() - wallStart;
+    result.coroutines.cpuTimeUs = BenchmarkHarness::processCpuTimeUs() - cpuStart;
+
+    return result;
+}
+
+/**
+ * Runs workflowCount (default 100) simulated tune-and-read-PS workflows
+ * with one thread each, then as coroutines sharing this thread, and
+ * compares the two
+ */
+std::string AsyncBenchmark::report(int workflowCount)
+{
+    Result result = run((workflowCount < 1) ? DEFAULT_WORKFLOW_COUNT : static_cast<uint32_t>(workflowCount));
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Workflows: %u\n", result.workflows);
+    BenchmarkHarness::appendFormat(output, "Thread per operation: %u completed, wall %llu ms, CPU %llu ms\n",
+                                   result.threadPerOperation.completed,
+                                   static_cast<unsigned long long>(result.threadPerOperation.wallTimeUs / 1000),
+                                   static_cast<unsigned long long>(result.threadPerOperation.cpuTimeUs / 1000));
+    BenchmarkHarness::appendFormat(output, "Coroutines (1 thread): %u completed, wall %llu ms, CPU %llu ms\n",
+                                   result.coroutines.completed,
+                                   static_cast<unsigned long long>(result.coroutines.wallTimeUs / 1000),
+                                   static_cast<unsigned long long>(result.coroutines.cpuTimeUs / 1000));
+    return output;
+}
@@ -0,0 +1,59 @@
+/**************************************************
+ * AsyncBenchmark.hpp - Thread-per-operation vs. coroutine comparison
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef ASYNCBENCHMARK_HPP
+#define ASYNCBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Runs the same tune-then-wait-for-PS workflow on many simulated tuners,
+ * first with one blocking thread per workflow and then as coroutines on a
+ * single TunerScheduler thread, and measures both.
+ *
+ * This header deliberately avoids the coroutine headers so it can be used
+ * from code built as C++14.
+ */
+class AsyncBenchmark
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Measurement
+    {
+        uint32_t completed;
+        uint64_t wallTimeUs;
+        uint64_t cpuTimeUs;
+    };
+
+    struct Result
+    {
+        uint32_t workflows;
+        Measurement threadPerOperation;
+        Measurement coroutines;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t workflowCount);
+
+    static std::string report(int workflowCount);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint32_t DEFAULT_WORKFLOW_COUNT = 100;
+    static const uint32_t PS_TIMEOUT_MS = 3000;
+};
+
+#endif  // ifndef ASYNCBENCHMARK_HPP
@@ -0,0 +1,129 @@
+/**************************************************
+ * BenchmarkHarness.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cerrno>
+#include <climits>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <strings.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+
+namespace
+{
+    void printUsage(const char* program, const BenchmarkHarness::Benchmark* benchmarks, size_t benchmarkCount)
+    {
+        std::fprintf(stderr, "Usage: %s <benchmark> [param]\n\n", program);
+        for (size_t benchmarkIdx = 0; benchmarkIdx < benchmarkCount; ++benchmarkIdx)
+        {
+            std::fprintf(stderr, "  %-10s %s\n", benchmarks[benchmarkIdx].name, benchmarks[benchmarkIdx].description);
+        }
+    }
+
+    // Same rules as a command's param
+    bool parseParam(const char* text, int& param)
+    {
+        char* end = nullptr;
+        errno = 0;
+        long value = std::strtol(text, &end, 0);
+        if (errno != 0 || end == text || *end != '\0' || value < INT_MIN || value > INT_MAX)
+        {
+            return false;
+        }
+
+        param = static_cast<int>(value);
+        return true;
+    }
+}
+
+/**
+ * Names are matched without regard to case. Returns 2 on a usage error.
+ */
+int BenchmarkHarness::run(int argc, char* argv[], const Benchmark* benchmarks, size_t benchmarkCount)
+{
+    if (argc < 2 || argc > 3)
+    {
+        printUsage(argv[0], benchmarks, benchmarkCount);
+        return 2;
+    }
+
+    int param = -1;
+    if (argc == 3 && !parseParam(argv[2], param))
+    {
+        std::fprintf(stderr, "Param must be an integer: %s\n", argv[2]);
+        return 2;
+    }
+
+    for (size_t benchmarkIdx = 0; benchmarkIdx < benchmarkCount; ++benchmarkIdx)
+    {
+        if (strcasecmp(argv[1], benchmarks[benchmarkIdx].name) == 0)
+        {
+            std::string output = benchmarks[benchmarkIdx].report(param);
+            std::fwrite(output.data(), 1, output.size(), stdout);
+            return 0;
+        }
+    }
+
+    std::fprintf(stderr, "Unknown benchmark %s\n\n", argv[1]);
+    printUsage(argv[0], benchmarks, benchmarkCount);
+    return 2;
+}
+
+uint64_t BenchmarkHarness::nowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+uint64_t BenchmarkHarness::processCpuTimeUs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+           static_cast<uint64_t>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+uint64_t BenchmarkHarness::perSecond(uint64_t count, uint64_t elapsedUs)
+{
+    return count * 1000000ULL / ((elapsedUs > 0) ? elapsedUs : 1);
+}
+
+/**
+ * Appends to output as printf would print
+ */
+void BenchmarkHarness::appendFormat(std::string& output, const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return;
+    }
+
+    if (static_cast<size_t>(length) < sizeof(buffer))
+    {
+        output.append(buffer, static_cast<size_t>(length));
+        return;
+    }
+
+    // Too long for the buffer; format again straight into output
+    size_t start = output.size();
+    output.resize(start + static_cast<size_t>(length) + 1);
+    va_start(args, format);
+    std::vsnprintf(&output[start], static_cast<size_t>(length) + 1, format, args);
+    va_end(args);
+    output.resize(start + static_cast<size_t>(length));
+}
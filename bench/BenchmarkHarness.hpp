@@ -0,0 +1,59 @@
+/**************************************************
+ * BenchmarkHarness.hpp - Shared pieces of the benchmark binary
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BENCHMARKHARNESS_HPP
+#define BENCHMARKHARNESS_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * The benchmarks are built into their own binary, RDA5807M-bench, rather
+ * than the radio's. Each one is a class whose static report() runs it and
+ * returns what to print. It takes the number given after the benchmark's
+ * name on the command line, or -1 for its default, the way commands take
+ * their param.
+ *
+ * The harness dispatches to them by name and holds what they all time
+ * and format with.
+ */
+class BenchmarkHarness
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Benchmark
+    {
+        const char* name;
+        std::string (*report)(int param);
+        const char* description;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+
+    // Runs the benchmark named by argv[1], or lists them all
+    static int run(int argc, char* argv[], const Benchmark* benchmarks, size_t benchmarkCount);
+
+    // CLOCK_MONOTONIC
+    static uint64_t nowNs();
+
+    // User and system time of the whole process
+    static uint64_t processCpuTimeUs();
+
+    // count per second over elapsedUs, treating 0 us as 1
+    static uint64_t perSecond(uint64_t count, uint64_t elapsedUs);
+
+    static void appendFormat(std::string& output, const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif  // ifndef BENCHMARKHARNESS_HPP
@@ -0,0 +1,46 @@
+/**************************************************
+ * BenchmarkMain.cpp - Runs one benchmark from the command line
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstddef>
+
+// Project includes
+#include "AsyncBenchmark.hpp"
+#include "BenchmarkHarness.hpp"
+#include "BusArbiterBenchmark.hpp"
+#include "I2cDevBenchmark.hpp"
+#include "LogBenchmark.hpp"
+#include "PollingBenchmark.hpp"
+#include "RdsBrokerBenchmark.hpp"
+#include "RegisterShadowBenchmark.hpp"
+#include "ScenarioBenchmark.hpp"
+#include "StationStateStress.hpp"
+#include "TmcBenchmark.hpp"
+
+namespace
+{
+    const BenchmarkHarness::Benchmark BENCHMARKS[] =
+    {
+        { "arbiter", &BusArbiterBenchmark::report, "Runs tune, RDS, sensor and scan clients on a simulated shared bus for param (default 5) seconds, behind a mutex and behind the arbiter"},
+        { "async", &AsyncBenchmark::report, "Compares param (default 100) simulated tune/PS workflows run thread-per-operation and as coroutines"},
+        { "i2c", &I2cDevBenchmark::report, "Counts system calls and times status refreshes, inits and group reads through libmraa and i2c-dev, on simulated chips or on I2C bus param (re-initializes the radio)"},
+        { "log", &LogBenchmark::report, "Logs param (default 100000) command lines to /dev/null with an ostream and std::endl and through the asynchronous log, and compares the cost per command"},
+        { "poll", &PollingBenchmark::report, "Compares fixed 10 ms and adaptive polling on simulated stations for param (default 30) seconds per phase"},
+        { "rdspub", &RdsBrokerBenchmark::report, "Publishes synthetic RDS events to param (default 16) socket subscribers and reports the fan-out cost"},
+        { "scenario", &ScenarioBenchmark::report, "Runs param (default 1000000) simulated dense urban RDS groups through the generator and the driver/decoders and reports groups/s"},
+        { "shadow", &RegisterShadowBenchmark::report, "Stress tests the register shadow with param (default 4) concurrent readers and reports read throughput"},
+        { "statestress", &StationStateStress::report, "Reads the published station state from param (default 4) threads while it is republished flat out, and counts retried and torn reads"},
+        { "tmc", &TmcBenchmark::report, "Times TMC decoding of param synthetic messages, or of the recorded group log if no param"},
+    };
+}
+
+/**
+ * Usage: RDA5807M-bench <benchmark> [param]
+ * Lists the benchmarks if none is given.
+ */
+int main(int argc, char* argv[])
+{
+    return BenchmarkHarness::run(argc, argv, BENCHMARKS, sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]));
+}
@@ -0,0 +1,380 @@
+/**************************************************
+ * BusArbiterBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "ArbitratedBus.hpp"
+#include "BenchmarkHarness.hpp"
+#include "BusArbiter.hpp"
+#include "BusArbiterBenchmark.hpp"
+#include "PollingController.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
+#include "SimulatedBus.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    // On a 100 kHz bus
+    const uint32_t READ_WIRE_US = PollingController::BITS_PER_READ * 1000000ULL /
+                                  PollingController::DEFAULT_I2C_CLOCK_HZ;
+    const uint32_t WRITE_WIRE_US = PollingController::BITS_PER_WRITE * 1000000ULL /
+                                   PollingController::DEFAULT_I2C_CLOCK_HZ;
+
+    // Start, address and stop, then nine bits per byte
+    const uint32_t SEQUENTIAL_WRITE_OVERHEAD_BITS = 11;
+
+    // The sensor is read like a radio register: two bytes behind a
+    // register address
+    const uint32_t SENSOR_READ_WIRE_US = READ_WIRE_US;
+
+    struct SharedBus
+    {
+        std::atomic<bool> stop{false};
+
+        // Set once the radios have powered up; only then are operations
+        // counted
+        std::atomic<bool> measuring{false};
+        std::atomic<uint64_t> wireUs{0};
+
+        // One of these guards the bus, depending on the run
+        std::mutex mutex;
+        BusArbiter arbiter;
+        bool arbitrated = false;
+    };
+
+    void holdBusFor(SharedBus& shared, uint32_t wireUs)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(wireUs));
+        shared.wireUs.fetch_add(wireUs, std::memory_order_relaxed);
+    }
+
+    /**
+     * A simulated chip whose transactions take as long as on the wire
+     */
+    class TimedBus : public RDA5807MBus
+    {
+    public:
+        TimedBus(RDA5807MBus& busParam, SharedBus& sharedParam) : bus(busParam), shared(sharedParam)
+        {
+        }
+
+        bool writeRegister(uint8_t reg, uint16_t value) override
+        {
+            holdBusFor(shared, WRITE_WIRE_US);
+            return bus.writeRegister(reg, value);
+        }
+
+        bool writeRegistersSequential(const uint16_t* values, uint8_t count) override
+        {
+            holdBusFor(shared, (SEQUENTIAL_WRITE_OVERHEAD_BITS + count * 18U) * 1000000ULL /
+                               PollingController::DEFAULT_I2C_CLOCK_HZ);
+            return bus.writeRegistersSequential(values, count);
+        }
+
+        bool readRegister(uint8_t reg, uint16_t& value) override
+        {
+            holdBusFor(shared, READ_WIRE_US);
+            return bus.readRegister(reg, value);
+        }
+
+    private:
+        RDA5807MBus& bus;
+        SharedBus& shared;
+    };
+
+    /**
+     * How a shared bus is usually protected: a lock around each transaction
+     */
+    class MutexBus : public RDA5807MBus
+    {
+    public:
+        MutexBus(RDA5807MBus& busParam, std::mutex& mutexParam) : bus(busParam), mutex(mutexParam)
+        {
+        }
+
+        bool writeRegister(uint8_t reg, uint16_t value) override
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            return bus.writeRegister(reg, value);
+        }
+
+        bool writeRegistersSequential(const uint16_t* values, uint8_t count) override
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            return bus.writeRegistersSequential(values, count);
+        }
+
+        bool readRegister(uint8_t reg, uint16_t& value) override
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            return bus.readRegister(reg, value);
+        }
+
+    private:
+        RDA5807MBus& bus;
+        std::mutex& mutex;
+    };
+
+    struct ClientSamples
+    {
+        std::vector<uint32_t> durationsUs;
+        uint64_t late = 0;
+    };
+
+    /**
+     * Repeats operation every periodUs (back to back if 0) until told to
+     * stop, timing each one
+     */
+    void runPaced(SharedBus& shared, uint32_t periodUs, ClientSamples& samples, const std::function<void()>& operation)
+    {
+        uint64_t dueUs = Util::getMonotonicTimeUs();
+        while (!shared.stop.load(std::memory_order_relaxed))
+        {
+            uint64_t startUs = Util::getMonotonicTimeUs();
+            if (startUs < dueUs)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(dueUs - startUs));
+                startUs = Util::getMonotonicTimeUs();
+            }
+
+            operation();
+
+            uint64_t endUs = Util::getMonotonicTimeUs();
+            bool measuring = shared.measuring.load(std::memory_order_relaxed);
+            if (measuring)
+            {
+                samples.durationsUs.push_back(static_cast<uint32_t>(endUs - startUs));
+            }
+            if (periodUs == 0)
+            {
+                continue;
+            }
+
+            dueUs += periodUs;
+            if (endUs > dueUs)
+            {
+                samples.late += measuring ? 1 : 0;
+                dueUs = endUs;
+            }
+        }
+    }
+
+    /**
+     * Drives a simulated radio on the shared bus, doing one kind of work
+     */
+    void runRadioClient(SharedBus& shared, BusArbiter::TrafficClass trafficClass, ClientSamples& samples)
+    {
+        BusArbiter::ClassScope busClass{trafficClass};
+
+        SimulatedBus simulatedBus;
+        simulatedBus.populateDemoBand();
+        TimedBus timedBus{simulatedBus, shared};
+
+        std::unique_ptr<RDA5807MBus> sharedBus;
+        if (shared.arbitrated)
+        {
+            sharedBus.reset(new ArbitratedBus(timedBus, shared.arbiter));
+        }
+        else
+        {
+            sharedBus.reset(new MutexBus(timedBus, shared.mutex));
+        }
+
+        RDA5807M radio{*sharedBus};
+        radio.setFrequencyKhz(98500);
+
+        if (trafficClass == BusArbiter::TrafficClass::USER_TUNE)
+        {
+            bool up = true;
+            runPaced(shared, BusArbiterBenchmark::USER_TUNE_PERIOD_US, samples, [&radio, &up]()
+            {
+                radio.setFrequencyKhz(up ? 101100 : 98500, false);
+                radio.setTune(true);
+                radio.readDeviceRegistersAndStoreLocally();
+                up = !up;
+            });
+        }
+        else if (trafficClass == BusArbiter::TrafficClass::RDS)
+        {
+            runPaced(shared, BusArbiterBenchmark::RDS_PERIOD_US, samples, [&radio]()
+            {
+                RDA5807M::RdsGroup group;
+                radio.readRdsGroup(group);
+            });
+        }
+        else
+        {
+            const ChannelPlanner& planner = radio.getChannelPlanner();
+            uint16_t channel = 0;
+            runPaced(shared, 0, samples, [&radio, &planner, &channel]()
+            {
+                radio.setFrequencyKhz(planner.getChannelTable()[channel], false);
+                radio.setTune(true);
+                radio.readDeviceRegistersAndStoreLocally();
+                channel = static_cast<uint16_t>((channel + 1) % planner.getChannelCount());
+            });
+        }
+    }
+
+    void runExternalClient(SharedBus& shared, ClientSamples& samples)
+    {
+        runPaced(shared, BusArbiterBenchmark::EXTERNAL_PERIOD_US, samples, [&shared]()
+        {
+            if (shared.arbitrated)
+            {
+                BusArbiter::Grant grant{shared.arbiter, BusArbiter::TrafficClass::EXTERNAL};
+                holdBusFor(shared, SENSOR_READ_WIRE_US);
+            }
+            else
+            {
+                std::lock_guard<std::mutex> guard(shared.mutex);
+                holdBusFor(shared, SENSOR_READ_WIRE_US);
+            }
+        });
+    }
+
+    BusArbiterBenchmark::ClientResult summarize(ClientSamples& samples)
+    {
+        BusArbiterBenchmark::ClientResult result = {};
+        std::vector<uint32_t>& durations = samples.durationsUs;
+        result.operations = durations.size();
+        result.lateOperations = samples.late;
+        if (durations.empty())
+        {
+            return result;
+        }
+
+        std::sort(durations.begin(), durations.end());
+        result.p50Us = durations[(durations.size() - 1) / 2];
+        result.p99Us = durations[(durations.size() - 1) * 99 / 100];
+        result.maxUs = durations.back();
+        return result;
+    }
+
+    void runClients(SharedBus& shared, uint32_t seconds, BusArbiterBenchmark::Measurement& measurement)
+    {
+        ClientSamples samples[BusArbiter::TRAFFIC_CLASS_COUNT];
+        std::vector<std::thread> threads;
+        for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+        {
+            BusArbiter::TrafficClass trafficClass = static_cast<BusArbiter::TrafficClass>(classIdx);
+            if (trafficClass == BusArbiter::TrafficClass::EXTERNAL)
+            {
+                threads.emplace_back(runExternalClient, std::ref(shared), std::ref(samples[classIdx]));
+            }
+            else
+            {
+                threads.emplace_back(runRadioClient, std::ref(shared), trafficClass, std::ref(samples[classIdx]));
+            }
+        }
+
+        // Leave out the radios powering up
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (shared.arbitrated)
+        {
+            shared.arbiter.resetStats();
+        }
+        uint64_t startUs = Util::getMonotonicTimeUs();
+        uint64_t wireStartUs = shared.wireUs.load();
+        shared.measuring.store(true);
+
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        shared.stop.store(true);
+        uint64_t elapsedUs = Util::getMonotonicTimeUs() - startUs;
+        uint64_t busyUs = shared.wireUs.load() - wireStartUs;
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+        {
+            measurement.clients[classIdx] = summarize(samples[classIdx]);
+        }
+        measurement.busUtilizationPpm = static_cast<uint32_t>(std::min<uint64_t>(busyUs * 1000000ULL / elapsedUs,
+                                                                                  1000000));
+    }
+}
+
+/**
+ * Runs the four clients for seconds behind a mutex, then for seconds
+ * behind the arbiter with its default rate limits
+ */
+BusArbiterBenchmark::Result BusArbiterBenchmark::run(uint32_t seconds)
+{
+    Result result = {};
+    result.seconds = seconds;
+
+    {
+        SharedBus shared;
+        runClients(shared, seconds, result.mutex);
+    }
+
+    {
+        SharedBus shared;
+        shared.arbitrated = true;
+        runClients(shared, seconds, result.arbitrated);
+        for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+        {
+            result.arbiterStats[classIdx] = shared.arbiter.getStats(static_cast<BusArbiter::TrafficClass>(classIdx));
+        }
+    }
+
+    return result;
+}
+
+/**
+ * seconds defaults to 5 for each guard
+ */
+std::string BusArbiterBenchmark::report(int seconds)
+{
+    Result result = run((seconds < 1) ? DEFAULT_SECONDS : static_cast<uint32_t>(seconds));
+
+    std::string output = "Client           Guard     ops   p50 us   p99 us   max us  late\n";
+    for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+    {
+        BusArbiter::TrafficClass trafficClass = static_cast<BusArbiter::TrafficClass>(classIdx);
+        const ClientResult* clients[] = { &result.mutex.clients[classIdx], &result.arbitrated.clients[classIdx] };
+        const char* guards[] = { "Mutex", "Arbiter" };
+        for (int guardIdx = 0; guardIdx < 2; ++guardIdx)
+        {
+            const ClientResult& client = *clients[guardIdx];
+            BenchmarkHarness::appendFormat(output, "%-16s %-7s %6llu %8llu %8llu %8llu %5llu\n",
+                                           BusArbiter::trafficClassToCString(trafficClass), guards[guardIdx],
+                                           static_cast<unsigned long long>(client.operations),
+                                           static_cast<unsigned long long>(client.p50Us),
+                                           static_cast<unsigned long long>(client.p99Us),
+                                           static_cast<unsigned long long>(client.maxUs),
+                                           static_cast<unsigned long long>(client.lateOperations));
+        }
+    }
+
+    BenchmarkHarness::appendFormat(output, "Bus use: mutex %u.%02u%%, arbiter %u.%02u%%\nArbiter grant waits, max us:",
+                                   result.mutex.busUtilizationPpm / 10000,
+                                   (result.mutex.busUtilizationPpm / 100) % 100,
+                                   result.arbitrated.busUtilizationPpm / 10000,
+                                   (result.arbitrated.busUtilizationPpm / 100) % 100);
+    for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+    {
+        BusArbiter::TrafficClass trafficClass = static_cast<BusArbiter::TrafficClass>(classIdx);
+        BenchmarkHarness::appendFormat(output, " %s %llu", BusArbiter::trafficClassToCString(trafficClass),
+                                       static_cast<unsigned long long>(result.arbiterStats[classIdx].maxWaitUs));
+    }
+    output.append("\n");
+    return output;
+}
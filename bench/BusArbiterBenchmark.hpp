@@ -0,0 +1,83 @@
+/**************************************************
+ * BusArbiterBenchmark.hpp - Latency of bus users sharing one I2C bus,
+ *                           with and without the arbiter
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSARBITERBENCHMARK_HPP
+#define BUSARBITERBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+#include "BusArbiter.hpp"
+
+/**
+ * Runs one client per traffic class against a shared bus, first behind a
+ * plain mutex taken per transaction and then behind a BusArbiter:
+ *
+ *   USER_TUNE        a tune and status read once a second
+ *   RDS              a status and group read every group period
+ *   EXTERNAL         a sensor read every 10 ms
+ *   BACKGROUND_SCAN  a sweep across the band, as fast as it is allowed
+ *
+ * The radios are simulated, but every transaction holds the bus for as
+ * long as it would take on a 100 kHz bus, so the clients really do queue
+ * for it. Each client measures its operations from start to finish.
+ */
+class BusArbiterBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_SECONDS = 5;
+
+    static const uint32_t USER_TUNE_PERIOD_US = 1000000;
+    static const uint32_t RDS_PERIOD_US = 87579;
+    static const uint32_t EXTERNAL_PERIOD_US = 10000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct ClientResult
+    {
+        uint64_t operations;
+        uint64_t p50Us;
+        uint64_t p99Us;
+        uint64_t maxUs;
+
+        // Operations that overran the client's period, so that it missed
+        // its next slot (never for the scan, which has no period)
+        uint64_t lateOperations;
+    };
+
+    struct Measurement
+    {
+        ClientResult clients[BusArbiter::TRAFFIC_CLASS_COUNT];
+
+        // Time the bus spent on transfers, in parts per million
+        uint32_t busUtilizationPpm;
+    };
+
+    struct Result
+    {
+        uint32_t seconds;
+        Measurement mutex;
+        Measurement arbitrated;
+
+        // Waits for a grant, as the arbiter saw them
+        BusArbiter::ClassStats arbiterStats[BusArbiter::TRAFFIC_CLASS_COUNT];
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t seconds = DEFAULT_SECONDS);
+
+    static std::string report(int seconds);
+};
+
+#endif  // ifndef BUSARBITERBENCHMARK_HPP
@@ -0,0 +1,327 @@
+/**************************************************
+ * I2cDevBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <fcntl.h>
+#include <functional>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <memory>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "I2cDevBenchmark.hpp"
+#include "I2cDevBus.hpp"
+#include "MraaBus.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
+#include "SimulatedBus.hpp"
+
+namespace
+{
+    const char* const OPERATION_TO_STRING[] = { "STATUS_REFRESH", "INIT", "GROUP_READ" };
+
+    /**
+     * Talks to a simulated chip, making the system calls libmraa makes for
+     * each transaction against /dev/null: an SMBus ioctl per register
+     * read, a write() per register write, and an address switch on either
+     * side of a sequential write
+     */
+    class FakeMraaBus : public RDA5807MBus
+    {
+    public:
+        explicit FakeMraaBus(RDA5807MBus& chipParam) : chip(chipParam), fd(open("/dev/null", O_RDWR | O_CLOEXEC)),
+                syscalls(0)
+        {
+        }
+
+        ~FakeMraaBus()
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        bool writeRegister(uint8_t reg, uint16_t value) override
+        {
+            uint8_t dataToWrite[3] = { reg, static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+            ++syscalls;
+            return write(fd, &dataToWrite[0], sizeof(dataToWrite)) == sizeof(dataToWrite) &&
+                   chip.writeRegister(reg, value);
+        }
+
+        bool writeRegistersSequential(const uint16_t* values, uint8_t count) override
+        {
+            syscalls += 3;
+            (void) ioctl(fd, I2C_SLAVE, RDA5807MBus::SEQUENTIAL_ACCESS_I2C_MODE_ADDR);
+            (void) write(fd, values, count * 2U);
+            (void) ioctl(fd, I2C_SLAVE, RDA5807MBus::RANDOM_ACCESS_I2C_MODE_ADDR);
+            return chip.writeRegistersSequential(values, count);
+        }
+
+        bool readRegister(uint8_t reg, uint16_t& value) override
+        {
+            union i2c_smbus_data data;
+            struct i2c_smbus_ioctl_data request = { I2C_SMBUS_READ, reg, I2C_SMBUS_WORD_DATA, &data };
+            ++syscalls;
+            (void) ioctl(fd, I2C_SMBUS, &request);
+            return chip.readRegister(reg, value);
+        }
+
+        uint64_t getSyscalls() const
+        {
+            return syscalls;
+        }
+
+    private:
+        RDA5807MBus& chip;
+        int fd;
+        uint64_t syscalls;
+    };
+
+    /**
+     * Counts the system calls libmraa makes on a real bus
+     */
+    class CountingBus : public RDA5807MBus
+    {
+    public:
+        explicit CountingBus(RDA5807MBus& busParam) : bus(busParam), syscalls(0)
+        {
+        }
+
+        bool writeRegister(uint8_t reg, uint16_t value) override
+        {
+            ++syscalls;
+            return bus.writeRegister(reg, value);
+        }
+
+        bool writeRegistersSequential(const uint16_t* values, uint8_t count) override
+        {
+            syscalls += 3;
+            return bus.writeRegistersSequential(values, count);
+        }
+
+        bool readRegister(uint8_t reg, uint16_t& value) override
+        {
+            ++syscalls;
+            return bus.readRegister(reg, value);
+        }
+
+        uint64_t getSyscalls() const
+        {
+            return syscalls;
+        }
+
+    private:
+        RDA5807MBus& bus;
+        uint64_t syscalls;
+    };
+
+    /**
+     * Makes every I2C_RDWR submission against /dev/null, where it fails
+     * but costs a real system call, then carries its messages out on a
+     * simulated chip
+     */
+    class FakeI2cDevBus : public I2cDevBus
+    {
+    public:
+        explicit FakeI2cDevBus(RDA5807MBus& chipParam) : I2cDevBus(open("/dev/null", O_RDWR | O_CLOEXEC), true),
+                chip(chipParam)
+        {
+        }
+
+    protected:
+        bool transfer(struct i2c_msg* messages, uint32_t count) override
+        {
+            struct i2c_rdwr_ioctl_data request = { messages, count };
+            (void) ioctl(fd, I2C_RDWR, &request);
+
+            bool succeeded = true;
+            for (uint32_t msgIdx = 0; msgIdx < count; ++msgIdx)
+            {
+                const struct i2c_msg& message = messages[msgIdx];
+                if (message.addr == RDA5807MBus::SEQUENTIAL_ACCESS_I2C_MODE_ADDR)
+                {
+                    uint16_t values[16];
+                    uint8_t valueCount = static_cast<uint8_t>(message.len / 2);
+                    for (uint8_t regIdx = 0; regIdx < valueCount; ++regIdx)
+                    {
+                        values[regIdx] = static_cast<uint16_t>((message.buf[regIdx * 2] << 8) |
+                                                               message.buf[regIdx * 2 + 1]);
+                    }
+                    succeeded = chip.writeRegistersSequential(values, valueCount) && succeeded;
+                }
+                else if (message.len == 1 && msgIdx + 1 < count && (messages[msgIdx + 1].flags & I2C_M_RD) != 0)
+                {
+                    // Register address, then the read it selects
+                    uint16_t value = 0;
+                    succeeded = chip.readRegister(message.buf[0], value) && succeeded;
+                    messages[msgIdx + 1].buf[0] = static_cast<uint8_t>(value >> 8);
+                    messages[msgIdx + 1].buf[1] = static_cast<uint8_t>(value);
+                    ++msgIdx;
+                }
+                else if (message.len == 3)
+                {
+                    succeeded = chip.writeRegister(message.buf[0],
+                                                   static_cast<uint16_t>((message.buf[1] << 8) | message.buf[2])) &&
+                                succeeded;
+                }
+            }
+            return succeeded;
+        }
+
+    private:
+        RDA5807MBus& chip;
+    };
+
+    /**
+     * Times iterations of each operation on a radio behind bus, counting
+     * system calls with getSyscalls
+     */
+    I2cDevBenchmark::Measurement measure(RDA5807MBus& bus, uint32_t iterations,
+                                         const std::function<uint64_t()>& getSyscalls)
+    {
+        I2cDevBenchmark::Measurement measurement = {};
+        RDA5807M radio{bus};
+        radio.setFrequencyKhz(98500);
+        measurement.succeeded = (radio.getBusStats().writeErrors == 0);
+
+        for (uint8_t opIdx = 0; opIdx < I2cDevBenchmark::OPERATION_COUNT; ++opIdx)
+        {
+            I2cDevBenchmark::Operation operation = static_cast<I2cDevBenchmark::Operation>(opIdx);
+            uint64_t startSyscalls = getSyscalls();
+            uint64_t startNs = BenchmarkHarness::nowNs();
+            for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+            {
+                if (operation == I2cDevBenchmark::Operation::STATUS_REFRESH)
+                {
+                    radio.readDeviceRegistersAndStoreLocally();
+                }
+                else if (operation == I2cDevBenchmark::Operation::INIT)
+                {
+                    radio.reset();
+                }
+                else
+                {
+                    RDA5807M::RdsGroup group;
+                    radio.readRdsGroup(group);
+                }
+            }
+            uint64_t elapsedNs = BenchmarkHarness::nowNs() - startNs;
+
+            uint64_t syscalls = getSyscalls() - startSyscalls;
+            measurement.operations[opIdx].syscalls = static_cast<uint32_t>((syscalls + iterations / 2) / iterations);
+            measurement.operations[opIdx].wallNs = elapsedNs / iterations;
+
+            if (operation == I2cDevBenchmark::Operation::INIT)
+            {
+                // Back to the station, for the group reads
+                radio.setFrequencyKhz(98500);
+            }
+        }
+
+        RDA5807M::BusStats stats = radio.getBusStats();
+        measurement.succeeded = measurement.succeeded && stats.readErrors == 0 && stats.writeErrors == 0;
+        return measurement;
+    }
+}
+
+/**
+ * Measures both buses against simulated chips if busNumber is negative,
+ * otherwise against the radio on /dev/i2c-busNumber
+ */
+I2cDevBenchmark::Result I2cDevBenchmark::run(int busNumber)
+{
+    Result result = {};
+    result.busNumber = busNumber;
+
+    if (busNumber < 0)
+    {
+        result.iterations = SIMULATED_ITERATIONS;
+
+        // A stepped clock, so a group is always waiting
+        SimulatedBus mraaChip;
+        mraaChip.populateDemoBand();
+        mraaChip.getClock().setSpeedUp(0);
+        FakeMraaBus mraaBus{mraaChip};
+        result.mraa = measure(mraaBus, result.iterations, [&mraaBus]() { return mraaBus.getSyscalls(); });
+
+        SimulatedBus i2cDevChip;
+        i2cDevChip.populateDemoBand();
+        i2cDevChip.getClock().setSpeedUp(0);
+        FakeI2cDevBus i2cDevBus{i2cDevChip};
+        result.i2cDev = measure(i2cDevBus, result.iterations, [&i2cDevBus]() { return i2cDevBus.getStats().syscalls; });
+        result.combinedTransfers = i2cDevBus.hasCombinedTransfers();
+        return result;
+    }
+
+    result.iterations = HARDWARE_ITERATIONS;
+    {
+        MraaBus mraaBus{busNumber};
+        CountingBus countingBus{mraaBus};
+        result.mraa = measure(countingBus, result.iterations, [&countingBus]() { return countingBus.getSyscalls(); });
+    }
+
+    I2cDevBus i2cDevBus{busNumber};
+    if (i2cDevBus.isOpen())
+    {
+        result.i2cDev = measure(i2cDevBus, result.iterations, [&i2cDevBus]() { return i2cDevBus.getStats().syscalls; });
+        result.combinedTransfers = i2cDevBus.hasCombinedTransfers();
+    }
+    return result;
+}
+
+/**
+ * Runs against simulated chips unless busNumber names the I2C bus of a
+ * radio, which is then initialized again
+ */
+std::string I2cDevBenchmark::report(int busNumber)
+{
+    Result result = run(busNumber);
+
+    std::string output;
+    if (result.busNumber < 0)
+    {
+        BenchmarkHarness::appendFormat(output, "Simulated chips, %u iterations per operation\n", result.iterations);
+    }
+    else
+    {
+        BenchmarkHarness::appendFormat(output, "I2C bus %d, %u iterations per operation%s\n", result.busNumber,
+                                       result.iterations,
+                                       (result.combinedTransfers || !result.i2cDev.succeeded)
+                                           ? "" : " (i2c-dev adapter is SMBus only)");
+    }
+
+    output.append("Operation        Bus      syscalls    ns/op\n");
+    for (uint8_t opIdx = 0; opIdx < OPERATION_COUNT; ++opIdx)
+    {
+        const Measurement* measurements[] = { &result.mraa, &result.i2cDev };
+        const char* buses[] = { "mraa", "i2c-dev" };
+        for (int busIdx = 0; busIdx < 2; ++busIdx)
+        {
+            const OperationCost& cost = measurements[busIdx]->operations[opIdx];
+            BenchmarkHarness::appendFormat(output, "%-16s %-8s %8u %8llu\n",
+                                           operationToCString(static_cast<Operation>(opIdx)), buses[busIdx],
+                                           cost.syscalls, static_cast<unsigned long long>(cost.wallNs));
+        }
+    }
+
+    if (!result.mraa.succeeded || !result.i2cDev.succeeded)
+    {
+        BenchmarkHarness::appendFormat(output, "Transfers failed: mraa %s, i2c-dev %s\n",
+                                       result.mraa.succeeded ? "no" : "yes", result.i2cDev.succeeded ? "no" : "yes");
+    }
+    return output;
+}
+
+const char* I2cDevBenchmark::operationToCString(Operation operation)
+{
+    return OPERATION_TO_STRING[static_cast<int>(operation)];
+}
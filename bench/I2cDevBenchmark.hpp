@@ -0,0 +1,81 @@
+/**************************************************
+ * I2cDevBenchmark.hpp - System calls and time per driver operation,
+ *                       through libmraa and through i2c-dev
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef I2CDEVBENCHMARK_HPP
+#define I2CDEVBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Runs the driver's common operations through a bus that talks to the
+ * chip the way libmraa does, one system call per register, and through
+ * I2cDevBus, and counts the system calls and times each operation.
+ *
+ * Without hardware, both buses talk to a simulated chip, but every
+ * system call they would have made is still made, against /dev/null, so
+ * that its cost is counted. On hardware, both run on the given bus, and
+ * the radio is initialized again in the process.
+ */
+class I2cDevBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t SIMULATED_ITERATIONS = 20000;
+    static const uint32_t HARDWARE_ITERATIONS = 200;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Operation {STATUS_REFRESH = 0, INIT = 1, GROUP_READ = 2};
+    static const uint8_t OPERATION_COUNT = 3;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct OperationCost
+    {
+        // Per operation
+        uint32_t syscalls;
+        uint64_t wallNs;
+    };
+
+    struct Measurement
+    {
+        OperationCost operations[OPERATION_COUNT];
+        bool succeeded;
+    };
+
+    struct Result
+    {
+        // -1 if simulated
+        int busNumber;
+        uint32_t iterations;
+
+        Measurement mraa;
+        Measurement i2cDev;
+
+        // False if the i2c-dev adapter only does SMBus
+        bool combinedTransfers;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(int busNumber = -1);
+
+    static std::string report(int busNumber);
+
+    static const char* operationToCString(Operation operation);
+};
+
+#endif  // ifndef I2CDEVBENCHMARK_HPP
@@ -0,0 +1,113 @@
+/**************************************************
+ * LogBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "Log.hpp"
+#include "LogBenchmark.hpp"
+
+namespace
+{
+    const char* const COMMANDS[] = { "FREQ", "RDSACQUIRE", "STATUS", "VOL" };
+    const uint8_t COMMAND_NAME_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);}
+
+LogBenchmark::Result LogBenchmark::run(uint32_t commandCount)
+{
+    Result result = {};
+    result.commandCount = commandCount;
+    if (commandCount == 0)
+    {
+        return result;
+    }
+
+    // The parser's commands are std::strings
+    std::string commands[COMMAND_NAME_COUNT];
+    for (uint8_t cmdIdx = 0; cmdIdx < COMMAND_NAME_COUNT; ++cmdIdx)
+    {
+        commands[cmdIdx] = COMMANDS[cmdIdx];
+    }
+
+    {
+        std::ofstream stream("/dev/null");
+        uint64_t startNs = BenchmarkHarness::nowNs();
+        for (uint32_t cmdIdx = 0; cmdIdx < commandCount; ++cmdIdx)
+        {
+            stream << "Executing: " << commands[cmdIdx % COMMAND_NAME_COUNT] << "(" << static_cast<int>(cmdIdx) << ")"
+                   << std::endl;
+        }
+        result.streamNs = (BenchmarkHarness::nowNs() - startNs) / commandCount;
+        result.streamWrites = commandCount;
+    }
+
+    FILE* devNull = std::fopen("/dev/null", "w");
+    if (devNull == nullptr)
+    {
+        return result;
+    }
+
+    {
+        Log log{devNull};
+        uint64_t loggingNs = 0;
+        uint64_t flushNs = 0;
+        for (uint32_t first = 0; first < commandCount; first += BURST_COMMANDS)
+        {
+            uint32_t last = (commandCount - first < BURST_COMMANDS) ? commandCount : first + BURST_COMMANDS;
+            uint64_t startNs = BenchmarkHarness::nowNs();
+            for (uint32_t cmdIdx = first; cmdIdx < last; ++cmdIdx)
+            {
+                log.info("Executing: %s(%d)", commands[cmdIdx % COMMAND_NAME_COUNT].c_str(), static_cast<int>(cmdIdx));
+            }
+            uint64_t loggedNs = BenchmarkHarness::nowNs();
+            log.flush();
+            loggingNs += loggedNs - startNs;
+            flushNs += BenchmarkHarness::nowNs() - loggedNs;
+        }
+
+        uint64_t startNs = BenchmarkHarness::nowNs();
+        for (uint32_t cmdIdx = 0; cmdIdx < commandCount; ++cmdIdx)
+        {
+            log.debug("Executing: %s(%d)", commands[cmdIdx % COMMAND_NAME_COUNT].c_str(), static_cast<int>(cmdIdx));
+        }
+        result.filteredNs = (BenchmarkHarness::nowNs() - startNs) / commandCount;
+
+        Log::Stats stats = log.getStats();
+        result.asyncNs = loggingNs / commandCount;
+        result.writerNs = flushNs / commandCount;
+        result.asyncWrites = stats.batchesWritten;
+        result.recordsDropped = stats.recordsDropped;
+    }
+
+    std::fclose(devNull);
+    return result;
+}
+
+/**
+ * commandCount defaults to 100000
+ */
+std::string LogBenchmark::report(int commandCount)
+{
+    Result result = run((commandCount < 1) ? DEFAULT_COMMAND_COUNT : static_cast<uint32_t>(commandCount));
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Commands logged: %u\n", result.commandCount);
+    BenchmarkHarness::appendFormat(output, "ostream + endl: %llu ns/command, %llu write() calls\n",
+                                   static_cast<unsigned long long>(result.streamNs),
+                                   static_cast<unsigned long long>(result.streamWrites));
+    BenchmarkHarness::appendFormat(output, "Async log: %llu ns/command, %llu write() calls, %llu dropped\n",
+                                   static_cast<unsigned long long>(result.asyncNs),
+                                   static_cast<unsigned long long>(result.asyncWrites),
+                                   static_cast<unsigned long long>(result.recordsDropped));
+    BenchmarkHarness::appendFormat(output, "Async log writer: %llu ns/record, on its own thread\n",
+                                   static_cast<unsigned long long>(result.writerNs));
+    BenchmarkHarness::appendFormat(output, "Filtered out at compile time: %llu ns/call\n",
+                                   static_cast<unsigned long long>(result.filteredNs));
+    return output;
+}
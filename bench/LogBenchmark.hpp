@@ -0,0 +1,66 @@
+/**************************************************
+ * LogBenchmark.hpp - Cost of logging a command, synchronously and
+ *                    through the asynchronous log
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef LOGBENCHMARK_HPP
+#define LOGBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Logs the "Executing: <command>(<param>)" line the command parser writes
+ * for every command, the way it used to (an ostream and std::endl, so a
+ * flush and a write() per line) and through a Log, both to /dev/null.
+ * Commands are logged in bursts, with the log flushed in between, so
+ * that the queue never overflows; only the logging calls are timed on the
+ * command side, and the flushes give the writer's cost.
+ */
+class LogBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_COMMAND_COUNT = 100000;
+    static const uint32_t BURST_COMMANDS = 1000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Result
+    {
+        uint32_t commandCount;
+
+        // On the command's thread, per command
+        uint64_t streamNs;
+        uint64_t asyncNs;
+
+        // A call below the compiled level
+        uint64_t filteredNs;
+
+        // On the writer's thread, per record
+        uint64_t writerNs;
+
+        // write() calls made
+        uint64_t streamWrites;
+        uint64_t asyncWrites;
+
+        uint64_t recordsDropped;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t commandCount = DEFAULT_COMMAND_COUNT);
+
+    static std::string report(int commandCount);
+};
+
+#endif  // ifndef LOGBENCHMARK_HPP
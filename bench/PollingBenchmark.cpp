@@ -0,0 +1,210 @@
+/**************************************************
+ * PollingBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "PollingBenchmark.hpp"
+#include "PollingController.hpp"
+#include "RDA5807M.hpp"
+#include "Scenario.hpp"
+#include "SimulatedBus.hpp"
+
+namespace
+{
+    const uint32_t STEADY_STATION_KHZ = 98500;
+    const uint32_t FADING_STATION_KHZ = 101100;
+
+    const uint32_t PHASE_STATIONS_KHZ[PollingBenchmark::PHASE_COUNT] = { STEADY_STATION_KHZ, FADING_STATION_KHZ,
+                                                                         STEADY_STATION_KHZ };
+
+    Scenario makeScenario()
+    {
+        Scenario scenario;
+
+        Scenario::Station steady = Scenario::makeStation(STEADY_STATION_KHZ, 55, 0x1A06, 10, "STEADY");
+        std::snprintf(steady.radioText, sizeof(steady.radioText), "Steady Artist - Steady Title");
+        steady.groupMix[static_cast<uint8_t>(Scenario::GroupKind::RADIO_TEXT)] = 1;
+        steady.rssi.noise = 2;
+        steady.errors.corrected = 20;
+        scenario.addStation(steady);
+
+        // Drops 30 dB within a second and a half, to well below the point
+        // where blocks start getting lost
+        Scenario::Station fading = Scenario::makeStation(FADING_STATION_KHZ, 45, 0x1A07, 5, "FADING");
+        fading.rssi.fadeDepth = 30;
+        fading.rssi.fadePeriodMs = 3000;
+        fading.rssi.noise = 3;
+        fading.errors.corrected = 40;
+        scenario.addStation(fading);
+
+        return scenario;
+    }
+
+    void tune(RDA5807M& radio, uint32_t frequencyKhz)
+    {
+        radio.setFrequencyKhz(frequencyKhz, false);
+        radio.setTune(true);
+    }
+
+    // Fills in what happened on the bus between before and now
+    void finishMeasurement(PollingBenchmark::Measurement& measurement, const RDA5807M::BusStats& busBefore,
+                           const SimulatedBus::Stats& groupsBefore, RDA5807M& radio, SimulatedBus& bus,
+                           uint64_t durationUs)
+    {
+        RDA5807M::BusStats busAfter = radio.getBusStats();
+        measurement.busReads = busAfter.reads - busBefore.reads;
+        measurement.busWrites = busAfter.writes - busBefore.writes;
+        measurement.groupsReceived = bus.getStats().groupsReceived - groupsBefore.groupsReceived;
+        measurement.groupsLost = bus.getStats().groupsLost - groupsBefore.groupsLost;
+
+        uint64_t busBits = measurement.busReads * PollingController::BITS_PER_READ +
+                           measurement.busWrites * PollingController::BITS_PER_WRITE;
+        uint64_t busTimeUs = busBits * 1000000ULL / PollingController::DEFAULT_I2C_CLOCK_HZ;
+        measurement.busUtilizationPpm = static_cast<uint32_t>(busTimeUs * 1000000ULL / durationUs);
+    }
+}
+
+/**
+ * Runs both pollers through both phases, phaseSeconds of simulated time
+ * each
+ */
+PollingBenchmark::Result PollingBenchmark::run(uint32_t phaseSeconds)
+{
+    Result result = {};
+    result.phaseSeconds = phaseSeconds;
+    uint64_t phaseUs = static_cast<uint64_t>(phaseSeconds) * 1000000ULL;
+    Scenario scenario = makeScenario();
+
+    // Fixed rate: read a group, if there is one, every 10 ms
+    {
+        std::unique_ptr<SimulatedBus> bus{new SimulatedBus()};
+        bus->setScenario(scenario);
+        bus->getClock().setSpeedUp(0);
+        bus->setSkipToEvents(false);
+        RDA5807M radio{*bus};
+        SimulationClock& clock = bus->getClock();
+
+        for (uint8_t phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            RDA5807M::BusStats busBefore = radio.getBusStats();
+            SimulatedBus::Stats groupsBefore = bus->getStats();
+            tune(radio, PHASE_STATIONS_KHZ[phase]);
+
+            Measurement& measurement = result.fixed[phase];
+            uint64_t endUs = clock.nowUs() + phaseUs;
+            for (uint64_t pollUs = clock.nowUs(); pollUs < endUs; pollUs += FIXED_POLL_INTERVAL_US)
+            {
+                clock.advanceTo(pollUs);
+                RDA5807M::RdsGroup group;
+                if (radio.readRdsGroup(group))
+                {
+                    ++measurement.groupsRead;
+                }
+            }
+            clock.advanceTo(endUs);
+            finishMeasurement(measurement, busBefore, groupsBefore, radio, *bus, phaseUs);
+        }
+    }
+
+    // Adaptive
+    {
+        std::unique_ptr<SimulatedBus> bus{new SimulatedBus()};
+        bus->setScenario(scenario);
+        bus->getClock().setSpeedUp(0);
+        bus->setSkipToEvents(false);
+        RDA5807M radio{*bus};
+        SimulationClock& clock = bus->getClock();
+        PollingController controller{radio};
+        controller.reset(clock.nowUs());
+
+        for (uint8_t phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            RDA5807M::BusStats busBefore = radio.getBusStats();
+            SimulatedBus::Stats groupsBefore = bus->getStats();
+            tune(radio, PHASE_STATIONS_KHZ[phase]);
+            controller.setRdsWanted(phase != static_cast<uint8_t>(Phase::IDLE));
+            controller.restart();
+
+            Measurement& measurement = result.adaptive[phase];
+            uint64_t endUs = clock.nowUs() + phaseUs;
+            uint64_t pollUs = clock.nowUs();
+            while (pollUs < endUs)
+            {
+                clock.advanceTo(pollUs);
+                RDA5807M::RdsGroup group;
+                bool groupRead = false;
+                pollUs += controller.poll(pollUs, group, groupRead);
+                if (groupRead)
+                {
+                    ++measurement.groupsRead;
+                }
+            }
+            clock.advanceTo(endUs);
+            finishMeasurement(measurement, busBefore, groupsBefore, radio, *bus, phaseUs);
+        }
+        result.controller = controller.getStats(clock.nowUs());
+    }
+
+    return result;
+}
+
+/**
+ * phaseSeconds defaults to 30. Bus use is the share of the simulated time
+ * the bus was busy.
+ */
+std::string PollingBenchmark::report(int phaseSeconds)
+{
+    Result result = run((phaseSeconds < 1) ? DEFAULT_PHASE_SECONDS : static_cast<uint32_t>(phaseSeconds));
+
+    std::string output = "Phase   Poller      reads  writes  bus use  groups rx/read/lost\n";
+    for (uint8_t phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        const Measurement* measurements[] = { &result.fixed[phase], &result.adaptive[phase] };
+        const char* pollers[] = { "Fixed 10ms", "Adaptive" };
+        for (int pollerIdx = 0; pollerIdx < 2; ++pollerIdx)
+        {
+            const Measurement& measurement = *measurements[pollerIdx];
+            BenchmarkHarness::appendFormat(output, "%-7s %-10s %7llu %7llu %3u.%02u%%  %llu/%llu/%llu\n",
+                                           phaseToCString(static_cast<Phase>(phase)), pollers[pollerIdx],
+                                           static_cast<unsigned long long>(measurement.busReads),
+                                           static_cast<unsigned long long>(measurement.busWrites),
+                                           measurement.busUtilizationPpm / 10000,
+                                           (measurement.busUtilizationPpm / 100) % 100,
+                                           static_cast<unsigned long long>(measurement.groupsReceived),
+                                           static_cast<unsigned long long>(measurement.groupsRead),
+                                           static_cast<unsigned long long>(measurement.groupsLost));
+        }
+    }
+
+    BenchmarkHarness::appendFormat(output, "Adaptive escalations: %u\nTime per mode (ms):",
+                                   result.controller.escalations);
+    for (uint8_t modeIdx = 0; modeIdx < PollingController::MODE_COUNT; ++modeIdx)
+    {
+        PollingController::Mode mode = static_cast<PollingController::Mode>(modeIdx);
+        BenchmarkHarness::appendFormat(output, " %s %llu", PollingController::modeToCString(mode),
+                                       static_cast<unsigned long long>(result.controller.timeInModeUs[modeIdx] / 1000));
+    }
+    output.append("\n");
+    return output;
+}
+
+const char* PollingBenchmark::phaseToCString(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::STEADY:
+            return "Steady";
+        case Phase::FADING:
+            return "Fading";
+        default:
+            return "Idle";
+    }
+}
@@ -0,0 +1,79 @@
+/**************************************************
+ * PollingBenchmark.hpp - Bus load and group loss of fixed-rate and
+ *                        adaptive status polling
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef POLLINGBENCHMARK_HPP
+#define POLLINGBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+#include "PollingController.hpp"
+
+/**
+ * Listens to a simulated station twice, once polling every 10 ms as
+ * acquireRds() used to and once with PollingController, and compares the
+ * I2C traffic and the RDS groups each got. Each run has three phases: a
+ * steady strong station, one with deep, fast fading that should make the
+ * controller escalate, and the steady station again with RDS not wanted,
+ * as when just listening. The fixed-rate poller can't tell the phases
+ * apart; the controller drops to keep-alive reads in the last one and
+ * leaves the groups unread. The simulation runs on a stepped clock
+ * driven by the poller, so a run takes milliseconds whatever its length.
+ */
+class PollingBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_PHASE_SECONDS = 30;
+    static const uint32_t FIXED_POLL_INTERVAL_US = 10000;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Phase {STEADY = 0, FADING = 1, IDLE = 2};
+    static const uint8_t PHASE_COUNT = 3;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Measurement
+    {
+        uint64_t busReads;
+        uint64_t busWrites;
+        uint32_t busUtilizationPpm;
+
+        // Received by the simulated chip, read by the poller, and
+        // overwritten before the poller got to them
+        uint64_t groupsReceived;
+        uint64_t groupsRead;
+        uint64_t groupsLost;
+    };
+
+    struct Result
+    {
+        uint32_t phaseSeconds;
+        Measurement fixed[PHASE_COUNT];
+        Measurement adaptive[PHASE_COUNT];
+
+        // The adaptive run as the controller saw it
+        PollingController::Stats controller;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t phaseSeconds = DEFAULT_PHASE_SECONDS);
+
+    static std::string report(int phaseSeconds);
+
+    static const char* phaseToCString(Phase phase);
+};
+
+#endif  // ifndef POLLINGBENCHMARK_HPP
@@ -0,0 +1,266 @@
+/**************************************************
+ * RdsBrokerBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "RDA5807M.hpp"
+#include "RdsBrokerBenchmark.hpp"
+#include "RdsDecoder.hpp"
+#include "RdsEventBroker.hpp"
+#include "RdsEventProtocol.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    const uint16_t BENCHMARK_PI_CODE = 0x1234;
+
+    /**
+     * Connects and subscribes. Subscribers cycle through three filters:
+     * everything, decoded events only, and one PI's group 0A only.
+     */
+    int connectSubscriber(const char* path, uint32_t subscriberIdx)
+    {
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        struct sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+
+        RdsEventProtocol::SubscribeRequest request;
+        std::memset(&request, 0, sizeof(request));
+        request.magic = RdsEventProtocol::SUBSCRIBE_MAGIC;
+        request.protocolVersion = RdsEventProtocol::PROTOCOL_VERSION;
+        request.eventMask = RdsEventProtocol::EVENT_MASK_ALL;
+        request.piCode = RdsEventProtocol::ANY_PI_CODE;
+        request.groupTypeMask = 0xFFFFFFFF;
+
+        switch (subscriberIdx % 3)
+        {
+            case 1:
+                request.eventMask = RdsEventProtocol::EVENT_MASK_ALL & ~RdsEventProtocol::EVENT_MASK_GROUP;
+                break;
+            case 2:
+                request.piCode = BENCHMARK_PI_CODE;
+                request.groupTypeMask = 1;
+                break;
+            default:
+                break;
+        }
+
+        send(fd, &request, sizeof(request), MSG_NOSIGNAL);
+        return fd;
+    }
+
+    void readSubscriber(int fd, const std::atomic<bool>& stop, std::atomic<uint64_t>& received)
+    {
+        RdsEventProtocol::Event events[RdsEventBroker::SEND_BATCH + 1];
+        struct pollfd pfd = { fd, POLLIN, 0 };
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (poll(&pfd, 1, 20) <= 0)
+            {
+                continue;
+            }
+
+            ssize_t bytes = recv(fd, events, sizeof(events), 0);
+            if (bytes <= 0)
+            {
+                break;
+            }
+            received.fetch_add(static_cast<uint64_t>(bytes) / sizeof(RdsEventProtocol::Event),
+                               std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Group sequenceIdx of a synthetic station sending 0A and 2A groups.
+     * The PS and RT change every few hundred groups.
+     */
+    RDA5807M::RdsGroup makeGroup(uint32_t sequenceIdx)
+    {
+        RDA5807M::RdsGroup group;
+        group.errorsA = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.errorsB = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.blocks[0] = BENCHMARK_PI_CODE;
+
+        uint32_t generation = sequenceIdx / 500;
+        char text[RdsDecoder::RT_LENGTH + 1];
+        std::snprintf(text, sizeof(text), "BENCH%03u Radio text number %u for the broker benchmark\r",
+                      generation % 1000, generation);
+
+        if (sequenceIdx % 2 == 0)
+        {
+            uint16_t segment = (sequenceIdx / 2) % 4;
+            group.blocks[1] = static_cast<uint16_t>(0x0000 | segment);
+            group.blocks[2] = 0;
+            group.blocks[3] = static_cast<uint16_t>((text[segment * 2] << 8) | text[segment * 2 + 1]);
+        }
+        else
+        {
+            uint16_t segment = (sequenceIdx / 2) % 16;
+            group.blocks[1] = static_cast<uint16_t>(0x2000 | ((generation & 1) << 4) | segment);
+            group.blocks[2] = static_cast<uint16_t>((text[segment * 4] << 8) | text[segment * 4 + 1]);
+            group.blocks[3] = static_cast<uint16_t>((text[segment * 4 + 2] << 8) | text[segment * 4 + 3]);
+        }
+
+        return group;
+    }
+}
+
+RdsBrokerBenchmark::Result RdsBrokerBenchmark::run(uint32_t subscriberCount, uint32_t groupCount)
+{
+    Result result;
+    std::memset(&result, 0, sizeof(result));
+    result.subscribers = subscriberCount;
+    result.groups = groupCount;
+
+    char path[64];
+    std::snprintf(path, sizeof(path), "/tmp/rda5807m_rds_bench.%d.sock", static_cast<int>(getpid()));
+
+    // The ring is too big for the stack
+    std::unique_ptr<RdsEventBroker> broker{new RdsEventBroker()};
+    if (!broker->open(path) || subscriberCount > RdsEventBroker::MAX_SUBSCRIBERS)
+    {
+        return result;
+    }
+
+    std::vector<int> fds;
+    for (uint32_t idx = 0; idx < subscriberCount; ++idx)
+    {
+        fds.push_back(connectSubscriber(path, idx));
+    }
+
+    // Let the broker accept everyone and read their filters
+    for (int attempt = 0; attempt < 10; ++attempt)
+    {
+        broker->service();
+        usleep(10000);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> received{0};
+    std::vector<std::thread> readers;
+
+    // Subscriber 0 is the stalled one
+    for (uint32_t idx = 1; idx < subscriberCount; ++idx)
+    {
+        readers.emplace_back(readSubscriber, fds[idx], std::cref(stop), std::ref(received));
+    }
+
+    RdsDecoder decoder;
+    uint64_t totalNs = 0;
+    uint64_t start = Util::getMonotonicTimeUs();
+
+    for (uint32_t groupIdx = 0; groupIdx < groupCount; ++groupIdx)
+    {
+        RDA5807M::RdsGroup group = makeGroup(groupIdx);
+        decoder.processGroup(group);
+
+        uint64_t before = BenchmarkHarness::nowNs();
+        broker->publish(group, decoder);
+        broker->service();
+        uint64_t elapsedNs = BenchmarkHarness::nowNs() - before;
+
+        totalNs += elapsedNs;
+        if (elapsedNs / 1000 > result.maxPublishUs)
+        {
+            result.maxPublishUs = elapsedNs / 1000;
+        }
+    }
+
+    result.wallTimeUs = Util::getMonotonicTimeUs() - start;
+
+    // Give the readers a moment to drain what was sent
+    for (int attempt = 0; attempt < 20; ++attempt)
+    {
+        broker->service();
+        usleep(10000);
+    }
+
+    stop = true;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    RdsEventBroker::Stats stats = broker->getStats();
+    result.eventsPublished = stats.eventsPublished;
+    result.eventsDelivered = stats.eventsDelivered;
+    result.eventsDropped = stats.eventsDropped;
+    result.eventsReceived = received.load();
+    result.meanPublishNs = groupCount > 0 ? totalNs / groupCount : 0;
+
+    broker->close();
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * subscriberCount defaults to 16, one of which never reads
+ */
+std::string RdsBrokerBenchmark::report(int subscriberCount)
+{
+    if (subscriberCount < 1)
+    {
+        subscriberCount = DEFAULT_SUBSCRIBER_COUNT;
+    }
+    else if (subscriberCount > RdsEventBroker::MAX_SUBSCRIBERS)
+    {
+        return "Too many subscribers\n";
+    }
+
+    Result result = run(static_cast<uint32_t>(subscriberCount));
+    if (result.eventsPublished == 0)
+    {
+        return "Unable to open benchmark socket\n";
+    }
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Subscribers: %u (1 stalled)\nGroups: %u in %llu ms\n",
+                                   result.subscribers, result.groups,
+                                   static_cast<unsigned long long>(result.wallTimeUs / 1000));
+    BenchmarkHarness::appendFormat(output, "Publish + service per group: mean %llu ns, max %llu us\n",
+                                   static_cast<unsigned long long>(result.meanPublishNs),
+                                   static_cast<unsigned long long>(result.maxPublishUs));
+    BenchmarkHarness::appendFormat(output, "Events published: %llu\nEvents delivered: %llu (%llu received)\n"
+                                           "Events dropped: %llu\n",
+                                   static_cast<unsigned long long>(result.eventsPublished),
+                                   static_cast<unsigned long long>(result.eventsDelivered),
+                                   static_cast<unsigned long long>(result.eventsReceived),
+                                   static_cast<unsigned long long>(result.eventsDropped));
+    return output;
+}
@@ -0,0 +1,62 @@
+/**************************************************
+ * RdsBrokerBenchmark.hpp - Fan-out cost of RdsEventBroker
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDSBROKERBENCHMARK_HPP
+#define RDSBROKERBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Publishes synthetic groups as fast as possible to a broker with many
+ * real socket subscribers, each reading on its own thread, with a mix of
+ * filters. The first subscriber never reads, to show that a stalled
+ * client only costs itself dropped events.
+ */
+class RdsBrokerBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_GROUP_COUNT = 20000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Result
+    {
+        uint32_t subscribers;
+        uint32_t groups;
+        uint64_t eventsPublished;
+        uint64_t eventsDelivered;
+        uint64_t eventsDropped;
+        uint64_t eventsReceived;
+        uint64_t wallTimeUs;
+
+        // Time spent in publish() + service() for one group
+        uint64_t meanPublishNs;
+        uint64_t maxPublishUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t subscriberCount, uint32_t groupCount = DEFAULT_GROUP_COUNT);
+
+    static std::string report(int subscriberCount);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint32_t DEFAULT_SUBSCRIBER_COUNT = 16;
+};
+
+#endif  // ifndef RDSBROKERBENCHMARK_HPP
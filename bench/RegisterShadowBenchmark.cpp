@@ -0,0 +1,255 @@
+/**************************************************
+ * RegisterShadowBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "RegisterShadow.hpp"
+#include "RegisterShadowBenchmark.hpp"
+
+namespace
+{
+    struct ReaderTotals
+    {
+        std::atomic<uint64_t> snapshots{0};
+        std::atomic<uint64_t> retries{0};
+        std::atomic<uint64_t> torn{0};
+        std::atomic<uint64_t> regressions{0};
+    };
+
+    // Update n sets register r to n + r, so every register of a snapshot
+    // must agree on n
+    bool isConsistent(const uint16_t* registers)
+    {
+        for (uint8_t reg = 1; reg < RegisterShadow::REGISTER_COUNT; ++reg)
+        {
+            if (static_cast<uint16_t>(registers[reg] - reg) != registers[0])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void writeUpdate(RegisterShadow& shadow, uint16_t update)
+    {
+        RegisterShadow::WriteScope writeScope{shadow};
+        for (uint8_t reg = 0; reg < RegisterShadow::REGISTER_COUNT; ++reg)
+        {
+            shadow.store(reg, static_cast<uint16_t>(update + reg));
+        }
+    }
+
+    void seqlockReader(const RegisterShadow& shadow, const std::atomic<bool>& stop, ReaderTotals& totals)
+    {
+        uint64_t snapshots = 0, retries = 0, torn = 0, regressions = 0;
+        uint32_t lastVersion = 0;
+        RegisterShadow::Snapshot snapshot;
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            retries += shadow.snapshot(snapshot);
+            ++snapshots;
+
+            if (!isConsistent(snapshot.registers))
+            {
+                ++torn;
+            }
+            if (snapshot.version < lastVersion)
+            {
+                ++regressions;
+            }
+            lastVersion = snapshot.version;
+        }
+
+        totals.snapshots.fetch_add(snapshots, std::memory_order_relaxed);
+        totals.retries.fetch_add(retries, std::memory_order_relaxed);
+        totals.torn.fetch_add(torn, std::memory_order_relaxed);
+        totals.regressions.fetch_add(regressions, std::memory_order_relaxed);
+    }
+
+    struct LockedShadow
+    {
+        std::mutex mutex;
+        uint16_t registers[RegisterShadow::REGISTER_COUNT];
+    };
+
+    void mutexReader(LockedShadow& locked, const std::atomic<bool>& stop, ReaderTotals& totals)
+    {
+        uint64_t snapshots = 0, torn = 0;
+        uint16_t registers[RegisterShadow::REGISTER_COUNT];
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            {
+                std::lock_guard<std::mutex> lock{locked.mutex};
+                std::memcpy(registers, locked.registers, sizeof(registers));
+            }
+            ++snapshots;
+
+            if (!isConsistent(registers))
+            {
+                ++torn;
+            }
+        }
+
+        totals.snapshots.fetch_add(snapshots, std::memory_order_relaxed);
+        totals.torn.fetch_add(torn, std::memory_order_relaxed);
+    }
+
+    /**
+     * Runs the writer on this thread for durationMs with readerCount
+     * readers built by makeReader, then stops them. A non-zero
+     * updateIntervalUs sleeps between updates.
+     */
+    template <typename Write, typename MakeReader>
+    RegisterShadowBenchmark::Measurement runPhase(uint32_t readerCount, uint32_t durationMs,
+                                                  uint32_t updateIntervalUs, Write write, MakeReader makeReader,
+                                                  RegisterShadowBenchmark::Result& result)
+    {
+        ReaderTotals totals;
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> readers;
+        for (uint32_t readerIdx = 0; readerIdx < readerCount; ++readerIdx)
+        {
+            readers.emplace_back(makeReader(stop, totals));
+        }
+
+        RegisterShadowBenchmark::Measurement measurement;
+        std::memset(&measurement, 0, sizeof(measurement));
+
+        uint64_t totalUpdateNs = 0;
+        uint64_t start = BenchmarkHarness::nowNs();
+        uint64_t end = start + static_cast<uint64_t>(durationMs) * 1000000ULL;
+        uint64_t now = start;
+        while (now < end)
+        {
+            write(static_cast<uint16_t>(measurement.writerUpdates++));
+
+            uint64_t written = BenchmarkHarness::nowNs();
+            totalUpdateNs += written - now;
+            if (written - now > measurement.maxUpdateNs)
+            {
+                measurement.maxUpdateNs = written - now;
+            }
+
+            if (updateIntervalUs > 0)
+            {
+                usleep(updateIntervalUs);
+            }
+            now = (updateIntervalUs > 0) ? BenchmarkHarness::nowNs() : written;
+        }
+
+        stop.store(true, std::memory_order_relaxed);
+        for (std::thread& reader : readers)
+        {
+            reader.join();
+        }
+
+        measurement.wallTimeUs = (BenchmarkHarness::nowNs() - start) / 1000;
+        measurement.meanUpdateNs = totalUpdateNs / measurement.writerUpdates;
+        measurement.snapshots = totals.snapshots.load(std::memory_order_relaxed);
+        measurement.retries = totals.retries.load(std::memory_order_relaxed);
+        result.tornSnapshots += totals.torn.load(std::memory_order_relaxed);
+        result.versionRegressions += totals.regressions.load(std::memory_order_relaxed);
+        return measurement;
+    }
+}
+
+RegisterShadowBenchmark::Result RegisterShadowBenchmark::run(uint32_t readerCount, uint32_t durationMs)
+{
+    Result result;
+    std::memset(&result, 0, sizeof(result));
+    result.readers = readerCount;
+
+    RegisterShadow shadow;
+    writeUpdate(shadow, 0);
+
+    auto writeShadow = [&shadow](uint16_t update) { writeUpdate(shadow, update); };
+    auto makeSeqlockReader = [&shadow](const std::atomic<bool>& stop, ReaderTotals& totals)
+    {
+        return std::thread(seqlockReader, std::cref(shadow), std::cref(stop), std::ref(totals));
+    };
+
+    result.stress = runPhase(readerCount, durationMs, 0, writeShadow, makeSeqlockReader, result);
+    result.seqlock = runPhase(readerCount, durationMs, PACED_UPDATE_INTERVAL_US, writeShadow, makeSeqlockReader,
+                              result);
+
+    LockedShadow locked;
+    for (uint8_t reg = 0; reg < RegisterShadow::REGISTER_COUNT; ++reg)
+    {
+        locked.registers[reg] = reg;
+    }
+
+    auto writeLocked = [&locked](uint16_t update)
+    {
+        std::lock_guard<std::mutex> lock{locked.mutex};
+        for (uint8_t reg = 0; reg < RegisterShadow::REGISTER_COUNT; ++reg)
+        {
+            locked.registers[reg] = static_cast<uint16_t>(update + reg);
+        }
+    };
+    auto makeMutexReader = [&locked](const std::atomic<bool>& stop, ReaderTotals& totals)
+    {
+        return std::thread(mutexReader, std::ref(locked), std::cref(stop), std::ref(totals));
+    };
+
+    result.mutex = runPhase(readerCount, durationMs, PACED_UPDATE_INTERVAL_US, writeLocked, makeMutexReader, result);
+
+    return result;
+}
+
+/**
+ * Hammers a register shadow with one writer and readerCount (default 4)
+ * snapshotting readers, checking every snapshot, then compares it with a
+ * mutex with the writer paced like the bus thread
+ */
+std::string RegisterShadowBenchmark::report(int readerCount)
+{
+    if (readerCount < 1)
+    {
+        readerCount = DEFAULT_READER_COUNT;
+    }
+    else if (readerCount > static_cast<int>(MAX_READER_COUNT))
+    {
+        return "Too many readers\n";
+    }
+
+    Result result = run(static_cast<uint32_t>(readerCount));
+
+    const Measurement* measurements[] = { &result.stress, &result.seqlock, &result.mutex };
+    const char* names[] = { "Stress", "Seqlock", "Mutex" };
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Readers: %u\n"
+                                           "Phase     snapshots/s  updates/s  update mean/max ns  retries\n",
+                                   result.readers);
+    for (int idx = 0; idx < 3; ++idx)
+    {
+        const Measurement& measurement = *measurements[idx];
+        uint64_t snapshotsPerSecond = BenchmarkHarness::perSecond(measurement.snapshots, measurement.wallTimeUs);
+        uint64_t updatesPerSecond = BenchmarkHarness::perSecond(measurement.writerUpdates, measurement.wallTimeUs);
+        BenchmarkHarness::appendFormat(output, "%-8s %12llu %10llu %9llu/%-9llu %8llu\n", names[idx],
+                                       static_cast<unsigned long long>(snapshotsPerSecond),
+                                       static_cast<unsigned long long>(updatesPerSecond),
+                                       static_cast<unsigned long long>(measurement.meanUpdateNs),
+                                       static_cast<unsigned long long>(measurement.maxUpdateNs),
+                                       static_cast<unsigned long long>(measurement.retries));
+    }
+
+    BenchmarkHarness::appendFormat(output, "Torn snapshots: %llu\nVersion regressions: %llu\n",
+                                   static_cast<unsigned long long>(result.tornSnapshots),
+                                   static_cast<unsigned long long>(result.versionRegressions));
+    return output;
+}
@@ -0,0 +1,84 @@
+/**************************************************
+ * RegisterShadowBenchmark.hpp - Stress test and read throughput of
+ *                               RegisterShadow
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef REGISTERSHADOWBENCHMARK_HPP
+#define REGISTERSHADOWBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * One writer thread rewrites every register of a RegisterShadow in each
+ * update, so that a snapshot mixing two updates can be recognised, while
+ * reader threads take snapshots flat out and check each one.
+ *
+ * The stress phase runs the writer flat out to give readers as many
+ * chances as possible to see a torn update. The timed phases pace the
+ * writer like the bus thread, which spends most of its time waiting on
+ * transfers, and compare the seqlock with a mutex-protected copy: reader
+ * throughput, and how long the writer's updates take with readers about.
+ */
+class RegisterShadowBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_DURATION_MS = 1000;
+
+    // Writer pacing in the timed phases, about one register transfer
+    static const uint32_t PACED_UPDATE_INTERVAL_US = 50;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Measurement
+    {
+        uint64_t snapshots;
+        uint64_t writerUpdates;
+        uint64_t wallTimeUs;
+
+        // Time the writer spent in each update, excluding pacing
+        uint64_t meanUpdateNs;
+        uint64_t maxUpdateNs;
+
+        // Seqlock snapshots that had to be retried
+        uint64_t retries;
+    };
+
+    struct Result
+    {
+        uint32_t readers;
+        Measurement stress;
+        Measurement seqlock;
+        Measurement mutex;
+
+        // Snapshots mixing registers from different updates, and snapshots
+        // older than one the same reader already had. Both must be 0.
+        uint64_t tornSnapshots;
+        uint64_t versionRegressions;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t readerCount, uint32_t durationMs = DEFAULT_DURATION_MS);
+
+    static std::string report(int readerCount);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint32_t DEFAULT_READER_COUNT = 4;
+    static const uint32_t MAX_READER_COUNT = 64;
+};
+
+#endif  // ifndef REGISTERSHADOWBENCHMARK_HPP
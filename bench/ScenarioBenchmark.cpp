@@ -0,0 +1,173 @@
+/**************************************************
+ * ScenarioBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "OdaRegistry.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "RtPlusHandler.hpp"
+#include "Scenario.hpp"
+#include "ScenarioBenchmark.hpp"
+#include "ScenarioGenerator.hpp"
+#include "SimulatedBus.hpp"
+#include "TmcDecoder.hpp"
+#include "Util.hpp"
+
+/**
+ * Generates groupCount groups with the generator alone, round-robin over
+ * the stations, then reads groupCount groups through the driver, split
+ * evenly over the RDS stations.
+ */
+ScenarioBenchmark::Result ScenarioBenchmark::run(uint32_t groupCount, uint32_t seed)
+{
+    Result result = {};
+
+    Scenario scenario;
+    scenario.populateDenseUrban(seed);
+    result.stations = scenario.getStationCount();
+    for (uint8_t idx = 0; idx < scenario.getStationCount(); ++idx)
+    {
+        if (scenario.getStation(idx).piCode != 0)
+        {
+            ++result.rdsStations;
+        }
+    }
+    if (result.rdsStations == 0)
+    {
+        return result;
+    }
+
+    // Generator alone. The checksum keeps the work from being optimised out.
+    {
+        ScenarioGenerator generator{scenario};
+        ScenarioGenerator::Group group;
+        uint64_t timeUs = 0;
+        uint32_t checksum = 0;
+        uint8_t station = 0;
+
+        uint64_t wallStart = Util::getMonotonicTimeUs();
+        for (uint32_t idx = 0; idx < groupCount; ++idx)
+        {
+            generator.nextGroup(station, timeUs, group);
+            checksum += group.blocks[3];
+            timeUs += ScenarioGenerator::GROUP_PERIOD_US;
+            station = static_cast<uint8_t>((station + 1) % result.stations);
+        }
+        result.generatorWallUs = Util::getMonotonicTimeUs() - wallStart;
+        result.generatorGroups = groupCount;
+
+        volatile uint32_t checksumSink = checksum;
+        (void) checksumSink;
+    }
+
+    // The whole receive path
+    std::unique_ptr<SimulatedBus> bus{new SimulatedBus()};
+    bus->setScenario(scenario);
+    bus->getClock().setSpeedUp(0);
+    RDA5807M radio{*bus};
+
+    // The decoders are large; keep them off the stack
+    std::unique_ptr<RdsDecoder> rdsDecoder{new RdsDecoder()};
+    std::unique_ptr<OdaRegistry> odaRegistry{new OdaRegistry()};
+    std::unique_ptr<RtPlusHandler> rtPlusHandler{new RtPlusHandler()};
+    std::unique_ptr<TmcDecoder> tmcDecoder{new TmcDecoder()};
+    odaRegistry->registerHandler(RtPlusHandler::AID, *rtPlusHandler);
+
+    uint32_t groupsPerStation = groupCount / result.rdsStations;
+    uint64_t simulatedStart = bus->getClock().nowUs();
+    uint64_t wallStart = Util::getMonotonicTimeUs();
+    for (uint8_t idx = 0; idx < scenario.getStationCount(); ++idx)
+    {
+        const Scenario::Station& station = scenario.getStation(idx);
+        if (station.piCode == 0)
+        {
+            continue;
+        }
+
+        rdsDecoder->reset();
+        odaRegistry->reset();
+        tmcDecoder->reset();
+
+        radio.setFrequencyKhz(station.frequencyKhz, false);
+        radio.setTune(true);
+        if (!radio.isStcComplete())
+        {
+            continue;
+        }
+
+        for (uint32_t read = 0; read < groupsPerStation; ++read)
+        {
+            RDA5807M::RdsGroup group;
+            if (!radio.readRdsGroup(group))
+            {
+                continue;
+            }
+            ++result.pipelineGroups;
+            rdsDecoder->processGroup(group);
+            odaRegistry->processGroup(group, *rdsDecoder);
+            tmcDecoder->processGroup(group, bus->getClock().nowUs());
+        }
+
+        result.groupsRejected += rdsDecoder->getCounters().groupsRejected;
+        if (rdsDecoder->isProgramServiceComplete())
+        {
+            ++result.programServicesComplete;
+        }
+        if (rtPlusHandler->getTags().title[0] != '\0')
+        {
+            ++result.titlesTagged;
+        }
+        result.tmcMessages += tmcDecoder->getActiveMessageCount();
+    }
+    result.pipelineWallUs = Util::getMonotonicTimeUs() - wallStart;
+    result.simulatedTimeUs = bus->getClock().nowUs() - simulatedStart;
+    result.blocksCorrupted = bus->getGeneratorCounters().blocksCorrupted;
+    result.blocksCorrected = bus->getGeneratorCounters().blocksCorrected;
+
+    return result;
+}
+
+/**
+ * groupCount defaults to 1,000,000. The real time factor is the air time
+ * of the pipeline's groups over the wall time they took.
+ */
+std::string ScenarioBenchmark::report(int groupCount)
+{
+    Result result = run((groupCount < 1) ? DEFAULT_GROUP_COUNT : static_cast<uint32_t>(groupCount));
+    if (result.rdsStations == 0)
+    {
+        return "Scenario has no RDS stations\n";
+    }
+
+    uint64_t generatorPerSecond = BenchmarkHarness::perSecond(result.generatorGroups, result.generatorWallUs);
+    uint64_t pipelinePerSecond = BenchmarkHarness::perSecond(result.pipelineGroups, result.pipelineWallUs);
+    uint64_t realTimeFactor = result.simulatedTimeUs / ((result.pipelineWallUs > 0) ? result.pipelineWallUs : 1);
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Stations: %u (%u with RDS)\n", result.stations, result.rdsStations);
+    BenchmarkHarness::appendFormat(output, "Generator: %llu groups in %llu ms, %llu groups/s\n",
+                                   static_cast<unsigned long long>(result.generatorGroups),
+                                   static_cast<unsigned long long>(result.generatorWallUs / 1000),
+                                   static_cast<unsigned long long>(generatorPerSecond));
+    BenchmarkHarness::appendFormat(output, "Driver and decoders: %llu groups in %llu ms, %llu groups/s "
+                                           "(%llux real time)\n",
+                                   static_cast<unsigned long long>(result.pipelineGroups),
+                                   static_cast<unsigned long long>(result.pipelineWallUs / 1000),
+                                   static_cast<unsigned long long>(pipelinePerSecond),
+                                   static_cast<unsigned long long>(realTimeFactor));
+    BenchmarkHarness::appendFormat(output, "Blocks corrupted: %llu, corrected: %llu; groups rejected: %llu\n",
+                                   static_cast<unsigned long long>(result.blocksCorrupted),
+                                   static_cast<unsigned long long>(result.blocksCorrected),
+                                   static_cast<unsigned long long>(result.groupsRejected));
+    BenchmarkHarness::appendFormat(output, "Decoded: PS on %u, RT+ title on %u stations; %u TMC messages\n",
+                                   result.programServicesComplete, result.titlesTagged, result.tmcMessages);
+    return output;
+}
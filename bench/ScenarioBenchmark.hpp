@@ -0,0 +1,71 @@
+/**************************************************
+ * ScenarioBenchmark.hpp - Group throughput of the scenario engine and of
+ *                         the driver and decoders it feeds
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SCENARIOBENCHMARK_HPP
+#define SCENARIOBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Generates a dense urban band (Scenario::populateDenseUrban()) and
+ * measures two things: how fast ScenarioGenerator alone produces groups,
+ * and how fast groups go through the whole receive path, from a
+ * SimulatedBus on a stepped clock through RDA5807M::readRdsGroup() into
+ * RdsDecoder, OdaRegistry with RT+ and TmcDecoder. The receive path visits
+ * each RDS station in turn and reports what it managed to decode, which
+ * checks that the simulated registers look like the chip's.
+ */
+class ScenarioBenchmark
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_GROUP_COUNT = 1000000;
+    static const uint32_t DEFAULT_SEED = 1;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Result
+    {
+        uint8_t stations;
+        uint8_t rdsStations;
+
+        uint64_t generatorGroups;
+        uint64_t generatorWallUs;
+
+        uint64_t pipelineGroups;
+        uint64_t pipelineWallUs;
+
+        // Air time the pipeline groups would have taken
+        uint64_t simulatedTimeUs;
+
+        // Generator error injection, and what the decoder made of it
+        uint64_t blocksCorrupted;
+        uint64_t blocksCorrected;
+        uint64_t groupsRejected;
+
+        // Stations whose PS, RT+ title and TMC messages were decoded
+        uint32_t programServicesComplete;
+        uint32_t titlesTagged;
+        uint32_t tmcMessages;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t groupCount = DEFAULT_GROUP_COUNT, uint32_t seed = DEFAULT_SEED);
+
+    static std::string report(int groupCount);
+};
+
+#endif  // ifndef SCENARIOBENCHMARK_HPP
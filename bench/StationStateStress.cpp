@@ -0,0 +1,223 @@
+/**************************************************
+ * StationStateStress.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "RDA5807M.hpp"
+#include "StationState.hpp"
+#include "StationStatePublisher.hpp"
+#include "StationStateReader.hpp"
+#include "StationStateStress.hpp"
+
+namespace
+{
+    struct ReaderTotals
+    {
+        std::atomic<uint64_t> reads{0};
+        std::atomic<uint64_t> retries{0};
+        std::atomic<uint64_t> torn{0};
+        std::atomic<uint64_t> regressions{0};
+    };
+
+    /**
+     * Fills the history ring with groups that all encode publishIdx
+     */
+    void recordPublish(StationStatePublisher& publisher, uint32_t publishIdx)
+    {
+        RDA5807M::RdsGroup group;
+        group.errorsA = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.errorsB = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.blocks[0] = static_cast<uint16_t>(publishIdx);
+        group.blocks[1] = static_cast<uint16_t>(publishIdx >> 16);
+        group.blocks[2] = static_cast<uint16_t>(~group.blocks[0]);
+        group.blocks[3] = static_cast<uint16_t>(~group.blocks[1]);
+
+        for (uint32_t groupIdx = 0; groupIdx < StationStateLayout::GROUP_HISTORY_LENGTH; ++groupIdx)
+        {
+            publisher.recordGroup(group);
+        }
+    }
+
+    /**
+     * Gives the publish a copy came from, or false if the copy is torn
+     */
+    bool decodePublish(const StationState& state, uint32_t& publishIdx)
+    {
+        if (state.groupHistoryCount % StationStateLayout::GROUP_HISTORY_LENGTH != 0)
+        {
+            return false;
+        }
+
+        publishIdx = state.groupHistoryCount / StationStateLayout::GROUP_HISTORY_LENGTH;
+        for (uint32_t groupIdx = 0; groupIdx < StationStateLayout::GROUP_HISTORY_LENGTH; ++groupIdx)
+        {
+            const uint16_t* blocks = state.groupHistory[groupIdx].blocks;
+            if (blocks[0] != static_cast<uint16_t>(publishIdx) ||
+                blocks[1] != static_cast<uint16_t>(publishIdx >> 16) ||
+                blocks[2] != static_cast<uint16_t>(~blocks[0]) ||
+                blocks[3] != static_cast<uint16_t>(~blocks[1]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void readState(const char* shmName, const std::atomic<bool>& stop, ReaderTotals& totals)
+    {
+        StationStateReader reader{shmName};
+        if (!reader.open())
+        {
+            return;
+        }
+
+        uint64_t reads = 0, retries = 0, torn = 0, regressions = 0;
+        uint32_t lastPublishIdx = 0;
+
+        // Too big to copy around the stack on every read
+        std::unique_ptr<StationState> state{new StationState()};
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (!reader.tryRead(*state))
+            {
+                ++retries;
+                continue;
+            }
+            ++reads;
+
+            uint32_t publishIdx = 0;
+            if (!decodePublish(*state, publishIdx))
+            {
+                ++torn;
+                continue;
+            }
+            if (publishIdx < lastPublishIdx)
+            {
+                ++regressions;
+            }
+            lastPublishIdx = publishIdx;
+        }
+
+        totals.reads.fetch_add(reads, std::memory_order_relaxed);
+        totals.retries.fetch_add(retries, std::memory_order_relaxed);
+        totals.torn.fetch_add(torn, std::memory_order_relaxed);
+        totals.regressions.fetch_add(regressions, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * The segment is removed again afterwards
+ */
+StationStateStress::Result StationStateStress::run(uint32_t readerCount, uint32_t durationMs)
+{
+    Result result;
+    std::memset(&result, 0, sizeof(result));
+    result.readers = readerCount;
+
+    char shmName[64];
+    std::snprintf(shmName, sizeof(shmName), "/rda5807m_state_stress.%d", static_cast<int>(getpid()));
+
+    // The working copy makes the publisher too big for the stack
+    std::unique_ptr<StationStatePublisher> publisher{new StationStatePublisher(shmName)};
+    if (!publisher->open())
+    {
+        return result;
+    }
+
+    // Readers never see the empty state open() stores, which would not
+    // decode
+    uint32_t publishIdx = 1;
+    recordPublish(*publisher, publishIdx);
+    publisher->publish();
+
+    ReaderTotals totals;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (uint32_t readerIdx = 0; readerIdx < readerCount; ++readerIdx)
+    {
+        readers.emplace_back(readState, shmName, std::cref(stop), std::ref(totals));
+    }
+
+    uint64_t start = BenchmarkHarness::nowNs();
+    uint64_t end = start + static_cast<uint64_t>(durationMs) * 1000000ULL;
+    while (BenchmarkHarness::nowNs() < end)
+    {
+        recordPublish(*publisher, ++publishIdx);
+        publisher->publish();
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    result.valid = true;
+    result.publishes = publisher->getPublishCount();
+    result.wallTimeUs = (BenchmarkHarness::nowNs() - start) / 1000;
+    result.reads = totals.reads.load(std::memory_order_relaxed);
+    result.retries = totals.retries.load(std::memory_order_relaxed);
+    result.tornReads = totals.torn.load(std::memory_order_relaxed);
+    result.regressions = totals.regressions.load(std::memory_order_relaxed);
+
+    publisher->close();
+    shm_unlink(shmName);
+    return result;
+}
+
+/**
+ * readerCount defaults to 4
+ */
+std::string StationStateStress::report(int readerCount)
+{
+    if (readerCount < 1)
+    {
+        readerCount = DEFAULT_READER_COUNT;
+    }
+    else if (readerCount > static_cast<int>(MAX_READER_COUNT))
+    {
+        return "Too many readers\n";
+    }
+
+    Result result = run(static_cast<uint32_t>(readerCount));
+    if (!result.valid)
+    {
+        return "Unable to create the shared memory segment\n";
+    }
+
+    uint64_t attempts = result.reads + result.retries;
+    uint64_t retryBasisPoints = (attempts > 0) ? result.retries * 10000 / attempts : 0;
+    uint64_t publishesPerSecond = BenchmarkHarness::perSecond(result.publishes, result.wallTimeUs);
+    uint64_t readsPerSecond = BenchmarkHarness::perSecond(result.reads, result.wallTimeUs);
+
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Readers: %u\nPublishes: %llu in %llu ms, %llu/s\n", result.readers,
+                                   static_cast<unsigned long long>(result.publishes),
+                                   static_cast<unsigned long long>(result.wallTimeUs / 1000),
+                                   static_cast<unsigned long long>(publishesPerSecond));
+    BenchmarkHarness::appendFormat(output, "Reads: %llu, %llu/s\nRetried reads: %llu (%llu.%02llu%% of attempts)\n",
+                                   static_cast<unsigned long long>(result.reads),
+                                   static_cast<unsigned long long>(readsPerSecond),
+                                   static_cast<unsigned long long>(result.retries),
+                                   static_cast<unsigned long long>(retryBasisPoints / 100),
+                                   static_cast<unsigned long long>(retryBasisPoints % 100));
+    BenchmarkHarness::appendFormat(output, "Torn reads: %llu\nRegressions: %llu\n",
+                                   static_cast<unsigned long long>(result.tornReads),
+                                   static_cast<unsigned long long>(result.regressions));
+    return output;
+}
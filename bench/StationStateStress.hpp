@@ -0,0 +1,72 @@
+/**************************************************
+ * StationStateStress.hpp - Concurrent readers of the published station
+ *                          state against a publisher running flat out
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef STATIONSTATESTRESS_HPP
+#define STATIONSTATESTRESS_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+//<none>
+
+/**
+ * Publishes station state to a segment of its own as fast as it can,
+ * while reader threads, each with its own StationStateReader and so its
+ * own mapping, read it back flat out.
+ *
+ * Before publish n the publisher records a whole history ring of groups
+ * whose blocks all encode n, so every entry of a consistent copy agrees,
+ * and agrees with groupHistoryCount. A copy that doesn't is torn. Readers
+ * retry tryRead() until it succeeds, counting the attempts that raced
+ * with a publish, and check that what they get never goes backwards.
+ */
+class StationStateStress
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_DURATION_MS = 1000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Result
+    {
+        // False if the segment couldn't be created or opened
+        bool valid;
+        uint32_t readers;
+        uint64_t publishes;
+        uint64_t wallTimeUs;
+
+        // Successful reads, and tryRead() calls that raced with a publish
+        uint64_t reads;
+        uint64_t retries;
+
+        // Copies mixing two publishes, and copies older than one the same
+        // reader already had. Both must be 0.
+        uint64_t tornReads;
+        uint64_t regressions;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t readerCount, uint32_t durationMs = DEFAULT_DURATION_MS);
+
+    static std::string report(int readerCount);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint32_t DEFAULT_READER_COUNT = 4;
+    static const uint32_t MAX_READER_COUNT = 64;
+};
+
+#endif  // ifndef STATIONSTATESTRESS_HPP
@@ -0,0 +1,231 @@
+/**************************************************
+ * TmcBenchmark.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+// Project includes
+#include "BenchmarkHarness.hpp"
+#include "RDA5807M.hpp"
+#include "RdsGroupLog.hpp"
+#include "TmcBenchmark.hpp"
+#include "TmcDecoder.hpp"
+#include "TmcTableFormat.hpp"
+#include "TmcTables.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    const uint16_t BENCHMARK_PI_CODE = 0xD3C2;
+
+    // One group at 1187.5 bit/s
+    const uint64_t GROUP_PERIOD_US = 87579;
+
+    // Fixed start so that runs are repeatable, 2024-01-01 06:00 UTC
+    const uint64_t START_TIME_US = 1704088800ULL * 1000000ULL;
+
+    /**
+     * Writes group twice, as TMC services do, with a 0A filler group
+     * after every fourth
+     */
+    bool appendGroup(RdsGroupLogWriter& writer, uint16_t blockB, uint16_t blockC, uint16_t blockD,
+                     uint64_t& timestampUs, uint32_t& sequence)
+    {
+        RDA5807M::RdsGroup group;
+        group.errorsA = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.errorsB = RDA5807M::RdsBlockErrors::ZERO_ERRORS;
+        group.blocks[0] = BENCHMARK_PI_CODE;
+        group.blocks[1] = blockB;
+        group.blocks[2] = blockC;
+        group.blocks[3] = blockD;
+
+        for (int copy = 0; copy < 2; ++copy)
+        {
+            if (!writer.append(group, timestampUs))
+            {
+                return false;
+            }
+            timestampUs += GROUP_PERIOD_US;
+
+            if (++sequence % 4 == 0)
+            {
+                RDA5807M::RdsGroup filler = group;
+                filler.blocks[1] = static_cast<uint16_t>(sequence & 0x3);
+                filler.blocks[2] = 0xE0CD;
+                filler.blocks[3] = 0x2020;
+                if (!writer.append(filler, timestampUs))
+                {
+                    return false;
+                }
+                timestampUs += GROUP_PERIOD_US;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Message messageIdx, at its own location. Seven in ten are single
+     * group; the rest carry a duration and, for some, an extra event in
+     * the optional content and span two or three groups.
+     */
+    bool appendMessage(RdsGroupLogWriter& writer, uint32_t messageIdx, uint64_t& timestampUs,
+                       uint32_t& sequence)
+    {
+        uint16_t location = static_cast<uint16_t>(1 + messageIdx % 65000);
+        uint16_t event = static_cast<uint16_t>(1 + (messageIdx * 37) % 2000);
+        uint16_t direction = (messageIdx & 1) ? 0x4000 : 0x0000;
+        uint16_t extent = static_cast<uint16_t>(((messageIdx >> 1) & 0x7) << 11);
+
+        if (messageIdx % 10 < 7)
+        {
+            uint16_t blockB = static_cast<uint16_t>(0x8000 | 0x0008 | (messageIdx % 8));
+            return appendGroup(writer, blockB, static_cast<uint16_t>(direction | extent | event), location,
+                               timestampUs, sequence);
+        }
+
+        uint16_t continuity = static_cast<uint16_t>(1 + messageIdx % 6);
+        uint16_t blockB = static_cast<uint16_t>(0x8000 | continuity);
+        if (!appendGroup(writer, blockB, static_cast<uint16_t>(0x8000 | direction | extent | event), location,
+                         timestampUs, sequence))
+        {
+            return false;
+        }
+
+        // 28 bits of optional content, MSB first: label 0 (duration) = 3,
+        // then for some label 9 (additional event)
+        uint32_t optional = 0x3U << 21;
+        bool threeGroups = (messageIdx % 3) == 0;
+        if (threeGroups)
+        {
+            optional |= (0x9U << 17) | (static_cast<uint32_t>((event + 1) & 0x7FF) << 6);
+        }
+
+        uint16_t remaining = threeGroups ? 1 : 0;
+        uint16_t secondC = static_cast<uint16_t>(0x4000 | (remaining << 12) | (optional >> 16));
+        if (!appendGroup(writer, blockB, secondC, static_cast<uint16_t>(optional & 0xFFFF), timestampUs, sequence))
+        {
+            return false;
+        }
+
+        return !threeGroups || appendGroup(writer, blockB, 0x0000, 0x0000, timestampUs, sequence);
+    }
+}
+
+/**
+ * Benchmarks messageCount distinct messages, so the decoder ends up
+ * holding up to that many at once
+ */
+TmcBenchmark::Result TmcBenchmark::run(uint32_t messageCount, const TmcTables* tables)
+{
+    char path[64];
+    std::snprintf(path, sizeof(path), "/tmp/rda5807m_tmc_bench.%d.rdslog", static_cast<int>(getpid()));
+
+    RdsGroupLogWriter writer;
+    bool written = writer.open(path, true);
+    uint64_t timestampUs = START_TIME_US;
+    uint32_t sequence = 0;
+
+    for (uint32_t messageIdx = 0; written && messageIdx < messageCount; ++messageIdx)
+    {
+        written = appendMessage(writer, messageIdx, timestampUs, sequence);
+    }
+    writer.close();
+
+    Result result;
+    std::memset(&result, 0, sizeof(result));
+    if (written)
+    {
+        result = replay(path, tables);
+    }
+
+    unlink(path);
+    return result;
+}
+
+TmcBenchmark::Result TmcBenchmark::replay(const char* path, const TmcTables* tables)
+{
+    Result result;
+    std::memset(&result, 0, sizeof(result));
+
+    RdsGroupLogReader reader;
+    if (!reader.open(path))
+    {
+        return result;
+    }
+
+    // The message table is too big for the stack
+    std::unique_ptr<TmcDecoder> decoder{new TmcDecoder()};
+    decoder->setTables(tables);
+
+    const RdsGroupLogFormat::Entry* entries = reader.getEntries();
+    uint64_t totalNs = 0;
+    uint64_t start = Util::getMonotonicTimeUs();
+
+    for (size_t entryIdx = 0; entryIdx < reader.getEntryCount(); ++entryIdx)
+    {
+        RDA5807M::RdsGroup group = RdsGroupLogReader::toGroup(entries[entryIdx]);
+
+        uint64_t before = BenchmarkHarness::nowNs();
+        decoder->processGroup(group, entries[entryIdx].timestampUs);
+        uint64_t groupNs = BenchmarkHarness::nowNs() - before;
+
+        totalNs += groupNs;
+        if (groupNs > result.maxNsPerGroup)
+        {
+            result.maxNsPerGroup = groupNs;
+        }
+        if (decoder->getActiveMessageCount() > result.peakActiveMessages)
+        {
+            result.peakActiveMessages = decoder->getActiveMessageCount();
+        }
+    }
+
+    result.valid = true;
+    result.wallTimeUs = Util::getMonotonicTimeUs() - start;
+    result.groups = reader.getEntryCount();
+    result.meanNsPerGroup = (result.groups > 0) ? totalNs / result.groups : 0;
+    result.finalActiveMessages = decoder->getActiveMessageCount();
+    result.decoderStats = decoder->getStats();
+    return result;
+}
+
+/**
+ * Times a synthetic stream of messageCount messages, or the group log
+ * RDSRECORD made if messageCount isn't given. Events and locations are
+ * named from the radio's TMC tables when they are there.
+ */
+std::string TmcBenchmark::report(int messageCount)
+{
+    TmcTables tables;
+    const TmcTables* tablesUsed = tables.open(TmcTableFormat::DEFAULT_PATH) ? &tables : nullptr;
+
+    Result result = (messageCount <= 0) ? replay(RdsGroupLogFormat::DEFAULT_PATH, tablesUsed)
+                                        : run(static_cast<uint32_t>(messageCount), tablesUsed);
+    if (!result.valid)
+    {
+        return (messageCount <= 0) ? std::string("Unable to read ") + RdsGroupLogFormat::DEFAULT_PATH + "\n"
+                                   : std::string("Unable to write benchmark group log\n");
+    }
+
+    const TmcDecoder::Stats& stats = result.decoderStats;
+    std::string output;
+    BenchmarkHarness::appendFormat(output, "Groups: %llu (%u 8A) in %llu ms\n",
+                                   static_cast<unsigned long long>(result.groups), stats.groups,
+                                   static_cast<unsigned long long>(result.wallTimeUs / 1000));
+    BenchmarkHarness::appendFormat(output, "Per group: mean %llu ns, max %llu ns\n",
+                                   static_cast<unsigned long long>(result.meanNsPerGroup),
+                                   static_cast<unsigned long long>(result.maxNsPerGroup));
+    BenchmarkHarness::appendFormat(output, "Messages: %u single-group, %u multi-group, %u assembly errors\n",
+                                   stats.singleGroupMessages, stats.multiGroupMessages, stats.assemblyErrors);
+    BenchmarkHarness::appendFormat(output, "Active: peak %u, final %u (%u expired, %u dropped)\n",
+                                   result.peakActiveMessages, result.finalActiveMessages, stats.messagesExpired,
+                                   stats.messagesDropped);
+    return output;
+}
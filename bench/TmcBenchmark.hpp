@@ -0,0 +1,51 @@
+/**************************************************
+ * TmcBenchmark.hpp - Decode cost of TmcDecoder on recorded streams
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TMCBENCHMARK_HPP
+#define TMCBENCHMARK_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+
+// Project includes
+#include "TmcDecoder.hpp"
+
+class TmcTables;
+
+/**
+ * Replays a group log through a fresh TmcDecoder as fast as possible and
+ * times each group. run() first records a synthetic 8A stream to a
+ * temporary log so that it goes through exactly the same path as a
+ * recording taken off air.
+ */
+class TmcBenchmark
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Result
+    {
+        bool valid;
+        uint64_t groups;
+        uint32_t peakActiveMessages;
+        uint32_t finalActiveMessages;
+        uint64_t wallTimeUs;
+        uint64_t meanNsPerGroup;
+        uint64_t maxNsPerGroup;
+        TmcDecoder::Stats decoderStats;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static Result run(uint32_t messageCount, const TmcTables* tables);
+    static Result replay(const char* path, const TmcTables* tables);
+
+    static std::string report(int messageCount);
+};
+
+#endif  // ifndef TMCBENCHMARK_HPP
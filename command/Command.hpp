@@ -12,6 +12,7 @@
 #include <cstring>
 
 // Project includes
+#include "BusTrace.hpp"
 #include "RDA5807M.hpp"
 #include "RDA5807MWrapper.hpp"
 
@@ -32,10 +33,12 @@ public:
     /**
      * Executes the function pointed to by cmdFunc with the parameter param.
      * wrapRef is used as the object on which cmdFunc is called.
-     * The result of the function is returned
+     * The result of the function is returned, and the call is traced
+     * as a WRAPPER span
      */
     T exec(int param, RDA5807MWrapper& wrapRef) const
     {
+        BusTrace::Span wrapperSpan{BusTraceFormat::Op::WRAPPER};
         return (wrapRef.*cmdFunc)(param);
     }
 
@@ -6,20 +6,28 @@
  */
 
 //System includes
-#include <iostream>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
 #include <regex>
 #include <string>
+#include <utility>
 
 // Project includes
+#include "BusTrace.hpp"
 #include "Command.hpp"
 #include "CommandParser.hpp"
+#include "Log.hpp"
 #include "RDA5807M.hpp"
 #include "RDA5807MWrapper.hpp"
+#include "Util.hpp"
 
 // Static initialization
 const Command<RDA5807M::StatusResult> CommandParser::STATUS_RESULT_COMMANDS[] =
 {
     Command<RDA5807M::StatusResult> { "FREQ", &RDA5807MWrapper::setFrequency, "Enter freq in as an integer"},
+    Command<RDA5807M::StatusResult> { "FREQKHZ", &RDA5807MWrapper::setFrequencyKhz, "Enter freq in kHz, e.g. 98525. Needed for 25/50 KHz spacing"},
     Command<RDA5807M::StatusResult> { "VOL", &RDA5807MWrapper::setVolume, "Enter volume from 0 to 15"},
     Command<RDA5807M::StatusResult> { "MUTE", &RDA5807MWrapper::setMute, "1 to mute, 0 to unmute"},
     Command<RDA5807M::StatusResult> { "BASSBOOST", &RDA5807MWrapper::setBassBoost, "1 to enable bass boost, 0 to disable"},
@@ -49,7 +57,34 @@ const Command<std::string> CommandParser::STRING_RESULT_COMMANDS[] =
     Command<std::string> { "FREQMAP" , &RDA5807MWrapper::generateFreqMap, "Prints dotplot of freqs and their RSSI. No param for short search. Param=1 shows RDS support (takes a long time)"},
     Command<std::string> { "RDSINFO" , &RDA5807MWrapper::getRdsInfoString, "No param. Prints RDS information"},
     Command<std::string> { "GETREGFROMLOCALMAP", &RDA5807MWrapper::getLocalCopyOfReg, "Returns the local copy of the register addressed by the param (in hex)"},
-    Command<std::string> { "SNOOPRDSGROUP2", &RDA5807MWrapper::snoopRdsGroupTwo, "Snoops RDS group 2 for param (in ms) milliseconds at 10ms intervals"}
+    Command<std::string> { "SNOOPRDSGROUP2", &RDA5807MWrapper::snoopRdsGroupTwo, "Snoops RDS group 2 for param (in ms) milliseconds, reading as each group is due"},
+    Command<std::string> { "RDSACQUIRE", &RDA5807MWrapper::acquireRds, "Decodes RDS for param (in ms) milliseconds and publishes station state to shared memory"},
+    Command<std::string> { "WATCHDOG", &RDA5807MWrapper::configureWatchdog, "Prints register watchdog stats. Param sets the check interval in ms (0 disables)"},
+    Command<std::string> { "SURVEY", &RDA5807MWrapper::surveyBand, "Surveys the band using every attached tuner. Param=1 also picks up RDS PI codes"},
+    Command<std::string> { "SURVEYSIM", &RDA5807MWrapper::surveySimulatedBand, "Surveys a simulated band using param simulated tuners and reports the wall time"},
+    Command<std::string> { "RDSSUBSCRIBERS", &RDA5807MWrapper::getRdsBrokerStats, "Prints RDS event socket subscriber and delivery statistics"},
+    Command<std::string> { "FINDPI", &RDA5807MWrapper::findPiCode, "Tunes to the first station with PI code param (e.g. FINDPI=0x1A04), best candidates first"},
+    Command<std::string> { "FINDPTY", &RDA5807MWrapper::findProgramType, "Tunes to the first station with program type param (0-31), best candidates first"},
+    Command<std::string> { "BUSTRACEDUMP", &RDA5807MWrapper::dumpBusTrace, "Dumps the bus trace to /var/tmp/rda5807m_bustrace.bin; param 1 also writes text, 2 a Chrome trace"},
+    Command<std::string> { "TRACESTATS", &RDA5807MWrapper::getCommandLatencies, "Prints per-command latency split into parsing, bus I/O, sleeping, formatting and the rest; param 1 adds the histograms, 0 clears them"},
+    Command<std::string> { "WATCHADD", &RDA5807MWrapper::addWatchlistStation, "Adds freq param (as for FREQ) to the watchlist WATCH rotates through"},
+    Command<std::string> { "WATCHCLEAR", &RDA5807MWrapper::clearWatchlist, "Empties the watchlist and forgets what was learned about its stations"},
+    Command<std::string> { "WATCH", &RDA5807MWrapper::monitorWatchlist, "Rotates the tuner through the watchlist for param ms (default 10000), then reports each station and its refresh interval and retunes"},
+    Command<std::string> { "ODA", &RDA5807MWrapper::getOpenDataApplications, "Lists Open Data Applications announced by the station and the RT+ title/artist"},
+    Command<std::string> { "TMC", &RDA5807MWrapper::getTmcMessages, "Lists current traffic messages received during RDSACQUIRE"},
+    Command<std::string> { "TA", &RDA5807MWrapper::configureTrafficAnnouncements, "Prints traffic announcement state, EON networks and action latency. Param 0 only signals announcements, 1 also switches audio"},
+    Command<std::string> { "TAVOL", &RDA5807MWrapper::setTrafficAnnouncementVolume, "Sets the volume (0-15) announcements are raised to when TA switches audio"},
+    Command<std::string> { "RDSRECORD", &RDA5807MWrapper::recordRdsGroups, "Records (1) or stops recording (0) RDS groups read during RDSACQUIRE to /var/tmp/rda5807m_groups.rdslog"},
+    Command<std::string> { "METRICS", &RDA5807MWrapper::serveMetrics, "Serves Prometheus metrics on 127.0.0.1:param (default 9105); 0 stops"},
+    Command<std::string> { "POLLSTATS", &RDA5807MWrapper::getPollingStats, "No param. Prints the polling mode, time per mode and bus utilization since the last RDSACQUIRE"},
+    Command<std::string> { "ARBITER", &RDA5807MWrapper::getBusArbiterStats, "Prints grants, waits and bus time per traffic class on the shared bus. Param=0 clears them"},
+    Command<std::string> { "I2CCAL", &RDA5807MWrapper::calibrateBusClock, "Tries each I2C clock rate with register read-back and write/read-back passes, runs the bus at the fastest stable one and saves it for the next start"},
+    Command<std::string> { "I2CCLOCKBENCH", &RDA5807MWrapper::benchmarkBusClock, "Times param (default 1000) status refreshes at each I2C clock rate against what the clock alone allows, then goes back to the calibrated rate"},
+    Command<std::string> { "RSSISAMPLE", &RDA5807MWrapper::sampleRssi, "Samples RSSI for param (in ms) milliseconds and prints streaming statistics"},
+    Command<std::string> { "RSSIRATE", &RDA5807MWrapper::setRssiSampleRate, "Sets the RSSI sample rate to param Hz and clears the statistics"},
+    Command<std::string> { "RSSISTATS", &RDA5807MWrapper::getRssiStats, "No param. Prints the RSSI statistics gathered so far"},
+    Command<std::string> { "WATERFALL", &RDA5807MWrapper::recordWaterfall, "Sweeps the band param times, appending to the waterfall history file"},
+    Command<std::string> { "WATERFALLVIEW", &RDA5807MWrapper::showWaterfall, "Shows the last param (default 60) minutes of the waterfall history"}
 };
 
 const Command<uint32_t> CommandParser::UINT32_RESULT_COMMANDS[] =
@@ -66,7 +101,7 @@ const size_t CommandParser::STATUS_RESULT_COMMANDS_LIST_LENGTH = sizeof(STATUS_R
 const size_t CommandParser::STRING_RESULT_COMMANDS_LIST_LENGTH = sizeof(STRING_RESULT_COMMANDS) / sizeof(Command<std::string>);
 const size_t CommandParser::UINT32_RESULT_COMMANDS_LIST_LENGTH = sizeof(UINT32_RESULT_COMMANDS) / sizeof(Command<uint32_t>);
 
-const std::regex CommandParser::CMD_REGEX { "^([a-zA-Z0-9]+){1}=*([0-9]*)"};
+const std::regex CommandParser::CMD_REGEX { "^([a-zA-Z0-9]+){1}=*(0[xX][0-9a-fA-F]+|[0-9]*)"};
 const std::string CommandParser::LIST_CMDS_COMMAND_STRING = "HELP";
 
 /**
@@ -79,6 +114,8 @@ std::string CommandParser::execute(std::string& unparsedCommand)
     std::string cmd;
     int param;
 
+    // Parsing and looking the command up count towards the command's span
+    uint64_t parseStartNs = BusTrace::now();
     bool parseResult = parse(unparsedCommand, cmd, param);
     if (!parseResult)
     {
@@ -92,37 +129,70 @@ std::string CommandParser::execute(std::string& unparsedCommand)
 
     for (size_t idx = 0; idx < STATUS_RESULT_COMMANDS_LIST_LENGTH; ++idx)
     {
-        Command<RDA5807M::StatusResult> statusResultCmd = STATUS_RESULT_COMMANDS[idx];
-        if (cmd.compare(statusResultCmd.getCommandString()) == 0)
+        if (cmd.compare(STATUS_RESULT_COMMANDS[idx].getCommandString()) == 0)
         {
-            std::cout << "Executing: " << cmd << "(" << param << ")" << std::endl;
-            return RDA5807M::statusResultToString(statusResultCmd.exec(param, radioWrapper));
+            return run(STATUS_RESULT_COMMANDS[idx], param, parseStartNs);
         }
     }
 
     for (size_t idx = 0; idx < STRING_RESULT_COMMANDS_LIST_LENGTH; ++idx)
     {
-        Command<std::string> stringResultCmd = STRING_RESULT_COMMANDS[idx];
-        if (cmd.compare(stringResultCmd.getCommandString()) == 0)
+        if (cmd.compare(STRING_RESULT_COMMANDS[idx].getCommandString()) == 0)
         {
-            std::cout << "Executing: " << cmd << "(" << param << ")" << std::endl;
-            return stringResultCmd.exec(param, radioWrapper);
+            return run(STRING_RESULT_COMMANDS[idx], param, parseStartNs);
         }
     }
 
     for (size_t idx = 0; idx < UINT32_RESULT_COMMANDS_LIST_LENGTH; ++idx)
     {
-        Command<uint32_t> uintResultCmd = UINT32_RESULT_COMMANDS[idx];
-        if (cmd.compare(uintResultCmd.getCommandString()) == 0)
+        if (cmd.compare(UINT32_RESULT_COMMANDS[idx].getCommandString()) == 0)
         {
-            std::cout << "Executing: " << cmd << "(" << param << ")" << std::endl;
-            return std::to_string(uintResultCmd.exec(param, radioWrapper));
+            return run(UINT32_RESULT_COMMANDS[idx], param, parseStartNs);
         }
     }
 
     return "COMMAND NOT VALID!";
 }
 
+/**
+ * Executes command, which was parsed from parseStartNs on, and returns its
+ * result as text. The command, its parsing, the wrapper method it runs and
+ * the formatting of its result are each traced as a span.
+ */
+template<typename T>
+std::string CommandParser::run(const Command<T>& command, int param, uint64_t parseStartNs)
+{
+    const char* commandString = command.getCommandString().c_str();
+    BusTrace::CommandScope traceScope{commandString, parseStartNs};
+    BusTrace::record(BusTraceFormat::Op::PARSE, 0, 0, true, parseStartNs);
+    Log::get().info("Executing: %s(%d)", commandString, param);
+
+    // Catch a chip that has reset since the last command before acting on it
+    radioWrapper.serviceWatchdog();
+
+    uint64_t startUs = Util::getMonotonicTimeUs();
+    T result = command.exec(param, radioWrapper);
+    radioWrapper.recordCommandLatency(commandString, Util::getMonotonicTimeUs() - startUs);
+
+    BusTrace::Span formatSpan{BusTraceFormat::Op::FORMAT};
+    return formatResult(result);
+}
+
+std::string CommandParser::formatResult(RDA5807M::StatusResult result)
+{
+    return RDA5807M::statusResultToString(result);
+}
+
+std::string CommandParser::formatResult(std::string& result)
+{
+    return std::move(result);
+}
+
+std::string CommandParser::formatResult(uint32_t result)
+{
+    return std::to_string(result);
+}
+
 /**
  * Returns a list of commands supported by this interpreter.
  */
@@ -163,6 +233,7 @@ std::string CommandParser::getCommandStringList()
 /**
  * Commands with params are of the form:
  * <COMMAND>=<VAL>
+ * where VAL is decimal, or hex if prefixed with 0x
  *
  * Commands with no params are of the form:
  * <COMMAND>
@@ -196,7 +267,20 @@ bool CommandParser::parse(const std::string& unparsedCommand, std::string& comma
     }
     else
     {
-        param = std::stoi(matches[2].str());
+        // Hex if prefixed with 0x, otherwise decimal (even with leading
+        // zeros). A value that doesn't fit in an int is a parse error.
+        const std::string value = matches[2].str();
+        bool isHex = value.size() > 2 && (value[1] == 'x' || value[1] == 'X');
+        const char* digits = value.c_str() + (isHex ? 2 : 0);
+        char* end = nullptr;
+
+        errno = 0;
+        long parsed = std::strtol(digits, &end, isHex ? 16 : 10);
+        if (errno != 0 || end == digits || *end != '\0' || parsed > INT_MAX || parsed < INT_MIN)
+        {
+            return false;
+        }
+        param = static_cast<int>(parsed);
     }
 
     return true;
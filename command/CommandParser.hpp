@@ -35,6 +35,13 @@ private:
     bool parse(const std::string& unparsedCommand, std::string& command, int& param);
     std::string getCommandStringList();
 
+    template<typename T>
+    std::string run(const Command<T>& command, int param, uint64_t parseStartNs);
+
+    static std::string formatResult(RDA5807M::StatusResult result);
+    static std::string formatResult(std::string& result);
+    static std::string formatResult(uint32_t result);
+
     /////////////////////////////
     // Private class Constants //
     /////////////////////////////
@@ -0,0 +1,290 @@
+/**************************************************
+ * MiniCommandInterpreter.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+// Project includes
+#include "MiniCommandInterpreter.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "Util.hpp"
+
+// Static initialization
+const MiniCommandInterpreter::MiniCommand MiniCommandInterpreter::COMMANDS[] =
+{
+    { "HELP", &MiniCommandInterpreter::help, "No param. Lists commands" },
+    { "FREQ", &MiniCommandInterpreter::setFrequency, "Enter freq in as an integer" },
+    { "VOL", &MiniCommandInterpreter::setVolume, "Enter volume from 0 to 15" },
+    { "MUTE", &MiniCommandInterpreter::setMute, "1 to mute, 0 to unmute" },
+    { "ENABLE", &MiniCommandInterpreter::setEnable, "1 to enable/reset radio, 0 to disable" },
+    { "RDS", &MiniCommandInterpreter::setRds, "1 to enable RDS, 0 to disable" },
+    { "RSSI", &MiniCommandInterpreter::getRssi, "No param. Prints the RSSI" },
+    { "STATUS", &MiniCommandInterpreter::getStatus, "No param. Prints status info" },
+    { "REG", &MiniCommandInterpreter::getRegister, "Returns the local copy of the register addressed by the param" },
+    { "RDSPOLL", &MiniCommandInterpreter::pollRds, "Decodes RDS for param (in ms) milliseconds" }
+};
+
+const size_t MiniCommandInterpreter::COMMANDS_LIST_LENGTH = sizeof(COMMANDS) / sizeof(MiniCommand);
+
+// The same polling interval the wrapper uses for RDS
+static const int RDS_POLL_INTERVAL_MS = 10;
+static const useconds_t MICROS_IN_MILLIS = 1000;
+
+MiniCommandInterpreter::MiniCommandInterpreter(RDA5807M& radioParam, RdsDecoder& rdsDecoderParam) :
+        radio(radioParam), rdsDecoder(rdsDecoderParam)
+{
+}
+
+/**
+ * Runs the command in unparsedCommand and writes its null-terminated result
+ * to output. Returns the number of characters written, not counting the
+ * terminator.
+ */
+size_t MiniCommandInterpreter::execute(const char* unparsedCommand, char* output, size_t outputSize)
+{
+    if (outputSize == 0)
+    {
+        return 0;
+    }
+
+    char cmd[MAX_COMMAND_LENGTH + 1];
+    int param;
+
+    if (parse(unparsedCommand, cmd, param))
+    {
+        for (size_t idx = 0; idx < COMMANDS_LIST_LENGTH; ++idx)
+        {
+            if (std::strcmp(cmd, COMMANDS[idx].commandString) == 0)
+            {
+                return (this->*COMMANDS[idx].handler)(param, output, outputSize);
+            }
+        }
+    }
+
+    int written = std::snprintf(output, outputSize, "COMMAND NOT VALID!");
+    return clampWritten(written, outputSize);
+}
+
+/**
+ * Matches the same syntax as CommandParser, "NAME" or "NAME=123", without
+ * using std::regex. Lower case names are accepted and upper-cased.
+ */
+bool MiniCommandInterpreter::parse(const char* unparsedCommand, char* command, int& param)
+{
+    size_t length = 0;
+    const char* current = unparsedCommand;
+
+    while ((*current >= 'A' && *current <= 'Z') || (*current >= 'a' && *current <= 'z') ||
+           (*current >= '0' && *current <= '9'))
+    {
+        if (length == MAX_COMMAND_LENGTH)
+        {
+            return false;
+        }
+
+        char upper = *current;
+        if (upper >= 'a' && upper <= 'z')
+        {
+            upper = static_cast<char>(upper - 'a' + 'A');
+        }
+        command[length++] = upper;
+        ++current;
+    }
+    command[length] = '\0';
+
+    if (length == 0)
+    {
+        return false;
+    }
+
+    while (*current == '=')
+    {
+        ++current;
+    }
+
+    if (*current < '0' || *current > '9')
+    {
+        param = UNUSED_PARAM_VALUE;
+        return true;
+    }
+
+    // A number too big for an int isn't a valid parameter
+    param = 0;
+    while (*current >= '0' && *current <= '9')
+    {
+        if (param > (INT_MAX - 9) / 10)
+        {
+            return false;
+        }
+        param = param * 10 + (*current - '0');
+        ++current;
+    }
+
+    return true;
+}
+
+/**
+ * Converts an snprintf() result into the number of characters actually
+ * stored, accounting for truncation.
+ */
+size_t MiniCommandInterpreter::clampWritten(int written, size_t outputSize)
+{
+    if (written < 0)
+    {
+        return 0;
+    }
+    else if (static_cast<size_t>(written) >= outputSize)
+    {
+        return outputSize - 1;
+    }
+
+    return static_cast<size_t>(written);
+}
+
+size_t MiniCommandInterpreter::formatStatus(RDA5807M::StatusResult result, char* output, size_t outputSize)
+{
+    int written = std::snprintf(output, outputSize, "%s", RDA5807M::statusResultToCString(result));
+    return clampWritten(written, outputSize);
+}
+
+size_t MiniCommandInterpreter::help(int UNUSED, char* output, size_t outputSize)
+{
+    (void) UNUSED;
+
+    size_t used = 0;
+    for (size_t idx = 0; idx < COMMANDS_LIST_LENGTH && used + 1 < outputSize; ++idx)
+    {
+        int written = std::snprintf(output + used, outputSize - used, "%s: %s\n",
+                                    COMMANDS[idx].commandString, COMMANDS[idx].helpString);
+        if (written < 0)
+        {
+            break;
+        }
+        used += clampWritten(written, outputSize - used);
+    }
+
+    return used;
+}
+
+size_t MiniCommandInterpreter::setFrequency(int freq, char* output, size_t outputSize)
+{
+    if (freq < 0)
+    {
+        return formatStatus(RDA5807M::StatusResult::BELOW_MIN, output, outputSize);
+    }
+
+    RDA5807M::StatusResult result = radio.setFrequencyKhz(static_cast<uint32_t>(freq) * 100, false);
+    if (result != RDA5807M::StatusResult::SUCCESS)
+    {
+        return formatStatus(result, output, outputSize);
+    }
+
+    rdsDecoder.reset();
+
+    return formatStatus(radio.setTune(true), output, outputSize);
+}
+
+size_t MiniCommandInterpreter::setVolume(int vol, char* output, size_t outputSize)
+{
+    if (vol > RDA5807M::MAX_VOLUME)
+    {
+        return formatStatus(RDA5807M::StatusResult::ABOVE_MAX, output, outputSize);
+    }
+    else if (vol < 0)
+    {
+        return formatStatus(RDA5807M::StatusResult::BELOW_MIN, output, outputSize);
+    }
+
+    return formatStatus(radio.setVolume(static_cast<uint8_t>(vol)), output, outputSize);
+}
+
+size_t MiniCommandInterpreter::setMute(int muteEnable, char* output, size_t outputSize)
+{
+    return formatStatus(radio.setMute(Util::boolFromInteger(muteEnable)), output, outputSize);
+}
+
+size_t MiniCommandInterpreter::setEnable(int radioEnable, char* output, size_t outputSize)
+{
+    bool isEnableRequested = Util::boolFromInteger(radioEnable);
+
+    if (isEnableRequested)
+    {
+        radio.reset();
+    }
+
+    return formatStatus(radio.setEnabled(isEnableRequested), output, outputSize);
+}
+
+size_t MiniCommandInterpreter::setRds(int rdsEnable, char* output, size_t outputSize)
+{
+    return formatStatus(radio.setRdsMode(Util::boolFromInteger(rdsEnable)), output, outputSize);
+}
+
+size_t MiniCommandInterpreter::getRssi(int UNUSED, char* output, size_t outputSize)
+{
+    (void) UNUSED;
+
+    int written = std::snprintf(output, outputSize, "%u", radio.getRssi());
+    return clampWritten(written, outputSize);
+}
+
+size_t MiniCommandInterpreter::getStatus(int UNUSED, char* output, size_t outputSize)
+{
+    (void) UNUSED;
+
+    radio.readDeviceRegistersAndStoreLocally();
+
+    int written = std::snprintf(output, outputSize,
+                                "Seek/Tune complete: %s\nRDS Sync'd?: %s\nAudio type: %s\n"
+                                "Read channel: %u\nRSSI: 0x%02x\nIs this freq a station?: %s\n",
+                                radio.isStcComplete() ? "Complete" : "Not Complete",
+                                radio.isRdsDecoderSynchronized() ? "Synchronized" : "Not synchronized",
+                                radio.isStereoEnabled() ? "Stereo" : "Mono",
+                                radio.getReadChannel(),
+                                radio.getRssi(),
+                                radio.isFmTrue() ? "Yes" : "No");
+    return clampWritten(written, outputSize);
+}
+
+size_t MiniCommandInterpreter::getRegister(int reg, char* output, size_t outputSize)
+{
+    if (reg < 0 || reg > static_cast<int>(RDA5807M::Register::BLOCK_D))
+    {
+        return formatStatus(RDA5807M::StatusResult::ABOVE_MAX, output, outputSize);
+    }
+
+    uint16_t value = radio.getLocalRegisterContent(static_cast<RDA5807M::Register>(reg));
+    int written = std::snprintf(output, outputSize, "0x%02x: 0x%04x", reg, value);
+    return clampWritten(written, outputSize);
+}
+
+size_t MiniCommandInterpreter::pollRds(int ms, char* output, size_t outputSize)
+{
+    int numPolls = ms / RDS_POLL_INTERVAL_MS;
+    uint32_t groupsRead = 0;
+
+    for (int pollIdx = 0; pollIdx < numPolls; ++pollIdx)
+    {
+        RDA5807M::RdsGroup group;
+        if (radio.readRdsGroup(group))
+        {
+            ++groupsRead;
+            rdsDecoder.processGroup(group);
+        }
+
+        usleep(RDS_POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+    }
+
+    const RdsDecoder::RdsData& rds = rdsDecoder.getData();
+    int written = std::snprintf(output, outputSize, "Groups read: %u\nPI: 0x%04x\nPTY: %02u\nPS: %s\nRT: %s\n",
+                                groupsRead, rds.piCode, rds.programType, rds.programService, rds.radioText);
+    return clampWritten(written, outputSize);
+}
@@ -0,0 +1,87 @@
+/**************************************************
+ * MiniCommandInterpreter.hpp - Command interpreter for the freestanding profile
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef MINICOMMANDINTERPRETER_HPP
+#define MINICOMMANDINTERPRETER_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+
+/**
+ * A small subset of CommandParser that talks to the driver directly. It uses
+ * no regex, strings or heap, so it builds in the freestanding profile; all
+ * output is formatted into a caller-supplied buffer.
+ */
+class MiniCommandInterpreter
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // Longest command name that will be matched
+    static const size_t MAX_COMMAND_LENGTH = 16;
+
+    // When no parameter is specified for a command, this value is used
+    static const int UNUSED_PARAM_VALUE = -1;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    MiniCommandInterpreter(RDA5807M& radioParam, RdsDecoder& rdsDecoderParam);
+
+    size_t execute(const char* unparsedCommand, char* output, size_t outputSize);
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    typedef size_t (MiniCommandInterpreter::*Handler)(int param, char* output, size_t outputSize);
+
+    struct MiniCommand
+    {
+        const char* commandString;
+        Handler handler;
+        const char* helpString;
+    };
+
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const MiniCommand COMMANDS[];
+    static const size_t COMMANDS_LIST_LENGTH;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    static bool parse(const char* unparsedCommand, char* command, int& param);
+    static size_t clampWritten(int written, size_t outputSize);
+
+    size_t formatStatus(RDA5807M::StatusResult result, char* output, size_t outputSize);
+
+    size_t help(int param, char* output, size_t outputSize);
+    size_t setFrequency(int freq, char* output, size_t outputSize);
+    size_t setVolume(int vol, char* output, size_t outputSize);
+    size_t setMute(int muteEnable, char* output, size_t outputSize);
+    size_t setEnable(int radioEnable, char* output, size_t outputSize);
+    size_t setRds(int rdsEnable, char* output, size_t outputSize);
+    size_t getRssi(int param, char* output, size_t outputSize);
+    size_t getStatus(int param, char* output, size_t outputSize);
+    size_t getRegister(int reg, char* output, size_t outputSize);
+    size_t pollRds(int ms, char* output, size_t outputSize);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    RdsDecoder& rdsDecoder;
+};
+
+#endif  // ifndef MINICOMMANDINTERPRETER_HPP
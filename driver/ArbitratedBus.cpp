@@ -0,0 +1,126 @@
+/**************************************************
+ * ArbitratedBus.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "ArbitratedBus.hpp"
+#include "BusArbiter.hpp"
+#include "RDA5807MBus.hpp"
+
+ArbitratedBus::ArbitratedBus(RDA5807MBus& busParam, BusArbiter& arbiterParam) :
+        bus(busParam), arbiter(arbiterParam), batchDepth(0), holdingGrant(false)
+{
+}
+
+ArbitratedBus::~ArbitratedBus()
+{
+    if (holdingGrant)
+    {
+        arbiter.release();
+    }
+}
+
+bool ArbitratedBus::writeRegister(uint8_t reg, uint16_t value)
+{
+    startTransaction();
+    bool written = bus.writeRegister(reg, value);
+    finishTransaction();
+    return written;
+}
+
+bool ArbitratedBus::writeRegistersSequential(const uint16_t* values, uint8_t count)
+{
+    startTransaction();
+    bool written = bus.writeRegistersSequential(values, count);
+    finishTransaction();
+    return written;
+}
+
+bool ArbitratedBus::readRegister(uint8_t reg, uint16_t& value)
+{
+    startTransaction();
+    bool read = bus.readRegister(reg, value);
+    finishTransaction();
+    return read;
+}
+
+bool ArbitratedBus::readRegisters(const uint8_t* regs, uint16_t* values, uint8_t count)
+{
+    startTransaction();
+    bool read = bus.readRegisters(regs, values, count);
+    finishTransaction();
+    return read;
+}
+
+bool ArbitratedBus::writeRegisters(const uint8_t* regs, const uint16_t* values, uint8_t count)
+{
+    startTransaction();
+    bool written = bus.writeRegisters(regs, values, count);
+    finishTransaction();
+    return written;
+}
+
+void ArbitratedBus::beginBatch()
+{
+    ++batchDepth;
+    bus.beginBatch();
+}
+
+void ArbitratedBus::endBatch()
+{
+    bus.endBatch();
+    if (batchDepth > 0)
+    {
+        --batchDepth;
+    }
+
+    if (batchDepth == 0 && holdingGrant)
+    {
+        holdingGrant = false;
+        arbiter.release();
+    }
+}
+
+/**
+ * Changing the clock takes a grant, so it doesn't happen in the middle of
+ * another device's transfer
+ */
+bool ArbitratedBus::setClockRate(ClockRate rate)
+{
+    startTransaction();
+    bool set = bus.setClockRate(rate);
+    finishTransaction();
+    return set;
+}
+
+/**
+ * Gets a grant for the next transaction, reusing the one held from earlier
+ * in the batch if the arbiter allows it
+ */
+void ArbitratedBus::startTransaction()
+{
+    if (holdingGrant)
+    {
+        if (arbiter.extendGrant())
+        {
+            return;
+        }
+        arbiter.release();
+    }
+
+    arbiter.acquire(BusArbiter::getCurrentClass());
+    holdingGrant = true;
+}
+
+void ArbitratedBus::finishTransaction()
+{
+    if (batchDepth == 0)
+    {
+        holdingGrant = false;
+        arbiter.release();
+    }
+}
@@ -0,0 +1,67 @@
+/**************************************************
+ * ArbitratedBus.hpp - RDA5807MBus that takes turns on a shared bus
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef ARBITRATEDBUS_HPP
+#define ARBITRATEDBUS_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "BusArbiter.hpp"
+#include "RDA5807MBus.hpp"
+
+/**
+ * Passes the driver's transactions on to another bus, each one under a
+ * grant from a BusArbiter in the calling thread's traffic class (see
+ * BusArbiter::ClassScope). Transactions inside a batch share a grant for
+ * as long as the arbiter lets them. A multi-register submission can't be
+ * split, so it counts as one transaction. Like the driver, it is meant
+ * to be used from one thread at a time.
+ */
+class ArbitratedBus : public RDA5807MBus
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    ArbitratedBus(RDA5807MBus& busParam, BusArbiter& arbiterParam);
+
+    ~ArbitratedBus();
+
+    bool writeRegister(uint8_t reg, uint16_t value) override;
+
+    bool writeRegistersSequential(const uint16_t* values, uint8_t count) override;
+
+    bool readRegister(uint8_t reg, uint16_t& value) override;
+
+    bool readRegisters(const uint8_t* regs, uint16_t* values, uint8_t count) override;
+
+    bool writeRegisters(const uint8_t* regs, const uint16_t* values, uint8_t count) override;
+
+    void beginBatch() override;
+
+    void endBatch() override;
+
+    bool setClockRate(ClockRate rate) override;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void startTransaction();
+    void finishTransaction();
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807MBus& bus;
+    BusArbiter& arbiter;
+
+    uint8_t batchDepth;
+    bool holdingGrant;
+};
+
+#endif  // ifndef ARBITRATEDBUS_HPP
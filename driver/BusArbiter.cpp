@@ -0,0 +1,331 @@
+/**************************************************
+ * BusArbiter.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+// Project includes
+#include "BusArbiter.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    const char* const TRAFFIC_CLASS_NAMES[BusArbiter::TRAFFIC_CLASS_COUNT] = { "User tune", "RDS", "External",
+                                                                               "Background scan" };
+
+    // Polling the status register every 5 ms while tuning, plus group reads
+    // when escalated, comes to well under this
+    const BusArbiter::RateLimit RDS_LIMIT = { 300, 32 };
+
+    // About a tenth of a 100 kHz bus
+    const BusArbiter::RateLimit BACKGROUND_SCAN_LIMIT = { 200, 16 };
+
+    thread_local BusArbiter::TrafficClass currentClass = BusArbiter::TrafficClass::USER_TUNE;
+
+    uint8_t getWaitBucket(uint64_t waitUs)
+    {
+        uint8_t bucket = 0;
+        while (waitUs > 0 && bucket < BusArbiter::WAIT_BUCKET_COUNT - 1)
+        {
+            waitUs >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+}
+
+BusArbiter::BusArbiter() :
+        nextTicket(0), busy(false), holderClass(0), transactionsInGrant(0), grantedUs(0), externalPassedOver(0)
+{
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    for (ClassState& state : classes)
+    {
+        state.limit = RateLimit { 0, 0 };
+        state.tokens = 0;
+        state.refilledUs = nowUs;
+        std::memset(&state.stats, 0, sizeof(state.stats));
+    }
+
+    setRateLimit(TrafficClass::RDS, RDS_LIMIT);
+    setRateLimit(TrafficClass::BACKGROUND_SCAN, BACKGROUND_SCAN_LIMIT);
+}
+
+/**
+ * Limits trafficClass to limit.transactionsPerSecond, allowing bursts of
+ * limit.burst. The class starts with a full bucket.
+ */
+void BusArbiter::setRateLimit(TrafficClass trafficClass, const RateLimit& limit)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    ClassState& state = classes[static_cast<uint8_t>(trafficClass)];
+    state.limit = limit;
+    if (state.limit.burst == 0)
+    {
+        state.limit.burst = 1;
+    }
+    state.tokens = static_cast<uint64_t>(state.limit.burst) * TOKEN_SCALE;
+    state.refilledUs = Util::getMonotonicTimeUs();
+
+    // Waiters may have been waiting for tokens under the old limit
+    busReleased.notify_all();
+}
+
+BusArbiter::RateLimit BusArbiter::getRateLimit(TrafficClass trafficClass) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return classes[static_cast<uint8_t>(trafficClass)].limit;
+}
+
+/**
+ * Waits in line for the bus. The wait, from here to the grant, is what
+ * the class's latency statistics measure.
+ */
+void BusArbiter::acquire(TrafficClass trafficClass)
+{
+    uint8_t classIdx = static_cast<uint8_t>(trafficClass);
+    ClassState& state = classes[classIdx];
+
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t requestedUs = Util::getMonotonicTimeUs();
+    uint64_t ticket = nextTicket++;
+    state.waiters.push_back(ticket);
+
+    bool throttled = false;
+    while (true)
+    {
+        uint64_t nowUs = Util::getMonotonicTimeUs();
+        if (!busy && state.waiters.front() == ticket && pickNextClass(nowUs) == classIdx)
+        {
+            break;
+        }
+
+        if (hasToken(state, nowUs))
+        {
+            busReleased.wait(guard);
+        }
+        else
+        {
+            throttled = true;
+            busReleased.wait_for(guard, std::chrono::microseconds(getTokenDueUs(state) - nowUs));
+        }
+    }
+
+    state.waiters.pop_front();
+    takeToken(state);
+
+    if (trafficClass == TrafficClass::EXTERNAL)
+    {
+        externalPassedOver = 0;
+    }
+    else if (!classes[static_cast<uint8_t>(TrafficClass::EXTERNAL)].waiters.empty())
+    {
+        ++externalPassedOver;
+    }
+
+    busy = true;
+    holderClass = classIdx;
+    transactionsInGrant = 1;
+    grantedUs = Util::getMonotonicTimeUs();
+
+    uint64_t waitUs = grantedUs - requestedUs;
+    ++state.stats.grants;
+    ++state.stats.transactions;
+    state.stats.throttledGrants += throttled ? 1 : 0;
+    state.stats.totalWaitUs += waitUs;
+    state.stats.maxWaitUs = (waitUs > state.stats.maxWaitUs) ? waitUs : state.stats.maxWaitUs;
+    ++state.stats.waitHistogram[getWaitBucket(waitUs)];
+}
+
+/**
+ * Returns true if the holder may do another transaction without giving up
+ * the bus: it has a token, nobody who outranks it or comes from outside
+ * is waiting, and the batch is short or nobody is waiting at all.
+ * Otherwise the holder should release and acquire again.
+ */
+bool BusArbiter::extendGrant()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    ClassState& state = classes[holderClass];
+    if (!busy || shouldYield())
+    {
+        return false;
+    }
+
+    if (!hasToken(state, Util::getMonotonicTimeUs()))
+    {
+        return false;
+    }
+
+    takeToken(state);
+    ++state.stats.transactions;
+    if (transactionsInGrant < UINT8_MAX)
+    {
+        ++transactionsInGrant;
+    }
+    return true;
+}
+
+void BusArbiter::release()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!busy)
+    {
+        return;
+    }
+
+    busy = false;
+    classes[holderClass].stats.busyUs += Util::getMonotonicTimeUs() - grantedUs;
+    busReleased.notify_all();
+}
+
+BusArbiter::ClassStats BusArbiter::getStats(TrafficClass trafficClass) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return classes[static_cast<uint8_t>(trafficClass)].stats;
+}
+
+void BusArbiter::resetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (ClassState& state : classes)
+    {
+        std::memset(&state.stats, 0, sizeof(state.stats));
+    }
+}
+
+/**
+ * Returns the wait that percent of the grants in stats didn't exceed, to
+ * the power of two above it
+ */
+uint64_t BusArbiter::getWaitPercentileUs(const ClassStats& stats, uint8_t percent)
+{
+    uint64_t threshold = (stats.grants * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t bucket = 0; bucket < WAIT_BUCKET_COUNT; ++bucket)
+    {
+        seen += stats.waitHistogram[bucket];
+        if (seen >= threshold && seen > 0)
+        {
+            uint64_t boundUs = (bucket == 0) ? 0 : (1ULL << bucket);
+            return (boundUs < stats.maxWaitUs) ? boundUs : stats.maxWaitUs;
+        }
+    }
+    return stats.maxWaitUs;
+}
+
+const char* BusArbiter::trafficClassToCString(TrafficClass trafficClass)
+{
+    return TRAFFIC_CLASS_NAMES[static_cast<uint8_t>(trafficClass)];
+}
+
+BusArbiter::TrafficClass BusArbiter::getCurrentClass()
+{
+    return currentClass;
+}
+
+BusArbiter::ClassScope::ClassScope(TrafficClass trafficClass) : previousClass(currentClass)
+{
+    currentClass = trafficClass;
+}
+
+BusArbiter::ClassScope::~ClassScope()
+{
+    currentClass = previousClass;
+}
+
+BusArbiter::Grant::Grant(BusArbiter& arbiterParam, TrafficClass trafficClass) : arbiter(arbiterParam)
+{
+    arbiter.acquire(trafficClass);
+}
+
+BusArbiter::Grant::~Grant()
+{
+    arbiter.release();
+}
+
+/**
+ * Adds the tokens earned since the last refill, up to the burst size.
+ * Must be called with the lock held, as must the token functions below.
+ */
+void BusArbiter::refill(ClassState& state, uint64_t nowUs)
+{
+    if (state.limit.transactionsPerSecond == 0 || nowUs <= state.refilledUs)
+    {
+        return;
+    }
+
+    uint64_t capacity = static_cast<uint64_t>(state.limit.burst) * TOKEN_SCALE;
+    uint64_t earned = (nowUs - state.refilledUs) * state.limit.transactionsPerSecond;
+    state.tokens = (capacity - state.tokens > earned) ? state.tokens + earned : capacity;
+    state.refilledUs = nowUs;
+}
+
+bool BusArbiter::hasToken(ClassState& state, uint64_t nowUs)
+{
+    refill(state, nowUs);
+    return state.limit.transactionsPerSecond == 0 || state.tokens >= TOKEN_SCALE;
+}
+
+// When the class will next have a whole token
+uint64_t BusArbiter::getTokenDueUs(const ClassState& state) const
+{
+    uint64_t missing = (state.tokens < TOKEN_SCALE) ? TOKEN_SCALE - state.tokens : 0;
+    uint64_t rate = state.limit.transactionsPerSecond;
+    return state.refilledUs + (missing + rate - 1) / rate;
+}
+
+void BusArbiter::takeToken(ClassState& state)
+{
+    if (state.limit.transactionsPerSecond != 0)
+    {
+        state.tokens -= TOKEN_SCALE;
+    }
+}
+
+/**
+ * Returns the class whose oldest waiter should get the bus next, or -1 if
+ * nobody can have it yet
+ */
+int BusArbiter::pickNextClass(uint64_t nowUs)
+{
+    ClassState& external = classes[static_cast<uint8_t>(TrafficClass::EXTERNAL)];
+    if (externalPassedOver >= EXTERNAL_FAIRNESS_GRANTS && !external.waiters.empty() && hasToken(external, nowUs))
+    {
+        return static_cast<int>(TrafficClass::EXTERNAL);
+    }
+
+    for (uint8_t classIdx = 0; classIdx < TRAFFIC_CLASS_COUNT; ++classIdx)
+    {
+        if (!classes[classIdx].waiters.empty() && hasToken(classes[classIdx], nowUs))
+        {
+            return classIdx;
+        }
+    }
+    return -1;
+}
+
+bool BusArbiter::shouldYield() const
+{
+    bool othersWaiting = false;
+    for (uint8_t classIdx = 0; classIdx < TRAFFIC_CLASS_COUNT; ++classIdx)
+    {
+        if (classes[classIdx].waiters.empty())
+        {
+            continue;
+        }
+
+        if (classIdx < holderClass || classIdx == static_cast<uint8_t>(TrafficClass::EXTERNAL))
+        {
+            return true;
+        }
+        othersWaiting = true;
+    }
+    return othersWaiting && transactionsInGrant >= MAX_BATCH_TRANSACTIONS;
+}
@@ -0,0 +1,199 @@
+/**************************************************
+ * BusArbiter.hpp - Shares one I2C bus between the radio and other devices
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSARBITER_HPP
+#define BUSARBITER_HPP
+
+// System includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Project includes
+//<none>
+
+/**
+ * Decides who gets the bus next when the radio shares it with sensors,
+ * EEPROMs and the like. Every user asks for a grant in a traffic class
+ * and holds it for one transaction, or for a batch of them:
+ *
+ *   USER_TUNE        commands someone is waiting on
+ *   RDS              RDS acquisition, which has a group period to meet
+ *   EXTERNAL         other devices on the bus
+ *   BACKGROUND_SCAN  sweeps and surveys, which can take the bus for
+ *                    minutes if nothing stops them
+ *
+ * The bus goes to the oldest waiter of the highest class that has a
+ * token. Each class can have a token bucket limiting its transaction
+ * rate; by default only RDS and background scans do.
+ *
+ * A batch of transactions keeps its grant until somebody of a higher
+ * class or an EXTERNAL client starts waiting, or until it has done
+ * MAX_BATCH_TRANSACTIONS while anybody else is. A waiting EXTERNAL client
+ * is never passed over more than EXTERNAL_FAIRNESS_GRANTS times, so other
+ * devices wait for a transaction or two however busy the radio keeps the
+ * bus.
+ *
+ * Only users in this process are arbitrated. Safe to use from any thread.
+ */
+class BusArbiter
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t MAX_BATCH_TRANSACTIONS = 8;
+    static const uint8_t EXTERNAL_FAIRNESS_GRANTS = 1;
+
+    // Waits are counted in powers of two of microseconds: bucket 0 is
+    // under 1 us, bucket n up to 2^n us. The last one takes the rest.
+    static const uint8_t WAIT_BUCKET_COUNT = 24;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    // In order of priority
+    enum class TrafficClass {USER_TUNE = 0, RDS = 1, EXTERNAL = 2, BACKGROUND_SCAN = 3};
+    static const uint8_t TRAFFIC_CLASS_COUNT = 4;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct RateLimit
+    {
+        // 0 for no limit
+        uint32_t transactionsPerSecond;
+
+        // Transactions that can go back to back after the class was idle
+        uint32_t burst;
+    };
+
+    struct ClassStats
+    {
+        uint64_t grants;
+        uint64_t transactions;
+
+        // Grants that had to wait for a token
+        uint64_t throttledGrants;
+
+        // From asking for the bus to getting it
+        uint64_t totalWaitUs;
+        uint64_t maxWaitUs;
+        uint64_t waitHistogram[WAIT_BUCKET_COUNT];
+
+        // Time the class held the bus
+        uint64_t busyUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    BusArbiter();
+
+    void setRateLimit(TrafficClass trafficClass, const RateLimit& limit);
+    RateLimit getRateLimit(TrafficClass trafficClass) const;
+
+    // Blocks until the bus is granted. The grant covers one transaction.
+    void acquire(TrafficClass trafficClass);
+
+    // Asks to do one more transaction under the current grant
+    bool extendGrant();
+
+    void release();
+
+    ClassStats getStats(TrafficClass trafficClass) const;
+    void resetStats();
+
+    static uint64_t getWaitPercentileUs(const ClassStats& stats, uint8_t percent);
+
+    static const char* trafficClassToCString(TrafficClass trafficClass);
+
+    // The class bus traffic on this thread is in; USER_TUNE unless a
+    // ClassScope says otherwise
+    static TrafficClass getCurrentClass();
+
+    /**
+     * Puts bus traffic on this thread in a class for the life of the
+     * scope. Scopes nest.
+     */
+    class ClassScope
+    {
+    public:
+        explicit ClassScope(TrafficClass trafficClass);
+
+        ~ClassScope();
+
+    private:
+        TrafficClass previousClass;
+    };
+
+    /**
+     * Holds the bus for the life of the scope, for clients that talk to
+     * their devices directly
+     */
+    class Grant
+    {
+    public:
+        Grant(BusArbiter& arbiterParam, TrafficClass trafficClass);
+
+        ~Grant();
+
+    private:
+        BusArbiter& arbiter;
+    };
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    // Tokens are kept in millionths, so that refilling by the microsecond
+    // stays exact
+    static const uint64_t TOKEN_SCALE = 1000000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct ClassState
+    {
+        RateLimit limit;
+        uint64_t tokens;
+        uint64_t refilledUs;
+
+        // Tickets of the threads waiting, oldest first
+        std::deque<uint64_t> waiters;
+
+        ClassStats stats;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void refill(ClassState& state, uint64_t nowUs);
+    bool hasToken(ClassState& state, uint64_t nowUs);
+    uint64_t getTokenDueUs(const ClassState& state) const;
+    void takeToken(ClassState& state);
+    int pickNextClass(uint64_t nowUs);
+    bool shouldYield() const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    mutable std::mutex lock;
+    std::condition_variable busReleased;
+
+    ClassState classes[TRAFFIC_CLASS_COUNT];
+    uint64_t nextTicket;
+
+    bool busy;
+    uint8_t holderClass;
+    uint8_t transactionsInGrant;
+    uint64_t grantedUs;
+
+    // Grants given to other classes while an EXTERNAL client waited
+    uint8_t externalPassedOver;
+};
+
+#endif  // ifndef BUSARBITER_HPP
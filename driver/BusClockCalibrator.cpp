@@ -0,0 +1,392 @@
+/**************************************************
+ * BusClockCalibrator.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+// Project includes
+#include "BusClockCalibrator.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RDA5807MWatchdog.hpp"
+#include "Util.hpp"
+
+// Static variable initialization
+const char* const BusClockCalibrator::DEFAULT_PATH = "/var/tmp/rda5807m_i2c_clock.bin";
+
+namespace
+{
+    // Indexed by RDA5807MBus::ClockRate
+    const uint32_t CLOCK_RATE_KHZ[] = { 100, 400, 3400 };
+
+    // Written into the scratch fields in turn: all clear, all set, the two
+    // alternating patterns, then a one walking across the register
+    const uint16_t FIXED_PATTERNS[] = { 0x0000, 0xFFFF, 0x5555, 0xAAAA };
+    const uint8_t FIXED_PATTERN_COUNT = sizeof(FIXED_PATTERNS) / sizeof(FIXED_PATTERNS[0]);
+
+    // A status refresh is seven SMBus word reads. Each is a start, the
+    // address, the register, a repeated start, the address again and two
+    // data bytes, every byte with its acknowledge bit, and a stop.
+    const uint32_t REFRESH_REGISTERS = 7;
+    const uint32_t SMBUS_WORD_READ_BITS = 47;
+
+    uint16_t patternForPass(uint32_t passIdx)
+    {
+        uint32_t patternIdx = passIdx % (FIXED_PATTERN_COUNT + 16U);
+        if (patternIdx < FIXED_PATTERN_COUNT)
+        {
+            return FIXED_PATTERNS[patternIdx];
+        }
+        return static_cast<uint16_t>(1U << (patternIdx - FIXED_PATTERN_COUNT));
+    }
+
+    uint64_t nowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+BusClockCalibrator::BusClockCalibrator(RDA5807M& radioParam) : radio(radioParam)
+{
+    savedScratchRegisters[0] = 0;
+    savedScratchRegisters[1] = 0;
+}
+
+/**
+ * Measures every rate, slowest first, then leaves the bus on the fastest
+ * stable one
+ */
+BusClockCalibrator::Calibration BusClockCalibrator::calibrate(const char* path)
+{
+    Calibration calibration;
+    std::memset(&calibration, 0, sizeof(calibration));
+    calibration.chosen = RDA5807MBus::ClockRate::STANDARD;
+
+    savedScratchRegisters[0] = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x05);
+    savedScratchRegisters[1] = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x07);
+
+    for (uint8_t rateIdx = 0; rateIdx < RDA5807MBus::CLOCK_RATE_COUNT; ++rateIdx)
+    {
+        RateResult& result = calibration.rates[rateIdx];
+        result = measure(static_cast<RDA5807MBus::ClockRate>(rateIdx), CALIBRATION_PASSES);
+        if (result.stable)
+        {
+            calibration.found = true;
+            calibration.chosen = result.rate;
+        }
+    }
+
+    radio.setBusClockRate(calibration.chosen);
+    calibration.restored = restoreScratchRegisters();
+    calibration.saved = calibration.found && path != nullptr && save(path, calibration.chosen);
+    return calibration;
+}
+
+/**
+ * Sets the rate saved in path and validates it, stepping down until a rate
+ * passes. A lower rate that passes replaces the saved one. If none does,
+ * the bus is left on STANDARD and the file as it was.
+ */
+BusClockCalibrator::Validation BusClockCalibrator::restore(const char* path)
+{
+    uint64_t startUs = Util::getMonotonicTimeUs();
+
+    Validation validation;
+    std::memset(&validation, 0, sizeof(validation));
+    validation.saved = RDA5807MBus::ClockRate::STANDARD;
+    validation.chosen = RDA5807MBus::ClockRate::STANDARD;
+
+    validation.found = load(path, validation.saved);
+    if (!validation.found)
+    {
+        return validation;
+    }
+
+    savedScratchRegisters[0] = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x05);
+    savedScratchRegisters[1] = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x07);
+
+    for (int rateIdx = static_cast<int>(validation.saved); rateIdx >= 0 && !validation.validated; --rateIdx)
+    {
+        RDA5807MBus::ClockRate rate = static_cast<RDA5807MBus::ClockRate>(rateIdx);
+        if (measure(rate, VALIDATION_PASSES).stable)
+        {
+            validation.validated = true;
+            validation.chosen = rate;
+        }
+    }
+
+    if (!validation.validated)
+    {
+        radio.setBusClockRate(RDA5807MBus::ClockRate::STANDARD);
+    }
+    restoreScratchRegisters();
+
+    if (validation.validated && validation.chosen != validation.saved)
+    {
+        save(path, validation.chosen);
+    }
+
+    validation.elapsedUs = Util::getMonotonicTimeUs() - startUs;
+    return validation;
+}
+
+/**
+ * Sets the rate saved in path without running any passes, so nothing is
+ * written to the radio. If the bus won't take the rate it is left on
+ * STANDARD. validated is always false.
+ */
+BusClockCalibrator::Validation BusClockCalibrator::apply(const char* path)
+{
+    uint64_t startUs = Util::getMonotonicTimeUs();
+
+    Validation validation;
+    std::memset(&validation, 0, sizeof(validation));
+    validation.saved = RDA5807MBus::ClockRate::STANDARD;
+    validation.chosen = RDA5807MBus::ClockRate::STANDARD;
+
+    validation.found = load(path, validation.saved);
+    if (validation.found && radio.setBusClockRate(validation.saved) == RDA5807M::StatusResult::SUCCESS)
+    {
+        validation.chosen = validation.saved;
+    }
+
+    validation.elapsedUs = Util::getMonotonicTimeUs() - startUs;
+    return validation;
+}
+
+/**
+ * Times the given number of status refreshes at each rate
+ */
+BusClockCalibrator::Benchmark BusClockCalibrator::benchmark(uint32_t refreshes, const char* path)
+{
+    Benchmark benchmark;
+    std::memset(&benchmark, 0, sizeof(benchmark));
+
+    for (uint8_t rateIdx = 0; rateIdx < RDA5807MBus::CLOCK_RATE_COUNT; ++rateIdx)
+    {
+        RefreshThroughput& throughput = benchmark.rates[rateIdx];
+        throughput.rate = static_cast<RDA5807MBus::ClockRate>(rateIdx);
+        throughput.wireLimitPerSecond = (rateToKhz(throughput.rate) * 1000.0) /
+                                        (REFRESH_REGISTERS * SMBUS_WORD_READ_BITS);
+
+        throughput.supported = (radio.setBusClockRate(throughput.rate) == RDA5807M::StatusResult::SUCCESS);
+        if (!throughput.supported || refreshes == 0)
+        {
+            continue;
+        }
+
+        RDA5807M::BusStats before = radio.getBusStats();
+        uint64_t startNs = nowNs();
+        for (uint32_t refreshIdx = 0; refreshIdx < refreshes; ++refreshIdx)
+        {
+            radio.readDeviceRegistersAndStoreLocally();
+        }
+        uint64_t elapsedNs = nowNs() - startNs;
+        RDA5807M::BusStats after = radio.getBusStats();
+
+        throughput.refreshes = refreshes;
+        throughput.busErrors = after.readErrors - before.readErrors;
+        throughput.refreshesPerSecond = (elapsedNs == 0) ? 0.0 : (refreshes * 1e9) / elapsedNs;
+    }
+
+    benchmark.restoredRate = RDA5807MBus::ClockRate::STANDARD;
+    if (path != nullptr)
+    {
+        load(path, benchmark.restoredRate);
+    }
+    radio.setBusClockRate(benchmark.restoredRate);
+
+    // Don't leave whatever the fastest rate garbled in the driver's copy
+    radio.readDeviceRegistersAndStoreLocally();
+    return benchmark;
+}
+
+/**
+ * Writes rate to a temporary file next to path and renames it over path.
+ * The directory is world-writable, so the temporary file must be one this
+ * call created: whatever is at its path, a link included, is removed
+ * first, and it is opened exclusively.
+ */
+bool BusClockCalibrator::save(const char* path, RDA5807MBus::ClockRate rate)
+{
+    FileContents contents;
+    std::memset(&contents, 0, sizeof(contents));
+    contents.magic = FILE_MAGIC;
+    contents.formatVersion = FORMAT_VERSION;
+    contents.rate = static_cast<uint16_t>(rate);
+    contents.checksum = computeChecksum(contents);
+
+    std::string tempPath = std::string(path) + ".tmp";
+    unlink(tempPath.c_str());
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool written = write(fd, &contents, sizeof(contents)) == static_cast<ssize_t>(sizeof(contents));
+    written = (close(fd) == 0) && written;
+    if (!written || std::rename(tempPath.c_str(), path) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BusClockCalibrator::load(const char* path, RDA5807MBus::ClockRate& rate)
+{
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    FileContents contents;
+    bool read = std::fread(&contents, sizeof(contents), 1, file) == 1;
+    std::fclose(file);
+
+    if (!read || contents.magic != FILE_MAGIC || contents.formatVersion != FORMAT_VERSION ||
+        contents.checksum != computeChecksum(contents) || contents.rate >= RDA5807MBus::CLOCK_RATE_COUNT)
+    {
+        return false;
+    }
+
+    rate = static_cast<RDA5807MBus::ClockRate>(contents.rate);
+    return true;
+}
+
+uint32_t BusClockCalibrator::rateToKhz(RDA5807MBus::ClockRate rate)
+{
+    return CLOCK_RATE_KHZ[static_cast<uint8_t>(rate)];
+}
+
+/**
+ * Sets rate and runs passes verification passes at it. Transactions and
+ * bus errors are the driver's counts over the passes.
+ */
+BusClockCalibrator::RateResult BusClockCalibrator::measure(RDA5807MBus::ClockRate rate, uint32_t passes)
+{
+    RateResult result;
+    std::memset(&result, 0, sizeof(result));
+    result.rate = rate;
+
+    result.supported = (radio.setBusClockRate(rate) == RDA5807M::StatusResult::SUCCESS);
+    if (!result.supported || passes == 0)
+    {
+        return result;
+    }
+
+    RDA5807M::BusStats before = radio.getBusStats();
+    uint64_t totalNs = 0;
+    for (uint32_t passIdx = 0; passIdx < passes; ++passIdx)
+    {
+        uint64_t startNs = nowNs();
+        runPass(passIdx, result);
+        uint64_t passNs = nowNs() - startNs;
+
+        totalNs += passNs;
+        if (passNs > result.maxPassNs)
+        {
+            result.maxPassNs = passNs;
+        }
+    }
+    RDA5807M::BusStats after = radio.getBusStats();
+
+    result.passes = passes;
+    result.meanPassNs = totalNs / passes;
+    result.transactions = (after.reads - before.reads) + (after.writes - before.writes);
+    result.busErrors = (after.readErrors - before.readErrors) + (after.writeErrors - before.writeErrors);
+    result.stable = (result.busErrors == 0 && result.mismatches == 0);
+    return result;
+}
+
+/**
+ * One pass: CHIP_ID, the writable registers against the driver's copy,
+ * and a write and read back of the next pattern in each scratch field.
+ * Register 0x07 gets the complement, so both levels go over the wire in
+ * every pass.
+ */
+void BusClockCalibrator::runPass(uint32_t passIdx, RateResult& result)
+{
+    readBack(RDA5807M::Register::REG_0x00, static_cast<uint16_t>(RDA5807M::CHIP_ID_VALUE << 8), CHIP_ID, result);
+
+    for (uint8_t reg = RDA5807M::Register::REG_0x02; reg <= RDA5807M::Register::REG_0x07; ++reg)
+    {
+        RDA5807M::Register writableReg = static_cast<RDA5807M::Register>(reg);
+        readBack(writableReg, radio.getLocalRegisterContent(writableReg),
+                 RDA5807MWatchdog::getVerifyMask(writableReg), result);
+    }
+
+    uint16_t pattern = patternForPass(passIdx);
+    writeAndReadBack(RDA5807M::Register::REG_0x05, SEEKTH, pattern, result);
+    writeAndReadBack(RDA5807M::Register::REG_0x07, SEEK_TH_OLD, static_cast<uint16_t>(~pattern), result);
+}
+
+/**
+ * Reads reg and counts a mismatch if the bits in mask aren't as in
+ * expected. A failed read is left to the driver's error count.
+ */
+void BusClockCalibrator::readBack(RDA5807M::Register reg, uint16_t expected, uint16_t mask, RateResult& result)
+{
+    uint16_t actual = 0;
+    if (radio.readRegisterFromDevice(reg, actual) && (actual & mask) != (expected & mask))
+    {
+        ++result.mismatches;
+    }
+}
+
+/**
+ * Puts pattern into field of reg and reads it back. A write that fails
+ * most likely never reached the chip, so the driver's copy is put back.
+ */
+void BusClockCalibrator::writeAndReadBack(RDA5807M::Register reg, uint16_t field, uint16_t pattern,
+                                          RateResult& result)
+{
+    uint16_t previous = radio.getLocalRegisterContent(reg);
+    uint16_t value = static_cast<uint16_t>((previous & ~field) | (pattern & field));
+
+    radio.setRegister(reg, value, 0xFFFF);
+    if (radio.writeRegisterToDevice(reg) != RDA5807M::StatusResult::SUCCESS)
+    {
+        radio.setRegister(reg, previous, 0xFFFF);
+        return;
+    }
+    readBack(reg, value, RDA5807MWatchdog::getVerifyMask(reg), result);
+}
+
+/**
+ * Writes registers 0x05 and 0x07 back as they were before the first pass
+ */
+bool BusClockCalibrator::restoreScratchRegisters()
+{
+    radio.setRegister(RDA5807M::Register::REG_0x05, savedScratchRegisters[0], 0xFFFF);
+    radio.setRegister(RDA5807M::Register::REG_0x07, savedScratchRegisters[1], 0xFFFF);
+
+    bool restored = (radio.writeRegisterToDevice(RDA5807M::Register::REG_0x05) == RDA5807M::StatusResult::SUCCESS);
+    restored = (radio.writeRegisterToDevice(RDA5807M::Register::REG_0x07) == RDA5807M::StatusResult::SUCCESS) &&
+               restored;
+    return restored;
+}
+
+uint16_t BusClockCalibrator::computeChecksum(const FileContents& contents)
+{
+    uint32_t sum = (contents.magic >> 16) + (contents.magic & 0xFFFF) + contents.formatVersion + contents.rate;
+
+    // Fold the carries back in
+    while ((sum >> 16) != 0)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
@@ -0,0 +1,175 @@
+/**************************************************
+ * BusClockCalibrator.hpp - Finds the fastest I2C clock the radio works at
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSCLOCKCALIBRATOR_HPP
+#define BUSCLOCKCALIBRATOR_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
+
+/**
+ * Steps the radio's bus through its clock rates, slowest first, and runs
+ * verification passes at each. A pass reads CHIP_ID, reads back the
+ * writable registers against the driver's copy, and writes patterns into
+ * the seek threshold fields of registers 0x05 and 0x07 and reads them
+ * back. Only seeking uses those fields, so the radio keeps playing; they
+ * are put back afterwards. A rate is stable if none of its transactions
+ * failed and nothing read back wrong, and the fastest stable rate is
+ * chosen and saved.
+ *
+ * The saved rate is a fixed-size record with a checksum, replaced
+ * atomically, like RadioStateFile's. On startup restore() sets it again
+ * and re-validates it with a few passes, stepping down a rate at a time
+ * if it no longer holds. apply() only sets it, for a warm attach, where
+ * the validation writes would disturb a radio that is already playing.
+ *
+ * Buses that can't set their clock (i2c-dev, where it is the kernel's)
+ * show every rate as unsupported. Meant to be called from the thread
+ * that owns the radio.
+ */
+class BusClockCalibrator
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const char* const DEFAULT_PATH;
+
+    static const uint32_t FILE_MAGIC = 0x4B4C4352; // "RCLK"
+    static const uint16_t FORMAT_VERSION = 1;
+
+    static const uint32_t CALIBRATION_PASSES = 200;
+    static const uint32_t VALIDATION_PASSES = 20;
+    static const uint32_t DEFAULT_BENCHMARK_REFRESHES = 1000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct RateResult
+    {
+        RDA5807MBus::ClockRate rate;
+
+        // The bus took the rate
+        bool supported;
+        uint32_t passes;
+        uint32_t transactions;
+        uint32_t busErrors;
+
+        // Reads that went through but held the wrong value
+        uint32_t mismatches;
+        uint64_t meanPassNs;
+        uint64_t maxPassNs;
+        bool stable;
+    };
+
+    struct Calibration
+    {
+        RateResult rates[RDA5807MBus::CLOCK_RATE_COUNT];
+
+        // False if no rate was stable, leaving the bus at STANDARD
+        bool found;
+        RDA5807MBus::ClockRate chosen;
+        bool saved;
+
+        // The scratch fields were written back as they were
+        bool restored;
+    };
+
+    struct Validation
+    {
+        // There was a saved rate
+        bool found;
+        RDA5807MBus::ClockRate saved;
+
+        // What the bus runs at now, and whether it passed
+        RDA5807MBus::ClockRate chosen;
+        bool validated;
+        uint64_t elapsedUs;
+    };
+
+    struct RefreshThroughput
+    {
+        RDA5807MBus::ClockRate rate;
+        bool supported;
+        uint32_t refreshes;
+        uint32_t busErrors;
+        double refreshesPerSecond;
+
+        // What the clock alone allows for the seven SMBus word reads of a
+        // refresh, with no time between them
+        double wireLimitPerSecond;
+    };
+
+    struct Benchmark
+    {
+        RefreshThroughput rates[RDA5807MBus::CLOCK_RATE_COUNT];
+
+        // The rate the bus was put back on afterwards
+        RDA5807MBus::ClockRate restoredRate;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit BusClockCalibrator(RDA5807M& radioParam);
+
+    // Saves the chosen rate to path, unless path is nullptr
+    Calibration calibrate(const char* path = DEFAULT_PATH);
+
+    Validation restore(const char* path = DEFAULT_PATH);
+
+    // Sets the saved rate without validating it, for when nothing may be
+    // written to the radio
+    Validation apply(const char* path = DEFAULT_PATH);
+
+    // Afterwards the bus is put back on the rate saved in path, or on
+    // STANDARD
+    Benchmark benchmark(uint32_t refreshes = DEFAULT_BENCHMARK_REFRESHES, const char* path = DEFAULT_PATH);
+
+    static bool save(const char* path, RDA5807MBus::ClockRate rate);
+
+    // False if there is no file, or it isn't a valid clock rate file
+    static bool load(const char* path, RDA5807MBus::ClockRate& rate);
+
+    static uint32_t rateToKhz(RDA5807MBus::ClockRate rate);
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct FileContents
+    {
+        uint32_t magic;
+        uint16_t formatVersion;
+        uint16_t rate;
+
+        // Ones' complement of the sum of the words above
+        uint16_t checksum;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    RateResult measure(RDA5807MBus::ClockRate rate, uint32_t passes);
+    void runPass(uint32_t passIdx, RateResult& result);
+    void readBack(RDA5807M::Register reg, uint16_t expected, uint16_t mask, RateResult& result);
+    void writeAndReadBack(RDA5807M::Register reg, uint16_t field, uint16_t pattern, RateResult& result);
+    bool restoreScratchRegisters();
+    static uint16_t computeChecksum(const FileContents& contents);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+
+    // Registers 0x05 and 0x07 as they were before the first pass
+    uint16_t savedScratchRegisters[2];
+};
+
+#endif  // ifndef BUSCLOCKCALIBRATOR_HPP
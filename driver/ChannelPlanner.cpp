@@ -0,0 +1,122 @@
+/**************************************************
+ * ChannelPlanner.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "ChannelPlanner.hpp"
+
+/**
+ * Starts out as the US/Europe band at 100 KHz, the driver's defaults
+ */
+ChannelPlanner::ChannelPlanner() : bottomKhz(0), topKhz(0), spacingKhz(0), channelCount(0)
+{
+    configure(87000, 108000, 100);
+}
+
+/**
+ * Rebuilds both tables for the given band edges and spacing. Returns false,
+ * leaving the previous plan in place, if the parameters can't describe a
+ * raster the chip supports.
+ */
+bool ChannelPlanner::configure(uint32_t bottomKhzParam, uint32_t topKhzParam, uint32_t spacingKhzParam)
+{
+    if (spacingKhzParam == 0 || spacingKhzParam % GRID_KHZ != 0 || bottomKhzParam % GRID_KHZ != 0 ||
+        topKhzParam < bottomKhzParam || (topKhzParam - bottomKhzParam) / GRID_KHZ >= MAX_GRID_POINTS)
+    {
+        return false;
+    }
+
+    if (bottomKhzParam == bottomKhz && topKhzParam == topKhz && spacingKhzParam == spacingKhz)
+    {
+        return true;
+    }
+
+    bottomKhz = bottomKhzParam;
+    topKhz = topKhzParam;
+    spacingKhz = spacingKhzParam;
+
+    for (uint16_t gridIdx = 0; gridIdx < MAX_GRID_POINTS; ++gridIdx)
+    {
+        gridToChannelTable[gridIdx] = INVALID_CHANNEL;
+    }
+
+    channelCount = 0;
+    for (uint32_t frequencyKhz = bottomKhz; frequencyKhz <= topKhz && channelCount < MAX_CHANNELS;
+         frequencyKhz += spacingKhz)
+    {
+        channelToKhzTable[channelCount] = frequencyKhz;
+        gridToChannelTable[(frequencyKhz - bottomKhz) / GRID_KHZ] = channelCount;
+        ++channelCount;
+    }
+
+    // The top of the band may not be reachable through a 10 bit CHAN
+    topKhz = channelToKhzTable[channelCount - 1];
+
+    return true;
+}
+
+/**
+ * Returns the CHAN value for frequencyKhz, or INVALID_CHANNEL if it is
+ * outside the band or not on the channel raster.
+ */
+uint16_t ChannelPlanner::khzToChannel(uint32_t frequencyKhz) const
+{
+    if (frequencyKhz < bottomKhz || frequencyKhz > topKhz || (frequencyKhz - bottomKhz) % GRID_KHZ != 0)
+    {
+        return INVALID_CHANNEL;
+    }
+
+    return gridToChannelTable[(frequencyKhz - bottomKhz) / GRID_KHZ];
+}
+
+/**
+ * Returns the frequency of CHAN value channel, or 0 if the band has no
+ * such channel.
+ */
+uint32_t ChannelPlanner::channelToKhz(uint16_t channel) const
+{
+    if (channel >= channelCount)
+    {
+        return 0;
+    }
+
+    return channelToKhzTable[channel];
+}
+
+bool ChannelPlanner::isOnRaster(uint32_t frequencyKhz) const
+{
+    return khzToChannel(frequencyKhz) != INVALID_CHANNEL;
+}
+
+/**
+ * Every channel of the band in ascending order; getChannelCount() entries
+ * long. Indexes are CHAN values.
+ */
+const uint32_t* ChannelPlanner::getChannelTable() const
+{
+    return channelToKhzTable;
+}
+
+uint16_t ChannelPlanner::getChannelCount() const
+{
+    return channelCount;
+}
+
+uint32_t ChannelPlanner::getBottomKhz() const
+{
+    return bottomKhz;
+}
+
+uint32_t ChannelPlanner::getTopKhz() const
+{
+    return topKhz;
+}
+
+uint32_t ChannelPlanner::getSpacingKhz() const
+{
+    return spacingKhz;
+}
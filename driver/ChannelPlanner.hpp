@@ -0,0 +1,85 @@
+/**************************************************
+ * ChannelPlanner.hpp - Precomputed kHz <-> CHAN tables for a band/spacing
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef CHANNELPLANNER_HPP
+#define CHANNELPLANNER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * Maps between frequencies in kHz and the chip's CHAN field for one band
+ * and channel spacing. Both directions are plain table lookups; the tables
+ * are rebuilt only when the band, spacing or 50 MHz mode changes, so scans
+ * can walk getChannelTable() instead of redoing the arithmetic and range
+ * checks for every step.
+ *
+ * The CHAN field is 10 bits wide, so a band with more than MAX_CHANNELS
+ * channels at the chosen spacing (e.g. 76-108 MHz at 25 KHz) is cut off at
+ * the top.
+ */
+class ChannelPlanner
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // CHAN is 10 bits wide
+    static const uint16_t MAX_CHANNELS = 1024;
+
+    // Returned by khzToChannel() for frequencies that aren't on the raster
+    static const uint16_t INVALID_CHANNEL = 0xFFFF;
+
+    // Finest spacing the chip supports; every raster is a multiple of it
+    static const uint32_t GRID_KHZ = 25;
+
+    // Widest band is 76-108 MHz
+    static const uint16_t MAX_GRID_POINTS = (108000 - 76000) / GRID_KHZ + 1;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    ChannelPlanner();
+
+    bool configure(uint32_t bottomKhzParam, uint32_t topKhzParam, uint32_t spacingKhzParam);
+
+    uint16_t khzToChannel(uint32_t frequencyKhz) const;
+
+    uint32_t channelToKhz(uint16_t channel) const;
+
+    bool isOnRaster(uint32_t frequencyKhz) const;
+
+    const uint32_t* getChannelTable() const;
+
+    uint16_t getChannelCount() const;
+
+    uint32_t getBottomKhz() const;
+
+    uint32_t getTopKhz() const;
+
+    uint32_t getSpacingKhz() const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    uint32_t bottomKhz;
+    uint32_t topKhz;
+    uint32_t spacingKhz;
+    uint16_t channelCount;
+
+    // CHAN -> kHz, channelCount entries
+    uint32_t channelToKhzTable[MAX_CHANNELS];
+
+    // (kHz - bottomKhz) / GRID_KHZ -> CHAN, or INVALID_CHANNEL when that
+    // grid point isn't a channel at the current spacing
+    uint16_t gridToChannelTable[MAX_GRID_POINTS];
+};
+
+#endif  // ifndef CHANNELPLANNER_HPP
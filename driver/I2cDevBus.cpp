@@ -0,0 +1,256 @@
+/**************************************************
+ * I2cDevBus.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// Project includes
+#include "I2cDevBus.hpp"
+
+namespace
+{
+    uint16_t swapBytes(uint16_t value)
+    {
+        return static_cast<uint16_t>((value << 8) | (value >> 8));
+    }
+
+    // Opens /dev/i2c-busNumber, or returns -1
+    int openBus(int busNumber)
+    {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/dev/i2c-%d", busNumber);
+        return open(path, O_RDWR | O_CLOEXEC);
+    }
+
+    bool supportsCombinedTransfers(int fd)
+    {
+        unsigned long functions = 0;
+        return fd >= 0 && ioctl(fd, I2C_FUNCS, &functions) == 0 && (functions & I2C_FUNC_I2C) != 0;
+    }
+}
+
+I2cDevBus::I2cDevBus(int busNumber) : I2cDevBus(openBus(busNumber), false)
+{
+    combinedTransfers = supportsCombinedTransfers(fd);
+
+    bool addressSet = fd >= 0 && (combinedTransfers || selectAddress(RANDOM_ACCESS_I2C_MODE_ADDR));
+    std::printf("i2c-dev bus %d: %s\n", busNumber,
+                !addressSet ? "Error!" : (combinedTransfers ? "OK!" : "OK! (SMBus only)"));
+}
+
+I2cDevBus::I2cDevBus(int fdParam, bool combinedTransfersParam) :
+        fd(fdParam), combinedTransfers(combinedTransfersParam), selectedAddress(0), stats{0, 0}
+{
+}
+
+I2cDevBus::~I2cDevBus()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool I2cDevBus::isOpen() const
+{
+    return fd >= 0;
+}
+
+bool I2cDevBus::hasCombinedTransfers() const
+{
+    return combinedTransfers;
+}
+
+const I2cDevBus::Stats& I2cDevBus::getStats() const
+{
+    return stats;
+}
+
+bool I2cDevBus::writeRegister(uint8_t reg, uint16_t value)
+{
+    return writeRegisters(&reg, &value, 1);
+}
+
+/**
+ * A single message to the sequential access address, or an SMBus I2C
+ * block write whose command byte is the first data byte, which puts the
+ * same bytes on the wire
+ */
+bool I2cDevBus::writeRegistersSequential(const uint16_t* values, uint8_t count)
+{
+    uint8_t dataToWrite[MAX_SEQUENTIAL_BYTES];
+    if (count == 0 || count > MAX_SEQUENTIAL_BYTES / 2)
+    {
+        return false;
+    }
+
+    for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+    {
+        dataToWrite[regIdx * 2] = static_cast<uint8_t>(values[regIdx] >> 8);
+        dataToWrite[regIdx * 2 + 1] = static_cast<uint8_t>(values[regIdx]);
+    }
+
+    if (combinedTransfers)
+    {
+        struct i2c_msg message = { SEQUENTIAL_ACCESS_I2C_MODE_ADDR, 0, static_cast<uint16_t>(count * 2),
+                                   &dataToWrite[0] };
+        return submit(&message, 1);
+    }
+
+    union i2c_smbus_data data;
+    data.block[0] = static_cast<uint8_t>(count * 2 - 1);
+    std::memcpy(&data.block[1], &dataToWrite[1], data.block[0]);
+
+    bool written = selectAddress(SEQUENTIAL_ACCESS_I2C_MODE_ADDR) &&
+                   smbusAccess(I2C_SMBUS_WRITE, dataToWrite[0], I2C_SMBUS_I2C_BLOCK_DATA, &data);
+
+    // Always go back to random access mode, which everything else assumes
+    return selectAddress(RANDOM_ACCESS_I2C_MODE_ADDR) && written;
+}
+
+bool I2cDevBus::readRegister(uint8_t reg, uint16_t& value)
+{
+    return readRegisters(&reg, &value, 1);
+}
+
+/**
+ * Each register is a one byte write of its address followed by a two byte
+ * read, as many of them per submission as the kernel takes
+ */
+bool I2cDevBus::readRegisters(const uint8_t* regs, uint16_t* values, uint8_t count)
+{
+    if (!combinedTransfers)
+    {
+        bool allRead = true;
+        for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+        {
+            union i2c_smbus_data data;
+            bool read = smbusAccess(I2C_SMBUS_READ, regs[regIdx], I2C_SMBUS_WORD_DATA, &data);
+            values[regIdx] = read ? swapBytes(data.word) : 0;
+            allRead = read && allRead;
+        }
+        return allRead;
+    }
+
+    for (uint8_t first = 0; first < count; first = static_cast<uint8_t>(first + MAX_READS_PER_TRANSFER))
+    {
+        uint8_t chunk = static_cast<uint8_t>(count - first);
+        chunk = (chunk < MAX_READS_PER_TRANSFER) ? chunk : MAX_READS_PER_TRANSFER;
+
+        uint8_t addresses[MAX_READS_PER_TRANSFER];
+        uint8_t data[MAX_READS_PER_TRANSFER][2];
+        struct i2c_msg messages[MAX_MESSAGES];
+        for (uint8_t regIdx = 0; regIdx < chunk; ++regIdx)
+        {
+            addresses[regIdx] = regs[first + regIdx];
+            messages[regIdx * 2] = { RANDOM_ACCESS_I2C_MODE_ADDR, 0, 1, &addresses[regIdx] };
+            messages[regIdx * 2 + 1] = { RANDOM_ACCESS_I2C_MODE_ADDR, I2C_M_RD, 2, &data[regIdx][0] };
+        }
+
+        if (!submit(messages, chunk * 2U))
+        {
+            return false;
+        }
+
+        for (uint8_t regIdx = 0; regIdx < chunk; ++regIdx)
+        {
+            values[first + regIdx] = static_cast<uint16_t>((data[regIdx][0] << 8) | data[regIdx][1]);
+        }
+    }
+    return true;
+}
+
+/**
+ * Each register is a three byte message: its address, then the value
+ * high byte first
+ */
+bool I2cDevBus::writeRegisters(const uint8_t* regs, const uint16_t* values, uint8_t count)
+{
+    if (!combinedTransfers)
+    {
+        bool allWritten = true;
+        for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+        {
+            union i2c_smbus_data data;
+            data.word = swapBytes(values[regIdx]);
+            allWritten = smbusAccess(I2C_SMBUS_WRITE, regs[regIdx], I2C_SMBUS_WORD_DATA, &data) && allWritten;
+        }
+        return allWritten;
+    }
+
+    for (uint8_t first = 0; first < count; first = static_cast<uint8_t>(first + MAX_MESSAGES))
+    {
+        uint8_t chunk = static_cast<uint8_t>(count - first);
+        chunk = (chunk < MAX_MESSAGES) ? chunk : MAX_MESSAGES;
+
+        uint8_t data[MAX_MESSAGES][3];
+        struct i2c_msg messages[MAX_MESSAGES];
+        for (uint8_t regIdx = 0; regIdx < chunk; ++regIdx)
+        {
+            data[regIdx][0] = regs[first + regIdx];
+            data[regIdx][1] = static_cast<uint8_t>(values[first + regIdx] >> 8);
+            data[regIdx][2] = static_cast<uint8_t>(values[first + regIdx]);
+            messages[regIdx] = { RANDOM_ACCESS_I2C_MODE_ADDR, 0, 3, &data[regIdx][0] };
+        }
+
+        if (!submit(messages, chunk))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool I2cDevBus::transfer(struct i2c_msg* messages, uint32_t count)
+{
+    struct i2c_rdwr_ioctl_data request = { messages, count };
+    return ioctl(fd, I2C_RDWR, &request) >= 0;
+}
+
+bool I2cDevBus::submit(struct i2c_msg* messages, uint32_t count)
+{
+    ++stats.syscalls;
+    stats.messages += count;
+    return fd >= 0 && transfer(messages, count);
+}
+
+/**
+ * Points SMBus transfers at address. Free if they already go there.
+ */
+bool I2cDevBus::selectAddress(uint8_t address)
+{
+    if (address == selectedAddress)
+    {
+        return true;
+    }
+
+    if (fd < 0 || ioctl(fd, I2C_SLAVE, address) < 0)
+    {
+        selectedAddress = 0;
+        return false;
+    }
+    selectedAddress = address;
+    return true;
+}
+
+bool I2cDevBus::smbusAccess(uint8_t readWrite, uint8_t command, uint32_t size, union i2c_smbus_data* data)
+{
+    ++stats.syscalls;
+    ++stats.messages;
+
+    struct i2c_smbus_ioctl_data request;
+    request.read_write = readWrite;
+    request.command = command;
+    request.size = size;
+    request.data = data;
+    return fd >= 0 && ioctl(fd, I2C_SMBUS, &request) >= 0;
+}
@@ -0,0 +1,106 @@
+/**************************************************
+ * I2cDevBus.hpp - RDA5807MBus implementation on top of Linux i2c-dev
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef I2CDEVBUS_HPP
+#define I2CDEVBUS_HPP
+
+// System includes
+#include <cstdint>
+#include <linux/i2c.h>
+
+// Project includes
+#include "RDA5807MBus.hpp"
+
+/**
+ * Talks to /dev/i2c-N directly instead of going through libmraa, so that
+ * transfers can be combined. A register read is the register address
+ * write and the data read in a single I2C_RDWR submission, joined by a
+ * repeated start, and reading or writing several registers is still a
+ * single submission: one system call where libmraa makes one per
+ * register. A sequential write names the chip's sequential access
+ * address in its message, so there is no switching addresses around it.
+ *
+ * Adapters that only speak SMBus, like the kernel's i2c-stub, get SMBus
+ * word transfers, one register per call, instead.
+ *
+ * Every submission goes through transfer(), which a subclass can override
+ * to run against a fake device.
+ */
+class I2cDevBus : public RDA5807MBus
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        // ioctl() calls made to move data, and the I2C messages in them
+        uint64_t syscalls;
+        uint64_t messages;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit I2cDevBus(int busNumber);
+
+    ~I2cDevBus();
+
+    bool isOpen() const;
+
+    // False if the adapter only does SMBus
+    bool hasCombinedTransfers() const;
+
+    const Stats& getStats() const;
+
+    bool writeRegister(uint8_t reg, uint16_t value) override;
+
+    bool writeRegistersSequential(const uint16_t* values, uint8_t count) override;
+
+    bool readRegister(uint8_t reg, uint16_t& value) override;
+
+    bool readRegisters(const uint8_t* regs, uint16_t* values, uint8_t count) override;
+
+    bool writeRegisters(const uint8_t* regs, const uint16_t* values, uint8_t count) override;
+
+protected:
+    // Adopts fdParam, which is closed on destruction
+    I2cDevBus(int fdParam, bool combinedTransfersParam);
+
+    // Makes one I2C_RDWR submission of count messages
+    virtual bool transfer(struct i2c_msg* messages, uint32_t count);
+
+    int fd;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    // I2C_RDWR_IOCTL_MAX_MSGS; two messages per register read
+    static const uint8_t MAX_MESSAGES = 42;
+    static const uint8_t MAX_READS_PER_TRANSFER = MAX_MESSAGES / 2;
+
+    // A sequential write of every writable register, and then some
+    static const uint8_t MAX_SEQUENTIAL_BYTES = 32;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    bool submit(struct i2c_msg* messages, uint32_t count);
+    bool selectAddress(uint8_t address);
+    bool smbusAccess(uint8_t readWrite, uint8_t command, uint32_t size, union i2c_smbus_data* data);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    bool combinedTransfers;
+
+    // The address SMBus transfers go to
+    uint8_t selectedAddress;
+
+    Stats stats;
+};
+
+#endif  // ifndef I2CDEVBUS_HPP
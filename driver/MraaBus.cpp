@@ -0,0 +1,111 @@
+/**************************************************
+ * MraaBus.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+
+// Project includes
+#include "mraa/i2c.h"
+#include "MraaBus.hpp"
+
+MraaBus::MraaBus(int busNumber) : i2cContext(mraa_i2c_init_raw(static_cast<unsigned int>(busNumber)))
+{
+    mraa_result_t result = MRAA_ERROR_INVALID_HANDLE;
+    if (i2cContext != nullptr)
+    {
+        result = mraa_i2c_address(i2cContext, RANDOM_ACCESS_I2C_MODE_ADDR);
+    }
+
+    std::printf("I2C address set result: %s\n", (result == MRAA_SUCCESS ? "OK!" : "Error!"));
+}
+
+MraaBus::~MraaBus()
+{
+    if (i2cContext != nullptr)
+    {
+        mraa_i2c_stop(i2cContext);
+    }
+}
+
+bool MraaBus::writeRegister(uint8_t reg, uint16_t value)
+{
+    uint8_t dataToWrite[3] = { reg, static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+
+//    std::printf("Writing: {reg: 0x%02x, upper: 0x%02x, lower: 0x%02x}\n", dataToWrite[0], dataToWrite[1], dataToWrite[2]);
+
+    return i2cContext != nullptr && mraa_i2c_write(i2cContext, &dataToWrite[0], 3) == MRAA_SUCCESS;
+}
+
+/**
+ * Switches to the sequential access address for the duration of the write
+ */
+bool MraaBus::writeRegistersSequential(const uint16_t* values, uint8_t count)
+{
+    uint8_t dataToWrite[32];
+    if (i2cContext == nullptr || count > sizeof(dataToWrite) / 2)
+    {
+        return false;
+    }
+
+    for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+    {
+        dataToWrite[regIdx * 2] = static_cast<uint8_t>(values[regIdx] >> 8);
+        dataToWrite[regIdx * 2 + 1] = static_cast<uint8_t>(values[regIdx]);
+    }
+
+    if (MRAA_SUCCESS != mraa_i2c_address(i2cContext, SEQUENTIAL_ACCESS_I2C_MODE_ADDR))
+    {
+        return false;
+    }
+
+    mraa_result_t result = mraa_i2c_write(i2cContext, &dataToWrite[0], count * 2);
+
+    // Always go back to random access mode, which everything else assumes
+    mraa_result_t addrResult = mraa_i2c_address(i2cContext, RANDOM_ACCESS_I2C_MODE_ADDR);
+
+    return result == MRAA_SUCCESS && addrResult == MRAA_SUCCESS;
+}
+
+/**
+ * mraa_i2c_read_word_data() returns the bytes swapped relative to the chip's
+ * big-endian register layout, so they are swapped back here.
+ */
+bool MraaBus::readRegister(uint8_t reg, uint16_t& value)
+{
+    if (i2cContext == nullptr)
+    {
+        return false;
+    }
+
+    int readResult = mraa_i2c_read_word_data(i2cContext, reg);
+    if (readResult < 0)
+    {
+        return false;
+    }
+
+    uint16_t data = static_cast<uint16_t>(readResult);
+
+    uint8_t dataLow = static_cast<uint8_t>(data >> 8);
+    uint8_t dataHigh = static_cast<uint8_t>(data & 0x00FF);
+
+    value = (0xFFFF & dataLow);
+    value |= dataHigh << 8;
+
+//    std::printf("Read reg: 0x%02x; Value: 0x%04x\n", reg, value);
+
+    return true;
+}
+
+#ifndef RDA5807M_FREESTANDING
+bool MraaBus::setClockRate(ClockRate rate)
+{
+    // Indexed by ClockRate
+    static const mraa_i2c_mode_t CLOCK_RATE_TO_MODE[] = { MRAA_I2C_STD, MRAA_I2C_FAST, MRAA_I2C_HIGH };
+
+    return i2cContext != nullptr &&
+           mraa_i2c_frequency(i2cContext, CLOCK_RATE_TO_MODE[static_cast<uint8_t>(rate)]) == MRAA_SUCCESS;
+}
+#endif
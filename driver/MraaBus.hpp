@@ -0,0 +1,46 @@
+/**************************************************
+ * MraaBus.hpp - RDA5807MBus implementation on top of libmraa
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef MRAABUS_HPP
+#define MRAABUS_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "mraa/i2c.h"
+#include "RDA5807MBus.hpp"
+
+class MraaBus : public RDA5807MBus
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    MraaBus(int busNumber);
+
+    ~MraaBus();
+
+    bool writeRegister(uint8_t reg, uint16_t value) override;
+
+    bool writeRegistersSequential(const uint16_t* values, uint8_t count) override;
+
+    bool readRegister(uint8_t reg, uint16_t& value) override;
+
+#ifndef RDA5807M_FREESTANDING
+    bool setClockRate(ClockRate rate) override;
+#endif
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+
+    // The I2c context used to talk to the radio. The C API is used so the
+    // bus also builds in the freestanding (no exceptions) profile.
+    mraa_i2c_context i2cContext;
+};
+
+#endif  // ifndef MRAABUS_HPP
@@ -0,0 +1,349 @@
+/**************************************************
+ * PollingController.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "PollingController.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "Util.hpp"
+
+PollingController::PollingController(RDA5807M& radioParam, uint32_t i2cClockHzParam) :
+        radio(radioParam), i2cClockHz(i2cClockHzParam), rdsWanted(true)
+{
+    reset(0);
+}
+
+/**
+ * Starts over in TUNING and restarts the statistics at nowUs
+ */
+void PollingController::reset(uint64_t nowUs)
+{
+    std::memset(&stats, 0, sizeof(stats));
+    startUs = nowUs;
+    busStatsAtStart = radio.getBusStats();
+
+    mode = Mode::TUNING;
+    modeStartUs = nowUs;
+    lastPollUs = nowUs;
+    lastGroupUs = 0;
+    anchorUs = 0;
+    groupsSinceAnchor = 0;
+    anchorValid = false;
+    anchorPrecise = false;
+    lastPollWasProbe = false;
+    lastPollMissed = false;
+    rssiBaseline = 0;
+    stationPresent = false;
+    badGroups = 0;
+}
+
+void PollingController::restart()
+{
+    enterMode(Mode::TUNING, lastPollUs);
+}
+
+void PollingController::setRdsWanted(bool rdsWantedParam)
+{
+    rdsWanted = rdsWantedParam;
+}
+
+/**
+ * Reads whatever the current mode calls for. If that included a complete
+ * RDS group, it is returned in group and groupRead is set. Returns the
+ * time in microseconds until the next poll is due.
+ */
+uint32_t PollingController::poll(uint64_t nowUs, RDA5807M::RdsGroup& group, bool& groupRead)
+{
+    groupRead = false;
+    ++stats.polls;
+    if (nowUs > lastPollUs)
+    {
+        stats.timeInModeUs[static_cast<uint8_t>(mode)] += nowUs - lastPollUs;
+    }
+    lastPollUs = nowUs;
+
+    switch (mode)
+    {
+        case Mode::TUNING:
+            return pollTuning(nowUs);
+        case Mode::KEEP_ALIVE:
+            return pollKeepAlive(nowUs);
+        default:
+            return pollForGroup(nowUs, group, groupRead);
+    }
+}
+
+PollingController::Mode PollingController::getMode() const
+{
+    return mode;
+}
+
+/**
+ * Returns the statistics up to nowUs, including the bus utilization of
+ * all the radio's traffic at the configured I2C clock
+ */
+PollingController::Stats PollingController::getStats(uint64_t nowUs) const
+{
+    Stats current = stats;
+    if (nowUs > lastPollUs)
+    {
+        current.timeInModeUs[static_cast<uint8_t>(mode)] += nowUs - lastPollUs;
+    }
+
+    // The counters are 32 bits; unsigned subtraction copes with a wrap
+    RDA5807M::BusStats busStats = radio.getBusStats();
+    current.busReads = static_cast<uint32_t>(busStats.reads - busStatsAtStart.reads);
+    current.busWrites = static_cast<uint32_t>(busStats.writes - busStatsAtStart.writes);
+    current.elapsedUs = (nowUs > startUs) ? nowUs - startUs : 0;
+
+    uint64_t busBits = current.busReads * BITS_PER_READ + current.busWrites * BITS_PER_WRITE;
+    uint64_t busTimeUs = busBits * 1000000ULL / i2cClockHz;
+    current.busUtilizationPpm = (current.elapsedUs > 0) ?
+            static_cast<uint32_t>(busTimeUs * 1000000ULL / current.elapsedUs) : 0;
+
+    return current;
+}
+
+const char* PollingController::modeToCString(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::TUNING:
+            return "Tuning";
+        case Mode::SYNCING:
+            return "Syncing";
+        case Mode::ALIGNED:
+            return "Aligned";
+        case Mode::KEEP_ALIVE:
+            return "Keep-alive";
+        default:
+            return "Escalated";
+    }
+}
+
+/**
+ * Waits for STC, then takes the RSSI the station settled at as the
+ * baseline for spotting drops
+ */
+uint32_t PollingController::pollTuning(uint64_t nowUs)
+{
+    if (!radio.isStcComplete())
+    {
+        return STC_POLL_US;
+    }
+
+    radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0B);
+    uint16_t regB = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B);
+    rssiBaseline = static_cast<int32_t>(Util::valueFromReg(regB, RSSI)) << RSSI_FRACTION_BITS;
+    stationPresent = Util::valueFromReg(regB, FM_TRUE) != 0;
+    badGroups = 0;
+    lastGroupUs = 0;
+
+    settle(nowUs);
+    return (mode == Mode::SYNCING) ? SYNC_POLL_US : KEEP_ALIVE_POLL_US;
+}
+
+/**
+ * SYNCING, ALIGNED and ESCALATED: read a group if one is ready, and watch
+ * for anything that needs a closer look
+ */
+uint32_t PollingController::pollForGroup(uint64_t nowUs, RDA5807M::RdsGroup& group, bool& groupRead)
+{
+    groupRead = radio.readRdsGroup(group);
+
+    uint16_t regA = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A);
+    if (Util::valueFromReg(regA, STC) == 0)
+    {
+        enterMode(Mode::TUNING, nowUs);
+        return STC_POLL_US;
+    }
+
+    // Reading a group refreshes 0x0B; escalated polls always want it
+    if (!groupRead && mode == Mode::ESCALATED)
+    {
+        radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0B);
+    }
+
+    bool anomaly = (groupRead || mode == Mode::ESCALATED) && checkStatus();
+    if (groupRead)
+    {
+        ++stats.groupsRead;
+        lastGroupUs = nowUs;
+
+        badGroups = (group.errorsB == RDA5807M::RdsBlockErrors::SIX_OR_MORE_ERRORS) ? badGroups + 1 : 0;
+        if (badGroups >= BAD_GROUPS_ANOMALY)
+        {
+            badGroups = 0;
+            anomaly = true;
+        }
+    }
+    if (mode == Mode::ALIGNED && Util::valueFromReg(regA, RDSS) == 0)
+    {
+        anomaly = true;
+    }
+
+    if (anomaly)
+    {
+        escalate(nowUs);
+        return ESCALATED_POLL_US;
+    }
+
+    switch (mode)
+    {
+        case Mode::SYNCING:
+            if (groupRead)
+            {
+                enterMode(Mode::ALIGNED, nowUs);
+                anchorValid = false;
+                return scheduleAligned(nowUs);
+            }
+            if (nowUs - modeStartUs >= RDS_SYNC_TIMEOUT_US)
+            {
+                enterMode(Mode::KEEP_ALIVE, nowUs);
+                return KEEP_ALIVE_POLL_US;
+            }
+            return SYNC_POLL_US;
+
+        case Mode::ESCALATED:
+            if (nowUs - modeStartUs < ESCALATION_HOLD_US)
+            {
+                return ESCALATED_POLL_US;
+            }
+
+            // Calm again. Groups still coming give the alignment back.
+            if (lastGroupUs != 0 && nowUs - lastGroupUs < GROUP_PERIOD_US)
+            {
+                enterMode(Mode::ALIGNED, nowUs);
+                anchorValid = false;
+                return scheduleAligned(lastGroupUs);
+            }
+            settle(nowUs);
+            return (mode == Mode::SYNCING) ? SYNC_POLL_US : KEEP_ALIVE_POLL_US;
+
+        default:
+            // ALIGNED. A miss means the group is due within a few
+            // milliseconds, unless groups have stopped.
+            if (groupRead)
+            {
+                return scheduleAligned(nowUs);
+            }
+            if (nowUs - lastGroupUs > 2 * GROUP_PERIOD_US)
+            {
+                enterMode(Mode::SYNCING, nowUs);
+                return SYNC_POLL_US;
+            }
+            lastPollMissed = true;
+            lastPollWasProbe = false;
+            return ALIGN_RETRY_US;
+    }
+}
+
+/**
+ * Called with the time a group was seen; returns the delay until the poll
+ * for the next one. A group seen right after a miss arrived within
+ * ALIGN_RETRY_US of being seen, which makes a precise anchor. One seen by
+ * a probe, or by the first poll after syncing, arrived some time before,
+ * so the anchor is only an upper bound and the next poll probes again.
+ */
+uint32_t PollingController::scheduleAligned(uint64_t groupSeenUs)
+{
+    if (!anchorValid || lastPollMissed || lastPollWasProbe)
+    {
+        anchorUs = groupSeenUs;
+        groupsSinceAnchor = 0;
+        anchorPrecise = anchorValid && lastPollMissed;
+        anchorValid = true;
+    }
+
+    ++groupsSinceAnchor;
+    lastPollMissed = false;
+    lastPollWasProbe = !anchorPrecise || groupsSinceAnchor % ALIGN_PROBE_INTERVAL == 0;
+
+    uint64_t dueUs = anchorUs + static_cast<uint64_t>(groupsSinceAnchor) * GROUP_PERIOD_US;
+    dueUs = lastPollWasProbe ? dueUs - ALIGN_PROBE_EARLY_US : dueUs + ALIGN_GUARD_US;
+    return (dueUs > lastPollUs) ? static_cast<uint32_t>(dueUs - lastPollUs) : ALIGN_RETRY_US;
+}
+
+/**
+ * Checks the tune, station and RSSI now and then, and notices RDS
+ * appearing if it is wanted
+ */
+uint32_t PollingController::pollKeepAlive(uint64_t nowUs)
+{
+    radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0A);
+    uint16_t regA = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A);
+    if (Util::valueFromReg(regA, STC) == 0)
+    {
+        enterMode(Mode::TUNING, nowUs);
+        return STC_POLL_US;
+    }
+
+    radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0B);
+    if (checkStatus())
+    {
+        escalate(nowUs);
+        return ESCALATED_POLL_US;
+    }
+
+    uint16_t regTwo = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x02);
+    if (rdsWanted && Util::valueFromReg(regTwo, RDS_EN) != 0 && Util::valueFromReg(regA, RDSS) != 0)
+    {
+        enterMode(Mode::SYNCING, nowUs);
+        return SYNC_POLL_US;
+    }
+    return KEEP_ALIVE_POLL_US;
+}
+
+void PollingController::enterMode(Mode newMode, uint64_t nowUs)
+{
+    mode = newMode;
+    modeStartUs = nowUs;
+}
+
+/**
+ * Picks the mode for a tuned station: SYNCING if RDS is wanted and on,
+ * KEEP_ALIVE otherwise
+ */
+void PollingController::settle(uint64_t nowUs)
+{
+    uint16_t regTwo = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x02);
+    bool rdsEnabled = Util::valueFromReg(regTwo, RDS_EN) != 0;
+    enterMode((rdsWanted && rdsEnabled) ? Mode::SYNCING : Mode::KEEP_ALIVE, nowUs);
+}
+
+/**
+ * Compares the freshly read 0x0B with what came before: losing the
+ * station or the RSSI falling well below its smoothed level is an
+ * anomaly. Slow fading moves the baseline along with it.
+ */
+bool PollingController::checkStatus()
+{
+    uint16_t regB = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B);
+    bool present = Util::valueFromReg(regB, FM_TRUE) != 0;
+    int32_t rssi = static_cast<int32_t>(Util::valueFromReg(regB, RSSI)) << RSSI_FRACTION_BITS;
+
+    bool anomaly = (stationPresent && !present) ||
+                   (rssi + (static_cast<int32_t>(RSSI_DROP_ANOMALY) << RSSI_FRACTION_BITS) < rssiBaseline);
+
+    stationPresent = present;
+    rssiBaseline += (rssi - rssiBaseline) / (1 << RSSI_SMOOTHING_SHIFT);
+    return anomaly;
+}
+
+/**
+ * Enters ESCALATED, or restarts its hold time if already there
+ */
+void PollingController::escalate(uint64_t nowUs)
+{
+    if (mode != Mode::ESCALATED)
+    {
+        ++stats.escalations;
+    }
+    enterMode(Mode::ESCALATED, nowUs);
+}
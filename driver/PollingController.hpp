@@ -0,0 +1,168 @@
+/**************************************************
+ * PollingController.hpp - Adapts status polling to what the tuner is doing
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef POLLINGCONTROLLER_HPP
+#define POLLINGCONTROLLER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Decides when to read the chip's status and which registers to read,
+ * instead of every caller polling everything at a fixed rate:
+ *
+ *   TUNING      STC only (0x0A), every 5 ms, until the tune completes
+ *   SYNCING     0x0A every quarter group until the first RDS group
+ *   ALIGNED     one read per group, timed for its arrival from the
+ *               measured group phase; the group registers (0x0B-0x0F)
+ *               only when a group is ready
+ *   KEEP_ALIVE  0x0A and 0x0B once a second, when RDS isn't wanted or
+ *               the station doesn't have it
+ *   ESCALATED   0x0A and 0x0B every 10 ms for half a second after an
+ *               anomaly: an RSSI drop, a run of uncorrectable blocks, or
+ *               loss of RDS sync or of the station
+ *
+ * A cleared STC in any mode means someone started a tune and sends the
+ * controller back to TUNING. The caller does the waiting: poll() returns
+ * how long to sleep until the next poll. Time is passed in so that the
+ * controller can also run against simulated time.
+ */
+class PollingController
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t STC_POLL_US = 5000;
+    static const uint32_t SYNC_POLL_US = 21895;
+    static const uint32_t KEEP_ALIVE_POLL_US = 1000000;
+    static const uint32_t ESCALATED_POLL_US = 10000;
+    static const uint32_t ESCALATION_HOLD_US = 500000;
+
+    // One group is 104 bits at 1187.5 bits/s
+    static const uint32_t GROUP_PERIOD_US = 87579;
+
+    // Give up waiting for RDS after this long and fall back to KEEP_ALIVE
+    static const uint32_t RDS_SYNC_TIMEOUT_US = 2000000;
+
+    // Anomaly thresholds
+    static const uint8_t RSSI_DROP_ANOMALY = 8;
+    static const uint8_t BAD_GROUPS_ANOMALY = 3;
+
+    // Standard-mode I2C. A random-access register read is five bytes plus
+    // start, repeated start and stop; a register write four bytes.
+    static const uint32_t DEFAULT_I2C_CLOCK_HZ = 100000;
+    static const uint32_t BITS_PER_READ = 48;
+    static const uint32_t BITS_PER_WRITE = 38;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Mode {TUNING = 0, SYNCING = 1, ALIGNED = 2, KEEP_ALIVE = 3, ESCALATED = 4};
+    static const uint8_t MODE_COUNT = 5;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint64_t polls;
+        uint64_t groupsRead;
+        uint32_t escalations;
+        uint64_t timeInModeUs[MODE_COUNT];
+
+        // All of the radio's bus traffic since reset(), not only polls
+        uint64_t busReads;
+        uint64_t busWrites;
+        uint64_t elapsedUs;
+
+        // Share of the bus in use over elapsedUs, in parts per million
+        uint32_t busUtilizationPpm;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit PollingController(RDA5807M& radioParam, uint32_t i2cClockHzParam = DEFAULT_I2C_CLOCK_HZ);
+
+    void reset(uint64_t nowUs);
+
+    // Call after starting a tune or seek, or restarting RDS
+    void restart();
+
+    void setRdsWanted(bool rdsWantedParam);
+
+    uint32_t poll(uint64_t nowUs, RDA5807M::RdsGroup& group, bool& groupRead);
+
+    Mode getMode() const;
+
+    Stats getStats(uint64_t nowUs) const;
+
+    static const char* modeToCString(Mode mode);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    // ALIGNED polls are scheduled from an anchor, the time a group was
+    // seen, ALIGN_GUARD_US after each following group is due. Every
+    // ALIGN_PROBE_INTERVAL groups a poll goes ALIGN_PROBE_EARLY_US early
+    // instead: if the group is there already, the anchor moves earlier;
+    // if not, retries ALIGN_RETRY_US apart pin the arrival down.
+    static const uint32_t ALIGN_GUARD_US = 500;
+    static const uint32_t ALIGN_PROBE_EARLY_US = 3000;
+    static const uint32_t ALIGN_RETRY_US = 2000;
+    static const uint32_t ALIGN_PROBE_INTERVAL = 16;
+
+    // Baseline RSSI is kept in 1/16 dB, tracking readings with weight 1/8
+    static const uint8_t RSSI_FRACTION_BITS = 4;
+    static const uint8_t RSSI_SMOOTHING_SHIFT = 3;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    uint32_t pollTuning(uint64_t nowUs);
+    uint32_t pollForGroup(uint64_t nowUs, RDA5807M::RdsGroup& group, bool& groupRead);
+    uint32_t pollKeepAlive(uint64_t nowUs);
+    uint32_t scheduleAligned(uint64_t groupSeenUs);
+    void enterMode(Mode newMode, uint64_t nowUs);
+    void settle(uint64_t nowUs);
+    bool checkStatus();
+    void escalate(uint64_t nowUs);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    uint32_t i2cClockHz;
+    bool rdsWanted;
+
+    Mode mode;
+    uint64_t modeStartUs;
+    uint64_t lastPollUs;
+    uint64_t lastGroupUs;
+
+    // ALIGNED schedule; see ALIGN_GUARD_US
+    uint64_t anchorUs;
+    uint32_t groupsSinceAnchor;
+    bool anchorValid;
+    bool anchorPrecise;
+    bool lastPollWasProbe;
+    bool lastPollMissed;
+
+    // Smoothed RSSI and whether there was a station, for spotting changes
+    int32_t rssiBaseline;
+    bool stationPresent;
+    uint8_t badGroups;
+
+    Stats stats;
+    uint64_t startUs;
+    RDA5807M::BusStats busStatsAtStart;
+};
+
+#endif  // ifndef POLLINGCONTROLLER_HPP
@@ -5,12 +5,17 @@
 
 // System includes
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
-#include <iostream>
 
 // Project includes
-#include "mraa.hpp"
+#include "BusTrace.hpp"
+#include "Log.hpp"
+#ifndef RDA5807M_FREESTANDING
+#include "MraaBus.hpp"
+#endif
 #include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
 #include "RDA5807MRegDefines.hpp"
 #include "Util.hpp"
 
@@ -34,35 +39,75 @@ const uint16_t RDA5807M::REGISTER_MAP_DEFAULT_STATE[] = {
         /* Reg 0x0E */0x0000,
         /* Reg 0x0F */0x0000 };
 
-const std::string RDA5807M::STATUSRESULT_TO_STRING[] = { "SUCCESS",
-                                                         "ABOVE_MAX",
-                                                         "BELOW_MIN",
-                                                         "GENERAL_FAILURE",
-                                                         "I2C_FAILURE" };
-const std::string RDA5807M::BLOCK_ERRORS_TO_STRING[] = { "ZERO_ERRORS",
-                                                         "ONE_TO_TWO_ERRORS",
-                                                         "THREE_TO_FIVE_ERRORS",
-                                                         "SIX_OR_MORE_ERRORS"};
-const uint16_t RDA5807M::FREQUENCY_RANGE_MIN[] = {870, 760, 760, 650};
-const uint16_t RDA5807M::FREQUENCY_RANGE_MAX[] = {1080, 910, 1080, 760};
+const char* const RDA5807M::STATUSRESULT_TO_STRING[] = { "SUCCESS",
+                                                        "ABOVE_MAX",
+                                                        "BELOW_MIN",
+                                                        "GENERAL_FAILURE",
+                                                        "I2C_FAILURE" };
+const char* const RDA5807M::BLOCK_ERRORS_TO_STRING[] = { "ZERO_ERRORS",
+                                                        "ONE_TO_TWO_ERRORS",
+                                                        "THREE_TO_FIVE_ERRORS",
+                                                        "SIX_OR_MORE_ERRORS"};
+const char* const RDA5807M::ATTACH_RESULT_TO_STRING[] = { "INITIALIZED", "ADOPTED", "RESTORED" };
+const uint32_t RDA5807M::BAND_BOTTOM_KHZ[] = {87000, 76000, 76000, 65000};
+const uint32_t RDA5807M::BAND_TOP_KHZ[] = {108000, 91000, 108000, 76000};
+const uint32_t RDA5807M::CHANNEL_SPACING_KHZ[] = {100, 200, 50, 25};
+
+#ifndef RDA5807M_FREESTANDING
+/**
+ * Creates a driver for a radio on the given I2C bus, talking to it
+ * through libmraa.
+ */
+RDA5807M::RDA5807M(int i2cBusNumber) : band(Band::US_EUR), attachResult(AttachResult::INITIALIZED), ownedBus(new MraaBus(i2cBusNumber)), bus(*ownedBus)
+{
+    init();
+}
+#endif
 
-RDA5807M::RDA5807M() : band(Band::US_EUR), i2cInterface(mraa::I2c(0, true))
+/**
+ * Creates a driver for a radio reachable through busParam, which must
+ * outlive the driver.
+ */
+RDA5807M::RDA5807M(RDA5807MBus& busParam) : band(Band::US_EUR), attachResult(AttachResult::INITIALIZED), bus(busParam)
 {
-    // Reset the local register map
-    std::memcpy(registers, REGISTER_MAP_DEFAULT_STATE, REGISTER_MAP_SIZE_BYTES);
+    init();
+}
 
-    // Set the i2c addr
-    StatusResult result = setI2cAddress(RANDOM_ACCESS_I2C_MODE_ADDR);
+/**
+ * Creates a driver for a radio reachable through busParam, which must
+ * outlive the driver. With StartMode::WARM_ATTACH, a chip that is already
+ * running keeps playing as it is, and one that lost its configuration
+ * gets savedState back if there is one; see getAttachResult() for which
+ * happened. Anything else gets a full init().
+ */
+RDA5807M::RDA5807M(RDA5807MBus& busParam, StartMode startMode, const SavedState* savedState) :
+        band(Band::US_EUR), attachResult(AttachResult::INITIALIZED), bus(busParam)
+{
+    if (startMode != StartMode::WARM_ATTACH || !warmAttach(savedState))
+    {
+        init();
+    }
+}
 
-    std::cout << "I2C address set result: " << (result == StatusResult::SUCCESS ? "OK!" : "Error!") << std::endl;
+RDA5807M::AttachResult RDA5807M::getAttachResult() const
+{
+    return attachResult;
+}
 
-    init();
+/**
+ * Copies the chip ID and the writable registers from the local register
+ * map, for a later warm attach to restore
+ */
+void RDA5807M::getSavedState(SavedState& state) const
+{
+    state.chipId = shadow.load(REG_0x00);
+    shadow.copy(WRITE_REGISTER_BASE_IDX, WRITABLE_REGISTER_COUNT, state.writableRegisters);
 }
 
 /**
  * Returns the string value of the result parameter
  */
-std::string RDA5807M::statusResultToString(StatusResult toConvert)
+const char* RDA5807M::statusResultToCString(StatusResult toConvert)
 {
     return STATUSRESULT_TO_STRING[static_cast<unsigned int>(toConvert)];
 }
@@ -70,11 +115,28 @@ std::string RDA5807M::statusResultToString(StatusResult toConvert)
 /**
  * Returns the string value of the result parameter
  */
-std::string RDA5807M::rdsBlockErrorToString(RdsBlockErrors toConvert)
+const char* RDA5807M::rdsBlockErrorToCString(RdsBlockErrors toConvert)
 {
     return BLOCK_ERRORS_TO_STRING[static_cast<int>(toConvert)];
 }
 
+const char* RDA5807M::attachResultToCString(AttachResult toConvert)
+{
+    return ATTACH_RESULT_TO_STRING[static_cast<int>(toConvert)];
+}
+
+#ifndef RDA5807M_FREESTANDING
+std::string RDA5807M::statusResultToString(StatusResult toConvert)
+{
+    return statusResultToCString(toConvert);
+}
+
+std::string RDA5807M::rdsBlockErrorToString(RdsBlockErrors toConvert)
+{
+    return rdsBlockErrorToCString(toConvert);
+}
+#endif
+
 /**
  * Resets the radio to a known state.
  */
@@ -89,22 +151,101 @@ void RDA5807M::reset()
  */
 void RDA5807M::init()
 {
-    std::memcpy(registers, REGISTER_MAP_DEFAULT_STATE, REGISTER_MAP_SIZE_BYTES);
-    setMute(true, false);
-    setHighImpedanceOutput(false, false);
-    setRdsMode(true, false);
-    setSoftMute(false, false);
-    setStereo(true, false);
-    setNewMethod(true, false); // KEEP ME ENABLED! Using new method offers a drastic performance reception improvement
-    setVolume(0x00, false);
-    setChannelSpacing(ChannelSpacing::ONE_HUND_KHZ, false);
-    setBand(band, false);
-    setTune(true, false);
-    setEnabled(true, false);
+    {
+        // Readers see the defaults and the settings below as one update
+        RegisterShadow::WriteScope writeScope{shadow};
+
+        for (uint8_t regIdx = 0; regIdx < REGISTER_MAP_SIZE_REGISTERS; ++regIdx)
+        {
+            shadow.store(regIdx, REGISTER_MAP_DEFAULT_STATE[regIdx]);
+        }
+
+        setMute(true, false);
+        setHighImpedanceOutput(false, false);
+        setRdsMode(true, false);
+        setSoftMute(false, false);
+        setStereo(true, false);
+        setNewMethod(true, false); // KEEP ME ENABLED! Using new method offers a drastic performance reception improvement
+        setVolume(0x00, false);
+        setChannelSpacing(ChannelSpacing::ONE_HUND_KHZ, false);
+        setBand(band, false);
+        setTune(true, false);
+        setEnabled(true, false);
+    }
 
     writeAllRegistersToDevice();
 }
 
+/**
+ * Takes over the chip without writing to it if it is enabled, reading the
+ * chip ID and the writable registers back in one submission. A chip that
+ * is powered down or was reset gets savedState, if it has one, in a
+ * single burst. Returns false if the chip has to be initialized instead.
+ */
+bool RDA5807M::warmAttach(const SavedState* savedState)
+{
+    static const uint8_t ATTACH_REGS[] = { REG_0x00, REG_0x02, REG_0x03, REG_0x04, REG_0x05, REG_0x06, REG_0x07 };
+
+    uint16_t values[sizeof(ATTACH_REGS)] = {0};
+    if (!readRegistersFromDevice(ATTACH_REGS, values, sizeof(ATTACH_REGS)) ||
+        Util::valueFromReg(values[0], CHIP_ID) != CHIP_ID_VALUE)
+    {
+        return false;
+    }
+
+    if ((values[1] & ENABLE) != 0)
+    {
+        adoptRegisters(values[0], &values[1]);
+        attachResult = AttachResult::ADOPTED;
+        return true;
+    }
+
+    if (savedState == nullptr || Util::valueFromReg(savedState->chipId, CHIP_ID) != CHIP_ID_VALUE ||
+        (savedState->writableRegisters[0] & ENABLE) == 0)
+    {
+        return false;
+    }
+
+    adoptRegisters(values[0], savedState->writableRegisters);
+    if (restoreWritableRegisters() != StatusResult::SUCCESS)
+    {
+        return false;
+    }
+    attachResult = AttachResult::RESTORED;
+    return true;
+}
+
+/**
+ * Loads the local register map with the defaults, then chipId and the
+ * writable registers, and derives the band and channel plan from them.
+ * Operations the chip has already carried out (seek, tune, soft reset) are
+ * cleared so that later writes don't repeat them.
+ */
+void RDA5807M::adoptRegisters(uint16_t chipId, const uint16_t* writableRegisters)
+{
+    {
+        RegisterShadow::WriteScope writeScope{shadow};
+
+        for (uint8_t regIdx = 0; regIdx < REGISTER_MAP_SIZE_REGISTERS; ++regIdx)
+        {
+            shadow.store(regIdx, REGISTER_MAP_DEFAULT_STATE[regIdx]);
+        }
+
+        shadow.store(REG_0x00, chipId);
+        for (uint8_t regIdx = 0; regIdx < WRITABLE_REGISTER_COUNT; ++regIdx)
+        {
+            shadow.store(static_cast<uint8_t>(WRITE_REGISTER_BASE_IDX + regIdx), writableRegisters[regIdx]);
+        }
+
+        setSeek(false, false);
+        setSoftReset(false, false);
+        setTune(false, false);
+    }
+
+    band = static_cast<Band>(Util::valueFromReg(shadow.load(REG_0x03), BAND));
+    updateChannelPlan();
+}
+
 /*
  * Applies value to the masked region in register regNum. The changes are not
  * pushed to the device by this call.
@@ -128,7 +269,7 @@ void RDA5807M::setRegister(Register regNum, uint16_t value, uint16_t mask)
     maskAndValue <<= shiftAmt;
 
     // Create a working copy of the register we intend to modify
-    uint16_t regTemp = registers[regNum];
+    uint16_t regTemp = shadow.load(regNum);
 
     // ANDing with the negation of mask will set zeroes to the mask region
     // but won't modify any other bits
@@ -139,94 +280,190 @@ void RDA5807M::setRegister(Register regNum, uint16_t value, uint16_t mask)
     regTemp |= maskAndValue;
 
     // Voila!
-    registers[regNum] = regTemp;
+    shadow.store(regNum, regTemp);
 }
 
-RDA5807M::StatusResult RDA5807M::setI2cAddress(uint8_t addr)
+RDA5807M::StatusResult RDA5807M::writeRegisterToDevice(Register reg)
 {
-    if (mraa::Result::SUCCESS != i2cInterface.address(addr))
+    busWrites.fetch_add(1, std::memory_order_relaxed);
+    uint64_t traceStartNs = BusTrace::now();
+    uint16_t value = shadow.load(reg);
+    bool written = bus.writeRegister(static_cast<uint8_t>(reg), value);
+    BusTrace::record(BusTraceFormat::Op::WRITE, static_cast<uint8_t>(reg), value, written, traceStartNs);
+
+    if (written)
     {
-        return StatusResult::I2C_FAILURE;
+        return StatusResult::SUCCESS;
     }
     else
     {
-        return StatusResult::SUCCESS;
+        busWriteErrors.fetch_add(1, std::memory_order_relaxed);
+        Log::get().error("\tWrite failed (register 0x%02x)", static_cast<uint8_t>(reg));
+        return StatusResult::I2C_FAILURE;
     }
 }
 
-RDA5807M::StatusResult RDA5807M::writeRegisterToDevice(Register reg)
+/**
+ * Writes registers 0x02-0x07 one by one, in a single submission if the
+ * bus can combine them
+ */
+RDA5807M::StatusResult RDA5807M::writeAllRegistersToDevice()
 {
-    uint8_t dataToWrite[3] = { static_cast<uint8_t>(reg), static_cast<uint8_t>(registers[reg] >> 8),
-            static_cast<uint8_t>(registers[reg]) };
+    static const uint8_t WRITE_REGS[] = { REG_0x02, REG_0x03, REG_0x04, REG_0x05, REG_0x06, REG_0x07 };
 
-//    std::printf("Writing: {reg: 0x%02x, upper: 0x%02x, lower: 0x%02x}\n", dataToWrite[0], dataToWrite[1], dataToWrite[2]);
+    return writeRegistersToDevice(WRITE_REGS, sizeof(WRITE_REGS));
+}
 
-    mraa::Result result = i2cInterface.write(&dataToWrite[0], 3);
+/**
+ * Writes registers 0x02-0x07 in a single I2C transaction using the chip's
+ * sequential access mode, which always starts writing at register 0x02.
+ */
+RDA5807M::StatusResult RDA5807M::writeAllRegistersToDeviceBurst()
+{
+    static const uint8_t BURST_LENGTH = WRITE_REGISTER_MAX_IDX - WRITE_REGISTER_BASE_IDX + 1;
 
-//    std::cout << "\tMRAA Result: " << result << std::endl;
+    uint16_t values[BURST_LENGTH];
+    shadow.copy(WRITE_REGISTER_BASE_IDX, BURST_LENGTH, values);
 
-    if (result == mraa::Result::SUCCESS)
-    {
-//        std::cout << "\tWrite successful" << std::endl;
-        return StatusResult::SUCCESS;
-    }
-    else
+    busWrites.fetch_add(1, std::memory_order_relaxed);
+    uint64_t traceStartNs = BusTrace::now();
+    bool written = bus.writeRegistersSequential(values, BURST_LENGTH);
+    BusTrace::record(BusTraceFormat::Op::WRITE_SEQUENTIAL, WRITE_REGISTER_BASE_IDX, BURST_LENGTH, written,
+                     traceStartNs);
+
+    if (!written)
     {
-        std::cout << "\tWrite failed" << std::endl;
+        busWriteErrors.fetch_add(1, std::memory_order_relaxed);
         return StatusResult::I2C_FAILURE;
     }
+    return StatusResult::SUCCESS;
 }
 
-RDA5807M::StatusResult RDA5807M::writeAllRegistersToDevice()
+/**
+ * Pushes the local image of the writable registers back to a device that
+ * has lost it (brownout, soft reset...). Self-clearing bits that shouldn't
+ * be replayed (SEEK, SOFT_RESET) are cleared first, and TUNE is set so the
+ * stored channel is reacquired.
+ */
+RDA5807M::StatusResult RDA5807M::restoreWritableRegisters()
 {
-    StatusResult res = StatusResult::SUCCESS;
+    setSeek(false, false);
+    setSoftReset(false, false);
+    setTune(true, false);
+
+    return writeAllRegistersToDeviceBurst();
+}
 
-    for (uint8_t regIdx = WRITE_REGISTER_BASE_IDX; regIdx <= WRITE_REGISTER_MAX_IDX; ++regIdx)
+/**
+ * Reads the specified register from the device into data. Returns false,
+ * leaving data as it was, if the read failed.
+ */
+bool RDA5807M::readRegisterFromDevice(Register reg, uint16_t& data)
+{
+    uint16_t value = 0;
+    busReads.fetch_add(1, std::memory_order_relaxed);
+    uint64_t traceStartNs = BusTrace::now();
+    bool read = bus.readRegister(static_cast<uint8_t>(reg), value);
+    BusTrace::record(BusTraceFormat::Op::READ, static_cast<uint8_t>(reg), value, read, traceStartNs);
+
+    if (!read)
     {
-        if (StatusResult::I2C_FAILURE == writeRegisterToDevice(static_cast<Register>(regIdx)))
-        {
-            res = StatusResult::I2C_FAILURE;
-        }
+        busReadErrors.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
-    return res;
+
+    data = value;
+    return true;
 }
 
 /**
- * Returns the content of the specified register from the device
+ * Reads count registers from the device into values, in as few submissions
+ * as the bus allows. Returns false if any read failed.
  */
-uint16_t RDA5807M::readRegisterFromDevice(Register reg)
+bool RDA5807M::readRegistersFromDevice(const uint8_t* regs, uint16_t* values, uint8_t count)
 {
-    uint16_t data = i2cInterface.readWordReg(static_cast<uint8_t>(reg));
+    busReads.fetch_add(count, std::memory_order_relaxed);
+    uint64_t traceStartNs = BusTrace::now();
+    bool read = bus.readRegisters(regs, values, count);
+    for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+    {
+        BusTrace::record(BusTraceFormat::Op::READ, regs[regIdx], values[regIdx], read, traceStartNs);
+    }
 
-    uint8_t dataLow = static_cast<uint8_t>(data >> 8);
-    uint8_t dataHigh = static_cast<uint8_t>(data & 0x00FF);
+    if (!read)
+    {
+        busReadErrors.fetch_add(count, std::memory_order_relaxed);
+    }
+    return read;
+}
 
-    data = (0xFFFF & dataLow);
-    data |= dataHigh << 8;
+/**
+ * Writes count registers from the local register map to the device, in as
+ * few submissions as the bus allows
+ */
+RDA5807M::StatusResult RDA5807M::writeRegistersToDevice(const uint8_t* regs, uint8_t count)
+{
+    uint16_t values[REGISTER_MAP_SIZE_REGISTERS];
+    for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+    {
+        values[regIdx] = shadow.load(regs[regIdx]);
+    }
 
-//    std::printf("Read reg: 0x%02x; Value: 0x%04x\n", reg, data);
+    busWrites.fetch_add(count, std::memory_order_relaxed);
+    uint64_t traceStartNs = BusTrace::now();
+    bool written = bus.writeRegisters(regs, values, count);
+    for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+    {
+        BusTrace::record(BusTraceFormat::Op::WRITE, regs[regIdx], values[regIdx], written, traceStartNs);
+    }
 
-    return data;
+    if (!written)
+    {
+        busWriteErrors.fetch_add(count, std::memory_order_relaxed);
+        Log::get().error("\tWrite failed (%u registers from 0x%02x)", count, regs[0]);
+        return StatusResult::I2C_FAILURE;
+    }
+    return StatusResult::SUCCESS;
 }
 
 /**
- * Reads a single register from the device and updates its value in the local register map
+ * Reads a single register from the device and updates its value in the local register map.
+ * If the read fails the local copy is left as it was and false is returned.
  */
-void RDA5807M::readAndStoreSingleRegisterFromDevice(Register reg)
+bool RDA5807M::readAndStoreSingleRegisterFromDevice(Register reg)
 {
-    registers[reg] = readRegisterFromDevice(static_cast<Register>(reg));
+    uint16_t value = 0;
+    if (!readRegisterFromDevice(reg, value))
+    {
+        return false;
+    }
+
+    shadow.store(reg, value);
+    return true;
 }
 
+/**
+ * Reads register 0x00 and the status registers. Readers of the shadow see
+ * them change together, and aren't held up while the bus is busy.
+ */
 void RDA5807M::readDeviceRegistersAndStoreLocally()
 {
-    registers[REG_0x00] = readRegisterFromDevice(static_cast<Register>(REG_0x00));
+    static const uint8_t READ_REGS[] = { REG_0x00, REG_0x0A, REG_0x0B, BLOCK_A, BLOCK_B, BLOCK_C, BLOCK_D };
+
+    uint16_t values[sizeof(READ_REGS)] = {0};
+    if (!readRegistersFromDevice(READ_REGS, values, sizeof(READ_REGS)))
+    {
+        return;
+    }
 
-    for (int regIdx = READ_REG_BASE_IDX; regIdx <= READ_REG_MAX_IDX; ++regIdx)
+    RegisterShadow::WriteScope writeScope{shadow};
+    for (uint8_t regIdx = 0; regIdx < sizeof(READ_REGS); ++regIdx)
     {
-        registers[regIdx] = readRegisterFromDevice(static_cast<Register>(regIdx));
+        shadow.store(READ_REGS[regIdx], values[regIdx]);
     }
 }
 
+#ifndef RDA5807M_FREESTANDING
 /**
  * Generates a fancy-formatted version of the register map
  */
@@ -237,15 +474,19 @@ std::string RDA5807M::getRegisterMap()
 
     regMap.append("| REG  | VALUE  |\n");
 
+    RegisterShadow::Snapshot snapshot;
+    shadow.snapshot(snapshot);
+
     for (uint16_t regIdx = 0; regIdx < REGISTER_MAP_SIZE_REGISTERS; ++regIdx)
     {
-        std::sprintf(buffer,"| 0x%02x | 0x%04x |\n", regIdx, registers[regIdx]);
+        std::sprintf(buffer,"| 0x%02x | 0x%04x |\n", regIdx, snapshot.registers[regIdx]);
         regMap.append("|---------------|\n");
         regMap.append(buffer);
     }
     regMap.append("|===============|");
     return regMap;
 }
+#endif
 
 /**
  * Enables mute if muteEnable is true, disables mute if muteEnable is false
@@ -384,12 +625,38 @@ RDA5807M::StatusResult RDA5807M::setEnabled(bool enable, bool writeResultToDevic
     return conditionallyWriteRegisterToDevice(REG_0x02, writeResultToDevice);
 }
 
-// TODO this depends on channel spacing!
-// We assume 100KHz spacing and US band currently, and the channel
-// must be in terms of 10f - that is, 985 for 98.5MHz, for example
+/**
+ * The channel must be in terms of 10f - that is, 985 for 98.5MHz, for
+ * example. Use setFrequencyKhz() to reach channels on a 25 or 50 KHz
+ * raster.
+ */
 RDA5807M::StatusResult RDA5807M::setChannel(uint16_t channel, bool writeResultToDevice)
 {
-    uint16_t chan = channel - FREQUENCY_RANGE_MIN[US_EUR_BAND_SELECT];
+    return setFrequencyKhz(static_cast<uint32_t>(channel) * 100, writeResultToDevice);
+}
+
+/**
+ * Sets CHAN for frequencyKhz under the current band and channel spacing.
+ * Frequencies outside the band return BELOW_MIN/ABOVE_MAX and frequencies
+ * between channels return GENERAL_FAILURE; the register is left untouched
+ * in both cases.
+ */
+RDA5807M::StatusResult RDA5807M::setFrequencyKhz(uint32_t frequencyKhz, bool writeResultToDevice)
+{
+    uint16_t chan = channelPlanner.khzToChannel(frequencyKhz);
+    if (chan == ChannelPlanner::INVALID_CHANNEL)
+    {
+        if (frequencyKhz < channelPlanner.getBottomKhz())
+        {
+            return StatusResult::BELOW_MIN;
+        }
+        else if (frequencyKhz > channelPlanner.getTopKhz())
+        {
+            return StatusResult::ABOVE_MAX;
+        }
+        return StatusResult::GENERAL_FAILURE;
+    }
+
     setRegister(REG_0x03, chan, CHAN);
 
     return conditionallyWriteRegisterToDevice(REG_0x03, writeResultToDevice);
@@ -423,6 +690,7 @@ RDA5807M::StatusResult RDA5807M::setBand(Band band, bool writeResultToDevice)
     setRegister(REG_0x03, bandBits, BAND);
 
     this->band = static_cast<Band>(bandBits);
+    updateChannelPlan();
 
     return conditionallyWriteRegisterToDevice(REG_0x03, writeResultToDevice);
 }
@@ -447,10 +715,40 @@ RDA5807M::StatusResult RDA5807M::setChannelSpacing(ChannelSpacing spacing, bool
             break;
     }
     setRegister(REG_0x03, spacingBits, SPACE);
+    updateChannelPlan();
 
     return conditionallyWriteRegisterToDevice(REG_0x03, writeResultToDevice);
 }
 
+/**
+ * Only affects the east europe band, which then covers 50-76 MHz instead
+ * of 65-76 MHz
+ */
+RDA5807M::StatusResult RDA5807M::setFiftyMhzMode(bool fiftyMhzEnable, bool writeResultToDevice)
+{
+    setRegister(REG_0x07, Util::boolToInteger(!fiftyMhzEnable), R_65M_50M_MODE);
+    updateChannelPlan();
+
+    return conditionallyWriteRegisterToDevice(REG_0x07, writeResultToDevice);
+}
+
+/**
+ * Rebuilds the channel tables from the band, spacing and 50 MHz mode in
+ * the local register map
+ */
+void RDA5807M::updateChannelPlan()
+{
+    uint8_t bandBits = static_cast<uint8_t>(band);
+    uint32_t bottomKhz = BAND_BOTTOM_KHZ[bandBits];
+    if (bandBits == EAST_EUR_BAND_SELECT && (shadow.load(REG_0x07) & R_65M_50M_MODE) == 0)
+    {
+        bottomKhz = FIFTY_MHZ_MODE_BOTTOM_KHZ;
+    }
+
+    channelPlanner.configure(bottomKhz, BAND_TOP_KHZ[bandBits],
+                             CHANNEL_SPACING_KHZ[Util::valueFromReg(shadow.load(REG_0x03), SPACE)]);
+}
+
 RDA5807M::StatusResult RDA5807M::setDeEmphasis(DeEmphasis de, bool writeResultToDevice)
 {
     uint8_t deemphasisBits = DEEMP_75_US;
@@ -496,7 +794,7 @@ RDA5807M::StatusResult RDA5807M::setSoftMute(bool softMuteEnable, bool writeResu
 bool RDA5807M::readAndStoreRegFromDeviceAndReturnFlag(Register reg, uint16_t mask)
 {
     readAndStoreSingleRegisterFromDevice(reg);
-    uint16_t maskedValue = Util::valueFromReg(registers[reg], mask);
+    uint16_t maskedValue = Util::valueFromReg(shadow.load(reg), mask);
 
     if (maskedValue == 0)
     {
@@ -538,16 +836,25 @@ bool RDA5807M::isStereoEnabled()
     return readAndStoreRegFromDeviceAndReturnFlag(REG_0x0A, ST);
 }
 
-//TODO this depends on channel spacing!
-// We assume 100KHz spacing and US band currently, and the channel
-// must be in terms of 10f - that is, 985 for 98.5MHz, for example
+/**
+ * Returns the tuned frequency in terms of 10f - that is, 985 for 98.5MHz.
+ * Frequencies on a 25 or 50 KHz raster are truncated; use
+ * getReadFrequencyKhz() for those.
+ */
 uint16_t RDA5807M::getReadChannel()
 {
-    registers[REG_0x0A] = readRegisterFromDevice(REG_0x0A);
+    return static_cast<uint16_t>(getReadFrequencyKhz() / 100);
+}
 
-    uint16_t readChannel = Util::valueFromReg(registers[REG_0x0A], READCHAN);
+/**
+ * Reads READCHAN from the device and returns the tuned frequency in kHz,
+ * or 0 if READCHAN is outside the current band
+ */
+uint32_t RDA5807M::getReadFrequencyKhz()
+{
+    readAndStoreSingleRegisterFromDevice(REG_0x0A);
 
-    return (readChannel + FREQUENCY_RANGE_MIN[US_EUR_BAND_SELECT]);
+    return channelPlanner.channelToKhz(Util::valueFromReg(shadow.load(REG_0x0A), READCHAN));
 }
 
 bool RDA5807M::isFmTrue()
@@ -562,8 +869,8 @@ bool RDA5807M::isFmReady()
 
 uint8_t RDA5807M::getRssi()
 {
-    registers[REG_0x0B] = readRegisterFromDevice(REG_0x0B);
-    return static_cast<uint8_t>(Util::valueFromReg(registers[REG_0x0B],
+    readAndStoreSingleRegisterFromDevice(REG_0x0B);
+    return static_cast<uint8_t>(Util::valueFromReg(shadow.load(REG_0x0B),
         RSSI));
 }
 
@@ -598,7 +905,7 @@ uint16_t RDA5807M::getRdsPiCode(bool readRegisterFromDevice)
     {
         readAndStoreSingleRegisterFromDevice(BLOCK_A);
     }
-    return registers[BLOCK_A];
+    return shadow.load(BLOCK_A);
 }
 
 uint8_t RDA5807M::getRdsGroupTypeCode(bool readRegisterFromDevice)
@@ -607,7 +914,7 @@ uint8_t RDA5807M::getRdsGroupTypeCode(bool readRegisterFromDevice)
     {
         readAndStoreSingleRegisterFromDevice(BLOCK_B);
     }
-    return static_cast<uint8_t>(Util::valueFromReg(registers[BLOCK_B], GROUP_TYPE));
+    return static_cast<uint8_t>(Util::valueFromReg(shadow.load(BLOCK_B), GROUP_TYPE));
 }
 
 uint8_t RDA5807M::getRdsVersionCode(bool readRegisterFromDevice)
@@ -616,7 +923,7 @@ uint8_t RDA5807M::getRdsVersionCode(bool readRegisterFromDevice)
     {
         readAndStoreSingleRegisterFromDevice(BLOCK_B);
     }
-    return static_cast<uint8_t>(Util::valueFromReg(registers[BLOCK_B], VERSION_CODE));
+    return static_cast<uint8_t>(Util::valueFromReg(shadow.load(BLOCK_B), VERSION_CODE));
 
 }
 
@@ -626,7 +933,7 @@ uint8_t RDA5807M::getRdsTrafficProgramIdCode(bool readRegisterFromDevice)
     {
         readAndStoreSingleRegisterFromDevice(BLOCK_B);
     }
-    return static_cast<uint8_t>(Util::valueFromReg(registers[BLOCK_B], TRAFFIC_PROGRAM));
+    return static_cast<uint8_t>(Util::valueFromReg(shadow.load(BLOCK_B), TRAFFIC_PROGRAM));
 }
 
 uint8_t RDA5807M::getRdsProgramTypeCode(bool readRegisterFromDevice)
@@ -635,16 +942,26 @@ uint8_t RDA5807M::getRdsProgramTypeCode(bool readRegisterFromDevice)
     {
         readAndStoreSingleRegisterFromDevice(BLOCK_B);
     }
-    return static_cast<uint8_t>(Util::valueFromReg(registers[BLOCK_B], PROGRAM_TYPE));
+    return static_cast<uint8_t>(Util::valueFromReg(shadow.load(BLOCK_B), PROGRAM_TYPE));
 }
 
 /**
  * Returns the content of the *LOCALLY STORED* register
- * specified by reg
+ * specified by reg. Safe to call from any thread.
  */
-uint16_t RDA5807M::getLocalRegisterContent(Register reg)
+uint16_t RDA5807M::getLocalRegisterContent(Register reg) const
 {
-    return registers[reg];
+    return shadow.read(reg);
+}
+
+/**
+ * Copies the whole local register map, consistently, from any thread
+ * without blocking the thread that owns the bus. Returns the number of
+ * times the copy was retried because that thread was updating the map.
+ */
+uint32_t RDA5807M::getRegisterSnapshot(RegisterShadow::Snapshot& snapshot) const
+{
+    return shadow.snapshot(snapshot);
 }
 
 /**
@@ -654,13 +971,14 @@ uint16_t RDA5807M::getLocalRegisterContent(Register reg)
  */
 RDA5807M::RdsBlockErrors RDA5807M::getRdsErrorsForBlock(Register block)
 {
+    // The error levels for both blocks live in register 0x0B
     if (block == BLOCK_A)
     {
-        return static_cast<RdsBlockErrors>(Util::valueFromReg(registers[block], BLERA));
+        return static_cast<RdsBlockErrors>(Util::valueFromReg(shadow.load(REG_0x0B), BLERA));
     }
     else if (block == BLOCK_B)
     {
-        return static_cast<RdsBlockErrors>(Util::valueFromReg(registers[block], BLERB));
+        return static_cast<RdsBlockErrors>(Util::valueFromReg(shadow.load(REG_0x0B), BLERB));
     }
     // Return SIX_OR_MORE_ERRORS in the event that an invalid
     // registers is passed as a param
@@ -670,6 +988,48 @@ RDA5807M::RdsBlockErrors RDA5807M::getRdsErrorsForBlock(Register block)
     }
 }
 
+/**
+ * Checks the RDSR flag and, if a new group is ready, reads register 0x0B and
+ * the four RDS block registers into the local register map and into group.
+ * Returns true if a new group was read, false otherwise. Only reads 0x0A
+ * when no group is pending. The check and the group go to the bus as one
+ * batch.
+ */
+bool RDA5807M::readRdsGroup(RdsGroup& group)
+{
+    static const uint8_t GROUP_REGS[] = { REG_0x0B, BLOCK_A, BLOCK_B, BLOCK_C, BLOCK_D };
+
+    uint16_t values[sizeof(GROUP_REGS)] = {0};
+    bus.beginBatch();
+    bool ready = isRdsReady();
+    bool read = ready && readRegistersFromDevice(GROUP_REGS, values, sizeof(GROUP_REGS));
+    bus.endBatch();
+
+    // A failed read leaves the previous group in the local map rather than
+    // passing zeros off as one
+    if (!read)
+    {
+        return false;
+    }
+
+    {
+        RegisterShadow::WriteScope writeScope{shadow};
+        for (uint8_t regIdx = 0; regIdx < sizeof(GROUP_REGS); ++regIdx)
+        {
+            shadow.store(GROUP_REGS[regIdx], values[regIdx]);
+        }
+    }
+
+    group.blocks[0] = shadow.load(BLOCK_A);
+    group.blocks[1] = shadow.load(BLOCK_B);
+    group.blocks[2] = shadow.load(BLOCK_C);
+    group.blocks[3] = shadow.load(BLOCK_D);
+    group.errorsA = getRdsErrorsForBlock(BLOCK_A);
+    group.errorsB = getRdsErrorsForBlock(BLOCK_B);
+
+    return true;
+}
+
 /**
  * Returns the currently selected band (stored as an internal member,
  * not read from the radio).
@@ -679,15 +1039,62 @@ RDA5807M::Band RDA5807M::getBand()
     return band;
 }
 
+/**
+ * Returns the 50 MHz mode stored in the local register map
+ */
+bool RDA5807M::getFiftyMhzMode()
+{
+    return (shadow.load(REG_0x07) & R_65M_50M_MODE) == 0;
+}
+
+/**
+ * Returns the channel spacing stored in the local register map
+ */
+RDA5807M::ChannelSpacing RDA5807M::getChannelSpacing()
+{
+    return static_cast<ChannelSpacing>(Util::valueFromReg(shadow.load(REG_0x03), SPACE));
+}
+
+/**
+ * Band edges in terms of 10f, e.g. 870 for 87.0 MHz
+ */
 uint16_t RDA5807M::getBandMinumumFrequency()
 {
-    return FREQUENCY_RANGE_MIN[static_cast<int>(band)];
+    return static_cast<uint16_t>(channelPlanner.getBottomKhz() / 100);
 }
 
 uint16_t RDA5807M::getBandMaximumFrequency()
 {
-    return FREQUENCY_RANGE_MAX[static_cast<int>(band)];
+    return static_cast<uint16_t>(channelPlanner.getTopKhz() / 100);
+}
 
+const ChannelPlanner& RDA5807M::getChannelPlanner() const
+{
+    return channelPlanner;
 }
 
 
+
+/**
+ * Returns the bus transaction counters. The four values are read
+ * independently, so a snapshot taken mid-transaction may be off by one.
+ */
+RDA5807M::BusStats RDA5807M::getBusStats() const
+{
+    BusStats stats;
+    stats.reads = busReads.load(std::memory_order_relaxed);
+    stats.writes = busWrites.load(std::memory_order_relaxed);
+    stats.readErrors = busReadErrors.load(std::memory_order_relaxed);
+    stats.writeErrors = busWriteErrors.load(std::memory_order_relaxed);
+    return stats;
+}
+
+#ifndef RDA5807M_FREESTANDING
+/**
+ * Fails if the bus can't set its clock, leaving it at the platform's rate
+ */
+RDA5807M::StatusResult RDA5807M::setBusClockRate(RDA5807MBus::ClockRate rate)
+{
+    return bus.setClockRate(rate) ? StatusResult::SUCCESS : StatusResult::I2C_FAILURE;
+}
+#endif
@@ -7,10 +7,17 @@
 #define RDA5807M_HPP
 
 // System includes
+#include <atomic>
 #include <cstdint>
+#ifndef RDA5807M_FREESTANDING
+#include <memory>
+#include <string>
+#endif
 
 // Project includes
-#include "mraa.hpp"
+#include "ChannelPlanner.hpp"
+#include "RDA5807MBus.hpp"
+#include "RegisterShadow.hpp"
 
 class RDA5807M
 {
@@ -19,9 +26,18 @@ public:
     // Class Constants //
     /////////////////////
     // Limits
-    static const uint8_t MAX_VOLUME = 0xFF;
+    static const uint8_t MAX_VOLUME = 0x0F;
     static const uint8_t RSSI_MAX = 0x7F;
 
+    // Expected value of the CHIP_ID field in register 0x00
+    static const uint8_t CHIP_ID_VALUE = 0x58;
+
+    // The I2C bus used when no bus is specified
+    static const int DEFAULT_I2C_BUS = 0;
+
+    // Registers 0x02-0x07
+    static const uint8_t WRITABLE_REGISTER_COUNT = 6;
+
     //////////////////////
     // Enum Definitions //
     //////////////////////
@@ -61,11 +77,59 @@ public:
         SUCCESS = 0, ABOVE_MAX = 1, BELOW_MIN = 2, GENERAL_FAILURE = 3, I2C_FAILURE = 4
     };
 
+    // COLD initializes the chip. WARM_ATTACH takes over a chip that is
+    // already running as it is, and only initializes it if it isn't.
+    enum class StartMode {COLD = 0, WARM_ATTACH = 1};
+
+    // What the driver did to the chip when it was created
+    enum class AttachResult {INITIALIZED = 0, ADOPTED = 1, RESTORED = 2};
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+
+    // A single RDS/RBDS group as read from registers 0x0C-0x0F. The chip
+    // only reports error levels for blocks A and B.
+    struct RdsGroup
+    {
+        uint16_t blocks[4];
+        RdsBlockErrors errorsA;
+        RdsBlockErrors errorsB;
+    };
+
+    // Bus transactions issued by the driver since it was created. A
+    // sequential write counts as one write.
+    struct BusStats
+    {
+        uint32_t reads;
+        uint32_t writes;
+        uint32_t readErrors;
+        uint32_t writeErrors;
+    };
+
+    // The chip's configuration, kept across restarts of the application
+    // so that a chip that lost it can be put back exactly as it was
+    struct SavedState
+    {
+        uint16_t chipId;
+        uint16_t writableRegisters[WRITABLE_REGISTER_COUNT];
+    };
+
     ////////////////////////////////
     // Public interface functions //
     ////////////////////////////////
 
-    RDA5807M();
+#ifndef RDA5807M_FREESTANDING
+    explicit RDA5807M(int i2cBusNumber = DEFAULT_I2C_BUS);
+#endif
+
+    explicit RDA5807M(RDA5807MBus& busParam);
+
+    RDA5807M(RDA5807MBus& busParam, StartMode startMode, const SavedState* savedState = nullptr);
+
+    AttachResult getAttachResult() const;
+
+    void getSavedState(SavedState& state) const;
 
     void reset();
 
@@ -77,13 +141,20 @@ public:
 
     StatusResult writeAllRegistersToDevice();
 
+    StatusResult writeAllRegistersToDeviceBurst();
+
+    StatusResult restoreWritableRegisters();
+
     void readDeviceRegistersAndStoreLocally();
 
-    void readAndStoreSingleRegisterFromDevice(Register reg);
+    bool readAndStoreSingleRegisterFromDevice(Register reg);
 
-    uint16_t readRegisterFromDevice(Register reg);
+    // False if the read failed, leaving data as it was
+    bool readRegisterFromDevice(Register reg, uint16_t& data);
 
-    uint16_t getLocalRegisterContent(Register reg);
+    // Safe to call from any thread
+    uint16_t getLocalRegisterContent(Register reg) const;
+    uint32_t getRegisterSnapshot(RegisterShadow::Snapshot& snapshot) const;
 
     // FUNCTIONS USED TO ENABLE/DISABLE RADIO MODES
     StatusResult setMute(bool muteEnable, bool writeResultToDevice = true);
@@ -110,12 +181,16 @@ public:
 
     StatusResult setChannel(uint16_t channel, bool writeResultToDevice = true);
 
+    StatusResult setFrequencyKhz(uint32_t frequencyKhz, bool writeResultToDevice = true);
+
     StatusResult setTune(bool enable, bool writeResultToDevice = true);
 
     StatusResult setBand(Band band, bool writeResultToDevice = true);
 
     StatusResult setChannelSpacing(ChannelSpacing spacing, bool writeResultToDevice = true);
 
+    StatusResult setFiftyMhzMode(bool fiftyMhzEnable, bool writeResultToDevice = true);
+
     StatusResult setVolume(uint8_t volume, bool writeResultToDevice = true);
 
     StatusResult setDeEmphasis(DeEmphasis de, bool writeResultToDevice = true);
@@ -142,6 +217,8 @@ public:
 
     uint16_t getReadChannel();
 
+    uint32_t getReadFrequencyKhz();
+
     uint8_t getRssi();
 
     bool isFmTrue();
@@ -155,15 +232,32 @@ public:
     uint8_t getRdsTrafficProgramIdCode(bool readRegisterFromDevice=false);
     uint8_t getRdsProgramTypeCode(bool readRegisterFromDevice=false);
     RdsBlockErrors getRdsErrorsForBlock(Register block);
+    bool readRdsGroup(RdsGroup& group);
 
+#ifndef RDA5807M_FREESTANDING
     std::string getRegisterMap();
 
     static std::string statusResultToString(StatusResult toConvert);
     static std::string rdsBlockErrorToString(RdsBlockErrors toConvert);
+#endif
+
+    static const char* statusResultToCString(StatusResult toConvert);
+    static const char* rdsBlockErrorToCString(RdsBlockErrors toConvert);
+    static const char* attachResultToCString(AttachResult toConvert);
 
     Band getBand();
+    bool getFiftyMhzMode();
+    ChannelSpacing getChannelSpacing();
     uint16_t getBandMinumumFrequency();
     uint16_t getBandMaximumFrequency();
+    const ChannelPlanner& getChannelPlanner() const;
+
+    // Safe to call from any thread
+    BusStats getBusStats() const;
+
+#ifndef RDA5807M_FREESTANDING
+    StatusResult setBusClockRate(RDA5807MBus::ClockRate rate);
+#endif
 
 private:
     /////////////////////////////
@@ -185,12 +279,6 @@ private:
     // Default values for the register map
     static const uint16_t REGISTER_MAP_DEFAULT_STATE[0x10];
 
-    // This driver makes use of the random access I2C mode, which
-    // isn't documented well for this chip. Nonetheless, it's less
-    // of a pain to use than the sequential access mode.
-    static const uint8_t SEQUENTIAL_ACCESS_I2C_MODE_ADDR = 0x10;
-    static const uint8_t RANDOM_ACCESS_I2C_MODE_ADDR = 0x11;
-
     // Number of bytes in the register map
     static const uint16_t REGISTER_MAP_SIZE_BYTES = sizeof(REGISTER_MAP_DEFAULT_STATE);
 
@@ -220,36 +308,64 @@ private:
     static const uint8_t DEEMP_50_US = 0x01;
 
     // String values for the StatusResult enum
-    static const std::string STATUSRESULT_TO_STRING[];
+    static const char* const STATUSRESULT_TO_STRING[];
+
+    static const char* const BLOCK_ERRORS_TO_STRING[];
+
+    static const char* const ATTACH_RESULT_TO_STRING[];
+
+    // The indices to these arrays are band selection IDs 0-3
+    // and the values are band edges in kHz
+    static const uint32_t BAND_BOTTOM_KHZ[];
+    static const uint32_t BAND_TOP_KHZ[];
 
-    static const std::string BLOCK_ERRORS_TO_STRING[];
+    // Bottom of the east europe band when 65M_50M_MODE is cleared
+    static const uint32_t FIFTY_MHZ_MODE_BOTTOM_KHZ = 50000;
 
-    // The indices to this array are band selection IDs 0-3
-    // The values of this array represent frequencies in MHz,
-    // where 870 = 87.0 MHz
-    static const uint16_t FREQUENCY_RANGE_MIN[];
-    static const uint16_t FREQUENCY_RANGE_MAX[];
+    // Indexed by channel spacing selection IDs 0-3
+    static const uint32_t CHANNEL_SPACING_KHZ[];
 
     /////////////////////////////////
     // Private interface functions //
     /////////////////////////////////
     void init();
-    StatusResult setI2cAddress(uint8_t addr);
+    bool warmAttach(const SavedState* savedState);
+    void adoptRegisters(uint16_t chipId, const uint16_t* writableRegisters);
+    void updateChannelPlan();
     StatusResult conditionallyWriteRegisterToDevice(Register regToWrite, bool shouldWrite);
+    bool readRegistersFromDevice(const uint8_t* regs, uint16_t* values, uint8_t count);
+    StatusResult writeRegistersToDevice(const uint8_t* regs, uint8_t count);
 
     //////////////////////////////
     // Private member variables //
     //////////////////////////////
 
     // The register map of the device. The first register is 0x00
-    // and the last is 0x0F. Each register is two bytes (16 bits)
-    uint16_t registers[0x10];
+    // and the last is 0x0F. Each register is two bytes (16 bits).
+    // Only the thread using the bus changes it; any thread may read it.
+    RegisterShadow shadow;
 
     // The current band (freq range)
     Band band;
 
-    // The I2c interface used to talk to the radio
-    mraa::I2c i2cInterface;
+    AttachResult attachResult;
+
+    // kHz <-> CHAN tables for the current band and spacing
+    ChannelPlanner channelPlanner;
+
+#ifndef RDA5807M_FREESTANDING
+    // Only set when the driver created its own bus
+    std::unique_ptr<RDA5807MBus> ownedBus;
+#endif
+
+    // The bus used to talk to the radio
+    RDA5807MBus& bus;
+
+    // Counted on the bus thread, read from anywhere by getBusStats()
+    std::atomic<uint32_t> busReads{0};
+    std::atomic<uint32_t> busWrites{0};
+    std::atomic<uint32_t> busReadErrors{0};
+    std::atomic<uint32_t> busWriteErrors{0};
 
 };
 
@@ -0,0 +1,110 @@
+/**************************************************
+ * RDA5807MBus.hpp - Bus interface used by the RDA5807M driver
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDA5807MBUS_HPP
+#define RDA5807MBUS_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * Everything the driver needs from the bus the chip sits on. Values are
+ * whole 16 bit registers in host order; implementations take care of the
+ * chip's big-endian byte order and of its two I2C addresses.
+ */
+class RDA5807MBus
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // This driver makes use of the random access I2C mode, which
+    // isn't documented well for this chip. Nonetheless, it's less
+    // of a pain to use than the sequential access mode.
+    static const uint8_t SEQUENTIAL_ACCESS_I2C_MODE_ADDR = 0x10;
+    static const uint8_t RANDOM_ACCESS_I2C_MODE_ADDR = 0x11;
+
+    // The sequential access mode always writes starting at this register
+    static const uint8_t SEQUENTIAL_WRITE_BASE_REG = 0x02;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+
+    // I2C clock rates: 100 kHz, 400 kHz and 3.4 MHz. The chip is rated for
+    // fast mode.
+    enum class ClockRate : uint8_t {STANDARD = 0, FAST = 1, HIGH_SPEED = 2};
+    static const uint8_t CLOCK_RATE_COUNT = 3;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+#ifndef RDA5807M_FREESTANDING
+    virtual ~RDA5807MBus() {};
+#endif
+
+    // Writes a single register. Returns false on failure.
+    virtual bool writeRegister(uint8_t reg, uint16_t value) = 0;
+
+    // Writes count registers, starting at SEQUENTIAL_WRITE_BASE_REG, in a
+    // single transaction. Returns false on failure.
+    virtual bool writeRegistersSequential(const uint16_t* values, uint8_t count) = 0;
+
+    // Reads a single register into value. Returns false on failure.
+    virtual bool readRegister(uint8_t reg, uint16_t& value) = 0;
+
+    // Read or write count registers, not necessarily adjacent, in as few
+    // submissions as the bus can manage. By default one register at a
+    // time. Returns false if any of them failed.
+    virtual bool readRegisters(const uint8_t* regs, uint16_t* values, uint8_t count)
+    {
+        bool allRead = true;
+        for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+        {
+            allRead = readRegister(regs[regIdx], values[regIdx]) && allRead;
+        }
+        return allRead;
+    };
+
+    virtual bool writeRegisters(const uint8_t* regs, const uint16_t* values, uint8_t count)
+    {
+        bool allWritten = true;
+        for (uint8_t regIdx = 0; regIdx < count; ++regIdx)
+        {
+            allWritten = writeRegister(regs[regIdx], values[regIdx]) && allWritten;
+        }
+        return allWritten;
+    };
+
+    // Bracket transactions the driver issues back to back, such as the
+    // registers of one RDS group, so that a shared bus can grant them
+    // together. Batches nest. Buses of their own needn't care.
+    virtual void beginBatch() {};
+    virtual void endBatch() {};
+
+#ifndef RDA5807M_FREESTANDING
+    // Runs the bus clock at rate from the next transaction on. Returns
+    // false if the bus can't set its clock, which then stays at whatever
+    // the platform set it to.
+    virtual bool setClockRate(ClockRate rate)
+    {
+        (void) rate;
+        return false;
+    };
+#endif
+
+#ifdef RDA5807M_FREESTANDING
+protected:
+    // Buses are never deleted through this interface in the freestanding
+    // profile; a virtual destructor would drag in operator delete
+    ~RDA5807MBus() {};
+#endif
+};
+
+#endif  // ifndef RDA5807MBUS_HPP
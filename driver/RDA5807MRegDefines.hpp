@@ -106,6 +106,24 @@
 #define TRAFFIC_PROGRAM 0x0400
 #define PROGRAM_TYPE    0x03E0
 
+// Block 2/B, group type 0 (basic tuning and switching)
+#define TRAFFIC_ANNOUNCEMENT    0x0010
+#define MUSIC_SPEECH            0x0008
+#define PS_SEGMENT_ADDRESS      0x0003
+
+// Block 2/B, group type 2 (RadioText)
+#define RT_AB_FLAG              0x0010
+#define RT_SEGMENT_ADDRESS      0x000F
+
+// Block 2/B, group type 14 (enhanced other networks)
+#define EON_TRAFFIC_PROGRAM         0x0010
+#define EON_TRAFFIC_ANNOUNCEMENT_B  0x0008
+#define EON_VARIANT_CODE            0x000F
+
+// Block 3/C, group type 14A variant 13
+#define EON_PROGRAM_TYPE            0xF800
+#define EON_TRAFFIC_ANNOUNCEMENT_A  0x0001
+
 /**
  * General masks
  */
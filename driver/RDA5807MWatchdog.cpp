@@ -0,0 +1,189 @@
+/**************************************************
+ * RDA5807MWatchdog.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RDA5807MWatchdog.hpp"
+#include "Util.hpp"
+
+// Static variable initialization
+// Indexed by register number - 0x02
+const uint16_t RDA5807MWatchdog::VERIFY_MASKS[] = {
+        /* Reg 0x02 */static_cast<uint16_t>(~(SEEK | SOFT_RESET)),
+        /* Reg 0x03 */static_cast<uint16_t>(~(CHAN | TUNE)),
+        /* Reg 0x04 */static_cast<uint16_t>(~(RSVD_04_0 | RSVD_04_1)),
+        /* Reg 0x05 */static_cast<uint16_t>(~(RSVD_05_0 | RSVD_05_1)),
+        /* Reg 0x06 */static_cast<uint16_t>(~RSVD_06_0),
+        /* Reg 0x07 */static_cast<uint16_t>(~(RSVD_07_0 | RSVD_07_1)) };
+
+RDA5807MWatchdog::RDA5807MWatchdog(RDA5807M& radioParam, uint32_t checkIntervalMsParam) :
+        radio(radioParam), checkIntervalMs(checkIntervalMsParam), lastCheckUs(0),
+        nextRotatingRegister(FIRST_ROTATING_REGISTER), eventCount(0)
+{
+    std::memset(&stats, 0, sizeof(stats));
+    std::memset(events, 0, sizeof(events));
+}
+
+const char* RDA5807MWatchdog::eventTypeToString(EventType toConvert)
+{
+    switch (toConvert)
+    {
+        case EventType::REGISTER_DRIFT:
+            return "REGISTER_DRIFT";
+        case EventType::CHIP_NOT_RESPONDING:
+            return "CHIP_NOT_RESPONDING";
+    }
+    return "UNKNOWN";
+}
+
+/**
+ * Runs check() if at least the check interval has passed since the last
+ * check, and does nothing otherwise. Intended to be called from any loop
+ * that talks to the radio. Returns true if drift was found.
+ */
+bool RDA5807MWatchdog::service()
+{
+    if (checkIntervalMs == 0)
+    {
+        return false;
+    }
+
+    uint64_t now = Util::getMonotonicTimeUs();
+    if ((now - lastCheckUs) < static_cast<uint64_t>(checkIntervalMs) * 1000)
+    {
+        return false;
+    }
+
+    return check();
+}
+
+/**
+ * Verifies the chip ID, register 0x02 and the next register in rotation
+ * against the local register map. If anything differs, the writable
+ * registers are restored in a single burst and an event is recorded.
+ * Returns true if drift was found.
+ */
+bool RDA5807MWatchdog::check()
+{
+    lastCheckUs = Util::getMonotonicTimeUs();
+    ++stats.checksRun;
+
+    uint16_t reg0 = 0;
+    bool read = radio.readRegisterFromDevice(RDA5807M::Register::REG_0x00, reg0);
+    ++stats.busReads;
+
+    if (!read || Util::valueFromReg(reg0, CHIP_ID) != RDA5807M::CHIP_ID_VALUE)
+    {
+        // Nothing useful can be restored to a chip that isn't answering;
+        // try again next time
+        ++stats.chipNotRespondingEvents;
+        recordEvent(EventType::CHIP_NOT_RESPONDING, RDA5807M::Register::REG_0x00,
+                    static_cast<uint16_t>(RDA5807M::CHIP_ID_VALUE << 8), reg0);
+        events[(eventCount - 1) % EVENT_LOG_LENGTH].restoreResult = RDA5807M::StatusResult::I2C_FAILURE;
+        return true;
+    }
+
+    RDA5807M::Register rotating = static_cast<RDA5807M::Register>(nextRotatingRegister);
+    nextRotatingRegister = (nextRotatingRegister == LAST_ROTATING_REGISTER) ? FIRST_ROTATING_REGISTER
+                                                                            : nextRotatingRegister + 1;
+
+    if (verifyRegister(RDA5807M::Register::REG_0x02) && verifyRegister(rotating))
+    {
+        return false;
+    }
+
+    uint64_t restoreStart = Util::getMonotonicTimeUs();
+    RDA5807M::StatusResult result = radio.restoreWritableRegisters();
+    stats.lastRestoreDurationUs = Util::getMonotonicTimeUs() - restoreStart;
+
+    events[(eventCount - 1) % EVENT_LOG_LENGTH].restoreResult = result;
+    if (result != RDA5807M::StatusResult::SUCCESS)
+    {
+        ++stats.restoreFailures;
+    }
+    return true;
+}
+
+/**
+ * Reads reg from the device and compares the verified bits against the
+ * local copy. Records a drift event and returns false on mismatch. A
+ * failed read says nothing about drift, so it passes; a chip that stops
+ * answering is caught by the chip ID check.
+ */
+bool RDA5807MWatchdog::verifyRegister(RDA5807M::Register reg)
+{
+    uint16_t mask = getVerifyMask(reg);
+    uint16_t expected = radio.getLocalRegisterContent(reg);
+    uint16_t actual = 0;
+    bool read = radio.readRegisterFromDevice(reg, actual);
+    ++stats.busReads;
+
+    if (!read || (expected & mask) == (actual & mask))
+    {
+        return true;
+    }
+
+    ++stats.driftEvents;
+    recordEvent(EventType::REGISTER_DRIFT, reg, expected, actual);
+    return false;
+}
+
+void RDA5807MWatchdog::recordEvent(EventType type, uint8_t reg, uint16_t expected, uint16_t actual)
+{
+    Event& event = events[eventCount % EVENT_LOG_LENGTH];
+    event.type = type;
+    event.timestampUs = Util::getMonotonicTimeUs();
+    event.reg = reg;
+    event.expected = expected;
+    event.actual = actual;
+    event.restoreResult = RDA5807M::StatusResult::SUCCESS;
+    ++eventCount;
+}
+
+/**
+ * Sets the minimum time between checks made by service(). 0 disables the
+ * watchdog; check() can still be called directly.
+ */
+void RDA5807MWatchdog::setCheckInterval(uint32_t checkIntervalMsParam)
+{
+    checkIntervalMs = checkIntervalMsParam;
+}
+
+uint32_t RDA5807MWatchdog::getCheckInterval() const
+{
+    return checkIntervalMs;
+}
+
+const RDA5807MWatchdog::Stats& RDA5807MWatchdog::getStats() const
+{
+    return stats;
+}
+
+/**
+ * Returns the number of events available through getEvent(), at most
+ * EVENT_LOG_LENGTH.
+ */
+uint8_t RDA5807MWatchdog::getEventCount() const
+{
+    return static_cast<uint8_t>(eventCount < EVENT_LOG_LENGTH ? eventCount : EVENT_LOG_LENGTH);
+}
+
+/**
+ * Returns a logged event. idx 0 is the most recent.
+ */
+const RDA5807MWatchdog::Event& RDA5807MWatchdog::getEvent(uint8_t idx) const
+{
+    return events[(eventCount - 1 - idx) % EVENT_LOG_LENGTH];
+}
+
+uint16_t RDA5807MWatchdog::getVerifyMask(RDA5807M::Register reg)
+{
+    return VERIFY_MASKS[reg - RDA5807M::Register::REG_0x02];
+}
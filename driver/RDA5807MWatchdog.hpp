@@ -0,0 +1,121 @@
+/**************************************************
+ * RDA5807MWatchdog.hpp - Detects and repairs register drift
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDA5807MWATCHDOG_HPP
+#define RDA5807MWATCHDOG_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * The driver trusts its local register map; if the chip browns out or is
+ * soft reset, the two silently diverge. The watchdog periodically reads
+ * back a few registers and, on any mismatch, restores the whole writable
+ * image in one burst.
+ *
+ * Each check costs three register reads: CHIP_ID (0x00), register 0x02
+ * (which a reset clears, disabling the chip), and one of 0x03-0x07 in
+ * rotation. A reset is therefore caught by the first check after it
+ * happens, and any other drift within five checks.
+ */
+class RDA5807MWatchdog
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_CHECK_INTERVAL_MS = 1000;
+
+    // Number of drift events kept in the event log
+    static const uint8_t EVENT_LOG_LENGTH = 8;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class EventType {REGISTER_DRIFT = 0, CHIP_NOT_RESPONDING = 1};
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Event
+    {
+        EventType type;
+        uint64_t timestampUs;
+        uint8_t reg;
+        uint16_t expected;
+        uint16_t actual;
+        RDA5807M::StatusResult restoreResult;
+    };
+
+    struct Stats
+    {
+        uint32_t checksRun;
+        uint32_t busReads;
+        uint32_t driftEvents;
+        uint32_t chipNotRespondingEvents;
+        uint32_t restoreFailures;
+        uint64_t lastRestoreDurationUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RDA5807MWatchdog(RDA5807M& radioParam, uint32_t checkIntervalMsParam = DEFAULT_CHECK_INTERVAL_MS);
+
+    bool service();
+
+    bool check();
+
+    void setCheckInterval(uint32_t checkIntervalMsParam);
+    uint32_t getCheckInterval() const;
+
+    const Stats& getStats() const;
+
+    uint8_t getEventCount() const;
+    const Event& getEvent(uint8_t idx) const;
+
+    // Bits of writable register reg (0x02-0x07) that read back as they
+    // were written
+    static uint16_t getVerifyMask(RDA5807M::Register reg);
+
+    static const char* eventTypeToString(EventType toConvert);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+
+    // Bits that are compared for each of the writable registers 0x02-0x07.
+    // Self-clearing bits, reserved bits and the channel (which seeking
+    // changes behind the driver's back) are ignored.
+    static const uint16_t VERIFY_MASKS[];
+
+    static const uint8_t FIRST_ROTATING_REGISTER = RDA5807M::Register::REG_0x03;
+    static const uint8_t LAST_ROTATING_REGISTER = RDA5807M::Register::REG_0x07;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    bool verifyRegister(RDA5807M::Register reg);
+    void recordEvent(EventType type, uint8_t reg, uint16_t expected, uint16_t actual);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    uint32_t checkIntervalMs;
+    uint64_t lastCheckUs;
+    uint8_t nextRotatingRegister;
+    Stats stats;
+
+    // Ring of the most recent events; eventCount is the total ever recorded
+    Event events[EVENT_LOG_LENGTH];
+    uint32_t eventCount;
+};
+
+#endif  // ifndef RDA5807MWATCHDOG_HPP
@@ -0,0 +1,83 @@
+/**************************************************
+ * RadioStateFile.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// Project includes
+#include "RadioStateFile.hpp"
+#include "RDA5807M.hpp"
+
+/**
+ * Writes state to a temporary file next to path and renames it over path
+ */
+bool RadioStateFile::save(const char* path, const RDA5807M::SavedState& state)
+{
+    FileContents contents;
+    std::memset(&contents, 0, sizeof(contents));
+    contents.magic = FILE_MAGIC;
+    contents.formatVersion = FORMAT_VERSION;
+    contents.chipId = state.chipId;
+    std::memcpy(contents.writableRegisters, state.writableRegisters, sizeof(contents.writableRegisters));
+    contents.checksum = computeChecksum(contents);
+
+    std::string tempPath = std::string(path) + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = std::fwrite(&contents, sizeof(contents), 1, file) == 1;
+    written = (std::fclose(file) == 0) && written;
+    if (!written || std::rename(tempPath.c_str(), path) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool RadioStateFile::load(const char* path, RDA5807M::SavedState& state)
+{
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    FileContents contents;
+    bool read = std::fread(&contents, sizeof(contents), 1, file) == 1;
+    std::fclose(file);
+
+    if (!read || contents.magic != FILE_MAGIC || contents.formatVersion != FORMAT_VERSION ||
+        contents.checksum != computeChecksum(contents))
+    {
+        return false;
+    }
+
+    state.chipId = contents.chipId;
+    std::memcpy(state.writableRegisters, contents.writableRegisters, sizeof(state.writableRegisters));
+    return true;
+}
+
+uint16_t RadioStateFile::computeChecksum(const FileContents& contents)
+{
+    uint32_t sum = (contents.magic >> 16) + (contents.magic & 0xFFFF) + contents.formatVersion + contents.chipId;
+    for (uint8_t regIdx = 0; regIdx < RDA5807M::WRITABLE_REGISTER_COUNT; ++regIdx)
+    {
+        sum += contents.writableRegisters[regIdx];
+    }
+
+    // Fold the carries back in
+    while ((sum >> 16) != 0)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
@@ -0,0 +1,60 @@
+/**************************************************
+ * RadioStateFile.hpp - Keeps the radio's configuration across restarts
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RADIOSTATEFILE_HPP
+#define RADIOSTATEFILE_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Saves an RDA5807M::SavedState to a file and loads it back, for a warm
+ * attach to restore a chip that lost its configuration while the
+ * application was not running. The file is a fixed-size record in host
+ * byte order with a checksum, replaced atomically on save, so a crash
+ * while saving leaves the previous state in place.
+ */
+class RadioStateFile
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t FILE_MAGIC = 0x54534452; // "RDST"
+    static const uint16_t FORMAT_VERSION = 1;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static bool save(const char* path, const RDA5807M::SavedState& state);
+
+    // False if there is no file, or it isn't a valid state file
+    static bool load(const char* path, RDA5807M::SavedState& state);
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct FileContents
+    {
+        uint32_t magic;
+        uint16_t formatVersion;
+        uint16_t chipId;
+        uint16_t writableRegisters[RDA5807M::WRITABLE_REGISTER_COUNT];
+
+        // Ones' complement of the sum of the words above
+        uint16_t checksum;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    static uint16_t computeChecksum(const FileContents& contents);
+};
+
+#endif  // ifndef RADIOSTATEFILE_HPP
@@ -0,0 +1,164 @@
+/**************************************************
+ * RegisterShadow.hpp - Seqlock-protected copy of the register map
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef REGISTERSHADOW_HPP
+#define REGISTERSHADOW_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "SeqLock.hpp"
+
+/**
+ * The driver's local copy of the chip's registers. One thread, the one
+ * that owns the bus, writes it; any number of other threads may take
+ * snapshots at the same time without locking.
+ *
+ * The registers live in a SeqLock, one word each, written in place. A
+ * reader copies every register and retries if a write overlapped, so it
+ * always ends up with a set of values that were all in the shadow
+ * together. The writer never waits for readers, and readers never wait
+ * for each other. Several writes can be grouped into one atomic update
+ * with WriteScope, e.g. a whole status read. Everything is inline since
+ * the bus thread goes through here for every register access.
+ */
+class RegisterShadow
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t REGISTER_COUNT = 0x10;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Snapshot
+    {
+        // Number of completed write batches when the snapshot was taken
+        uint32_t version;
+        uint16_t registers[REGISTER_COUNT];
+    };
+
+    /**
+     * Makes every write done while it exists visible to readers at once
+     */
+    class WriteScope
+    {
+    public:
+        explicit WriteScope(RegisterShadow& shadowParam) : shadow(shadowParam)
+        {
+            shadow.beginWrite();
+        };
+
+        ~WriteScope()
+        {
+            shadow.endWrite();
+        };
+
+        WriteScope(const WriteScope&) = delete;
+        WriteScope& operator=(const WriteScope&) = delete;
+
+    private:
+        RegisterShadow& shadow;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RegisterShadow() : writeDepth(0) {};
+
+    // Writer thread only
+    uint16_t load(uint8_t reg) const
+    {
+        return registers.loadWord(reg);
+    };
+
+    // Writer thread only
+    void store(uint8_t reg, uint16_t value)
+    {
+        beginWrite();
+        registers.storeWord(reg, value);
+        endWrite();
+    };
+
+    // Writer thread only. Copies count registers starting at first.
+    void copy(uint8_t first, uint8_t count, uint16_t* values) const
+    {
+        for (uint8_t idx = 0; idx < count; ++idx)
+        {
+            values[idx] = registers.loadWord(first + idx);
+        }
+    };
+
+    // Any thread. Returns the number of times the copy had to be retried
+    // because the writer was busy.
+    uint32_t snapshot(Snapshot& result) const
+    {
+        Registers values;
+        uint32_t retries = 0;
+        while (!registers.tryLoad(values, result.version))
+        {
+            ++retries;
+        }
+
+        for (uint8_t reg = 0; reg < REGISTER_COUNT; ++reg)
+        {
+            result.registers[reg] = values.values[reg];
+        }
+        return retries;
+    };
+
+    // Any thread. A single register needs no retry loop.
+    uint16_t read(uint8_t reg) const
+    {
+        return registers.loadWord(reg);
+    };
+
+    // Any thread
+    uint32_t getVersion() const
+    {
+        return registers.getVersion();
+    };
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Registers
+    {
+        uint16_t values[REGISTER_COUNT];
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void beginWrite()
+    {
+        if (writeDepth++ == 0)
+        {
+            registers.beginWrite();
+        }
+    };
+
+    void endWrite()
+    {
+        if (--writeDepth == 0)
+        {
+            registers.endWrite();
+        }
+    };
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    SeqLock<Registers, uint16_t> registers;
+
+    // Nesting of WriteScopes and store()s; only touched by the writer
+    uint32_t writeDepth;
+};
+
+#endif  // ifndef REGISTERSHADOW_HPP
@@ -6,35 +6,85 @@
  */
 
 // System includes
+#include <algorithm>
 #include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <memory>
 #include <string>
 #include <unistd.h>
+#include <vector>
 
 // Project includes
+#include "BusArbiter.hpp"
+#include "BusClockCalibrator.hpp"
+#include "BusTrace.hpp"
+#include "BusTraceReader.hpp"
+#include "MetricsRegistry.hpp"
+#include "MetricsServer.hpp"
+#include "OdaRegistry.hpp"
+#include "ParallelSurvey.hpp"
+#include "PollingController.hpp"
 #include "RDA5807M.hpp"
 #include "RDA5807MRegDefines.hpp"
+#include "RDA5807MWatchdog.hpp"
 #include "RDA5807MWrapper.hpp"
+#include "RdsDecoder.hpp"
+#include "RdsGroupLog.hpp"
+#include "RssiSampler.hpp"
+#include "RtPlusHandler.hpp"
+#include "SimulatedBus.hpp"
+#include "StationStatePublisher.hpp"
+#include "TmcDecoder.hpp"
+#include "TmcTableFormat.hpp"
+#include "TmcTables.hpp"
 #include "Util.hpp"
+#include "WaterfallFormat.hpp"
+#include "WaterfallReader.hpp"
+#include "WaterfallWriter.hpp"
+
+const char* const RDA5807MWrapper::WATERFALL_PATH = "/var/tmp/rda5807m_waterfall.wf";
+const char* const RDA5807MWrapper::BUS_TRACE_PATH = "/var/tmp/rda5807m_bustrace.bin";
+const char* const RDA5807MWrapper::TMC_TABLE_PATH = TmcTableFormat::DEFAULT_PATH;
+const char* const RDA5807MWrapper::GROUP_LOG_PATH = RdsGroupLogFormat::DEFAULT_PATH;
 
 /**
  * Sets the radio frequency. The frequency is to be provided as an integer.
  * For example: 104.3MHz is passed as 1043
- * The minimum frequency is 87 MHz, and the maximum is 108MHz; US/European bands
- * are assumed.
+ * The frequency is validated against the current band and channel spacing.
  */
 RDA5807M::StatusResult RDA5807MWrapper::setFrequency(int freq)
 {
-    // Frequency ranges assume US/Europe band selection
-    if (freq < radio.getBandMinumumFrequency())
+    if (freq < 0)
     {
         return RDA5807M::StatusResult { RDA5807M::StatusResult::BELOW_MIN };
     }
-    else if (freq > radio.getBandMaximumFrequency())
+
+    return setFrequencyKhz(freq * 100);
+}
+
+/**
+ * Sets the radio frequency in kHz, e.g. 104325 for 104.325MHz. Needed to
+ * reach channels on a 25 or 50 KHz raster.
+ */
+RDA5807M::StatusResult RDA5807MWrapper::setFrequencyKhz(int freqKhz)
+{
+    if (freqKhz < 0)
     {
-        return RDA5807M::StatusResult { RDA5807M::StatusResult::ABOVE_MAX };
+        return RDA5807M::StatusResult { RDA5807M::StatusResult::BELOW_MIN };
+    }
+
+    RDA5807M::StatusResult result = radio.setFrequencyKhz(static_cast<uint32_t>(freqKhz), false);
+    if (result != RDA5807M::StatusResult::SUCCESS)
+    {
+        return result;
     }
 
-    radio.setChannel(static_cast<uint16_t>(freq), false);
+    // Anything decoded so far belongs to the previous station
+    rdsDecoder.reset();
+    odaRegistry.reset();
+    trafficAnnouncements.reset();
+
     return radio.setTune(true);
 }
 
@@ -89,6 +139,7 @@ std::string RDA5807MWrapper::getStatusString(int UNUSED)
     (void) UNUSED;
 
     radio.readDeviceRegistersAndStoreLocally();
+    updateTunerMetrics();
 
     std::string status{""};
     char buffer[100] = {0};
@@ -179,21 +230,42 @@ RDA5807M::StatusResult RDA5807MWrapper::setTune(int tuneEnable)
  */
 std::string RDA5807MWrapper::generateFreqMap(int length)
 {
+    BusArbiter::ClassScope busClass{BusArbiter::TrafficClass::BACKGROUND_SCAN};
 
     std::string results{""};
     radio.setMute(true);
-    for (int freq = 881; freq <= 1081; freq+=2)
+
+    // The odd tenths of the band, at whatever spacing is configured. A
+    // 200 KHz raster from an even tenth has none, so it is walked whole.
+    const ChannelPlanner& planner = radio.getChannelPlanner();
+    const uint32_t* channelTable = planner.getChannelTable();
+    uint16_t firstChan = 0;
+    while (firstChan < planner.getChannelCount() && channelTable[firstChan] % FREQ_MAP_STEP_KHZ != FREQ_MAP_OFFSET_KHZ)
     {
-        setFrequency(freq);
+        ++firstChan;
+    }
+
+    uint16_t chanStep = static_cast<uint16_t>(FREQ_MAP_STEP_KHZ / planner.getSpacingKhz());
+    if (firstChan == planner.getChannelCount() || chanStep == 0)
+    {
+        firstChan = 0;
+        chanStep = 1;
+    }
+
+    for (uint16_t chan = firstChan; chan < planner.getChannelCount(); chan += chanStep)
+    {
+        uint32_t freqKhz = channelTable[chan];
+        setFrequencyKhz(static_cast<int>(freqKhz));
+        pollingController.setRdsWanted(length == 1);
         if (length == 1)
         {
             radio.setRdsMode(false);
             radio.setRdsMode(true);
-            usleep(1000*MICROS_IN_MILLIS);
+            waitForTuneToSettle(FREQ_MAP_RDS_DWELL_MS);
         }
         else
         {
-            usleep(120*MICROS_IN_MILLIS);
+            waitForTuneToSettle(FREQ_MAP_DWELL_MS);
         }
 
         // Generate freq bars
@@ -205,11 +277,12 @@ std::string RDA5807MWrapper::generateFreqMap(int length)
         char fullBuff[160] = {0};
         if (length == 1)
         {
-            std::sprintf(fullBuff, "Freq: %04u  RDS: %s  RSSI(%03u): %s\n", freq, radio.isRdsDecoderSynchronized() ? "Y" : "N", rssi, barBuff);
+            std::sprintf(fullBuff, "Freq: %3u.%03u  RDS: %s  RSSI(%03u): %s\n", freqKhz / 1000, freqKhz % 1000,
+                         radio.isRdsDecoderSynchronized() ? "Y" : "N", rssi, barBuff);
         }
         else
         {
-            std::sprintf(fullBuff, "Freq: %04u RSSI(%03u): %s\n", freq, rssi, barBuff);
+            std::sprintf(fullBuff, "Freq: %3u.%03u RSSI(%03u): %s\n", freqKhz / 1000, freqKhz % 1000, rssi, barBuff);
         }
         results.append(fullBuff);
     }
@@ -299,6 +372,7 @@ std::string RDA5807MWrapper::getRdsInfoString(int UNUSED)
     (void) UNUSED;
 
     radio.readDeviceRegistersAndStoreLocally();
+    updateTunerMetrics();
 
     std::string status{""};
     char buffer[350] = {0};
@@ -358,35 +432,1299 @@ std::string RDA5807MWrapper::getLocalCopyOfReg(int reg)
 
 /**
  * Prints the contents block C and D registers when they contain group 2 data.
- * The process runs for ms milliseconds.
- * The RDS registers are queried approximately every 10 ms.
+ * The process runs for ms milliseconds, reading when the polling
+ * controller says a group is due.
  */
 std::string RDA5807MWrapper::snoopRdsGroupTwo(int ms)
 {
-    const uint8_t msToWait = 10;
-    int numRetries = ms/msToWait;
-
+    BusArbiter::ClassScope busClass{BusArbiter::TrafficClass::RDS};
     char charBuff[15] = {};
     std::string strBuff;
-    for (int retryIdx = 0; retryIdx < numRetries; ++retryIdx)
+
+    pollingController.setRdsWanted(true);
+    pollingController.reset(Util::getMonotonicTimeUs());
+
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    uint64_t endUs = nowUs + static_cast<uint64_t>(ms > 0 ? ms : 0) * MICROS_IN_MILLIS;
+    while (nowUs < endUs)
     {
-        radio.readDeviceRegistersAndStoreLocally();
-        if (radio.isRdsDecoderSynchronized() && radio.getRdsGroupTypeCode() == 2)
+        RDA5807M::RdsGroup group;
+        bool groupRead = false;
+        uint32_t delayUs = pollingController.poll(nowUs, group, groupRead);
+        if (groupRead && (group.blocks[1] >> 12) == 2)
         {
             sprintf(charBuff, "%c%c%c%c",
-                    Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::BLOCK_C), UINT16_UPPER_BYTE),
-                    Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::BLOCK_C), UINT16_LOWER_BYTE),
-                    Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::BLOCK_D), UINT16_UPPER_BYTE),
-                    Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::BLOCK_D), UINT16_LOWER_BYTE));
+                    Util::valueFromReg(group.blocks[2], UINT16_UPPER_BYTE),
+                    Util::valueFromReg(group.blocks[2], UINT16_LOWER_BYTE),
+                    Util::valueFromReg(group.blocks[3], UINT16_UPPER_BYTE),
+                    Util::valueFromReg(group.blocks[3], UINT16_LOWER_BYTE));
             strBuff += charBuff;
 
             // Toggle RDS. This clears the synchronized flag
             radio.setRdsMode(false);
             radio.setRdsMode(true);
+            pollingController.restart();
         }
-        usleep(msToWait * MICROS_IN_MILLIS);
+        nowUs = sleepUntil(std::min(nowUs + delayUs, endUs));
     }
 
     return strBuff;
 }
 
+/**
+ * Reads and decodes RDS groups for ms milliseconds, publishing the tuner
+ * state to shared memory after every poll so that other processes can
+ * follow along (see StationStateReader). Groups and decoded changes are
+ * also streamed to RDS event socket subscribers, if the socket could be
+ * opened. Unlike snoopRdsGroupTwo(), this doesn't toggle RDS, so the
+ * decoder stays synchronized.
+ */
+std::string RDA5807MWrapper::acquireRds(int ms)
+{
+    BusArbiter::ClassScope busClass{BusArbiter::TrafficClass::RDS};
+
+    if (!stationStatePublisher.isOpen() && !stationStatePublisher.open())
+    {
+        return "Unable to open shared memory segment";
+    }
+
+    // Subscribers are optional, so carry on without the socket
+    if (!rdsEventBroker.isOpen())
+    {
+        rdsEventBroker.open();
+    }
+
+    loadTmcTables();
+
+    uint32_t groupsRead = 0;
+    pollingController.setRdsWanted(true);
+    pollingController.reset(Util::getMonotonicTimeUs());
+
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    uint64_t endUs = nowUs + static_cast<uint64_t>(ms > 0 ? ms : 0) * MICROS_IN_MILLIS;
+    while (nowUs < endUs)
+    {
+        watchdog.service();
+
+        RDA5807M::RdsGroup group;
+        bool groupRead = false;
+        uint32_t delayUs = pollingController.poll(nowUs, group, groupRead);
+        if (groupRead)
+        {
+            ++groupsRead;
+
+            // First, so an announcement is acted on before anything else
+            // is done with the group
+            trafficAnnouncements.processGroup(group, Util::getMonotonicTimeUs());
+            rdsDecoder.processGroup(group);
+            odaRegistry.processGroup(group, rdsDecoder);
+            stationStatePublisher.recordGroup(group);
+            rdsEventBroker.publish(group, rdsDecoder);
+            metrics.recordGroup(group);
+
+            uint64_t realtimeUs = Util::getRealtimeUs();
+            tmcDecoder.processGroup(group, realtimeUs);
+            if (groupLogWriter.isOpen())
+            {
+                groupLogWriter.append(group, realtimeUs);
+            }
+        }
+
+        rdsEventBroker.service();
+        stationStatePublisher.updateStatus(radio);
+        updateTunerMetrics();
+        stationStatePublisher.updateRds(rdsDecoder);
+        stationStatePublisher.publish();
+
+        nowUs = sleepUntil(std::min(nowUs + delayUs, endUs));
+    }
+
+    // Nothing follows an announcement once acquisition stops, so it is
+    // ended rather than left switched in
+    trafficAnnouncements.endAnnouncements();
+
+    const RdsDecoder::RdsData& rds = rdsDecoder.getData();
+    char buffer[200] = {0};
+    std::sprintf(buffer, "Groups read: %u\nPI: 0x%04x\nPTY: %02u\nPS: %s\nRT: %s\n",
+                 groupsRead, rds.piCode, rds.programType, rds.programService, rds.radioText);
+    std::string output = buffer;
+
+    const RtPlusHandler::Tags& tags = rtPlusHandler.getTags();
+    if (tags.title[0] != '\0' || tags.artist[0] != '\0')
+    {
+        output += std::string("Title: ") + tags.title + "\nArtist: " + tags.artist + "\n";
+    }
+    return output;
+}
+
+/**
+ * Polls through the tune that was just started, and through RDS
+ * synchronization if RDS is wanted, for at most timeoutMs
+ */
+void RDA5807MWrapper::waitForTuneToSettle(uint32_t timeoutMs)
+{
+    pollingController.restart();
+
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    uint64_t endUs = nowUs + static_cast<uint64_t>(timeoutMs) * MICROS_IN_MILLIS;
+    while (nowUs < endUs)
+    {
+        RDA5807M::RdsGroup group;
+        bool groupRead = false;
+        uint32_t delayUs = pollingController.poll(nowUs, group, groupRead);
+
+        PollingController::Mode mode = pollingController.getMode();
+        if (mode != PollingController::Mode::TUNING && mode != PollingController::Mode::SYNCING)
+        {
+            return;
+        }
+        nowUs = sleepUntil(std::min(nowUs + delayUs, endUs));
+    }
+}
+
+/**
+ * Sleeps until the monotonic clock reaches wakeUs and returns the time
+ * on waking
+ */
+uint64_t RDA5807MWrapper::sleepUntil(uint64_t wakeUs)
+{
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    if (wakeUs > nowUs)
+    {
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        usleep(static_cast<useconds_t>(wakeUs - nowUs));
+        nowUs = Util::getMonotonicTimeUs();
+    }
+    return nowUs;
+}
+
+void RDA5807MWrapper::serviceWatchdog()
+{
+    watchdog.service();
+}
+
+void RDA5807MWrapper::recordCommandLatency(const char* command, uint64_t durationUs)
+{
+    metrics.recordCommandLatency(command, durationUs);
+}
+
+/**
+ * Copies the tuner status from the local register map, which the caller
+ * must have just refreshed, to the metrics. Doesn't touch the bus.
+ */
+void RDA5807MWrapper::updateTunerMetrics()
+{
+    uint16_t regA = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A);
+    uint16_t regB = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B);
+
+    metrics.setTunerState(radio.getChannelPlanner().channelToKhz(Util::valueFromReg(regA, READCHAN)),
+                          static_cast<uint8_t>(Util::valueFromReg(regB, RSSI)), Util::valueFromReg(regA, ST) != 0,
+                          Util::valueFromReg(regB, FM_TRUE) != 0, Util::valueFromReg(regA, RDSS) != 0);
+}
+
+/**
+ * Sets the watchdog check interval to intervalMs (0 disables it) unless
+ * no param is given, then prints the watchdog statistics and event log.
+ */
+std::string RDA5807MWrapper::configureWatchdog(int intervalMs)
+{
+    if (intervalMs >= 0)
+    {
+        watchdog.setCheckInterval(static_cast<uint32_t>(intervalMs));
+    }
+
+    const RDA5807MWatchdog::Stats& stats = watchdog.getStats();
+    std::string status{""};
+    char buffer[150] = {0};
+
+    std::sprintf(buffer, "Check interval: %u ms\n", watchdog.getCheckInterval());
+    status.append(buffer);
+
+    std::sprintf(buffer, "Checks run: %u (%u register reads)\n", stats.checksRun, stats.busReads);
+    status.append(buffer);
+
+    std::sprintf(buffer, "Drift events: %u\nChip not responding: %u\nRestore failures: %u\n",
+                 stats.driftEvents, stats.chipNotRespondingEvents, stats.restoreFailures);
+    status.append(buffer);
+
+    std::sprintf(buffer, "Last restore took: %llu us\n", static_cast<unsigned long long>(stats.lastRestoreDurationUs));
+    status.append(buffer);
+
+    uint64_t now = Util::getMonotonicTimeUs();
+    for (uint8_t idx = 0; idx < watchdog.getEventCount(); ++idx)
+    {
+        const RDA5807MWatchdog::Event& event = watchdog.getEvent(idx);
+        std::sprintf(buffer, "%llu ms ago: %s on reg 0x%02x (expected 0x%04x, read 0x%04x), restore: %s\n",
+                     static_cast<unsigned long long>((now - event.timestampUs) / 1000),
+                     RDA5807MWatchdog::eventTypeToString(event.type), event.reg, event.expected, event.actual,
+                     RDA5807M::statusResultToString(event.restoreResult).c_str());
+        status.append(buffer);
+    }
+
+    return status;
+}
+
+void RDA5807MWrapper::addSurveyTuner(RDA5807M& tuner)
+{
+    extraSurveyTuners.push_back(&tuner);
+}
+
+void RDA5807MWrapper::setBusArbiter(BusArbiter& arbiter)
+{
+    busArbiter = &arbiter;
+}
+
+/**
+ * Surveys the band with radio and every tuner added with addSurveyTuner(),
+ * splitting the channels between them. If detectRds is 1, the PI code of
+ * every station carrying RDS is picked up as well (takes longer).
+ */
+std::string RDA5807MWrapper::surveyBand(int detectRds)
+{
+    std::vector<RDA5807M*> tuners{&radio};
+    tuners.insert(tuners.end(), extraSurveyTuners.begin(), extraSurveyTuners.end());
+
+    ParallelSurvey survey{tuners};
+    std::map<uint32_t, ParallelSurvey::ChannelResult> results = survey.run(detectRds == 1);
+
+    // The radio is back on its channel, but what was decoded before the
+    // survey went across the band is stale
+    rdsDecoder.reset();
+    odaRegistry.reset();
+    metrics.recordScanDuration(survey.getStats().wallTimeUs);
+
+    for (const std::pair<const uint32_t, ParallelSurvey::ChannelResult>& entry : results)
+    {
+        TargetedSearch::ChannelHistory& history = stationHistory[entry.first];
+        history.rssi = entry.second.rssi;
+        history.fmTrue = entry.second.fmTrue;
+        if (entry.second.rdsSynchronized)
+        {
+            history.piCodeKnown = true;
+            history.piCode = entry.second.piCode;
+        }
+    }
+
+    return formatSurvey(results, survey.getStats());
+}
+
+/**
+ * Runs an RDS survey of a simulated band with tunerCount simulated tuners.
+ * Comparing the wall time for different tuner counts shows how the survey
+ * scales without needing the hardware.
+ */
+std::string RDA5807MWrapper::surveySimulatedBand(int tunerCount)
+{
+    if (tunerCount < 1)
+    {
+        tunerCount = 1;
+    }
+
+    std::vector<std::unique_ptr<SimulatedBus>> buses;
+    std::vector<std::unique_ptr<RDA5807M>> simulatedRadios;
+    std::vector<RDA5807M*> tuners;
+
+    for (int idx = 0; idx < tunerCount; ++idx)
+    {
+        buses.emplace_back(new SimulatedBus());
+        buses.back()->populateDemoBand();
+        simulatedRadios.emplace_back(new RDA5807M(*buses.back()));
+        tuners.push_back(simulatedRadios.back().get());
+    }
+
+    ParallelSurvey survey{tuners};
+    std::map<uint32_t, ParallelSurvey::ChannelResult> results = survey.run(true);
+    metrics.recordScanDuration(survey.getStats().wallTimeUs);
+
+    return formatSurvey(results, survey.getStats());
+}
+
+/**
+ * Lists the channels that carry a station, followed by the survey timing
+ */
+std::string RDA5807MWrapper::formatSurvey(const std::map<uint32_t, ParallelSurvey::ChannelResult>& results,
+                                          const ParallelSurvey::Stats& stats)
+{
+    std::string output{""};
+    char buffer[100] = {0};
+
+    for (const std::pair<const uint32_t, ParallelSurvey::ChannelResult>& entry : results)
+    {
+        const ParallelSurvey::ChannelResult& result = entry.second;
+        if (!result.fmTrue)
+        {
+            continue;
+        }
+
+        if (result.rdsSynchronized)
+        {
+            std::sprintf(buffer, "Freq: %3u.%03u  RSSI: %03u  PI: 0x%04x  (tuner %u)\n", result.frequencyKhz / 1000,
+                         result.frequencyKhz % 1000, result.rssi, result.piCode, result.tunerIdx);
+        }
+        else
+        {
+            std::sprintf(buffer, "Freq: %3u.%03u  RSSI: %03u  (tuner %u)\n", result.frequencyKhz / 1000,
+                         result.frequencyKhz % 1000, result.rssi, result.tunerIdx);
+        }
+        output.append(buffer);
+    }
+
+    std::sprintf(buffer, "\nSurveyed %u channels in %llu ms (%u steals)\n", stats.channelsSurveyed,
+                 static_cast<unsigned long long>(stats.wallTimeUs / 1000), stats.steals);
+    output.append(buffer);
+
+    for (size_t idx = 0; idx < stats.channelsPerTuner.size(); ++idx)
+    {
+        std::sprintf(buffer, "Tuner %u: %u channels, busy %llu ms\n", static_cast<unsigned int>(idx),
+                     stats.channelsPerTuner[idx], static_cast<unsigned long long>(stats.busyTimeUsPerTuner[idx] / 1000));
+        output.append(buffer);
+    }
+
+    return output;
+}
+
+/**
+ * Prints how the polling controller spent its time since the last
+ * RDSACQUIRE or SNOOPRDSGROUP2 started, and the bus load over that time
+ */
+std::string RDA5807MWrapper::getPollingStats(int UNUSED)
+{
+    (void) UNUSED;
+
+    PollingController::Stats stats = pollingController.getStats(Util::getMonotonicTimeUs());
+    uint64_t elapsedMs = (stats.elapsedUs > 0) ? stats.elapsedUs / 1000 : 1;
+
+    char buffer[200] = {0};
+    std::sprintf(buffer, "Mode: %s\nPolls: %llu (%llu groups read, %u escalations)\n"
+                         "Bus: %llu reads, %llu writes in %llu ms, %u.%02u%% utilization\n",
+                 PollingController::modeToCString(pollingController.getMode()),
+                 static_cast<unsigned long long>(stats.polls), static_cast<unsigned long long>(stats.groupsRead),
+                 stats.escalations, static_cast<unsigned long long>(stats.busReads),
+                 static_cast<unsigned long long>(stats.busWrites), static_cast<unsigned long long>(elapsedMs),
+                 stats.busUtilizationPpm / 10000, (stats.busUtilizationPpm / 100) % 100);
+    std::string output = buffer;
+
+    for (uint8_t modeIdx = 0; modeIdx < PollingController::MODE_COUNT; ++modeIdx)
+    {
+        std::sprintf(buffer, "  %-10s %8llu ms\n",
+                     PollingController::modeToCString(static_cast<PollingController::Mode>(modeIdx)),
+                     static_cast<unsigned long long>(stats.timeInModeUs[modeIdx] / 1000));
+        output.append(buffer);
+    }
+    return output;
+}
+
+/**
+ * Prints, for each traffic class on the shared bus, how often it got the
+ * bus, how long it waited and how much of the bus it used. clearStats 0
+ * starts the statistics over.
+ */
+std::string RDA5807MWrapper::getBusArbiterStats(int clearStats)
+{
+    if (busArbiter == nullptr)
+    {
+        return "The radio's bus isn't shared";
+    }
+
+    if (clearStats == 0)
+    {
+        busArbiter->resetStats();
+        return "Cleared";
+    }
+
+    std::string output = "Class             grants  transfers throttled  wait p50/p99/max us   bus ms  limit/s\n";
+    char buffer[200] = {0};
+    for (uint8_t classIdx = 0; classIdx < BusArbiter::TRAFFIC_CLASS_COUNT; ++classIdx)
+    {
+        BusArbiter::TrafficClass trafficClass = static_cast<BusArbiter::TrafficClass>(classIdx);
+        BusArbiter::ClassStats stats = busArbiter->getStats(trafficClass);
+        BusArbiter::RateLimit limit = busArbiter->getRateLimit(trafficClass);
+        std::sprintf(buffer, "%-16s %7llu %10llu %9llu %6llu/%6llu/%6llu %8llu  %7u\n",
+                     BusArbiter::trafficClassToCString(trafficClass), static_cast<unsigned long long>(stats.grants),
+                     static_cast<unsigned long long>(stats.transactions),
+                     static_cast<unsigned long long>(stats.throttledGrants),
+                     static_cast<unsigned long long>(BusArbiter::getWaitPercentileUs(stats, 50)),
+                     static_cast<unsigned long long>(BusArbiter::getWaitPercentileUs(stats, 99)),
+                     static_cast<unsigned long long>(stats.maxWaitUs),
+                     static_cast<unsigned long long>(stats.busyUs / 1000), limit.transactionsPerSecond);
+        output.append(buffer);
+    }
+    return output;
+}
+
+/**
+ * Runs the I2C clock calibration on the radio's bus, leaves the bus on the
+ * fastest stable rate and saves it for the next start
+ */
+std::string RDA5807MWrapper::calibrateBusClock(int UNUSED)
+{
+    (void) UNUSED;
+
+    BusClockCalibrator calibrator{radio};
+    BusClockCalibrator::Calibration calibration = calibrator.calibrate(BusClockCalibrator::DEFAULT_PATH);
+
+    char buffer[200] = {0};
+    std::string output = "Clock      passes  transactions  errors  mismatches  us/pass  max us\n";
+    bool anySupported = false;
+    for (uint8_t rateIdx = 0; rateIdx < RDA5807MBus::CLOCK_RATE_COUNT; ++rateIdx)
+    {
+        const BusClockCalibrator::RateResult& result = calibration.rates[rateIdx];
+        std::sprintf(buffer, "%4u kHz  ", BusClockCalibrator::rateToKhz(result.rate));
+        output.append(buffer);
+        if (!result.supported)
+        {
+            output.append("not supported by the bus\n");
+            continue;
+        }
+        anySupported = true;
+
+        std::sprintf(buffer, "%6u %13u %7u %11u %8.1f %7.1f  %s\n", result.passes, result.transactions,
+                     result.busErrors, result.mismatches, result.meanPassNs / 1000.0, result.maxPassNs / 1000.0,
+                     result.stable ? "stable" : "UNSTABLE");
+        output.append(buffer);
+    }
+
+    if (!anySupported)
+    {
+        output.append("The bus can't set its clock; it stays at the platform's rate\n");
+        return output;
+    }
+    if (!calibration.found)
+    {
+        output.append("No rate was stable; left at 100 kHz, nothing saved\n");
+    }
+    else
+    {
+        std::sprintf(buffer, "Running at %u kHz, %s %s\n", BusClockCalibrator::rateToKhz(calibration.chosen),
+                     calibration.saved ? "saved to" : "UNABLE to save to", BusClockCalibrator::DEFAULT_PATH);
+        output.append(buffer);
+    }
+    if (!calibration.restored)
+    {
+        output.append("Unable to write the seek thresholds back\n");
+    }
+    return output;
+}
+
+/**
+ * Times refreshes (default 1000) status refreshes at each I2C clock rate,
+ * next to what the clock alone would allow, then puts the bus back on the
+ * calibrated rate. Simulated chips take no time on the wire.
+ */
+std::string RDA5807MWrapper::benchmarkBusClock(int refreshes)
+{
+    uint32_t refreshCount = (refreshes > 0) ? static_cast<uint32_t>(refreshes) :
+                            BusClockCalibrator::DEFAULT_BENCHMARK_REFRESHES;
+
+    BusClockCalibrator calibrator{radio};
+    BusClockCalibrator::Benchmark benchmark = calibrator.benchmark(refreshCount, BusClockCalibrator::DEFAULT_PATH);
+
+    char buffer[200] = {0};
+    std::string output = "Clock      refreshes  errors  refreshes/s  wire limit/s\n";
+    for (uint8_t rateIdx = 0; rateIdx < RDA5807MBus::CLOCK_RATE_COUNT; ++rateIdx)
+    {
+        const BusClockCalibrator::RefreshThroughput& throughput = benchmark.rates[rateIdx];
+        if (!throughput.supported)
+        {
+            std::sprintf(buffer, "%4u kHz  not supported by the bus %13.0f\n",
+                         BusClockCalibrator::rateToKhz(throughput.rate), throughput.wireLimitPerSecond);
+        }
+        else
+        {
+            std::sprintf(buffer, "%4u kHz  %10u %7u %12.0f %13.0f\n", BusClockCalibrator::rateToKhz(throughput.rate),
+                         throughput.refreshes, throughput.busErrors, throughput.refreshesPerSecond,
+                         throughput.wireLimitPerSecond);
+        }
+        output.append(buffer);
+    }
+
+    std::sprintf(buffer, "Back at %u kHz\n", BusClockCalibrator::rateToKhz(benchmark.restoredRate));
+    output.append(buffer);
+    return output;
+}
+
+/**
+ * Prints how many RDS event subscribers are connected and how the events
+ * published by acquireRds() were delivered to them
+ */
+std::string RDA5807MWrapper::getRdsBrokerStats(int UNUSED)
+{
+    (void) UNUSED;
+
+    if (!rdsEventBroker.isOpen())
+    {
+        return "RDS event socket not open; run RDSACQUIRE first";
+    }
+
+    RdsEventBroker::Stats stats = rdsEventBroker.getStats();
+
+    char buffer[300] = {0};
+    std::sprintf(buffer, "Subscribers: %u (%u accepted, %u disconnected as slow)\n"
+                         "Events published: %llu\nEvents delivered: %llu\nEvents dropped: %llu\n",
+                 stats.subscribers, stats.subscribersAccepted, stats.slowConsumersDisconnected,
+                 static_cast<unsigned long long>(stats.eventsPublished),
+                 static_cast<unsigned long long>(stats.eventsDelivered),
+                 static_cast<unsigned long long>(stats.eventsDropped));
+    return buffer;
+}
+
+/**
+ * Serves metrics for scraping on 127.0.0.1:port (default 9105). A port of
+ * 0 stops the endpoint.
+ */
+std::string RDA5807MWrapper::serveMetrics(int port)
+{
+    if (port == 0)
+    {
+        metricsServer.stop();
+        return "Metrics endpoint stopped";
+    }
+
+    if (port < 0)
+    {
+        port = MetricsServer::DEFAULT_PORT;
+    }
+    else if (port > 0xFFFF)
+    {
+        return "Port out of range";
+    }
+
+    if (metricsServer.getPort() != port && !metricsServer.start(static_cast<uint16_t>(port)))
+    {
+        return "Unable to listen on port " + std::to_string(port);
+    }
+
+    char buffer[100] = {0};
+    std::sprintf(buffer, "Serving http://127.0.0.1:%u/metrics (%llu scrapes so far)\n", metricsServer.getPort(),
+                 static_cast<unsigned long long>(metricsServer.getScrapeCount()));
+    return buffer;
+}
+
+/**
+ * Tunes to the first station found with PI code piCode (hex with 0x, or
+ * decimal)
+ */
+std::string RDA5807MWrapper::findPiCode(int piCode)
+{
+    if (piCode <= 0 || piCode > 0xFFFF)
+    {
+        return "Enter a PI code, e.g. 0x1A04";
+    }
+
+    TargetedSearch::Query query = {};
+    query.matchPiCode = true;
+    query.piCode = static_cast<uint16_t>(piCode);
+    return runTargetedSearch(query);
+}
+
+/**
+ * Tunes to the first station found broadcasting program type programType
+ */
+std::string RDA5807MWrapper::findProgramType(int programType)
+{
+    if (programType < 0 || programType > 31)
+    {
+        return "Enter a program type from 0 to 31";
+    }
+
+    TargetedSearch::Query query = {};
+    query.matchProgramType = true;
+    query.programType = static_cast<uint8_t>(programType);
+    return runTargetedSearch(query);
+}
+
+/**
+ * Runs query, leaving the radio on the hit, or where it was if there is
+ * none, and reports how the channels
+ * tried were rejected along with time-to-hit over all searches so far
+ */
+std::string RDA5807MWrapper::runTargetedSearch(const TargetedSearch::Query& query)
+{
+    TargetedSearch search{radio};
+    std::vector<TargetedSearch::Hit> hits = search.run(query, stationHistory);
+    const TargetedSearch::Stats& stats = search.getStats();
+
+    // Whatever was decoded belongs to some channel the search passed over
+    rdsDecoder.reset();
+    odaRegistry.reset();
+    metrics.recordScanDuration(stats.wallTimeUs);
+
+    std::string output{""};
+    char buffer[160] = {0};
+
+    if (hits.empty())
+    {
+        ++searchMisses;
+        std::sprintf(buffer, "No match after %u channels in %llu ms\n", stats.channelsTried,
+                     static_cast<unsigned long long>(stats.wallTimeUs / 1000));
+        output.append(buffer);
+    }
+    else
+    {
+        const TargetedSearch::Hit& hit = hits.front();
+        searchTimeToHitMs.add(static_cast<double>(hit.timeToHitUs) / 1000.0);
+        searchMaxTimeToHitUs = std::max(searchMaxTimeToHitUs, hit.timeToHitUs);
+
+        std::sprintf(buffer, "Found %3u.%03u  PI: 0x%04x  PTY: %02u  RSSI: %03u in %llu ms (%u channels tried)\n",
+                     hit.frequencyKhz / 1000, hit.frequencyKhz % 1000, hit.piCode, hit.programType, hit.rssi,
+                     static_cast<unsigned long long>(hit.timeToHitUs / 1000), stats.channelsTried);
+        output.append(buffer);
+    }
+
+    for (int outcome = static_cast<int>(TargetedSearch::Outcome::NO_STATION);
+         outcome <= static_cast<int>(TargetedSearch::Outcome::NO_RDS); ++outcome)
+    {
+        std::sprintf(buffer, "  %-12s %u\n", TargetedSearch::outcomeToString(static_cast<TargetedSearch::Outcome>(outcome)),
+                     stats.outcomes[outcome]);
+        output.append(buffer);
+    }
+
+    uint32_t rejected = stats.channelsTried - stats.outcomes[static_cast<int>(TargetedSearch::Outcome::MATCH)];
+    std::sprintf(buffer, "Mean time per rejected channel: %llu ms\n",
+                 static_cast<unsigned long long>(rejected > 0 ? stats.rejectTimeUs / rejected / 1000 : 0));
+    output.append(buffer);
+
+    std::sprintf(buffer, "Searches: %llu hits, %u misses. Time to hit: mean %.0f ms, sd %.0f ms, max %llu ms\n",
+                 static_cast<unsigned long long>(searchTimeToHitMs.getCount()), searchMisses,
+                 searchTimeToHitMs.getMean(), searchTimeToHitMs.getStandardDeviation(),
+                 static_cast<unsigned long long>(searchMaxTimeToHitUs / 1000));
+    output.append(buffer);
+
+    return output;
+}
+
+/**
+ * Dumps the bus trace of every thread to BUS_TRACE_PATH. A format of 1
+ * also converts it to text, 2 to a Chrome trace; otherwise convert it
+ * offline with bustrace-convert.
+ */
+std::string RDA5807MWrapper::dumpBusTrace(int format)
+{
+    uint32_t recordsWritten = 0;
+    if (!BusTrace::dump(BUS_TRACE_PATH, recordsWritten))
+    {
+        return std::string("Unable to write ") + BUS_TRACE_PATH;
+    }
+
+    std::string output = "Wrote " + std::to_string(recordsWritten) + " records to " + BUS_TRACE_PATH + "\n";
+    if (format != 1 && format != 2)
+    {
+        return output;
+    }
+
+    BusTraceReader reader;
+    std::string convertedPath = std::string(BUS_TRACE_PATH) + (format == 1 ? ".txt" : ".json");
+
+    // Next to the dump, so just as careful not to follow a link
+    int convertedFd = reader.load(BUS_TRACE_PATH)
+                          ? open(convertedPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644)
+                          : -1;
+    FILE* converted = (convertedFd >= 0) ? fdopen(convertedFd, "w") : nullptr;
+    if (converted == nullptr)
+    {
+        if (convertedFd >= 0)
+        {
+            close(convertedFd);
+        }
+        return output + "Unable to write " + convertedPath + "\n";
+    }
+
+    if (format == 1)
+    {
+        reader.writeText(converted);
+    }
+    else
+    {
+        reader.writeChromeTrace(converted);
+    }
+    std::fclose(converted);
+
+    return output + "Converted to " + convertedPath + "\n";
+}
+
+/**
+ * Prints, for every command that has run, how long it takes and where the
+ * time goes: the mean per phase. A detail of 1 adds each phase's
+ * histogram, 0 clears them all after printing.
+ */
+std::string RDA5807MWrapper::getCommandLatencies(int detail)
+{
+    std::vector<BusTrace::CommandStats> commands = BusTrace::getCommandStats();
+    if (commands.empty())
+    {
+        return "No commands traced";
+    }
+
+    std::string output;
+    char buffer[200] = {0};
+    std::sprintf(buffer, "%-16s %6s %9s %9s %9s %9s | %9s %9s %9s %9s %9s\n", "Command", "Runs", "Mean_us", "P50_us",
+                 "P99_us", "Max_us", "Parse", "Bus", "Sleep", "Format", "Other");
+    output.append(buffer);
+
+    for (const BusTrace::CommandStats& command : commands)
+    {
+        const BusTrace::PhaseStats& total = command.phases[static_cast<int>(BusTrace::Phase::TOTAL)];
+        std::sprintf(buffer, "%-16s %6llu %9.1f %9llu %9llu %9.1f |", command.name,
+                     static_cast<unsigned long long>(total.count),
+                     total.count > 0 ? static_cast<double>(total.totalNs) / total.count / 1e3 : 0.0,
+                     static_cast<unsigned long long>(BusTrace::getPercentileUs(total, 50)),
+                     static_cast<unsigned long long>(BusTrace::getPercentileUs(total, 99)),
+                     static_cast<double>(total.maxNs) / 1e3);
+        output.append(buffer);
+
+        for (uint8_t phase = static_cast<uint8_t>(BusTrace::Phase::PARSE); phase < BusTrace::PHASE_COUNT; ++phase)
+        {
+            const BusTrace::PhaseStats& phaseStats = command.phases[phase];
+            // A phase the command never entered has no mean
+            std::sprintf(buffer, " %9.1f",
+                         phaseStats.count > 0 ? static_cast<double>(phaseStats.totalNs) / phaseStats.count / 1e3 : 0.0);
+            output.append(buffer);
+        }
+        output.append("\n");
+
+        if (detail != 1)
+        {
+            continue;
+        }
+
+        // Non-empty buckets, by their upper bound
+        for (uint8_t phase = 0; phase < BusTrace::PHASE_COUNT; ++phase)
+        {
+            const BusTrace::PhaseStats& phaseStats = command.phases[phase];
+            std::sprintf(buffer, "  %-7s", BusTrace::phaseToCString(static_cast<BusTrace::Phase>(phase)));
+            output.append(buffer);
+            for (uint8_t bucket = 0; bucket < BusTrace::HISTOGRAM_BUCKETS; ++bucket)
+            {
+                if (phaseStats.buckets[bucket] == 0)
+                {
+                    continue;
+                }
+                if (bucket + 1 < BusTrace::HISTOGRAM_BUCKETS)
+                {
+                    std::sprintf(buffer, " <%lluus:%llu", 1ULL << bucket,
+                                 static_cast<unsigned long long>(phaseStats.buckets[bucket]));
+                }
+                else
+                {
+                    std::sprintf(buffer, " >=%lluus:%llu", 1ULL << (bucket - 1),
+                                 static_cast<unsigned long long>(phaseStats.buckets[bucket]));
+                }
+                output.append(buffer);
+            }
+            output.append("\n");
+        }
+    }
+
+    if (detail == 0)
+    {
+        BusTrace::resetCommandStats();
+        output.append("Cleared\n");
+    }
+    return output;
+}
+
+/**
+ * Adds freq, in units of 100 kHz as for FREQ, to the watchlist
+ */
+std::string RDA5807MWrapper::addWatchlistStation(int freq)
+{
+    if (freq <= 0 || !watchlist.addStation(static_cast<uint32_t>(freq) * 100))
+    {
+        return "Unable to add station: off the band, already watched, or the watchlist is full (" +
+               std::to_string(WatchlistMonitor::MAX_STATIONS) + " stations)";
+    }
+    return "Watching " + std::to_string(watchlist.getStations().size()) + " stations";
+}
+
+std::string RDA5807MWrapper::clearWatchlist(int UNUSED)
+{
+    (void) UNUSED;
+
+    watchlist.clear();
+    return "Watchlist cleared";
+}
+
+/**
+ * Rotates the tuner through the watchlist for ms milliseconds, then
+ * returns to the station tuned before. Reports what is known about each
+ * station and how often it has been refreshed, over this and earlier
+ * runs.
+ */
+std::string RDA5807MWrapper::monitorWatchlist(int ms)
+{
+    if (watchlist.getStations().empty())
+    {
+        return "Watchlist is empty; add stations with WATCHADD";
+    }
+
+    // The channel last asked for, which READCHAN only shows once the tune completes
+    uint32_t previousKhz = radio.getChannelPlanner().channelToKhz(
+            Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::REG_0x03), CHAN));
+
+    uint32_t visits = watchlist.run(ms > 0 ? static_cast<uint32_t>(ms) : 10000);
+
+    // Whatever was decoded belongs to some station on the watchlist
+    rdsDecoder.reset();
+    odaRegistry.reset();
+    setFrequencyKhz(static_cast<int>(previousKhz));
+
+    std::string output;
+    char buffer[200] = {0};
+    std::sprintf(buffer, "%-7s %-6s %-8s %3s %2s %2s %4s %6s %5s %8s %8s %10s %10s\n", "Freq", "PI", "PS", "PTY",
+                 "TP", "TA", "RSSI", "Visits", "Refr", "Dwell_ms", "Visit_ms", "Refresh_ms", "Max_ms");
+    output.append(buffer);
+
+    for (const WatchlistMonitor::Station& station : watchlist.getStations())
+    {
+        const RdsDecoder::RdsData& rds = station.decoder.getData();
+        std::sprintf(buffer, "%3u.%03u 0x%04x %-8s %3u %2u %2u %4u %6u %5u %8u %8.0f %10.0f %10llu\n",
+                     station.frequencyKhz / 1000, station.frequencyKhz % 1000, station.piCode,
+                     station.rdsAbsent || !station.fmTrue ? "-" : rds.programService, rds.programType,
+                     rds.trafficProgram ? 1 : 0, rds.trafficAnnouncement ? 1 : 0, station.rssi, station.visits,
+                     station.refreshes, station.dwellBudgetMs, station.visitMs.getMean(),
+                     station.refreshIntervalMs.getMean(),
+                     static_cast<unsigned long long>(station.maxRefreshIntervalUs / 1000));
+        output.append(buffer);
+
+        if (rds.rtSegmentMask != 0)
+        {
+            output += std::string("        RT") + (station.decoder.isRadioTextComplete() ? ": " : " (partial): ") +
+                      rds.radioText + "\n";
+        }
+
+        TargetedSearch::ChannelHistory& history = stationHistory[station.frequencyKhz];
+        history.rssi = station.rssi;
+        history.fmTrue = station.fmTrue;
+        if (station.piCodeKnown)
+        {
+            history.piCodeKnown = true;
+            history.piCode = station.piCode;
+            history.programTypeKnown = true;
+            history.programType = rds.programType;
+        }
+    }
+
+    const WatchlistMonitor::Stats& stats = watchlist.getStats();
+    std::sprintf(buffer, "%u visits this run. Overall: %u visits, %u refreshed (%u early), mean tune %.1f ms\n",
+                 visits, stats.visits, stats.refreshes, stats.earlyExits,
+                 stats.visits > 0 ? static_cast<double>(stats.tuneTimeUs) / stats.visits / 1000.0 : 0.0);
+    output.append(buffer);
+    std::sprintf(buffer, "Expected refresh interval for %u stations: %llu ms\n",
+                 static_cast<unsigned>(watchlist.getStations().size()),
+                 static_cast<unsigned long long>(watchlist.getExpectedCycleUs() / 1000));
+    output.append(buffer);
+
+    return output;
+}
+
+/**
+ * Lists the Open Data Applications the current station has announced in
+ * 3A groups, which of them are decoded, and the RT+ state
+ */
+std::string RDA5807MWrapper::getOpenDataApplications(int UNUSED)
+{
+    (void) UNUSED;
+
+    std::string output = "AID    Group  Handled  Announcements  Groups\n";
+    char buffer[200] = {0};
+
+    const OdaRegistry::Application* applications = odaRegistry.getApplications();
+    for (uint8_t appIdx = 0; appIdx < odaRegistry.getApplicationCount(); ++appIdx)
+    {
+        const OdaRegistry::Application& application = applications[appIdx];
+        std::sprintf(buffer, "0x%04X %-6s %-8s %13u  %6u\n", application.aid,
+                     OdaRegistry::groupIndexToString(application.groupIndex), application.handled ? "yes" : "no",
+                     application.announcements,
+                     application.handled ? odaRegistry.getGroupsDispatched(application.groupIndex) : 0);
+        output.append(buffer);
+    }
+
+    const RtPlusHandler::Tags& tags = rtPlusHandler.getTags();
+    std::sprintf(buffer, "RT+ groups: %u (template %u, %u item changes, item %s)\n", tags.tagGroups,
+                 tags.templateNumber, tags.itemChanges, tags.itemRunning ? "running" : "stopped");
+    output.append(buffer);
+    output += std::string("Title: ") + tags.title + "\nArtist: " + tags.artist + "\n";
+
+    return output;
+}
+
+/**
+ * Opens the TMC tables the first time they're found. The decoder keys
+ * messages by update class once it has them, so anything decoded before
+ * is dropped rather than left to be duplicated.
+ */
+void RDA5807MWrapper::loadTmcTables()
+{
+    if (!tmcTables.isOpen() && tmcTables.open(TMC_TABLE_PATH))
+    {
+        tmcDecoder.reset();
+        tmcDecoder.setTables(&tmcTables);
+    }
+}
+
+/**
+ * Lists the traffic messages received by acquireRds() that are still
+ * current, named from the TMC tables if they're installed
+ */
+std::string RDA5807MWrapper::getTmcMessages(int UNUSED)
+{
+    (void) UNUSED;
+
+    loadTmcTables();
+
+    uint64_t nowUs = Util::getRealtimeUs();
+    std::vector<TmcDecoder::Message> messages;
+    tmcDecoder.getActiveMessages(messages, nowUs);
+
+    const TmcDecoder::Stats& stats = tmcDecoder.getStats();
+    char buffer[400] = {0};
+    std::sprintf(buffer, "Active messages: %zu (LTN %u)\n"
+                         "8A groups: %u (%u rejected, %u repeats, %u tuning)\n"
+                         "Messages: %u single-group, %u multi-group, %u assembly errors\n"
+                         "Table: %u added, %u refreshed, %u replaced, %u expired, %u dropped\n",
+                 messages.size(), tmcTables.getLocationTableNumber(), stats.groups, stats.groupsRejected,
+                 stats.repeatsSuppressed, stats.tuningGroups, stats.singleGroupMessages, stats.multiGroupMessages,
+                 stats.assemblyErrors, stats.messagesAdded, stats.messagesRefreshed, stats.messagesReplaced,
+                 stats.messagesExpired, stats.messagesDropped);
+    std::string output = buffer;
+
+    for (const TmcDecoder::Message& message : messages)
+    {
+        const TmcTableFormat::EventEntry* event = tmcTables.findEvent(message.eventCode);
+        const TmcTableFormat::LocationEntry* location = tmcTables.findLocation(message.locationCode);
+
+        std::sprintf(buffer, "%5u %c%u  %4u %-40s %s  (%u min left, %u receptions)\n", message.locationCode,
+                     message.directionNegative ? '-' : '+', message.extent, message.eventCode,
+                     (event != nullptr) ? tmcTables.getString(event->textOffset) : "",
+                     (location != nullptr) ? tmcTables.getString(location->nameOffset) : "",
+                     static_cast<uint32_t>((message.expiresUs - nowUs) / 60000000ULL), message.receptions);
+        output.append(buffer);
+    }
+
+    return output;
+}
+
+/**
+ * Sets whether announcements only get signalled (0) or also switch the
+ * audio (1), then reports what acquireRds() has seen of them: the tuned
+ * station's TP/TA, the other networks it links to, and how long acting
+ * on each edge took
+ */
+std::string RDA5807MWrapper::configureTrafficAnnouncements(int mode)
+{
+    if (mode == 0 || mode == 1)
+    {
+        trafficAnnouncementService.setMode(mode == 1 ? TrafficAnnouncementService::Mode::SWITCH_AUDIO
+                                                     : TrafficAnnouncementService::Mode::SIGNAL_ONLY);
+    }
+    else if (mode != -1)
+    {
+        return "Mode must be 0 (signal only) or 1 (switch audio)";
+    }
+
+    const TrafficAnnouncementDetector::Network& tuned = trafficAnnouncements.getTunedNetwork();
+    const TrafficAnnouncementDetector::Stats& detectorStats = trafficAnnouncements.getStats();
+    const TrafficAnnouncementService::Stats& serviceStats = trafficAnnouncementService.getStats();
+
+    char buffer[400] = {0};
+    std::sprintf(buffer, "Mode: %s (volume %u)\n"
+                         "Tuned 0x%04x: TP %u TA %u, %s\n"
+                         "Groups: %llu (%llu too damaged), %llu EON, %llu glitches suppressed\n"
+                         "Edges: %u tuned, %u other networks\n",
+                 trafficAnnouncementService.getMode() == TrafficAnnouncementService::Mode::SWITCH_AUDIO
+                         ? "switch audio" : "signal only",
+                 trafficAnnouncementService.getAnnouncementVolume(), tuned.piCode, tuned.trafficProgram.value,
+                 tuned.trafficAnnouncement.value, tuned.active ? "announcing" : "not announcing",
+                 static_cast<unsigned long long>(detectorStats.groups),
+                 static_cast<unsigned long long>(detectorStats.groupsIgnored),
+                 static_cast<unsigned long long>(detectorStats.eonGroups),
+                 static_cast<unsigned long long>(detectorStats.glitchesSuppressed), detectorStats.edges,
+                 detectorStats.otherNetworkEdges);
+    std::string output = buffer;
+
+    if (serviceStats.actionLatencyUs.getCount() > 0)
+    {
+        std::sprintf(buffer, "Action latency: mean %.0f us, max %llu us, %u over one group (%u us)\n"
+                             "Debounce: mean %.0f us\n",
+                     serviceStats.actionLatencyUs.getMean(),
+                     static_cast<unsigned long long>(serviceStats.maxActionLatencyUs), serviceStats.lateActions,
+                     TrafficAnnouncementService::GROUP_PERIOD_US, serviceStats.debounceUs.getMean());
+        output.append(buffer);
+    }
+
+    for (uint8_t idx = 0; idx < trafficAnnouncements.getOtherNetworkCount(); ++idx)
+    {
+        const TrafficAnnouncementDetector::Network& network = trafficAnnouncements.getOtherNetwork(idx);
+        std::sprintf(buffer, "EON 0x%04x %s PTY %02u TP %u TA %u %s(%u groups)\n", network.piCode,
+                     network.programService, network.programType, network.trafficProgram.value,
+                     network.trafficAnnouncement.value, network.active ? "announcing " : "", network.groups);
+        output.append(buffer);
+    }
+
+    return output;
+}
+
+std::string RDA5807MWrapper::setTrafficAnnouncementVolume(int volume)
+{
+    if (volume < 0 || volume > RDA5807M::MAX_VOLUME)
+    {
+        return "Volume must be 0 to 15";
+    }
+
+    trafficAnnouncementService.setAnnouncementVolume(static_cast<uint8_t>(volume));
+    return "Announcement volume: " + std::to_string(volume);
+}
+
+/**
+ * Starts (1) or stops (0) recording every group acquireRds() reads to
+ * GROUP_LOG_PATH. Recordings are appended to, for replaying with
+ * RDA5807M-bench tmc.
+ */
+std::string RDA5807MWrapper::recordRdsGroups(int recordEnable)
+{
+    if (recordEnable == 0)
+    {
+        uint64_t entryCount = groupLogWriter.getEntryCount();
+        groupLogWriter.close();
+        return "Group log holds " + std::to_string(entryCount) + " groups";
+    }
+
+    if (!groupLogWriter.isOpen() && !groupLogWriter.open(GROUP_LOG_PATH))
+    {
+        return std::string("Unable to open ") + GROUP_LOG_PATH;
+    }
+
+    return std::string("Recording groups to ") + GROUP_LOG_PATH + " (" +
+           std::to_string(groupLogWriter.getEntryCount()) + " so far)";
+}
+
+/**
+ * Samples RSSI at the configured rate for ms milliseconds, adding to the
+ * statistics gathered so far
+ */
+std::string RDA5807MWrapper::sampleRssi(int ms)
+{
+    if (ms <= 0)
+    {
+        return "Enter a duration in ms";
+    }
+
+    rssiSampler.run(static_cast<uint32_t>(ms));
+
+    return formatRssiStats();
+}
+
+/**
+ * Sets the RSSI sample rate. Summaries stay at ten per second, and the
+ * statistics gathered so far are discarded.
+ */
+std::string RDA5807MWrapper::setRssiSampleRate(int sampleRateHz)
+{
+    uint32_t decimation = static_cast<uint32_t>(sampleRateHz) / 10;
+    if (sampleRateHz <= 0 || !rssiSampler.configure(static_cast<uint32_t>(sampleRateHz), decimation == 0 ? 1 : decimation))
+    {
+        char buffer[60] = {0};
+        std::sprintf(buffer, "Rate must be 1 to %u Hz", RssiSampler::MAX_SAMPLE_RATE_HZ);
+        return buffer;
+    }
+
+    rssiSampler.reset();
+    return "OK";
+}
+
+std::string RDA5807MWrapper::getRssiStats(int UNUSED)
+{
+    (void) UNUSED;
+    return formatRssiStats();
+}
+
+std::string RDA5807MWrapper::formatRssiStats()
+{
+    RssiSampler::Stats stats = rssiSampler.getStats();
+    if (stats.samples == 0)
+    {
+        return "No RSSI samples yet";
+    }
+
+    std::string output{""};
+    char buffer[160] = {0};
+
+    double achievedHz = stats.runTimeUs == 0 ? 0.0 : stats.samples * 1000000.0 / stats.runTimeUs;
+    std::sprintf(buffer, "Samples: %llu at %u Hz (achieved %.0f Hz, %llu overruns)\n",
+                 static_cast<unsigned long long>(stats.samples), rssiSampler.getSampleRateHz(), achievedHz,
+                 static_cast<unsigned long long>(stats.overruns));
+    output.append(buffer);
+
+    std::sprintf(buffer, "Mean: %.2f  StdDev: %.2f  EWMA: %.2f\n", stats.mean, stats.standardDeviation, stats.ewma);
+    output.append(buffer);
+
+    std::sprintf(buffer, "P10: %.1f  Median: %.1f  P90: %.1f\n", stats.p10, stats.median, stats.p90);
+    output.append(buffer);
+
+    std::sprintf(buffer, "Window (last %u) min: %u  max: %u\n", RssiSampler::WINDOW_LENGTH, stats.windowMin,
+                 stats.windowMax);
+    output.append(buffer);
+
+    std::sprintf(buffer, "Recent summaries (%llu total), newest first:\n",
+                 static_cast<unsigned long long>(stats.summaries));
+    output.append(buffer);
+
+    for (uint8_t age = 0; age < rssiSampler.getSummaryCount(); ++age)
+    {
+        const RssiSampler::Summary& summary = rssiSampler.getSummary(age);
+        std::sprintf(buffer, "  mean %5.1f  min %3u  max %3u  FM_TRUE %3.0f%%  FM_READY %3.0f%%\n", summary.meanRssi,
+                     summary.minRssi, summary.maxRssi, summary.fmTrueRatio * 100.0f, summary.fmReadyRatio * 100.0f);
+        output.append(buffer);
+    }
+
+    return output;
+}
+
+/**
+ * Sweeps the whole band sweeps times, appending RSSI, FM_TRUE and RDS sync
+ * of every channel to the waterfall file. Afterwards the radio goes back
+ * to the channel it was on, with its mute and RDS settings as they were.
+ */
+std::string RDA5807MWrapper::recordWaterfall(int sweeps)
+{
+    BusArbiter::ClassScope busClass{BusArbiter::TrafficClass::BACKGROUND_SCAN};
+
+    if (sweeps <= 0)
+    {
+        sweeps = 1;
+    }
+
+    const ChannelPlanner& planner = radio.getChannelPlanner();
+    WaterfallWriter::OpenResult opened = waterfallWriter.open(WATERFALL_PATH, planner.getBottomKhz(),
+                                                              planner.getSpacingKhz(), planner.getChannelCount());
+    if (opened == WaterfallWriter::OpenResult::PLAN_MISMATCH)
+    {
+        return std::string("Waterfall file ") + WATERFALL_PATH +
+               " was recorded for a different band or spacing; move it aside first";
+    }
+    if (opened != WaterfallWriter::OpenResult::OPENED)
+    {
+        return "Unable to open waterfall file";
+    }
+
+    uint64_t sizeBefore = waterfallWriter.getFileSize();
+    std::vector<WaterfallFormat::Cell> sweep(planner.getChannelCount());
+    const uint32_t* channelTable = planner.getChannelTable();
+
+    uint16_t reg02 = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x02);
+    bool wasMuted = (reg02 & DMUTE) == 0;
+    bool rdsWasEnabled = (reg02 & RDS_EN) != 0;
+    uint32_t previousKhz = radio.getReadFrequencyKhz();
+    radio.setMute(true);
+
+    for (int sweepIdx = 0; sweepIdx < sweeps; ++sweepIdx)
+    {
+        uint64_t timestampUs = Util::getRealtimeUs();
+        uint64_t sweepStartUs = Util::getMonotonicTimeUs();
+        for (uint16_t chan = 0; chan < planner.getChannelCount(); ++chan)
+        {
+            radio.setFrequencyKhz(channelTable[chan], false);
+            radio.setTune(true);
+            {
+                BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+                usleep(WATERFALL_SETTLE_MS * MICROS_IN_MILLIS);
+            }
+
+            radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0A);
+            radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0B);
+            uint16_t regA = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A);
+            uint16_t regB = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B);
+
+            sweep[chan].rssi = static_cast<uint8_t>(Util::valueFromReg(regB, RSSI));
+            sweep[chan].fmTrue = (regB & FM_TRUE) != 0;
+            sweep[chan].rdsSynchronized = (regA & RDSS) != 0;
+        }
+        waterfallWriter.appendSweep(timestampUs, sweep.data());
+        metrics.recordScanDuration(Util::getMonotonicTimeUs() - sweepStartUs);
+    }
+
+    for (uint16_t chan = 0; chan < planner.getChannelCount(); ++chan)
+    {
+        TargetedSearch::ChannelHistory& history = stationHistory[channelTable[chan]];
+        history.rssi = sweep[chan].rssi;
+        history.fmTrue = sweep[chan].fmTrue;
+    }
+    waterfallWriter.close();
+
+    if (previousKhz != 0)
+    {
+        radio.setFrequencyKhz(previousKhz, false);
+        radio.setTune(true);
+    }
+    radio.setRdsMode(rdsWasEnabled);
+    radio.setMute(wasMuted);
+
+    // What was decoded before the sweep may be stale by now
+    rdsDecoder.reset();
+    odaRegistry.reset();
+
+    char buffer[120] = {0};
+    std::sprintf(buffer, "Recorded %d sweeps of %u channels to %s (%llu bytes, file now %llu bytes)\n", sweeps,
+                 planner.getChannelCount(), WATERFALL_PATH,
+                 static_cast<unsigned long long>(waterfallWriter.getFileSize() - sizeBefore),
+                 static_cast<unsigned long long>(waterfallWriter.getFileSize()));
+    return buffer;
+}
+
+/**
+ * Renders the last minutes (default 60) of the waterfall file, one sweep
+ * per line and one character per channel, darker for stronger RSSI
+ */
+std::string RDA5807MWrapper::showWaterfall(int minutes)
+{
+    static const char RSSI_SHADES[] = " .:-=+*#%@";
+    static const uint8_t SHADE_COUNT = sizeof(RSSI_SHADES) - 1;
+
+    if (minutes <= 0)
+    {
+        minutes = 60;
+    }
+
+    WaterfallReader reader;
+    if (!reader.open(WATERFALL_PATH) || reader.getBlockCount() == 0)
+    {
+        return "No waterfall recorded yet";
+    }
+
+    WaterfallReader::Query query;
+    query.firstChannel = 0;
+    query.lastChannel = static_cast<uint16_t>(reader.getHeader().channelCount - 1);
+    query.endUs = reader.getLastTimestampUs();
+    query.startUs = query.endUs - std::min<uint64_t>(query.endUs, static_cast<uint64_t>(minutes) * 60000000ULL);
+
+    std::vector<uint64_t> timestamps;
+    std::vector<WaterfallFormat::Cell> cells;
+    uint64_t start = Util::getMonotonicTimeUs();
+    size_t sweeps = reader.query(query, timestamps, cells);
+    uint64_t decodeUs = Util::getMonotonicTimeUs() - start;
+
+    std::string output{""};
+    size_t width = query.lastChannel + 1;
+    for (size_t sweepIdx = 0; sweepIdx < sweeps; ++sweepIdx)
+    {
+        char prefix[32] = {0};
+        std::sprintf(prefix, "-%5llus |", static_cast<unsigned long long>((query.endUs - timestamps[sweepIdx]) / 1000000));
+        output.append(prefix);
+        for (size_t chan = 0; chan < width; ++chan)
+        {
+            const WaterfallFormat::Cell& cell = cells[sweepIdx * width + chan];
+            output.push_back(RSSI_SHADES[cell.rssi * SHADE_COUNT / (RDA5807M::RSSI_MAX + 1)]);
+        }
+        output.append("|\n");
+    }
+
+    char buffer[160] = {0};
+    std::sprintf(buffer, "%u.%03u MHz to %u.%03u MHz, %zu sweeps. Decoded %zu cells in %llu us\n",
+                 reader.getHeader().bottomKhz / 1000, reader.getHeader().bottomKhz % 1000,
+                 (reader.getHeader().bottomKhz + query.lastChannel * reader.getHeader().spacingKhz) / 1000,
+                 (reader.getHeader().bottomKhz + query.lastChannel * reader.getHeader().spacingKhz) % 1000,
+                 sweeps, cells.size(), static_cast<unsigned long long>(decodeUs));
+    output.append(buffer);
+
+    return output;
+}
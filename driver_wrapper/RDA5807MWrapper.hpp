@@ -10,10 +10,33 @@
 
 // System Includes
 #include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 
 // Project Includes
+#include "BusArbiter.hpp"
+#include "MetricsRegistry.hpp"
+#include "MetricsServer.hpp"
+#include "OdaRegistry.hpp"
+#include "ParallelSurvey.hpp"
+#include "PollingController.hpp"
 #include "RDA5807M.hpp"
+#include "RDA5807MWatchdog.hpp"
+#include "RdsDecoder.hpp"
+#include "RdsEventBroker.hpp"
+#include "RdsGroupLog.hpp"
+#include "RssiSampler.hpp"
+#include "RtPlusHandler.hpp"
+#include "StationStatePublisher.hpp"
+#include "StreamingStats.hpp"
+#include "TargetedSearch.hpp"
+#include "TmcDecoder.hpp"
+#include "TmcTables.hpp"
+#include "TrafficAnnouncementDetector.hpp"
+#include "TrafficAnnouncementService.hpp"
+#include "WatchlistMonitor.hpp"
+#include "WaterfallWriter.hpp"
 
 class RDA5807MWrapper
 {
@@ -21,10 +44,30 @@ public:
     ////////////////////////////////
     // Public interface functions //
     ////////////////////////////////
-    RDA5807MWrapper(RDA5807M& radioParam) : radio(radioParam) { };
+    RDA5807MWrapper(RDA5807M& radioParam) : radio(radioParam), watchdog(radioParam), pollingController(radioParam),
+            rssiSampler(radioParam), metricsServer(metrics, radioParam), watchlist(radioParam),
+            trafficAnnouncementService(radioParam, rdsEventBroker, metrics)
+    {
+        odaRegistry.registerHandler(RtPlusHandler::AID, rtPlusHandler);
+        trafficAnnouncements.setListener(&trafficAnnouncementService);
+    };
+
+    // Gives the register watchdog a chance to run. Cheap when no check is due.
+    void serviceWatchdog();
+
+    // Adds a tuner (on another bus) to be used alongside radio by SURVEY
+    void addSurveyTuner(RDA5807M& tuner);
+
+    // The arbiter radio's bus goes through, if it shares one, for ARBITER
+    void setBusArbiter(BusArbiter& arbiter);
+
+    // Times a command for the metrics endpoint. command must be a name
+    // from a static command table.
+    void recordCommandLatency(const char* command, uint64_t durationUs);
 
     // RDA5807M::StatusResult-returning functions
     RDA5807M::StatusResult setFrequency(int freq);
+    RDA5807M::StatusResult setFrequencyKhz(int freqKhz);
     RDA5807M::StatusResult setVolume(int vol);
     RDA5807M::StatusResult setMute(int muteEnable);
     RDA5807M::StatusResult setBassBoost(int bassBoostEnable);
@@ -53,6 +96,33 @@ public:
     std::string getRdsInfoString(int UNUSED);
     std::string getLocalCopyOfReg(int reg);
     std::string snoopRdsGroupTwo(int ms);
+    std::string acquireRds(int ms);
+    std::string configureWatchdog(int intervalMs);
+    std::string surveyBand(int detectRds);
+    std::string surveySimulatedBand(int tunerCount);
+    std::string getPollingStats(int UNUSED);
+    std::string getBusArbiterStats(int clearStats);
+    std::string calibrateBusClock(int UNUSED);
+    std::string benchmarkBusClock(int refreshes);
+    std::string sampleRssi(int ms);
+    std::string setRssiSampleRate(int sampleRateHz);
+    std::string getRssiStats(int UNUSED);
+    std::string recordWaterfall(int sweeps);
+    std::string showWaterfall(int minutes);
+    std::string getRdsBrokerStats(int UNUSED);
+    std::string serveMetrics(int port);
+    std::string findPiCode(int piCode);
+    std::string findProgramType(int programType);
+    std::string dumpBusTrace(int format);
+    std::string getCommandLatencies(int detail);
+    std::string addWatchlistStation(int freq);
+    std::string clearWatchlist(int UNUSED);
+    std::string monitorWatchlist(int ms);
+    std::string getOpenDataApplications(int UNUSED);
+    std::string getTmcMessages(int UNUSED);
+    std::string configureTrafficAnnouncements(int mode);
+    std::string setTrafficAnnouncementVolume(int volume);
+    std::string recordRdsGroups(int recordEnable);
 
     // uint32_t-returning functions
     uint32_t getRssi(int UNUSED);
@@ -75,10 +145,110 @@ private:
     /////////////////////////////
     static const int MICROS_IN_MILLIS = 1000;
 
+    // Longest generateFreqMap() waits on each channel for the tune to
+    // settle, and for RDS when asked to show it
+    static const uint32_t FREQ_MAP_DWELL_MS = 120;
+    static const uint32_t FREQ_MAP_RDS_DWELL_MS = 1000;
+
+    // FREQMAP visits the odd tenths of a MHz (88.1, 88.3...), where North
+    // American stations sit
+    static const uint32_t FREQ_MAP_STEP_KHZ = 200;
+    static const uint32_t FREQ_MAP_OFFSET_KHZ = 100;
+
+    // Where recordWaterfall() keeps the sweep history
+    static const char* const WATERFALL_PATH;
+
+    // Where dumpBusTrace() writes the bus trace. Conversions are written
+    // next to it with .txt or .json appended.
+    static const char* const BUS_TRACE_PATH;
+
+    // Compiled TMC event and location tables, made by tmc-table-compile.
+    // Messages are decoded without them, just not named.
+    static const char* const TMC_TABLE_PATH;
+
+    // Where acquireRds() records raw groups while RDSRECORD is on
+    static const char* const GROUP_LOG_PATH;
+
+    // Time given to each channel of a waterfall sweep before sampling it
+    static const int WATERFALL_SETTLE_MS = 40;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    std::string formatRssiStats();
+    void updateTunerMetrics();
+    std::string runTargetedSearch(const TargetedSearch::Query& query);
+    void loadTmcTables();
+    void waitForTuneToSettle(uint32_t timeoutMs);
+    static uint64_t sleepUntil(uint64_t wakeUs);
+    static std::string formatSurvey(const std::map<uint32_t, ParallelSurvey::ChannelResult>& results,
+                                    const ParallelSurvey::Stats& stats);
+
     ///////////////////////////
     // Private Class Members //
     ///////////////////////////
     RDA5807M& radio;
+
+    // Decoded RDS state of the currently tuned station
+    RdsDecoder rdsDecoder;
+
+    // Publishes tuner state to shared memory for other processes
+    StationStatePublisher stationStatePublisher;
+
+    // Streams RDS groups and PS/RT/TA changes to socket subscribers
+    RdsEventBroker rdsEventBroker;
+
+    // Open Data Applications announced by the current station, and the
+    // handlers for the ones understood
+    OdaRegistry odaRegistry;
+    RtPlusHandler rtPlusHandler;
+
+    // Traffic messages from 8A groups received by acquireRds()
+    TmcDecoder tmcDecoder;
+    TmcTables tmcTables;
+
+    // Raw groups recorded by acquireRds() for replaying offline
+    RdsGroupLogWriter groupLogWriter;
+
+    // Detects and repairs divergence between the chip and the local register map
+    RDA5807MWatchdog watchdog;
+
+    // Paces status and RDS reads by what the tuner is doing
+    PollingController pollingController;
+
+    // Streaming signal quality statistics, fed by sampleRssi()
+    RssiSampler rssiSampler;
+
+    // Sweep history written by recordWaterfall()
+    WaterfallWriter waterfallWriter;
+
+    // Tuner, bus and decoder health, scraped through metricsServer
+    MetricsRegistry metrics;
+    MetricsServer metricsServer;
+
+    // What surveys, sweeps and searches have seen on each channel, used
+    // to order targeted searches
+    TargetedSearch::History stationHistory;
+
+    // Time to hit of every targeted search that found something
+    RunningVariance searchTimeToHitMs;
+    uint64_t searchMaxTimeToHitUs = 0;
+    uint32_t searchMisses = 0;
+
+    // Stations monitorWatchlist() keeps fresh, and what it has learned
+    // about them
+    WatchlistMonitor watchlist;
+
+    // Traffic announcements followed by acquireRds(), on the tuned station
+    // and through EON, and what is done about them
+    TrafficAnnouncementDetector trafficAnnouncements;
+    TrafficAnnouncementService trafficAnnouncementService;
+
+    // Additional tuners used by surveyBand()
+    std::vector<RDA5807M*> extraSurveyTuners;
+
+    // Shares radio's bus with other devices; not owned
+    BusArbiter* busArbiter = nullptr;
 };
 
 #endif /* DRIVER_WRAPPER_RDA5807MWRAPPER_HPP_ */
@@ -0,0 +1,96 @@
+/**************************************************
+ * FreestandingMain.cpp - Entry point for the low-footprint profile
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// Project includes
+#include "MiniCommandInterpreter.hpp"
+#include "MraaBus.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "Util.hpp"
+
+// Built with -fno-exceptions -fno-rtti and linked without libstdc++, so the
+// one runtime hook the vtables need is provided here.
+extern "C" void __cxa_pure_virtual()
+{
+    std::abort();
+}
+
+static const size_t LINE_BUFFER_SIZE = 64;
+static const size_t OUTPUT_BUFFER_SIZE = 512;
+
+// All working storage is static; nothing in this profile touches the heap
+static char lineBuffer[LINE_BUFFER_SIZE];
+static char outputBuffer[OUTPUT_BUFFER_SIZE];
+
+/**
+ * Reads one line from stdin into lineBuffer, dropping anything past its
+ * length. Returns false on EOF or error.
+ */
+static bool readLine()
+{
+    size_t length = 0;
+    char current;
+
+    while (true)
+    {
+        ssize_t result = read(STDIN_FILENO, &current, 1);
+        if (result <= 0)
+        {
+            return false;
+        }
+
+        if (current == '\n')
+        {
+            break;
+        }
+
+        if (length + 1 < LINE_BUFFER_SIZE)
+        {
+            lineBuffer[length++] = current;
+        }
+    }
+
+    lineBuffer[length] = '\0';
+    return true;
+}
+
+/**
+ * Startup time, from entering main() to being ready for the first command,
+ * is printed once at boot so it can be tracked alongside the size metrics
+ * produced by make/freestanding.mk.
+ */
+int main()
+{
+    uint64_t startUs = Util::getMonotonicTimeUs();
+
+    MraaBus bus { RDA5807M::DEFAULT_I2C_BUS };
+    RDA5807M radio { bus };
+    RdsDecoder rdsDecoder;
+    MiniCommandInterpreter interpreter { radio, rdsDecoder };
+
+    std::printf("Startup time: %llu us\n", static_cast<unsigned long long>(Util::getMonotonicTimeUs() - startUs));
+
+    while (true)
+    {
+        std::printf("Enter Command: ");
+        std::fflush(stdout);
+
+        if (!readLine())
+        {
+            break;
+        }
+
+        interpreter.execute(lineBuffer, outputBuffer, OUTPUT_BUFFER_SIZE);
+        std::printf("Exec Result: \n%s\n\n", outputBuffer);
+    }
+
+    return 0;
+}
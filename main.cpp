@@ -4,46 +4,356 @@
  *************************************************/
 
 // System includes
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <semaphore.h>
 #include <signal.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 // Project includes
+#include "ArbitratedBus.hpp"
+#include "BusArbiter.hpp"
+#include "BusClockCalibrator.hpp"
 #include "CommandParser.hpp"
+#include "I2cDevBus.hpp"
+#include "Log.hpp"
+#include "MraaBus.hpp"
 #include "RDA5807M.hpp"
+#include "RDA5807MBus.hpp"
+#include "RDA5807MRegDefines.hpp"
 #include "RDA5807MWrapper.hpp"
+#include "RadioStateFile.hpp"
+#include "Scenario.hpp"
+#include "SimulatedBus.hpp"
+#include "Util.hpp"
 
-RDA5807M radio;
+// All of the radio's traffic goes through the arbiter, so that other
+// devices on its bus get their turn
+BusArbiter busArbiter;
+
+// One of these is set, depending on whether a scenario is being run
+std::unique_ptr<RDA5807MBus> hardwareBus;
+std::unique_ptr<SimulatedBus> simulatedBus;
+
+std::unique_ptr<ArbitratedBus> arbitratedBus;
+std::unique_ptr<RDA5807M> radio;
+
+// A warm start takes over the radio as it is playing and leaves it playing
+// on exit, saving its configuration to statePath if there is one
+bool warmStart = false;
+const char* statePath = nullptr;
+
+// The thread that owns the bus. SIGINT only asks it to stop; touching the
+// radio from the handler could interleave with a transfer already in
+// progress on the bus. A second SIGINT hands the shutdown to
+// runForcedExit() without waiting for the command, and a third exits at
+// once.
+pthread_t mainThread;
+volatile sig_atomic_t interruptCount = 0;
+sem_t forcedExit;
 
 void die(int UNUSED)
 {
     (void) UNUSED;
 
-    radio.setVolume(0x00);
-    radio.writeRegisterToDevice(RDA5807M::Register::REG_0x05);
+    // Make sure the main thread's blocking read is the one interrupted
+    if (!pthread_equal(pthread_self(), mainThread))
+    {
+        pthread_kill(mainThread, SIGINT);
+        return;
+    }
+
+    interruptCount = interruptCount + 1;
+    if (interruptCount == 2)
+    {
+        sem_post(&forcedExit);
+    }
+    else if (interruptCount > 2)
+    {
+        _exit(130);
+    }
+}
+
+/**
+ * Waits for a second SIGINT, then powers the radio down and exits while
+ * the main thread is still in its command. The driver belongs to the main
+ * thread, so the writes go straight to the bus underneath it, under a
+ * grant from the arbiter so they can't cut into a transaction already in
+ * progress. A warm start leaves the radio playing, as on a normal exit,
+ * but doesn't save its state.
+ */
+void runForcedExit()
+{
+    while (sem_wait(&forcedExit) != 0)
+    {
+    }
 
-    radio.setEnabled(false);
-    radio.writeRegisterToDevice(RDA5807M::Register::REG_0x02);
-    exit(0);
+    if (!warmStart)
+    {
+        RDA5807MBus& bus = hardwareBus ? *hardwareBus : *simulatedBus;
+        BusArbiter::Grant grant{busArbiter, BusArbiter::TrafficClass::USER_TUNE};
+        bus.writeRegister(RDA5807M::Register::REG_0x05,
+                          radio->getLocalRegisterContent(RDA5807M::Register::REG_0x05) & ~VOLUME);
+        bus.writeRegister(RDA5807M::Register::REG_0x02,
+                          radio->getLocalRegisterContent(RDA5807M::Register::REG_0x02) & ~ENABLE);
+    }
+    _exit(130);
 }
 
-int main()
+void shutDownRadio()
 {
+    if (warmStart)
+    {
+        RDA5807M::SavedState state;
+        radio->getSavedState(state);
+        if (statePath != nullptr && !RadioStateFile::save(statePath, state))
+        {
+            std::cerr << "Unable to save the radio state to " << statePath << std::endl;
+        }
+        return;
+    }
+
+    radio->setVolume(0x00);
+    radio->setEnabled(false);
+}
+
+/**
+ * Creates the driver for the radio on bus, attaching to it warm if asked to
+ */
+void createRadio(RDA5807MBus& bus)
+{
+    if (!warmStart)
+    {
+        radio.reset(new RDA5807M(bus));
+        return;
+    }
+
+    uint64_t startUs = Util::getMonotonicTimeUs();
+    RDA5807M::SavedState state;
+    bool haveState = (statePath != nullptr) && RadioStateFile::load(statePath, state);
+    radio.reset(new RDA5807M(bus, RDA5807M::StartMode::WARM_ATTACH, haveState ? &state : nullptr));
+
+    std::cout << "Warm attach: " << RDA5807M::attachResultToCString(radio->getAttachResult()) << " in "
+              << (Util::getMonotonicTimeUs() - startUs) << " us" << std::endl;
+}
+
+/**
+ * Moves the radio's bus to the clock rate I2CCAL saved, if it did, once
+ * the radio has been brought up at the platform's rate. The rate is
+ * checked first, unless the radio was attached warm, where checking it
+ * would write to a radio that is playing.
+ */
+void restoreBusClock()
+{
+    BusClockCalibrator calibrator{*radio};
+    BusClockCalibrator::Validation validation = warmStart ? calibrator.apply(BusClockCalibrator::DEFAULT_PATH) :
+                                                            calibrator.restore(BusClockCalibrator::DEFAULT_PATH);
+    if (!validation.found)
+    {
+        return;
+    }
+
+    std::cout << "I2C clock: " << BusClockCalibrator::rateToKhz(validation.chosen) << " kHz";
+    if (warmStart)
+    {
+        if (validation.chosen != validation.saved)
+        {
+            std::cout << ", the bus can't run at the saved " << BusClockCalibrator::rateToKhz(validation.saved)
+                      << " kHz";
+        }
+        std::cout << ", not validated on a warm attach";
+    }
+    else if (!validation.validated)
+    {
+        std::cout << ", saved " << BusClockCalibrator::rateToKhz(validation.saved)
+                  << " kHz and every rate below it failed validation";
+    }
+    else if (validation.chosen != validation.saved)
+    {
+        std::cout << ", saved " << BusClockCalibrator::rateToKhz(validation.saved) << " kHz failed validation";
+    }
+    std::cout << " (" << validation.elapsedUs << " us)" << std::endl;
+}
+
+/**
+ * Puts the radio on a simulated chip playing the scenario in path, or the
+ * dense urban preset if path is "urban". Returns false if the scenario
+ * can't be loaded.
+ */
+bool attachScenario(const char* path, uint32_t speedUp)
+{
+    Scenario scenario;
+    if (std::strcmp(path, "urban") == 0)
+    {
+        scenario.populateDenseUrban(1);
+    }
+    else
+    {
+        uint32_t errorLine = 0;
+        if (!scenario.load(path, errorLine))
+        {
+            std::cerr << "Unable to load scenario " << path;
+            if (errorLine != 0)
+            {
+                std::cerr << " (line " << errorLine << ")";
+            }
+            std::cerr << std::endl;
+            return false;
+        }
+    }
+
+    simulatedBus.reset(new SimulatedBus());
+    simulatedBus->setScenario(scenario);
+    simulatedBus->getClock().setSpeedUp(speedUp);
+    arbitratedBus.reset(new ArbitratedBus(*simulatedBus, busArbiter));
+    createRadio(*arbitratedBus);
+    return true;
+}
+
+/**
+ * Opens the I2C bus busNumber through libmraa, or through i2c-dev if
+ * useI2cDev
+ */
+RDA5807MBus* openHardwareBus(int busNumber, bool useI2cDev)
+{
+    if (useI2cDev)
+    {
+        return new I2cDevBus(busNumber);
+    }
+    return new MraaBus(busNumber);
+}
+
+/**
+ * "--scenario <file>" runs against a simulated chip instead of the
+ * hardware, with "--speedup <n>" making its time run n times faster (0
+ * for as fast as it is polled). "--bus i2c-dev" talks to the hardware
+ * through /dev/i2c-N instead of libmraa ("--bus mraa"). "--warm" takes
+ * over a radio that is already playing without interrupting it, and
+ * leaves it playing on exit; "--state <file>" does the same and also
+ * keeps the radio's configuration in file, to put back a radio that lost
+ * it. "--log <file>" sends log lines to file rather than stdout. Any
+ * other arguments are I2C bus numbers of additional tuners, which are
+ * used to speed up band surveys. An I2C clock rate saved by I2CCAL is
+ * validated and put back on startup.
+ */
+int main(int argc, char* argv[])
+{
+    mainThread = pthread_self();
+    sem_init(&forcedExit, 0, 0);
+
+    // No SA_RESTART, so that SIGINT ends a read from the terminal
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = die;
     sigfillset(&sa.sa_mask);
     sigaction(SIGINT, &sa, NULL);
 
-    RDA5807MWrapper wrapper { radio };
+    const char* scenarioPath = nullptr;
+    uint32_t speedUp = 1;
+    bool useI2cDev = false;
+    std::vector<int> extraBusNumbers;
+    for (int argIdx = 1; argIdx < argc; ++argIdx)
+    {
+        if (std::strcmp(argv[argIdx], "--scenario") == 0 && argIdx + 1 < argc)
+        {
+            scenarioPath = argv[++argIdx];
+        }
+        else if (std::strcmp(argv[argIdx], "--speedup") == 0 && argIdx + 1 < argc)
+        {
+            speedUp = static_cast<uint32_t>(std::strtoul(argv[++argIdx], nullptr, 10));
+        }
+        else if (std::strcmp(argv[argIdx], "--warm") == 0)
+        {
+            warmStart = true;
+        }
+        else if (std::strcmp(argv[argIdx], "--state") == 0 && argIdx + 1 < argc)
+        {
+            warmStart = true;
+            statePath = argv[++argIdx];
+        }
+        else if (std::strcmp(argv[argIdx], "--log") == 0 && argIdx + 1 < argc)
+        {
+            const char* logPath = argv[++argIdx];
+            if (!Log::get().redirect(logPath))
+            {
+                std::cerr << "Unable to open log file " << logPath << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[argIdx], "--bus") == 0 && argIdx + 1 < argc)
+        {
+            const char* busType = argv[++argIdx];
+            if (std::strcmp(busType, "i2c-dev") == 0)
+            {
+                useI2cDev = true;
+            }
+            else if (std::strcmp(busType, "mraa") != 0)
+            {
+                std::cerr << "Unknown bus " << busType << "; expected mraa or i2c-dev" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            extraBusNumbers.push_back(std::atoi(argv[argIdx]));
+        }
+    }
+
+    if (scenarioPath == nullptr)
+    {
+        hardwareBus.reset(openHardwareBus(RDA5807M::DEFAULT_I2C_BUS, useI2cDev));
+        arbitratedBus.reset(new ArbitratedBus(*hardwareBus, busArbiter));
+        createRadio(*arbitratedBus);
+    }
+    else if (!attachScenario(scenarioPath, speedUp))
+    {
+        return 1;
+    }
+    restoreBusClock();
+
+    RDA5807MWrapper wrapper { *radio };
+    wrapper.setBusArbiter(busArbiter);
+
+    // The buses outlive their tuners
+    std::vector<std::unique_ptr<RDA5807MBus>> extraBuses;
+    std::vector<std::unique_ptr<RDA5807M>> extraTuners;
+    for (int busNumber : extraBusNumbers)
+    {
+        extraBuses.emplace_back(openHardwareBus(busNumber, useI2cDev));
+        extraTuners.emplace_back(new RDA5807M(*extraBuses.back()));
+        wrapper.addSurveyTuner(*extraTuners.back());
+    }
+
     CommandParser parser { wrapper };
+    std::thread(runForcedExit).detach();
 
-    while (true) {
+    // An interrupted command finishes before the radio is shut down,
+    // unless a second SIGINT forces the exit
+    while (interruptCount == 0) {
         std::cout << "Enter Command: " << std::flush;
         std::string line = "";
-        std::getline(std::cin, line);
+        if (!std::getline(std::cin, line))
+        {
+            if (std::cin.eof())
+            {
+                break;
+            }
+            std::cin.clear();
+            continue;
+        }
         std::string result = parser.execute(line);
+
+        // Keep the command's log lines ahead of its result
+        Log::get().flush();
         std::cout << "Exec Result: \n" << result << std::endl;
         std::cout << "\n" << std::endl;
     }
+
+    shutDownRadio();
+    return 0;
 }
@@ -0,0 +1,27 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../async/AsyncTuner.cpp \
+../async/TunerScheduler.cpp 
+
+OBJS += \
+./async/AsyncTuner.o \
+./async/TunerScheduler.o 
+
+CPP_DEPS += \
+./async/AsyncTuner.d \
+./async/TunerScheduler.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+async/%.o: ../async/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++2a -fcoroutines -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
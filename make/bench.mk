@@ -0,0 +1,58 @@
+################################################################################
+# Benchmarks
+#
+# Builds the benchmarks into their own binary so that they stay out of the
+# radio's. They run against simulated chips unless noted, linking the
+# driver, RDS, service and simulator sources but not the command layer.
+#
+# Usage (from this directory):
+#   make -f bench.mk                   builds RDA5807M-bench
+#   ./RDA5807M-bench                   lists the benchmarks
+#   ./RDA5807M-bench <name> [param]    runs one
+################################################################################
+
+RM := rm -f
+
+BENCH_DIR := bench-build
+BENCH_TARGET := RDA5807M-bench
+
+BENCH_SRCS := \
+$(wildcard ../bench/*.cpp) \
+$(wildcard ../async/*.cpp) \
+$(wildcard ../driver/*.cpp) \
+$(wildcard ../monitor/*.cpp) \
+$(wildcard ../rds/*.cpp) \
+$(wildcard ../scan/*.cpp) \
+$(wildcard ../service/*.cpp) \
+$(wildcard ../sim/*.cpp) \
+$(wildcard ../util/*.cpp)
+
+BENCH_OBJS := $(patsubst ../%.cpp,$(BENCH_DIR)/%.o,$(BENCH_SRCS))
+
+BENCH_STD := -std=c++14
+BENCH_CXXFLAGS := -I../bench -I../util -I../driver -I../rds -I../service -I../sim -I../scan -I../async \
+	-I../monitor -O3 -g -Wall -Wextra -fmessage-length=0
+BENCH_LIBS := -lmraa -lrt
+
+# The coroutine sources, and the benchmark that drives them
+$(BENCH_DIR)/async/%.o $(BENCH_DIR)/bench/AsyncBenchmark.o: BENCH_STD := -std=c++2a -fcoroutines
+
+all: $(BENCH_TARGET)
+
+$(BENCH_DIR)/%.o: ../%.cpp
+	@mkdir -p $(dir $@)
+	@echo 'Building file: $<'
+	g++ $(BENCH_STD) $(BENCH_CXXFLAGS) -c -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo ' '
+
+$(BENCH_TARGET): $(BENCH_OBJS)
+	@echo 'Building target: $@'
+	g++ -o "$@" $(BENCH_OBJS) $(BENCH_LIBS)
+	@echo ' '
+
+clean:
+	-$(RM) -r $(BENCH_DIR) $(BENCH_TARGET)
+
+-include $(BENCH_OBJS:%.o=%.d)
+
+.PHONY: all clean
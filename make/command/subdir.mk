@@ -4,20 +4,23 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
-../command/CommandParser.cpp 
+../command/CommandParser.cpp \
+../command/MiniCommandInterpreter.cpp 
 
 OBJS += \
-./command/CommandParser.o 
+./command/CommandParser.o \
+./command/MiniCommandInterpreter.o 
 
 CPP_DEPS += \
-./command/CommandParser.d 
+./command/CommandParser.d \
+./command/MiniCommandInterpreter.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 command/%.o: ../command/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
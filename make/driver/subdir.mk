@@ -4,20 +4,47 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
-../driver/RDA5807M.cpp 
+../driver/ArbitratedBus.cpp \
+../driver/BusArbiter.cpp \
+../driver/BusClockCalibrator.cpp \
+../driver/ChannelPlanner.cpp \
+../driver/I2cDevBus.cpp \
+../driver/MraaBus.cpp \
+../driver/PollingController.cpp \
+../driver/RDA5807M.cpp \
+../driver/RDA5807MWatchdog.cpp \
+../driver/RadioStateFile.cpp 
 
 OBJS += \
-./driver/RDA5807M.o 
+./driver/ArbitratedBus.o \
+./driver/BusArbiter.o \
+./driver/BusClockCalibrator.o \
+./driver/ChannelPlanner.o \
+./driver/I2cDevBus.o \
+./driver/MraaBus.o \
+./driver/PollingController.o \
+./driver/RDA5807M.o \
+./driver/RDA5807MWatchdog.o \
+./driver/RadioStateFile.o 
 
 CPP_DEPS += \
-./driver/RDA5807M.d 
+./driver/ArbitratedBus.d \
+./driver/BusArbiter.d \
+./driver/BusClockCalibrator.d \
+./driver/ChannelPlanner.d \
+./driver/I2cDevBus.d \
+./driver/MraaBus.d \
+./driver/PollingController.d \
+./driver/RDA5807M.d \
+./driver/RDA5807MWatchdog.d \
+./driver/RadioStateFile.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
 driver/%.o: ../driver/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
@@ -0,0 +1,74 @@
+################################################################################
+# Freestanding low-footprint profile
+#
+# Builds the driver, register map, RDS decoder and the minimal command
+# interpreter with no exceptions, RTTI, heap or iostream/regex. Linked with
+# gcc rather than g++, so anything that pulls in libstdc++ fails the link.
+#
+# Usage (from this directory):
+#   make -f freestanding.mk            builds RDA5807M-freestanding
+#   make -f freestanding.mk metrics    also checks symbols and size budgets
+################################################################################
+
+RM := rm -f
+
+FS_DIR := freestanding-build
+FS_TARGET := RDA5807M-freestanding
+FS_METRICS := $(FS_DIR)/metrics.txt
+
+# Regressions past these budgets fail the metrics target
+FS_TEXT_BUDGET := 16384
+FS_STATIC_RAM_BUDGET := 2048
+
+FS_SRCS := \
+../command/MiniCommandInterpreter.cpp \
+../driver/ChannelPlanner.cpp \
+../driver/MraaBus.cpp \
+../driver/RDA5807M.cpp \
+../freestanding/FreestandingMain.cpp \
+../rds/RdsDecoder.cpp \
+../util/Util.cpp 
+
+FS_OBJS := $(patsubst ../%.cpp,$(FS_DIR)/%.o,$(FS_SRCS))
+
+FS_CXXFLAGS := -std=c++14 -DRDA5807M_FREESTANDING -I../util -I../command -I../driver -I../rds \
+	-Os -g -Wall -Wextra -fno-exceptions -fno-rtti -fno-threadsafe-statics \
+	-fno-asynchronous-unwind-tables -ffunction-sections -fdata-sections -fmessage-length=0
+
+FS_LDFLAGS := -Wl,--gc-sections
+FS_LIBS := -lmraa -lrt
+
+# Symbols that mean the profile has picked up the hosted runtime
+FS_FORBIDDEN_SYMBOLS := malloc|calloc|realloc|_Znwm|_Znam|_ZdlPv|_ZdaPv|__cxa_throw|__cxa_allocate_exception|__gxx_personality|_ZTI|_ZTS|ios_base|regex|basic_string
+
+all: $(FS_TARGET)
+
+$(FS_DIR)/%.o: ../%.cpp
+	@mkdir -p $(dir $@)
+	@echo 'Building file: $<'
+	g++ $(FS_CXXFLAGS) -c -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo ' '
+
+$(FS_TARGET): $(FS_OBJS)
+	@echo 'Building target: $@'
+	gcc $(FS_LDFLAGS) -o "$@" $(FS_OBJS) $(FS_LIBS)
+	@echo ' '
+
+# Binary size is the text segment; static RAM is data + bss. Startup time is
+# printed by the binary itself at boot.
+metrics: $(FS_TARGET)
+	@if nm -u $(FS_TARGET) | grep -E '$(FS_FORBIDDEN_SYMBOLS)'; then \
+		echo 'Forbidden runtime symbols referenced'; exit 1; fi
+	@size $(FS_TARGET) | awk 'NR == 2 { print "text_bytes " $$1; print "data_bytes " $$2; \
+		print "bss_bytes " $$3; print "static_ram_bytes " $$2 + $$3 }' > $(FS_METRICS)
+	@cat $(FS_METRICS)
+	@awk '/^text_bytes/ && $$2 > $(FS_TEXT_BUDGET) { print "text over budget"; bad = 1 } \
+		/^static_ram_bytes/ && $$2 > $(FS_STATIC_RAM_BUDGET) { print "static RAM over budget"; bad = 1 } \
+		END { exit bad }' $(FS_METRICS)
+
+clean:
+	-$(RM) -r $(FS_DIR) $(FS_TARGET)
+
+-include $(FS_OBJS:%.o=%.d)
+
+.PHONY: all metrics clean
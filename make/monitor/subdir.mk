@@ -0,0 +1,36 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../monitor/RssiSampler.cpp \
+../monitor/StreamingStats.cpp \
+../monitor/WatchlistMonitor.cpp \
+../monitor/WaterfallReader.cpp \
+../monitor/WaterfallWriter.cpp 
+
+OBJS += \
+./monitor/RssiSampler.o \
+./monitor/StreamingStats.o \
+./monitor/WatchlistMonitor.o \
+./monitor/WaterfallReader.o \
+./monitor/WaterfallWriter.o 
+
+CPP_DEPS += \
+./monitor/RssiSampler.d \
+./monitor/StreamingStats.d \
+./monitor/WatchlistMonitor.d \
+./monitor/WaterfallReader.d \
+./monitor/WaterfallWriter.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+monitor/%.o: ../monitor/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -0,0 +1,42 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../rds/OdaRegistry.cpp \
+../rds/RdsDecoder.cpp \
+../rds/RdsGroupLog.cpp \
+../rds/RtPlusHandler.cpp \
+../rds/TmcDecoder.cpp \
+../rds/TmcTables.cpp \
+../rds/TrafficAnnouncementDetector.cpp 
+
+OBJS += \
+./rds/OdaRegistry.o \
+./rds/RdsDecoder.o \
+./rds/RdsGroupLog.o \
+./rds/RtPlusHandler.o \
+./rds/TmcDecoder.o \
+./rds/TmcTables.o \
+./rds/TrafficAnnouncementDetector.o 
+
+CPP_DEPS += \
+./rds/OdaRegistry.d \
+./rds/RdsDecoder.d \
+./rds/RdsGroupLog.d \
+./rds/RtPlusHandler.d \
+./rds/TmcDecoder.d \
+./rds/TmcTables.d \
+./rds/TrafficAnnouncementDetector.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+rds/%.o: ../rds/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -0,0 +1,27 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../scan/ParallelSurvey.cpp \
+../scan/TargetedSearch.cpp 
+
+OBJS += \
+./scan/ParallelSurvey.o \
+./scan/TargetedSearch.o 
+
+CPP_DEPS += \
+./scan/ParallelSurvey.d \
+./scan/TargetedSearch.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+scan/%.o: ../scan/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
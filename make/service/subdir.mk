@@ -0,0 +1,39 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../service/MetricsRegistry.cpp \
+../service/MetricsServer.cpp \
+../service/RdsEventBroker.cpp \
+../service/StationStatePublisher.cpp \
+../service/StationStateReader.cpp \
+../service/TrafficAnnouncementService.cpp 
+
+OBJS += \
+./service/MetricsRegistry.o \
+./service/MetricsServer.o \
+./service/RdsEventBroker.o \
+./service/StationStatePublisher.o \
+./service/StationStateReader.o \
+./service/TrafficAnnouncementService.o 
+
+CPP_DEPS += \
+./service/MetricsRegistry.d \
+./service/MetricsServer.d \
+./service/RdsEventBroker.d \
+./service/StationStatePublisher.d \
+./service/StationStateReader.d \
+./service/TrafficAnnouncementService.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+service/%.o: ../service/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
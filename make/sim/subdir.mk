@@ -0,0 +1,33 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../sim/Scenario.cpp \
+../sim/ScenarioGenerator.cpp \
+../sim/SimulatedBus.cpp \
+../sim/SimulationClock.cpp 
+
+OBJS += \
+./sim/Scenario.o \
+./sim/ScenarioGenerator.o \
+./sim/SimulatedBus.o \
+./sim/SimulationClock.o 
+
+CPP_DEPS += \
+./sim/Scenario.d \
+./sim/ScenarioGenerator.d \
+./sim/SimulatedBus.d \
+./sim/SimulationClock.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+sim/%.o: ../sim/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
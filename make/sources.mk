@@ -23,9 +23,15 @@ C_DEPS :=
 
 # Every subdirectory with source files must be described here
 SUBDIRS := \
+async \
 command \
 driver \
 driver_wrapper \
 . \
+monitor \
+rds \
+scan \
+service \
+sim \
 util \
 
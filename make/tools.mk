@@ -0,0 +1,53 @@
+################################################################################
+# Offline tools
+#
+# Host utilities that work on files the main program writes and don't need
+# the radio or libmraa.
+#
+# Usage (from this directory):
+#   make -f tools.mk            builds bustrace-convert and tmc-table-compile
+################################################################################
+
+RM := rm -f
+
+TOOLS_DIR := tools-build
+
+TOOLS_CXXFLAGS := -std=c++14 -I../util -I../rds -O3 -g -Wall -Wextra -fmessage-length=0
+
+BUSTRACE_CONVERT_SRCS := \
+../tools/BusTraceConvert.cpp \
+../util/BusTraceReader.cpp 
+
+BUSTRACE_CONVERT_OBJS := $(patsubst ../%.cpp,$(TOOLS_DIR)/%.o,$(BUSTRACE_CONVERT_SRCS))
+
+TMC_TABLE_COMPILE_SRCS := \
+../tools/TmcTableCompile.cpp 
+
+TMC_TABLE_COMPILE_OBJS := $(patsubst ../%.cpp,$(TOOLS_DIR)/%.o,$(TMC_TABLE_COMPILE_SRCS))
+
+all: bustrace-convert tmc-table-compile
+
+$(TOOLS_DIR)/%.o: ../%.cpp
+	@mkdir -p $(dir $@)
+	@echo 'Building file: $<'
+	g++ $(TOOLS_CXXFLAGS) -c -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	@echo ' '
+
+bustrace-convert: $(BUSTRACE_CONVERT_OBJS)
+	@echo 'Building target: $@'
+	g++ -o "$@" $(BUSTRACE_CONVERT_OBJS)
+	@echo ' '
+
+tmc-table-compile: $(TMC_TABLE_COMPILE_OBJS)
+	@echo 'Building target: $@'
+	g++ -o "$@" $(TMC_TABLE_COMPILE_OBJS)
+	@echo ' '
+
+clean:
+	-$(RM) -r $(TOOLS_DIR) bustrace-convert tmc-table-compile
+	-@echo ' '
+
+-include $(BUSTRACE_CONVERT_OBJS:%.o=%.d)
+-include $(TMC_TABLE_COMPILE_OBJS:%.o=%.d)
+
+.PHONY: all clean
@@ -4,12 +4,21 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../util/BusTrace.cpp \
+../util/BusTraceReader.cpp \
+../util/Log.cpp \
 ../util/Util.cpp 
 
 OBJS += \
+./util/BusTrace.o \
+./util/BusTraceReader.o \
+./util/Log.o \
 ./util/Util.o 
 
 CPP_DEPS += \
+./util/BusTrace.d \
+./util/BusTraceReader.d \
+./util/Log.d \
 ./util/Util.d 
 
 
@@ -17,7 +26,7 @@ CPP_DEPS += \
 util/%.o: ../util/%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: GCC C++ Compiler'
-	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	g++ -std=c++14 -I../util -I../driver_wrapper -I../command -I../driver -I../rds -I../service -I../sim -I../scan -I../async -I../monitor -O3 -g -Wall -Wextra -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
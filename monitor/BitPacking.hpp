@@ -0,0 +1,131 @@
+/**************************************************
+ * BitPacking.hpp - Fixed-width bit packing helpers
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BITPACKING_HPP
+#define BITPACKING_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Project includes
+//<none>
+
+namespace BitPacking
+{
+    // Maps small signed deltas to small unsigned values: 0, -1, 1, -2, ...
+    inline uint32_t zigzagEncode(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    inline int32_t zigzagDecode(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    // Number of bits needed to hold value; 0 for 0
+    inline uint8_t bitsNeeded(uint64_t value)
+    {
+        uint8_t bits = 0;
+        while (value != 0)
+        {
+            ++bits;
+            value >>= 1;
+        }
+        return bits;
+    }
+
+    /**
+     * Appends values LSB-first to a byte vector
+     */
+    class Writer
+    {
+    public:
+        Writer(std::vector<uint8_t>& outParam) : out(outParam), accumulator(0), accumulatedBits(0) {}
+
+        void write(uint64_t value, uint8_t bits)
+        {
+            // Keep each step within the 64 bit accumulator
+            while (bits > 32)
+            {
+                write(value & 0xFFFFFFFFULL, 32);
+                value >>= 32;
+                bits -= 32;
+            }
+
+            accumulator |= (value & ((1ULL << bits) - 1)) << accumulatedBits;
+            accumulatedBits += bits;
+            while (accumulatedBits >= 8)
+            {
+                out.push_back(static_cast<uint8_t>(accumulator));
+                accumulator >>= 8;
+                accumulatedBits -= 8;
+            }
+        }
+
+        // Pads to a whole byte
+        void flush()
+        {
+            if (accumulatedBits > 0)
+            {
+                out.push_back(static_cast<uint8_t>(accumulator));
+            }
+            accumulator = 0;
+            accumulatedBits = 0;
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t accumulator;
+        uint8_t accumulatedBits;
+    };
+
+    /**
+     * Reads back what Writer wrote. Never reads past end.
+     */
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* dataParam, const uint8_t* endParam) :
+                data(dataParam), end(endParam), accumulator(0), accumulatedBits(0) {}
+
+        uint64_t read(uint8_t bits)
+        {
+            if (bits > 32)
+            {
+                uint64_t low = read(32);
+                return low | (read(bits - 32) << 32);
+            }
+
+            while (accumulatedBits < bits)
+            {
+                uint64_t next = data < end ? *data++ : 0;
+                accumulator |= next << accumulatedBits;
+                accumulatedBits += 8;
+            }
+
+            uint64_t value = accumulator & ((1ULL << bits) - 1);
+            accumulator >>= bits;
+            accumulatedBits -= bits;
+            return value;
+        }
+
+        // Position of the next whole byte
+        const uint8_t* alignedPosition() const
+        {
+            return data;
+        }
+
+    private:
+        const uint8_t* data;
+        const uint8_t* end;
+        uint64_t accumulator;
+        uint8_t accumulatedBits;
+    };
+};
+
+#endif  // ifndef BITPACKING_HPP
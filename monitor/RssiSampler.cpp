@@ -0,0 +1,204 @@
+/**************************************************
+ * RssiSampler.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <time.h>
+
+// Project includes
+#include "BusTrace.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RssiSampler.hpp"
+#include "StreamingStats.hpp"
+#include "Util.hpp"
+
+constexpr double RssiSampler::EWMA_ALPHA;
+
+RssiSampler::RssiSampler(RDA5807M& radioParam) :
+        radio(radioParam), sampleRateHz(DEFAULT_SAMPLE_RATE_HZ), decimation(DEFAULT_DECIMATION),
+        ewma(EWMA_ALPHA), p10(0.1), median(0.5), p90(0.9)
+{
+    reset();
+}
+
+/**
+ * Returns false, leaving the configuration alone, if either parameter is
+ * out of range
+ */
+bool RssiSampler::configure(uint32_t sampleRateHzParam, uint32_t decimationParam)
+{
+    if (sampleRateHzParam == 0 || sampleRateHzParam > MAX_SAMPLE_RATE_HZ || decimationParam == 0)
+    {
+        return false;
+    }
+
+    sampleRateHz = sampleRateHzParam;
+    decimation = decimationParam;
+    return true;
+}
+
+void RssiSampler::reset()
+{
+    ewma.reset();
+    variance.reset();
+    p10.reset();
+    median.reset();
+    p90.reset();
+    window.reset();
+
+    blockSamples = 0;
+    blockRssiSum = 0;
+    blockMin = RDA5807M::RSSI_MAX;
+    blockMax = 0;
+    blockFmTrue = 0;
+    blockFmReady = 0;
+
+    summaryHead = 0;
+    summaryCount = 0;
+
+    samples = 0;
+    summariesEmitted = 0;
+    overruns = 0;
+    runTimeUs = 0;
+}
+
+/**
+ * Samples for durationMs on absolute deadlines, so time spent on the bus
+ * doesn't stretch the period. Returns the number of samples taken.
+ */
+uint32_t RssiSampler::run(uint32_t durationMs)
+{
+    const uint64_t periodNs = 1000000000ULL / sampleRateHz;
+    const uint64_t sampleCount = static_cast<uint64_t>(durationMs) * sampleRateHz / 1000;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t startUs = Util::getMonotonicTimeUs();
+
+    for (uint64_t sampleIdx = 0; sampleIdx < sampleCount; ++sampleIdx)
+    {
+        radio.readAndStoreSingleRegisterFromDevice(RDA5807M::Register::REG_0x0B);
+        addSample(radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B), Util::getMonotonicTimeUs());
+
+        uint64_t nextNs = static_cast<uint64_t>(deadline.tv_nsec) + periodNs;
+        deadline.tv_sec += static_cast<time_t>(nextNs / 1000000000ULL);
+        deadline.tv_nsec = static_cast<long>(nextNs % 1000000000ULL);
+
+        // Falling behind isn't made up with a burst of back-to-back reads;
+        // the schedule restarts from now instead
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec > deadline.tv_nsec))
+        {
+            ++overruns;
+            deadline = now;
+            continue;
+        }
+
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+    }
+
+    runTimeUs += Util::getMonotonicTimeUs() - startUs;
+    return static_cast<uint32_t>(sampleCount);
+}
+
+/**
+ * Feeds one raw value of register 0x0B to every estimator. O(1) apart
+ * from the amortized sliding window.
+ */
+void RssiSampler::addSample(uint16_t statusRegister, uint64_t timestampUs)
+{
+    uint8_t rssi = static_cast<uint8_t>(Util::valueFromReg(statusRegister, RSSI));
+
+    ++samples;
+    ewma.add(rssi);
+    variance.add(rssi);
+    p10.add(rssi);
+    median.add(rssi);
+    p90.add(rssi);
+    window.add(rssi);
+
+    ++blockSamples;
+    blockRssiSum += rssi;
+    if (rssi < blockMin)
+    {
+        blockMin = rssi;
+    }
+    if (rssi > blockMax)
+    {
+        blockMax = rssi;
+    }
+    blockFmTrue += (statusRegister & FM_TRUE) != 0 ? 1 : 0;
+    blockFmReady += (statusRegister & FM_READY) != 0 ? 1 : 0;
+
+    if (blockSamples >= decimation)
+    {
+        emitSummary(timestampUs);
+    }
+}
+
+void RssiSampler::emitSummary(uint64_t timestampUs)
+{
+    Summary& summary = summaries[summaryHead];
+    summary.timestampUs = timestampUs;
+    summary.samples = blockSamples;
+    summary.meanRssi = static_cast<float>(blockRssiSum) / blockSamples;
+    summary.minRssi = blockMin;
+    summary.maxRssi = blockMax;
+    summary.fmTrueRatio = static_cast<float>(blockFmTrue) / blockSamples;
+    summary.fmReadyRatio = static_cast<float>(blockFmReady) / blockSamples;
+
+    summaryHead = (summaryHead + 1) % SUMMARY_HISTORY_LENGTH;
+    if (summaryCount < SUMMARY_HISTORY_LENGTH)
+    {
+        ++summaryCount;
+    }
+    ++summariesEmitted;
+
+    blockSamples = 0;
+    blockRssiSum = 0;
+    blockMin = RDA5807M::RSSI_MAX;
+    blockMax = 0;
+    blockFmTrue = 0;
+    blockFmReady = 0;
+}
+
+RssiSampler::Stats RssiSampler::getStats() const
+{
+    Stats stats;
+    stats.samples = samples;
+    stats.summaries = summariesEmitted;
+    stats.overruns = overruns;
+    stats.runTimeUs = runTimeUs;
+    stats.ewma = ewma.get();
+    stats.mean = variance.getMean();
+    stats.standardDeviation = variance.getStandardDeviation();
+    stats.p10 = p10.get();
+    stats.median = median.get();
+    stats.p90 = p90.get();
+    stats.windowMin = window.getMin();
+    stats.windowMax = window.getMax();
+    return stats;
+}
+
+uint32_t RssiSampler::getSampleRateHz() const
+{
+    return sampleRateHz;
+}
+
+uint8_t RssiSampler::getSummaryCount() const
+{
+    return summaryCount;
+}
+
+/**
+ * age 0 is the newest summary. age must be below getSummaryCount().
+ */
+const RssiSampler::Summary& RssiSampler::getSummary(uint8_t age) const
+{
+    return summaries[(summaryHead + SUMMARY_HISTORY_LENGTH - 1 - age) % SUMMARY_HISTORY_LENGTH];
+}
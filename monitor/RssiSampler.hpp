@@ -0,0 +1,142 @@
+/**************************************************
+ * RssiSampler.hpp - High-rate signal quality sampling
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RSSISAMPLER_HPP
+#define RSSISAMPLER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "StreamingStats.hpp"
+
+/**
+ * Samples register 0x0B (RSSI, FM_TRUE, FM_READY) on a fixed-rate clock
+ * and feeds every sample through constant-memory estimators. Every
+ * decimation samples, the block is reduced to a Summary kept in a small
+ * ring, so a long-running monitor can be queried at a much lower rate
+ * than it samples.
+ *
+ * Sampling runs in the calling thread for a given duration. Nothing is
+ * allocated after construction.
+ */
+class RssiSampler
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_SAMPLE_RATE_HZ = 1000;
+    static const uint32_t MAX_SAMPLE_RATE_HZ = 10000;
+
+    // Samples per summary; 10 summaries per second at the default rate
+    static const uint32_t DEFAULT_DECIMATION = 100;
+
+    // Samples covered by the sliding min/max
+    static const uint16_t WINDOW_LENGTH = 1024;
+
+    // Number of summaries kept
+    static const uint8_t SUMMARY_HISTORY_LENGTH = 16;
+
+    // Weight of the newest sample in the EWMA
+    static constexpr double EWMA_ALPHA = 0.01;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Summary
+    {
+        uint64_t timestampUs;
+        uint32_t samples;
+        float meanRssi;
+        uint8_t minRssi;
+        uint8_t maxRssi;
+
+        // Fraction of samples with FM_TRUE/FM_READY set
+        float fmTrueRatio;
+        float fmReadyRatio;
+    };
+
+    struct Stats
+    {
+        uint64_t samples;
+        uint64_t summaries;
+
+        // Sample deadlines that had already passed when the previous
+        // sample finished
+        uint64_t overruns;
+        uint64_t runTimeUs;
+
+        double ewma;
+        double mean;
+        double standardDeviation;
+        double p10;
+        double median;
+        double p90;
+        uint8_t windowMin;
+        uint8_t windowMax;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RssiSampler(RDA5807M& radioParam);
+
+    bool configure(uint32_t sampleRateHzParam, uint32_t decimationParam);
+
+    void reset();
+
+    uint32_t run(uint32_t durationMs);
+
+    void addSample(uint16_t statusRegister, uint64_t timestampUs);
+
+    Stats getStats() const;
+
+    uint32_t getSampleRateHz() const;
+
+    uint8_t getSummaryCount() const;
+
+    const Summary& getSummary(uint8_t age) const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void emitSummary(uint64_t timestampUs);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    uint32_t sampleRateHz;
+    uint32_t decimation;
+
+    Ewma ewma;
+    RunningVariance variance;
+    P2Quantile p10;
+    P2Quantile median;
+    P2Quantile p90;
+    SlidingMinMax<uint8_t, WINDOW_LENGTH> window;
+
+    // The block being accumulated into the next summary
+    uint32_t blockSamples;
+    uint32_t blockRssiSum;
+    uint8_t blockMin;
+    uint8_t blockMax;
+    uint32_t blockFmTrue;
+    uint32_t blockFmReady;
+
+    Summary summaries[SUMMARY_HISTORY_LENGTH];
+    uint8_t summaryHead;
+    uint8_t summaryCount;
+
+    uint64_t samples;
+    uint64_t summariesEmitted;
+    uint64_t overruns;
+    uint64_t runTimeUs;
+};
+
+#endif  // ifndef RSSISAMPLER_HPP
@@ -0,0 +1,219 @@
+/**************************************************
+ * StreamingStats.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Project includes
+#include "StreamingStats.hpp"
+
+Ewma::Ewma(double alphaParam) : alpha(alphaParam), average(0.0), seeded(false)
+{
+}
+
+void Ewma::reset()
+{
+    average = 0.0;
+    seeded = false;
+}
+
+void Ewma::add(double value)
+{
+    if (!seeded)
+    {
+        average = value;
+        seeded = true;
+        return;
+    }
+
+    average += alpha * (value - average);
+}
+
+double Ewma::get() const
+{
+    return average;
+}
+
+RunningVariance::RunningVariance() : count(0), mean(0.0), sumSquaredDeviations(0.0)
+{
+}
+
+void RunningVariance::reset()
+{
+    count = 0;
+    mean = 0.0;
+    sumSquaredDeviations = 0.0;
+}
+
+void RunningVariance::add(double value)
+{
+    ++count;
+    double delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    sumSquaredDeviations += delta * (value - mean);
+}
+
+uint64_t RunningVariance::getCount() const
+{
+    return count;
+}
+
+double RunningVariance::getMean() const
+{
+    return mean;
+}
+
+/**
+ * Sample variance; 0 until there are two samples
+ */
+double RunningVariance::getVariance() const
+{
+    if (count < 2)
+    {
+        return 0.0;
+    }
+
+    return sumSquaredDeviations / static_cast<double>(count - 1);
+}
+
+double RunningVariance::getStandardDeviation() const
+{
+    return std::sqrt(getVariance());
+}
+
+P2Quantile::P2Quantile(double quantileParam) : quantile(quantileParam)
+{
+    reset();
+}
+
+void P2Quantile::reset()
+{
+    count = 0;
+
+    for (uint8_t idx = 0; idx < MARKER_COUNT; ++idx)
+    {
+        heights[idx] = 0.0;
+        positions[idx] = idx + 1;
+    }
+
+    desiredPositions[0] = 1.0;
+    desiredPositions[1] = 1.0 + 2.0 * quantile;
+    desiredPositions[2] = 1.0 + 4.0 * quantile;
+    desiredPositions[3] = 3.0 + 2.0 * quantile;
+    desiredPositions[4] = 5.0;
+
+    increments[0] = 0.0;
+    increments[1] = quantile / 2.0;
+    increments[2] = quantile;
+    increments[3] = (1.0 + quantile) / 2.0;
+    increments[4] = 1.0;
+}
+
+void P2Quantile::add(double value)
+{
+    // The first five samples become the initial markers
+    if (count < MARKER_COUNT)
+    {
+        heights[count++] = value;
+        if (count == MARKER_COUNT)
+        {
+            std::sort(heights, heights + MARKER_COUNT);
+        }
+        return;
+    }
+    ++count;
+
+    // Find the cell the sample falls in, stretching the extremes if needed
+    uint8_t cell;
+    if (value < heights[0])
+    {
+        heights[0] = value;
+        cell = 0;
+    }
+    else if (value >= heights[MARKER_COUNT - 1])
+    {
+        heights[MARKER_COUNT - 1] = value;
+        cell = MARKER_COUNT - 2;
+    }
+    else
+    {
+        cell = 0;
+        while (value >= heights[cell + 1])
+        {
+            ++cell;
+        }
+    }
+
+    for (uint8_t idx = cell + 1; idx < MARKER_COUNT; ++idx)
+    {
+        positions[idx] += 1.0;
+    }
+    for (uint8_t idx = 0; idx < MARKER_COUNT; ++idx)
+    {
+        desiredPositions[idx] += increments[idx];
+    }
+
+    // Nudge the middle markers towards where they should be
+    for (uint8_t idx = 1; idx < MARKER_COUNT - 1; ++idx)
+    {
+        double offset = desiredPositions[idx] - positions[idx];
+        if ((offset >= 1.0 && positions[idx + 1] - positions[idx] > 1.0) ||
+            (offset <= -1.0 && positions[idx - 1] - positions[idx] < -1.0))
+        {
+            int direction = offset > 0 ? 1 : -1;
+            double candidate = parabolic(idx, direction);
+            if (heights[idx - 1] < candidate && candidate < heights[idx + 1])
+            {
+                heights[idx] = candidate;
+            }
+            else
+            {
+                heights[idx] = linear(idx, direction);
+            }
+            positions[idx] += direction;
+        }
+    }
+}
+
+/**
+ * Until five samples have arrived the estimate is taken from the sorted
+ * samples directly
+ */
+double P2Quantile::get() const
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    if (count < MARKER_COUNT)
+    {
+        double sorted[MARKER_COUNT];
+        std::copy(heights, heights + count, sorted);
+        std::sort(sorted, sorted + count);
+        return sorted[static_cast<uint8_t>(quantile * static_cast<double>(count - 1) + 0.5)];
+    }
+
+    return heights[2];
+}
+
+double P2Quantile::parabolic(uint8_t idx, double direction) const
+{
+    double below = positions[idx] - positions[idx - 1];
+    double above = positions[idx + 1] - positions[idx];
+    double span = positions[idx + 1] - positions[idx - 1];
+
+    return heights[idx] + direction / span *
+           ((below + direction) * (heights[idx + 1] - heights[idx]) / above +
+            (above - direction) * (heights[idx] - heights[idx - 1]) / below);
+}
+
+double P2Quantile::linear(uint8_t idx, int direction) const
+{
+    return heights[idx] + direction * (heights[idx + direction] - heights[idx]) /
+           (positions[idx + direction] - positions[idx]);
+}
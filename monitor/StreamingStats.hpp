@@ -0,0 +1,222 @@
+/**************************************************
+ * StreamingStats.hpp - Constant-memory streaming estimators
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef STREAMINGSTATS_HPP
+#define STREAMINGSTATS_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * Exponentially weighted moving average. The first sample seeds the
+ * average.
+ */
+class Ewma
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit Ewma(double alphaParam);
+
+    void reset();
+    void add(double value);
+    double get() const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    double alpha;
+    double average;
+    bool seeded;
+};
+
+/**
+ * Mean and variance using Welford's online algorithm, which doesn't lose
+ * precision on long runs the way sum-of-squares does
+ */
+class RunningVariance
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RunningVariance();
+
+    void reset();
+    void add(double value);
+    uint64_t getCount() const;
+    double getMean() const;
+    double getVariance() const;
+    double getStandardDeviation() const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    uint64_t count;
+    double mean;
+    double sumSquaredDeviations;
+};
+
+/**
+ * Estimates a single quantile with the P-square algorithm (Jain and
+ * Chlamtac), which keeps five markers instead of the samples
+ */
+class P2Quantile
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit P2Quantile(double quantileParam);
+
+    void reset();
+    void add(double value);
+    double get() const;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint8_t MARKER_COUNT = 5;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    double parabolic(uint8_t idx, double direction) const;
+    double linear(uint8_t idx, int direction) const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    double quantile;
+    uint64_t count;
+    double heights[MARKER_COUNT];
+    double positions[MARKER_COUNT];
+    double desiredPositions[MARKER_COUNT];
+    double increments[MARKER_COUNT];
+};
+
+/**
+ * Minimum and maximum over the last WINDOW samples in amortized O(1) per
+ * sample, using a monotonic queue for each. Both queues live in fixed
+ * arrays, so nothing is allocated.
+ */
+template<typename T, uint16_t WINDOW>
+class SlidingMinMax
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    SlidingMinMax()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        sampleIdx = 0;
+        minQueue.clear();
+        maxQueue.clear();
+    }
+
+    void add(T value)
+    {
+        // Whatever the new sample pushes out of the window falls out the
+        // front first, which leaves room for it in a full queue
+        if (sampleIdx >= WINDOW)
+        {
+            minQueue.expire(sampleIdx + 1 - WINDOW);
+            maxQueue.expire(sampleIdx + 1 - WINDOW);
+        }
+
+        minQueue.push(sampleIdx, value, true);
+        maxQueue.push(sampleIdx, value, false);
+        ++sampleIdx;
+    }
+
+    bool isEmpty() const
+    {
+        return sampleIdx == 0;
+    }
+
+    T getMin() const
+    {
+        return minQueue.front();
+    }
+
+    T getMax() const
+    {
+        return maxQueue.front();
+    }
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+
+    // Indices increase from front to back; values are monotonic, so the
+    // front is always the extreme of the window
+    struct MonotonicQueue
+    {
+        uint64_t indices[WINDOW];
+        T values[WINDOW];
+        uint16_t head;
+        uint16_t size;
+
+        void clear()
+        {
+            head = 0;
+            size = 0;
+        }
+
+        void push(uint64_t idx, T value, bool keepMinimum)
+        {
+            while (size > 0)
+            {
+                T back = values[(head + size - 1) % WINDOW];
+                if ((keepMinimum && back < value) || (!keepMinimum && back > value))
+                {
+                    break;
+                }
+                --size;
+            }
+
+            uint16_t slot = static_cast<uint16_t>((head + size) % WINDOW);
+            indices[slot] = idx;
+            values[slot] = value;
+            ++size;
+        }
+
+        void expire(uint64_t oldestKept)
+        {
+            while (size > 0 && indices[head] < oldestKept)
+            {
+                head = static_cast<uint16_t>((head + 1) % WINDOW);
+                --size;
+            }
+        }
+
+        T front() const
+        {
+            return size > 0 ? values[head] : T();
+        }
+    };
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    uint64_t sampleIdx;
+    MonotonicQueue minQueue;
+    MonotonicQueue maxQueue;
+};
+
+#endif  // ifndef STREAMINGSTATS_HPP
@@ -0,0 +1,301 @@
+/**************************************************
+ * WatchlistMonitor.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BusTrace.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "StreamingStats.hpp"
+#include "Util.hpp"
+#include "WatchlistMonitor.hpp"
+
+namespace
+{
+    const uint32_t MICROS_IN_MILLIS = 1000;
+
+    // RDS sends about 11.4 groups a second
+    const uint32_t GROUP_PERIOD_MS = 88;
+
+    // Learned dwell is this much over the 90th percentile time to refresh,
+    // plus a group period
+    const double DWELL_MARGIN = 1.25;
+
+    // Group indices (see RdsDecoder::getGroupIndex()) of 0A and 0B
+    const uint8_t GROUP_0A = 0;
+    const uint8_t GROUP_0B = 1;
+}
+
+WatchlistMonitor::Station::Station(uint32_t frequencyKhzParam) :
+        frequencyKhz(frequencyKhzParam), rssi(0), fmTrue(false), decoder(), piCodeKnown(false), piCode(0),
+        rdsAbsent(false), visitsWithoutRds(0), visits(0), refreshes(0), dwellBudgetMs(DEFAULT_DWELL_MS),
+        timeToRefreshMs(0.9), visitMs(), refreshIntervalMs(), maxRefreshIntervalUs(0), lastVisitUs(0),
+        lastRefreshUs(0)
+{
+}
+
+WatchlistMonitor::WatchlistMonitor(RDA5807M& tunerParam) : tuner(tunerParam)
+{
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Adds a station to the end of the watchlist. Returns false if it is
+ * already on it, off the current band's raster, or the list is full.
+ */
+bool WatchlistMonitor::addStation(uint32_t frequencyKhz)
+{
+    if (stations.size() >= MAX_STATIONS || !tuner.getChannelPlanner().isOnRaster(frequencyKhz))
+    {
+        return false;
+    }
+
+    for (const Station& station : stations)
+    {
+        if (station.frequencyKhz == frequencyKhz)
+        {
+            return false;
+        }
+    }
+
+    stations.emplace_back(frequencyKhz);
+    return true;
+}
+
+void WatchlistMonitor::clear()
+{
+    stations.clear();
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Visits stations for durationMs, finishing the visit in progress when it
+ * runs out, and returns the number of visits. Leaves the tuner on the
+ * last station visited.
+ */
+uint32_t WatchlistMonitor::run(uint32_t durationMs)
+{
+    if (stations.empty())
+    {
+        return 0;
+    }
+
+    // Refresh intervals only count time spent monitoring
+    for (Station& station : stations)
+    {
+        station.lastRefreshUs = 0;
+    }
+
+    uint32_t visits = 0;
+    uint64_t startUs = Util::getMonotonicTimeUs();
+    uint64_t endUs = startUs + static_cast<uint64_t>(durationMs) * MICROS_IN_MILLIS;
+    while (Util::getMonotonicTimeUs() < endUs)
+    {
+        visit(nextStation());
+        ++visits;
+    }
+
+    stats.wallTimeUs += Util::getMonotonicTimeUs() - startUs;
+    return visits;
+}
+
+const std::vector<WatchlistMonitor::Station>& WatchlistMonitor::getStations() const
+{
+    return stations;
+}
+
+const WatchlistMonitor::Stats& WatchlistMonitor::getStats() const
+{
+    return stats;
+}
+
+/**
+ * The sum of every station's mean visit, or the longest a first visit
+ * can take for stations not visited yet
+ */
+uint64_t WatchlistMonitor::getExpectedCycleUs() const
+{
+    uint64_t cycleUs = 0;
+    for (const Station& station : stations)
+    {
+        if (station.visitMs.getCount() > 0)
+        {
+            cycleUs += static_cast<uint64_t>(station.visitMs.getMean() * MICROS_IN_MILLIS);
+        }
+        else
+        {
+            cycleUs += static_cast<uint64_t>(TUNE_TIMEOUT_MS + station.dwellBudgetMs) * MICROS_IN_MILLIS;
+        }
+    }
+    return cycleUs;
+}
+
+/**
+ * The station visited longest ago, or never, first in list order
+ */
+WatchlistMonitor::Station& WatchlistMonitor::nextStation()
+{
+    return *std::min_element(stations.begin(), stations.end(),
+                             [](const Station& left, const Station& right)
+                             {
+                                 return left.lastVisitUs < right.lastVisitUs;
+                             });
+}
+
+/**
+ * Tunes to station, takes its RSSI and, if it may have RDS, reads groups
+ * until it is refreshed or its dwell budget is spent
+ */
+void WatchlistMonitor::visit(Station& station)
+{
+    uint64_t startUs = Util::getMonotonicTimeUs();
+
+    tuner.setFrequencyKhz(station.frequencyKhz, false);
+    tuner.setTune(true);
+    for (uint32_t waited = 0; waited < TUNE_TIMEOUT_MS && !tuner.isStcComplete(); waited += POLL_INTERVAL_MS)
+    {
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        usleep(POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+    }
+
+    station.rssi = tuner.getRssi();
+    station.fmTrue = tuner.isFmTrue();
+    uint64_t tunedUs = Util::getMonotonicTimeUs();
+    stats.tuneTimeUs += tunedUs - startUs;
+    ++station.visits;
+    ++stats.visits;
+
+    // Nothing on air, or nothing but the RSSI to refresh, is fresh as soon
+    // as it is tuned
+    bool fullVisit = station.fmTrue && (!station.rdsAbsent || station.visits % NO_RDS_RECHECK_VISITS == 0);
+    bool refreshed = !fullVisit || readStation(station, tunedUs);
+
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    station.visitMs.add(static_cast<double>(nowUs - startUs) / MICROS_IN_MILLIS);
+    station.lastVisitUs = nowUs;
+
+    if (refreshed)
+    {
+        if (station.lastRefreshUs != 0)
+        {
+            uint64_t intervalUs = nowUs - station.lastRefreshUs;
+            station.refreshIntervalMs.add(static_cast<double>(intervalUs) / MICROS_IN_MILLIS);
+            station.maxRefreshIntervalUs = std::max(station.maxRefreshIntervalUs, intervalUs);
+        }
+        station.lastRefreshUs = nowUs;
+        ++station.refreshes;
+        ++stats.refreshes;
+    }
+}
+
+/**
+ * Reads groups from tunedUs on, for at most the station's dwell budget,
+ * and returns true, having learned how long it took, once a trusted PI,
+ * a type 0 group and every PS segment have arrived
+ */
+bool WatchlistMonitor::readStation(Station& station, uint64_t tunedUs)
+{
+    // Restart RDS so nothing from the previous station is read
+    tuner.setRdsMode(false);
+    tuner.setRdsMode(true);
+
+    bool piCodeRead = false;
+    bool basicTuningRead = false;
+    uint8_t psSegments = 0;
+    uint32_t groupsRead = 0;
+
+    uint64_t deadlineUs = tunedUs + static_cast<uint64_t>(station.dwellBudgetMs) * MICROS_IN_MILLIS;
+    uint64_t nowUs = tunedUs;
+    while (nowUs < deadlineUs)
+    {
+        RDA5807M::RdsGroup group;
+        if (!tuner.readRdsGroup(group))
+        {
+            {
+                BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+                usleep(POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+            }
+            nowUs = Util::getMonotonicTimeUs();
+            continue;
+        }
+        ++groupsRead;
+
+        if (RdsDecoder::isBlockTrusted(group.errorsA))
+        {
+            // Another station has taken the frequency over
+            if (station.piCodeKnown && group.blocks[0] != station.piCode)
+            {
+                station.decoder.reset();
+            }
+            station.piCodeKnown = true;
+            station.piCode = group.blocks[0];
+            piCodeRead = true;
+        }
+
+        if (station.decoder.processGroup(group))
+        {
+            uint8_t groupIndex = RdsDecoder::getGroupIndex(group.blocks[1]);
+            if (groupIndex == GROUP_0A || groupIndex == GROUP_0B)
+            {
+                basicTuningRead = true;
+                psSegments |= static_cast<uint8_t>(1 << Util::valueFromReg(group.blocks[1], PS_SEGMENT_ADDRESS));
+            }
+        }
+
+        nowUs = Util::getMonotonicTimeUs();
+        if (piCodeRead && basicTuningRead && psSegments == PS_SEGMENTS_ALL)
+        {
+            ++stats.earlyExits;
+            station.rdsAbsent = false;
+            station.visitsWithoutRds = 0;
+            learnDwell(station, true, nowUs - tunedUs);
+            return true;
+        }
+    }
+
+    if (groupsRead > 0)
+    {
+        station.rdsAbsent = false;
+        station.visitsWithoutRds = 0;
+        learnDwell(station, false, 0);
+        return false;
+    }
+
+    // A silent station's budget says nothing about its RDS
+    if (station.visitsWithoutRds < NO_RDS_VISITS)
+    {
+        ++station.visitsWithoutRds;
+    }
+    station.rdsAbsent = (station.visitsWithoutRds >= NO_RDS_VISITS);
+    return station.rdsAbsent;
+}
+
+/**
+ * Sets the dwell budget from the times of the refreshes so far, or raises
+ * it by half after a visit that ran out of time
+ */
+void WatchlistMonitor::learnDwell(Station& station, bool refreshed, uint64_t timeToRefreshUs)
+{
+    uint32_t budgetMs = station.dwellBudgetMs;
+    if (refreshed)
+    {
+        station.timeToRefreshMs.add(static_cast<double>(timeToRefreshUs) / MICROS_IN_MILLIS);
+        budgetMs = static_cast<uint32_t>(station.timeToRefreshMs.get() * DWELL_MARGIN) + GROUP_PERIOD_MS;
+    }
+    else
+    {
+        budgetMs += budgetMs / 2;
+    }
+
+    station.dwellBudgetMs = std::min(std::max(budgetMs, static_cast<uint32_t>(MIN_DWELL_MS)),
+                                     static_cast<uint32_t>(MAX_DWELL_MS));
+}
@@ -0,0 +1,150 @@
+/**************************************************
+ * WatchlistMonitor.hpp - Keeps several stations fresh with one tuner
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef WATCHLISTMONITOR_HPP
+#define WATCHLISTMONITOR_HPP
+
+// System includes
+#include <cstdint>
+#include <vector>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "StreamingStats.hpp"
+
+/**
+ * Time-slices one tuner across a watchlist of stations, visiting the one
+ * visited longest ago next, so every station is refreshed once per
+ * cycle.
+ *
+ * A visit tunes, polls STC rather than waiting a fixed settle time, and
+ * takes the RSSI. It then reads groups until it has what a refresh
+ * needs: a trusted PI, PTY/TP/TA from a type 0 group and all four PS
+ * segments. It leaves as soon as they are in, or when the station's
+ * dwell budget runs out. RadioText is too long to wait for on every
+ * visit (16 segments), so it builds up from whatever type 2 groups
+ * arrive meanwhile, over as many visits as it takes.
+ *
+ * Each station's dwell budget is learned from how long its completed
+ * visits took (the 90th percentile plus a margin), and raised after a
+ * visit that ran out of time. A station that shows no RDS on several
+ * visits in a row is only tuned for its RSSI, with an occasional full
+ * visit in case RDS comes back. That keeps the cycle, and so the refresh
+ * interval of every station, as short as the watchlist allows.
+ */
+class WatchlistMonitor
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t MAX_STATIONS = 16;
+
+    // Longest wait for STC after starting a tune
+    static const uint32_t TUNE_TIMEOUT_MS = 100;
+
+    // Dwell budget before anything is learned, and its bounds
+    static const uint32_t DEFAULT_DWELL_MS = 1500;
+    static const uint32_t MIN_DWELL_MS = 150;
+    static const uint32_t MAX_DWELL_MS = 4000;
+
+    // Full visits without a single group before a station is taken as
+    // having no RDS, and visits between full visits after that
+    static const uint8_t NO_RDS_VISITS = 3;
+    static const uint8_t NO_RDS_RECHECK_VISITS = 10;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Station
+    {
+        explicit Station(uint32_t frequencyKhzParam);
+
+        uint32_t frequencyKhz;
+
+        // As of the latest visit
+        uint8_t rssi;
+        bool fmTrue;
+
+        // PTY, TP/TA, PS and RadioText gathered over all visits
+        RdsDecoder decoder;
+        bool piCodeKnown;
+        uint16_t piCode;
+        bool rdsAbsent;
+        uint8_t visitsWithoutRds;
+
+        uint32_t visits;
+        uint32_t refreshes;
+        uint32_t dwellBudgetMs;
+
+        // Time from the end of the tune to a complete refresh
+        P2Quantile timeToRefreshMs;
+
+        // Time on the station per visit, tune included
+        RunningVariance visitMs;
+
+        // Between consecutive refreshes in the same run
+        RunningVariance refreshIntervalMs;
+        uint64_t maxRefreshIntervalUs;
+
+        uint64_t lastVisitUs;
+        uint64_t lastRefreshUs;
+    };
+
+    struct Stats
+    {
+        uint64_t wallTimeUs;
+        uint32_t visits;
+        uint32_t refreshes;
+
+        // Visits cut short because everything needed had arrived
+        uint32_t earlyExits;
+
+        uint64_t tuneTimeUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit WatchlistMonitor(RDA5807M& tunerParam);
+
+    bool addStation(uint32_t frequencyKhz);
+    void clear();
+
+    uint32_t run(uint32_t durationMs);
+
+    const std::vector<Station>& getStations() const;
+    const Stats& getStats() const;
+
+    // Time one cycle through the watchlist is expected to take
+    uint64_t getExpectedCycleUs() const;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint32_t POLL_INTERVAL_MS = 5;
+
+    // Every PS segment received
+    static const uint8_t PS_SEGMENTS_ALL = 0x0F;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    Station& nextStation();
+    void visit(Station& station);
+    bool readStation(Station& station, uint64_t tunedUs);
+    void learnDwell(Station& station, bool refreshed, uint64_t timeToRefreshUs);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& tuner;
+    std::vector<Station> stations;
+    Stats stats;
+};
+
+#endif  // ifndef WATCHLISTMONITOR_HPP
@@ -0,0 +1,92 @@
+/**************************************************
+ * WaterfallFormat.hpp - On-disk layout of waterfall (sweep history) files
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef WATERFALLFORMAT_HPP
+#define WATERFALLFORMAT_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * A waterfall file is a FileHeader followed by blocks of up to
+ * SWEEPS_PER_BLOCK sweeps. Each block is a BlockHeader and a payload:
+ *
+ *   timestamp deltas    (sweepCount - 1) x timestampDeltaBits, bit-packed
+ *   column offsets      uint32_t x channelCount, from the payload start
+ *   one column per channel:
+ *     uint8_t           RSSI of the first sweep
+ *     uint8_t           bits per RSSI delta
+ *     RSSI deltas       (sweepCount - 1) zigzag-encoded, bit-packed
+ *     FM_TRUE bitmap    one bit per sweep
+ *     RDS sync bitmap   one bit per sweep
+ *
+ * Every bit-packed run is padded to a whole byte. Storing the band
+ * column-wise keeps each channel's slowly changing RSSI together, so most
+ * deltas pack into a few bits, and lets a query decode only the channels
+ * it asks for.
+ *
+ * The time index lives in a sidecar file (path + INDEX_SUFFIX) holding one
+ * IndexEntry per block, in file order.
+ *
+ * All fields are host byte order. Bump FORMAT_VERSION whenever the layout
+ * changes.
+ */
+namespace WaterfallFormat
+{
+    static const uint32_t FILE_MAGIC = 0x46575244; // "RDWF"
+    static const uint32_t BLOCK_MAGIC = 0x4B4C4257; // "WBLK"
+    static const uint32_t FORMAT_VERSION = 1;
+
+    static const uint16_t SWEEPS_PER_BLOCK = 64;
+
+    // Widest bit-packed value. A block whose timestamps would span more
+    // than this many bits is ended early.
+    static const uint8_t MAX_DELTA_BITS = 32;
+
+    static const char* const INDEX_SUFFIX = ".idx";
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t formatVersion;
+        uint32_t bottomKhz;
+        uint32_t spacingKhz;
+        uint16_t channelCount;
+        uint16_t sweepsPerBlock;
+        uint32_t reserved;
+    };
+
+    struct BlockHeader
+    {
+        uint32_t magic;
+        uint16_t sweepCount;
+        uint16_t channelCount;
+        uint64_t firstTimestampUs;
+        uint64_t lastTimestampUs;
+        uint32_t payloadBytes;
+        uint8_t timestampDeltaBits;
+        uint8_t reserved[3];
+    };
+
+    struct IndexEntry
+    {
+        uint64_t firstTimestampUs;
+        uint64_t lastTimestampUs;
+        uint64_t blockOffset;
+    };
+
+    // One channel of one sweep
+    struct Cell
+    {
+        uint8_t rssi;
+        bool fmTrue;
+        bool rdsSynchronized;
+    };
+};
+
+#endif  // ifndef WATERFALLFORMAT_HPP
@@ -0,0 +1,324 @@
+/**************************************************
+ * WaterfallReader.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BitPacking.hpp"
+#include "WaterfallFormat.hpp"
+#include "WaterfallReader.hpp"
+
+namespace
+{
+    // Maps the whole of path read-only. Empty files map to nullptr.
+    bool mapFile(const std::string& path, const uint8_t*& mapping, size_t& size)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        size = static_cast<size_t>(info.st_size);
+        mapping = nullptr;
+        if (size > 0)
+        {
+            void* result = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (result == MAP_FAILED)
+            {
+                ::close(fd);
+                return false;
+            }
+            mapping = static_cast<const uint8_t*>(result);
+        }
+
+        ::close(fd);
+        return true;
+    }
+
+    // Where one channel's data sits in a block's payload
+    struct Column
+    {
+        uint8_t firstRssi;
+        uint8_t deltaBits;
+        const uint8_t* deltas;
+        const uint8_t* fmTrueBitmap;
+        const uint8_t* rdsBitmap;
+    };
+
+    // False if the channel's column, as its offset and delta width
+    // describe it, doesn't fit in the payload
+    bool locateColumn(const uint8_t* payload, const uint8_t* payloadEnd, const uint8_t* offsetTable,
+                      uint16_t channel, uint16_t sweepCount, Column& column)
+    {
+        uint32_t columnOffset;
+        std::memcpy(&columnOffset, offsetTable + channel * sizeof(uint32_t), sizeof(columnOffset));
+
+        size_t payloadBytes = static_cast<size_t>(payloadEnd - payload);
+        if (columnOffset > payloadBytes || payloadBytes - columnOffset < 2)
+        {
+            return false;
+        }
+
+        const uint8_t* start = payload + columnOffset;
+        column.firstRssi = start[0];
+        column.deltaBits = start[1];
+        if (column.deltaBits > WaterfallFormat::MAX_DELTA_BITS)
+        {
+            return false;
+        }
+
+        size_t deltaBytes = ((sweepCount - 1) * static_cast<size_t>(column.deltaBits) + 7) / 8;
+        size_t bitmapBytes = (sweepCount + 7) / 8;
+        if (2 + deltaBytes + 2 * bitmapBytes > payloadBytes - columnOffset)
+        {
+            return false;
+        }
+
+        column.deltas = start + 2;
+        column.fmTrueBitmap = column.deltas + deltaBytes;
+        column.rdsBitmap = column.fmTrueBitmap + bitmapBytes;
+        return true;
+    }
+}
+
+WaterfallReader::WaterfallReader() :
+        data(nullptr), dataSize(0), index(nullptr), indexSize(0), blockCount(0)
+{
+    std::memset(&header, 0, sizeof(header));
+}
+
+WaterfallReader::~WaterfallReader()
+{
+    close();
+}
+
+bool WaterfallReader::open(const std::string& path)
+{
+    close();
+
+    const uint8_t* indexMapping = nullptr;
+    if (!mapFile(path, data, dataSize) || !mapFile(path + WaterfallFormat::INDEX_SUFFIX, indexMapping, indexSize))
+    {
+        close();
+        return false;
+    }
+    index = reinterpret_cast<const WaterfallFormat::IndexEntry*>(indexMapping);
+
+    if (dataSize < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != WaterfallFormat::FILE_MAGIC || header.formatVersion != WaterfallFormat::FORMAT_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // Ignore index entries for blocks that didn't make it into the file
+    blockCount = indexSize / sizeof(WaterfallFormat::IndexEntry);
+    while (blockCount > 0 && index[blockCount - 1].blockOffset + sizeof(WaterfallFormat::BlockHeader) > dataSize)
+    {
+        --blockCount;
+    }
+
+    return true;
+}
+
+void WaterfallReader::close()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(data), dataSize);
+    }
+    if (index != nullptr)
+    {
+        munmap(const_cast<WaterfallFormat::IndexEntry*>(index), indexSize);
+    }
+
+    data = nullptr;
+    dataSize = 0;
+    index = nullptr;
+    indexSize = 0;
+    blockCount = 0;
+}
+
+bool WaterfallReader::isOpen() const
+{
+    return data != nullptr;
+}
+
+const WaterfallFormat::FileHeader& WaterfallReader::getHeader() const
+{
+    return header;
+}
+
+size_t WaterfallReader::getBlockCount() const
+{
+    return blockCount;
+}
+
+uint64_t WaterfallReader::getFirstTimestampUs() const
+{
+    return blockCount > 0 ? index[0].firstTimestampUs : 0;
+}
+
+uint64_t WaterfallReader::getLastTimestampUs() const
+{
+    return blockCount > 0 ? index[blockCount - 1].lastTimestampUs : 0;
+}
+
+/**
+ * Appends every sweep in [startUs, endUs] to timestamps and, for each, the
+ * cells of channels firstChannel through lastChannel to cells (sweep-major).
+ * Returns the number of sweeps found.
+ */
+size_t WaterfallReader::query(const Query& query, std::vector<uint64_t>& timestamps,
+                              std::vector<WaterfallFormat::Cell>& cells) const
+{
+    if (!isOpen() || query.firstChannel > query.lastChannel || query.lastChannel >= header.channelCount ||
+        query.startUs > query.endUs)
+    {
+        return 0;
+    }
+
+    size_t sweepsBefore = timestamps.size();
+
+    // First block that ends at or after the start of the range
+    size_t low = 0;
+    size_t high = blockCount;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (index[mid].lastTimestampUs < query.startUs)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    for (size_t blockIdx = low; blockIdx < blockCount && index[blockIdx].firstTimestampUs <= query.endUs; ++blockIdx)
+    {
+        decodeBlock(blockIdx, query, timestamps, cells);
+    }
+
+    return timestamps.size() - sweepsBefore;
+}
+
+/**
+ * Decodes the sweeps of one block that fall in the query's range. The file
+ * is not trusted: a block whose counts, widths or offsets would take the
+ * decoding outside its payload is skipped whole.
+ */
+void WaterfallReader::decodeBlock(size_t blockIdx, const Query& query, std::vector<uint64_t>& timestamps,
+                                  std::vector<WaterfallFormat::Cell>& cells) const
+{
+    uint64_t blockOffset = index[blockIdx].blockOffset;
+    if (blockOffset > dataSize || dataSize - blockOffset < sizeof(WaterfallFormat::BlockHeader))
+    {
+        return;
+    }
+
+    WaterfallFormat::BlockHeader block;
+    std::memcpy(&block, data + blockOffset, sizeof(block));
+    if (block.magic != WaterfallFormat::BLOCK_MAGIC || block.channelCount != header.channelCount ||
+        block.payloadBytes > dataSize - blockOffset - sizeof(block) || block.sweepCount == 0 ||
+        block.sweepCount > WaterfallFormat::SWEEPS_PER_BLOCK ||
+        block.timestampDeltaBits > WaterfallFormat::MAX_DELTA_BITS)
+    {
+        return;
+    }
+
+    const uint8_t* payload = data + blockOffset + sizeof(block);
+    const uint8_t* payloadEnd = payload + block.payloadBytes;
+
+    // Work out which sweeps of the block fall in the time range
+    uint64_t sweepTimestamps[WaterfallFormat::SWEEPS_PER_BLOCK];
+    BitPacking::Reader timestampReader{payload, payloadEnd};
+    sweepTimestamps[0] = block.firstTimestampUs;
+    for (uint16_t sweepIdx = 1; sweepIdx < block.sweepCount; ++sweepIdx)
+    {
+        sweepTimestamps[sweepIdx] = sweepTimestamps[sweepIdx - 1] + timestampReader.read(block.timestampDeltaBits);
+    }
+    const uint8_t* offsetTable = timestampReader.alignedPosition();
+    if (static_cast<size_t>(payloadEnd - offsetTable) < header.channelCount * sizeof(uint32_t))
+    {
+        return;
+    }
+
+    uint16_t firstSweep = 0;
+    while (firstSweep < block.sweepCount && sweepTimestamps[firstSweep] < query.startUs)
+    {
+        ++firstSweep;
+    }
+    uint16_t endSweep = firstSweep;
+    while (endSweep < block.sweepCount && sweepTimestamps[endSweep] <= query.endUs)
+    {
+        ++endSweep;
+    }
+    if (firstSweep == endSweep)
+    {
+        return;
+    }
+
+    // Check every column asked for before anything is added to the output
+    Column column = {};
+    for (uint16_t channel = query.firstChannel; channel <= query.lastChannel; ++channel)
+    {
+        if (!locateColumn(payload, payloadEnd, offsetTable, channel, block.sweepCount, column))
+        {
+            return;
+        }
+    }
+
+    const size_t width = query.lastChannel - query.firstChannel + 1;
+    const size_t rowBase = cells.size();
+    timestamps.insert(timestamps.end(), sweepTimestamps + firstSweep, sweepTimestamps + endSweep);
+    cells.resize(rowBase + (endSweep - firstSweep) * width);
+
+    for (uint16_t channel = query.firstChannel; channel <= query.lastChannel; ++channel)
+    {
+        locateColumn(payload, payloadEnd, offsetTable, channel, block.sweepCount, column);
+        uint8_t rssi = column.firstRssi;
+        BitPacking::Reader deltaReader{column.deltas, payloadEnd};
+
+        // Deltas have to be walked from the start of the block
+        for (uint16_t sweepIdx = 0; sweepIdx < endSweep; ++sweepIdx)
+        {
+            if (sweepIdx > 0)
+            {
+                rssi = static_cast<uint8_t>(rssi + BitPacking::zigzagDecode(static_cast<uint32_t>(deltaReader.read(column.deltaBits))));
+            }
+
+            if (sweepIdx >= firstSweep)
+            {
+                WaterfallFormat::Cell& cell = cells[rowBase + (sweepIdx - firstSweep) * width + (channel - query.firstChannel)];
+                cell.rssi = rssi;
+                cell.fmTrue = (column.fmTrueBitmap[sweepIdx / 8] >> (sweepIdx % 8)) & 1;
+                cell.rdsSynchronized = (column.rdsBitmap[sweepIdx / 8] >> (sweepIdx % 8)) & 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/**************************************************
+ * WaterfallReader.hpp - Range queries over a waterfall file
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef WATERFALLREADER_HPP
+#define WATERFALLREADER_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "WaterfallFormat.hpp"
+
+/**
+ * Maps a waterfall file and its index read-only. A query binary searches
+ * the index for the blocks overlapping its time range and decodes only
+ * the columns of the requested channels. Blocks appended after open()
+ * aren't seen until the file is reopened.
+ */
+class WaterfallReader
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+
+    // Channels are CHAN values; both ranges are inclusive
+    struct Query
+    {
+        uint16_t firstChannel;
+        uint16_t lastChannel;
+        uint64_t startUs;
+        uint64_t endUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    WaterfallReader();
+    ~WaterfallReader();
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const;
+
+    const WaterfallFormat::FileHeader& getHeader() const;
+
+    size_t getBlockCount() const;
+
+    uint64_t getFirstTimestampUs() const;
+
+    uint64_t getLastTimestampUs() const;
+
+    size_t query(const Query& query, std::vector<uint64_t>& timestamps,
+                 std::vector<WaterfallFormat::Cell>& cells) const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void decodeBlock(size_t blockIdx, const Query& query, std::vector<uint64_t>& timestamps,
+                     std::vector<WaterfallFormat::Cell>& cells) const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const uint8_t* data;
+    size_t dataSize;
+    const WaterfallFormat::IndexEntry* index;
+    size_t indexSize;
+    size_t blockCount;
+    WaterfallFormat::FileHeader header;
+};
+
+#endif  // ifndef WATERFALLREADER_HPP
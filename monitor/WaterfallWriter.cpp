@@ -0,0 +1,337 @@
+/**************************************************
+ * WaterfallWriter.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BitPacking.hpp"
+#include "WaterfallFormat.hpp"
+#include "WaterfallWriter.hpp"
+
+namespace
+{
+    bool writeFully(int fd, const void* data, size_t length)
+    {
+        const uint8_t* current = static_cast<const uint8_t*>(data);
+        while (length > 0)
+        {
+            ssize_t written = ::write(fd, current, length);
+            if (written <= 0)
+            {
+                return false;
+            }
+            current += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+WaterfallWriter::WaterfallWriter() : dataFd(-1), indexFd(-1), fileSize(0), pendingSweeps(0)
+{
+    std::memset(&header, 0, sizeof(header));
+}
+
+WaterfallWriter::~WaterfallWriter()
+{
+    close();
+}
+
+/**
+ * Opens path for appending, creating it (and its index) if needed. A file
+ * holding sweeps of another channel plan or format version is left as it
+ * is and PLAN_MISMATCH returned; the caller has to move it aside.
+ */
+WaterfallWriter::OpenResult WaterfallWriter::open(const std::string& path, uint32_t bottomKhz, uint32_t spacingKhz,
+                                                  uint16_t channelCount)
+{
+    close();
+
+    if (channelCount == 0)
+    {
+        return OpenResult::FAILED;
+    }
+
+    // The files live in a world-writable directory; don't follow a link
+    // someone else put there
+    dataFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    indexFd = ::open((path + WaterfallFormat::INDEX_SUFFIX).c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                     0644);
+    struct stat dataInfo;
+    if (dataFd < 0 || indexFd < 0 || fstat(dataFd, &dataInfo) != 0)
+    {
+        close();
+        return OpenResult::FAILED;
+    }
+
+    if (dataInfo.st_size == 0)
+    {
+        header.magic = WaterfallFormat::FILE_MAGIC;
+        header.formatVersion = WaterfallFormat::FORMAT_VERSION;
+        header.bottomKhz = bottomKhz;
+        header.spacingKhz = spacingKhz;
+        header.channelCount = channelCount;
+        header.sweepsPerBlock = WaterfallFormat::SWEEPS_PER_BLOCK;
+        header.reserved = 0;
+
+        // An index without data can only be left over from a file that
+        // was since removed
+        if (ftruncate(indexFd, 0) != 0 || !writeFully(dataFd, &header, sizeof(header)))
+        {
+            close();
+            return OpenResult::FAILED;
+        }
+        fileSize = sizeof(header);
+    }
+    else
+    {
+        WaterfallFormat::FileHeader existing;
+        if (pread(dataFd, &existing, sizeof(existing), 0) != sizeof(existing) ||
+            existing.magic != WaterfallFormat::FILE_MAGIC)
+        {
+            close();
+            return OpenResult::FAILED;
+        }
+
+        if (existing.formatVersion != WaterfallFormat::FORMAT_VERSION || existing.bottomKhz != bottomKhz ||
+            existing.spacingKhz != spacingKhz || existing.channelCount != channelCount ||
+            existing.sweepsPerBlock != WaterfallFormat::SWEEPS_PER_BLOCK)
+        {
+            close();
+            return OpenResult::PLAN_MISMATCH;
+        }
+
+        header = existing;
+        if (!recoverAppendPosition())
+        {
+            close();
+            return OpenResult::FAILED;
+        }
+    }
+
+    lseek(dataFd, static_cast<off_t>(fileSize), SEEK_SET);
+    lseek(indexFd, 0, SEEK_END);
+
+    pendingSweeps = 0;
+    pendingTimestamps.assign(WaterfallFormat::SWEEPS_PER_BLOCK, 0);
+    pendingCells.assign(static_cast<size_t>(WaterfallFormat::SWEEPS_PER_BLOCK) * channelCount,
+                        WaterfallFormat::Cell{0, false, false});
+    return OpenResult::OPENED;
+}
+
+/**
+ * Drops anything after the last indexed block, which can only be a block
+ * cut short by a crash, so new blocks follow the last complete one.
+ */
+bool WaterfallWriter::recoverAppendPosition()
+{
+    struct stat indexInfo;
+    if (fstat(indexFd, &indexInfo) != 0)
+    {
+        return false;
+    }
+
+    uint64_t entryCount = static_cast<uint64_t>(indexInfo.st_size) / sizeof(WaterfallFormat::IndexEntry);
+    if (ftruncate(indexFd, static_cast<off_t>(entryCount * sizeof(WaterfallFormat::IndexEntry))) != 0)
+    {
+        return false;
+    }
+
+    fileSize = sizeof(WaterfallFormat::FileHeader);
+    if (entryCount > 0)
+    {
+        WaterfallFormat::IndexEntry last;
+        WaterfallFormat::BlockHeader lastBlock;
+        off_t lastEntryOffset = static_cast<off_t>((entryCount - 1) * sizeof(WaterfallFormat::IndexEntry));
+        if (pread(indexFd, &last, sizeof(last), lastEntryOffset) != sizeof(last) ||
+            pread(dataFd, &lastBlock, sizeof(lastBlock), static_cast<off_t>(last.blockOffset)) != sizeof(lastBlock) ||
+            lastBlock.magic != WaterfallFormat::BLOCK_MAGIC)
+        {
+            return false;
+        }
+        fileSize = last.blockOffset + sizeof(lastBlock) + lastBlock.payloadBytes;
+    }
+
+    return ftruncate(dataFd, static_cast<off_t>(fileSize)) == 0;
+}
+
+/**
+ * Writes out any buffered sweeps and closes the file
+ */
+void WaterfallWriter::close()
+{
+    if (dataFd >= 0 && indexFd >= 0)
+    {
+        flush();
+    }
+
+    if (dataFd >= 0)
+    {
+        ::close(dataFd);
+        dataFd = -1;
+    }
+    if (indexFd >= 0)
+    {
+        ::close(indexFd);
+        indexFd = -1;
+    }
+}
+
+bool WaterfallWriter::isOpen() const
+{
+    return dataFd >= 0;
+}
+
+/**
+ * Adds one sweep of channelCount cells. Timestamps must not go backwards;
+ * one that does is clamped to the previous sweep's. A sweep too long after
+ * the first of the pending block starts a new one.
+ */
+bool WaterfallWriter::appendSweep(uint64_t timestampUs, const WaterfallFormat::Cell* cells)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (pendingSweeps > 0 && timestampUs < pendingTimestamps[pendingSweeps - 1])
+    {
+        timestampUs = pendingTimestamps[pendingSweeps - 1];
+    }
+
+    if (pendingSweeps > 0 &&
+        BitPacking::bitsNeeded(timestampUs - pendingTimestamps[0]) > WaterfallFormat::MAX_DELTA_BITS && !flush())
+    {
+        return false;
+    }
+
+    pendingTimestamps[pendingSweeps] = timestampUs;
+    std::memcpy(&pendingCells[static_cast<size_t>(pendingSweeps) * header.channelCount], cells,
+                header.channelCount * sizeof(WaterfallFormat::Cell));
+    ++pendingSweeps;
+
+    if (pendingSweeps == header.sweepsPerBlock)
+    {
+        return flush();
+    }
+    return true;
+}
+
+/**
+ * Encodes the buffered sweeps as a (possibly short) block and writes it,
+ * followed by its index entry
+ */
+bool WaterfallWriter::flush()
+{
+    if (!isOpen() || pendingSweeps == 0)
+    {
+        return isOpen();
+    }
+
+    encodeBlock();
+
+    WaterfallFormat::BlockHeader block;
+    std::memset(&block, 0, sizeof(block));
+    block.magic = WaterfallFormat::BLOCK_MAGIC;
+    block.sweepCount = pendingSweeps;
+    block.channelCount = header.channelCount;
+    block.firstTimestampUs = pendingTimestamps[0];
+    block.lastTimestampUs = pendingTimestamps[pendingSweeps - 1];
+    block.payloadBytes = static_cast<uint32_t>(encodeBuffer.size());
+    block.timestampDeltaBits = BitPacking::bitsNeeded(block.lastTimestampUs - block.firstTimestampUs);
+
+    WaterfallFormat::IndexEntry entry;
+    entry.firstTimestampUs = block.firstTimestampUs;
+    entry.lastTimestampUs = block.lastTimestampUs;
+    entry.blockOffset = fileSize;
+
+    pendingSweeps = 0;
+
+    // The index entry goes last, so a block is only visible once complete
+    if (!writeFully(dataFd, &block, sizeof(block)) || !writeFully(dataFd, encodeBuffer.data(), encodeBuffer.size()) ||
+        !writeFully(indexFd, &entry, sizeof(entry)))
+    {
+        return false;
+    }
+
+    fileSize += sizeof(block) + encodeBuffer.size();
+    return true;
+}
+
+void WaterfallWriter::encodeBlock()
+{
+    const uint16_t sweeps = pendingSweeps;
+    const uint16_t channels = header.channelCount;
+    encodeBuffer.clear();
+
+    // Timestamps, relative to the first. Deltas are no wider than the span
+    // of the whole block, which is what the header records.
+    uint8_t timestampBits = BitPacking::bitsNeeded(pendingTimestamps[sweeps - 1] - pendingTimestamps[0]);
+    BitPacking::Writer timestampWriter{encodeBuffer};
+    for (uint16_t sweepIdx = 1; sweepIdx < sweeps; ++sweepIdx)
+    {
+        timestampWriter.write(pendingTimestamps[sweepIdx] - pendingTimestamps[sweepIdx - 1], timestampBits);
+    }
+    timestampWriter.flush();
+
+    // Filled in as each column is written
+    size_t offsetTableStart = encodeBuffer.size();
+    encodeBuffer.resize(offsetTableStart + channels * sizeof(uint32_t));
+
+    for (uint16_t channel = 0; channel < channels; ++channel)
+    {
+        uint32_t columnOffset = static_cast<uint32_t>(encodeBuffer.size());
+        std::memcpy(&encodeBuffer[offsetTableStart + channel * sizeof(uint32_t)], &columnOffset, sizeof(columnOffset));
+
+        const WaterfallFormat::Cell* column = &pendingCells[channel];
+        uint8_t firstRssi = column[0].rssi;
+
+        uint32_t widest = 0;
+        for (uint16_t sweepIdx = 1; sweepIdx < sweeps; ++sweepIdx)
+        {
+            int32_t delta = column[sweepIdx * channels].rssi - column[(sweepIdx - 1) * channels].rssi;
+            widest |= BitPacking::zigzagEncode(delta);
+        }
+        uint8_t deltaBits = BitPacking::bitsNeeded(widest);
+
+        encodeBuffer.push_back(firstRssi);
+        encodeBuffer.push_back(deltaBits);
+
+        BitPacking::Writer columnWriter{encodeBuffer};
+        for (uint16_t sweepIdx = 1; sweepIdx < sweeps; ++sweepIdx)
+        {
+            int32_t delta = column[sweepIdx * channels].rssi - column[(sweepIdx - 1) * channels].rssi;
+            columnWriter.write(BitPacking::zigzagEncode(delta), deltaBits);
+        }
+        columnWriter.flush();
+
+        for (uint16_t sweepIdx = 0; sweepIdx < sweeps; ++sweepIdx)
+        {
+            columnWriter.write(column[sweepIdx * channels].fmTrue ? 1 : 0, 1);
+        }
+        columnWriter.flush();
+
+        for (uint16_t sweepIdx = 0; sweepIdx < sweeps; ++sweepIdx)
+        {
+            columnWriter.write(column[sweepIdx * channels].rdsSynchronized ? 1 : 0, 1);
+        }
+        columnWriter.flush();
+    }
+}
+
+/**
+ * Bytes on disk, not counting sweeps that haven't been flushed
+ */
+uint64_t WaterfallWriter::getFileSize() const
+{
+    return fileSize;
+}
@@ -0,0 +1,75 @@
+/**************************************************
+ * WaterfallWriter.hpp - Appends sweeps to a waterfall file
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef WATERFALLWRITER_HPP
+#define WATERFALLWRITER_HPP
+
+// System includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "WaterfallFormat.hpp"
+
+/**
+ * Buffers sweeps in memory and encodes them a block at a time (see
+ * WaterfallFormat.hpp). Opening an existing file with the same channel
+ * plan appends to it; a file with a different plan is refused, never
+ * overwritten.
+ */
+class WaterfallWriter
+{
+public:
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+
+    // PLAN_MISMATCH: the file holds sweeps of another channel plan
+    enum class OpenResult {OPENED = 0, PLAN_MISMATCH = 1, FAILED = 2};
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    WaterfallWriter();
+    ~WaterfallWriter();
+
+    OpenResult open(const std::string& path, uint32_t bottomKhz, uint32_t spacingKhz, uint16_t channelCount);
+
+    void close();
+
+    bool isOpen() const;
+
+    bool appendSweep(uint64_t timestampUs, const WaterfallFormat::Cell* cells);
+
+    bool flush();
+
+    uint64_t getFileSize() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    bool recoverAppendPosition();
+    void encodeBlock();
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    int dataFd;
+    int indexFd;
+    WaterfallFormat::FileHeader header;
+    uint64_t fileSize;
+
+    // Sweeps not yet written; pendingCells is sweep-major
+    uint16_t pendingSweeps;
+    std::vector<uint64_t> pendingTimestamps;
+    std::vector<WaterfallFormat::Cell> pendingCells;
+
+    // Reused between blocks
+    std::vector<uint8_t> encodeBuffer;
+};
+
+#endif  // ifndef WATERFALLWRITER_HPP
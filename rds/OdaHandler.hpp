@@ -0,0 +1,41 @@
+/**************************************************
+ * OdaHandler.hpp - Interface for Open Data Application decoders
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef ODAHANDLER_HPP
+#define ODAHANDLER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+
+/**
+ * Decodes one Open Data Application. Handlers are registered with an
+ * OdaRegistry under their AID and only see groups once the station has
+ * announced which group type carries the application.
+ */
+class OdaHandler
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    virtual ~OdaHandler() {};
+
+    // Called for every 3A group announcing this handler's AID, with the
+    // application's message from block C
+    virtual void processAnnouncement(uint16_t message) = 0;
+
+    // Called for every group of the announced type. decoder has already
+    // processed the group, so its RadioText etc. are up to date.
+    virtual void processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder) = 0;
+
+    // Forgets everything decoded so far, after a retune
+    virtual void reset() = 0;
+};
+
+#endif  // ifndef ODAHANDLER_HPP
@@ -0,0 +1,213 @@
+/**************************************************
+ * OdaRegistry.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "OdaHandler.hpp"
+#include "OdaRegistry.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+
+namespace
+{
+    const uint8_t ANNOUNCEMENT_GROUP_INDEX = 6; // 3A
+
+    // Application group type code in 3A block B, in group index form
+    const uint16_t APPLICATION_GROUP_MASK = 0x001F;
+
+    // "Temporary data fault" (15B in the application group type code)
+    const uint8_t DATA_FAULT_GROUP_INDEX = 31;
+
+    // Group types that may carry an ODA (IEC 62106 table 6): 3B, 4B, 5A-9B,
+    // 10B and 11A-13B. Nothing can take over the groups RdsDecoder uses.
+    const uint32_t ODA_CAPABLE_GROUPS = 0x0FEFFE80;
+
+    const char* const GROUP_NAMES[RdsDecoder::GROUP_TYPE_COUNT] =
+    {
+        "0A", "0B", "1A", "1B", "2A", "2B", "3A", "3B", "4A", "4B", "5A", "5B", "6A", "6B", "7A", "7B",
+        "8A", "8B", "9A", "9B", "10A", "10B", "11A", "11B", "12A", "12B", "13A", "13B", "14A", "14B", "15A", "15B"
+    };
+}
+
+OdaRegistry::OdaRegistry() : announcementHandler(*this), registrationCount(0)
+{
+    std::memset(registrations, 0, sizeof(registrations));
+    reset();
+}
+
+bool OdaRegistry::registerHandler(uint16_t aid, OdaHandler& handler)
+{
+    if (registrationCount >= MAX_HANDLERS || findHandler(aid) != nullptr)
+    {
+        return false;
+    }
+
+    registrations[registrationCount].aid = aid;
+    registrations[registrationCount].handler = &handler;
+    ++registrationCount;
+
+    // The station may already have announced it
+    for (uint8_t appIdx = 0; appIdx < applicationCount; ++appIdx)
+    {
+        Application& application = applications[appIdx];
+        if (application.aid == aid)
+        {
+            application.handled = true;
+            if (application.groupIndex != NO_CARRIER_GROUP)
+            {
+                dispatch[application.groupIndex] = &handler;
+            }
+        }
+    }
+    return true;
+}
+
+void OdaRegistry::reset()
+{
+    std::memset(applications, 0, sizeof(applications));
+    applicationCount = 0;
+    std::memset(groupsDispatched, 0, sizeof(groupsDispatched));
+
+    for (uint8_t groupIdx = 0; groupIdx < RdsDecoder::GROUP_TYPE_COUNT; ++groupIdx)
+    {
+        dispatch[groupIdx] = nullptr;
+    }
+    dispatch[ANNOUNCEMENT_GROUP_INDEX] = &announcementHandler;
+
+    for (uint8_t regIdx = 0; regIdx < registrationCount; ++regIdx)
+    {
+        registrations[regIdx].handler->reset();
+    }
+}
+
+/**
+ * Should be given every group after decoder has processed it
+ */
+void OdaRegistry::processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder)
+{
+    if (!RdsDecoder::isBlockTrusted(group.errorsB))
+    {
+        return;
+    }
+
+    uint8_t groupIndex = RdsDecoder::getGroupIndex(group.blocks[1]);
+    OdaHandler* handler = dispatch[groupIndex];
+    if (handler != nullptr)
+    {
+        ++groupsDispatched[groupIndex];
+        handler->processGroup(group, decoder);
+    }
+}
+
+uint8_t OdaRegistry::getApplicationCount() const
+{
+    return applicationCount;
+}
+
+const OdaRegistry::Application* OdaRegistry::getApplications() const
+{
+    return applications;
+}
+
+uint32_t OdaRegistry::getGroupsDispatched(uint8_t groupIndex) const
+{
+    return (groupIndex < RdsDecoder::GROUP_TYPE_COUNT) ? groupsDispatched[groupIndex] : 0;
+}
+
+const char* OdaRegistry::groupIndexToString(uint8_t groupIndex)
+{
+    return (groupIndex < RdsDecoder::GROUP_TYPE_COUNT) ? GROUP_NAMES[groupIndex] : "-";
+}
+
+/**
+ * Records which group type carries aid and, if it has a handler, points
+ * that type's dispatch entry at it. A station moving an application to
+ * another group type frees the old entry.
+ */
+void OdaRegistry::processAnnouncement(uint16_t blockB, uint16_t message, uint16_t aid)
+{
+    uint8_t groupIndex = static_cast<uint8_t>(blockB & APPLICATION_GROUP_MASK);
+    if (groupIndex == DATA_FAULT_GROUP_INDEX)
+    {
+        return;
+    }
+
+    if (groupIndex == 0 || ((ODA_CAPABLE_GROUPS >> groupIndex) & 0x1) == 0)
+    {
+        groupIndex = NO_CARRIER_GROUP;
+    }
+
+    Application* application = nullptr;
+    for (uint8_t appIdx = 0; appIdx < applicationCount; ++appIdx)
+    {
+        if (applications[appIdx].aid == aid)
+        {
+            application = &applications[appIdx];
+            break;
+        }
+    }
+
+    OdaHandler* handler = findHandler(aid);
+    if (application == nullptr)
+    {
+        if (applicationCount >= MAX_APPLICATIONS)
+        {
+            return;
+        }
+        application = &applications[applicationCount++];
+        application->aid = aid;
+        application->groupIndex = NO_CARRIER_GROUP;
+        application->handled = (handler != nullptr);
+    }
+
+    ++application->announcements;
+    if (application->groupIndex != groupIndex)
+    {
+        if (application->groupIndex != NO_CARRIER_GROUP && dispatch[application->groupIndex] == handler)
+        {
+            dispatch[application->groupIndex] = nullptr;
+        }
+        application->groupIndex = groupIndex;
+        if (handler != nullptr && groupIndex != NO_CARRIER_GROUP)
+        {
+            dispatch[groupIndex] = handler;
+        }
+    }
+
+    if (handler != nullptr)
+    {
+        handler->processAnnouncement(message);
+    }
+}
+
+OdaHandler* OdaRegistry::findHandler(uint16_t aid) const
+{
+    for (uint8_t regIdx = 0; regIdx < registrationCount; ++regIdx)
+    {
+        if (registrations[regIdx].aid == aid)
+        {
+            return registrations[regIdx].handler;
+        }
+    }
+    return nullptr;
+}
+
+void OdaRegistry::AnnouncementHandler::processAnnouncement(uint16_t message)
+{
+    (void) message;
+}
+
+void OdaRegistry::AnnouncementHandler::processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder)
+{
+    (void) decoder;
+    registry.processAnnouncement(group.blocks[1], group.blocks[2], group.blocks[3]);
+}
+
+void OdaRegistry::AnnouncementHandler::reset()
+{
+}
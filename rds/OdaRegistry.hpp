@@ -0,0 +1,121 @@
+/**************************************************
+ * OdaRegistry.hpp - Routes Open Data Application groups to handlers
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef ODAREGISTRY_HPP
+#define ODAREGISTRY_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "OdaHandler.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+
+/**
+ * Keeps track of the ODAs a station announces in 3A groups (AID ->
+ * carrier group type) and hands each group to the handler registered
+ * for the application it carries. Dispatch is a lookup in a flat table
+ * indexed by RdsDecoder::getGroupIndex(); 3A itself is routed through the
+ * same table. Registering a handler or receiving an announcement only
+ * rewrites table entries, so adding ODAs never touches the per-group path.
+ */
+class OdaRegistry
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t MAX_HANDLERS = 8;
+
+    // Distinct AIDs remembered per station
+    static const uint8_t MAX_APPLICATIONS = 16;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Application
+    {
+        uint16_t aid;
+
+        // Index of the carrier group (see RdsDecoder::getGroupIndex()), or
+        // NO_CARRIER_GROUP if the application only uses 3A
+        uint8_t groupIndex;
+        bool handled;
+        uint32_t announcements;
+    };
+
+    static const uint8_t NO_CARRIER_GROUP = 0xFF;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    OdaRegistry();
+
+    // handler must outlive the registry. Returns false if the registry is
+    // full or aid already has a handler.
+    bool registerHandler(uint16_t aid, OdaHandler& handler);
+
+    // Forgets the station's announcements and resets every handler
+    void reset();
+
+    void processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder);
+
+    uint8_t getApplicationCount() const;
+    const Application* getApplications() const;
+
+    // Groups handed to a handler, by group index
+    uint32_t getGroupsDispatched(uint8_t groupIndex) const;
+
+    static const char* groupIndexToString(uint8_t groupIndex);
+
+private:
+    /**
+     * Occupies the 3A entry of the dispatch table
+     */
+    class AnnouncementHandler : public OdaHandler
+    {
+    public:
+        explicit AnnouncementHandler(OdaRegistry& registryParam) : registry(registryParam) { };
+
+        void processAnnouncement(uint16_t message) override;
+        void processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder) override;
+        void reset() override;
+
+    private:
+        OdaRegistry& registry;
+    };
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Registration
+    {
+        uint16_t aid;
+        OdaHandler* handler;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void processAnnouncement(uint16_t blockB, uint16_t message, uint16_t aid);
+    OdaHandler* findHandler(uint16_t aid) const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    AnnouncementHandler announcementHandler;
+
+    Registration registrations[MAX_HANDLERS];
+    uint8_t registrationCount;
+
+    Application applications[MAX_APPLICATIONS];
+    uint8_t applicationCount;
+
+    OdaHandler* dispatch[RdsDecoder::GROUP_TYPE_COUNT];
+    uint32_t groupsDispatched[RdsDecoder::GROUP_TYPE_COUNT];
+};
+
+#endif  // ifndef ODAREGISTRY_HPP
@@ -0,0 +1,207 @@
+/**************************************************
+ * RdsDecoder.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "Util.hpp"
+
+const RdsDecoder::GroupDecoder RdsDecoder::GROUP_DECODERS[GROUP_DECODER_COUNT] =
+{
+    &RdsDecoder::ignoreGroup, &RdsDecoder::decodeBasicTuning, &RdsDecoder::decodeRadioText
+};
+
+const uint8_t RdsDecoder::GROUP_DECODER_INDEX[GROUP_TYPE_COUNT] =
+{
+    1, 1,   // 0A, 0B
+    0, 0,   // 1A, 1B
+    2, 2,   // 2A, 2B
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+RdsDecoder::RdsDecoder()
+{
+    reset();
+}
+
+/**
+ * Forgets everything decoded so far. Should be called after a retune.
+ */
+void RdsDecoder::reset()
+{
+    std::memset(&data, 0, sizeof(data));
+    std::memset(&counters, 0, sizeof(counters));
+
+    std::memset(data.programService, ' ', PS_LENGTH);
+    clearRadioText();
+}
+
+/**
+ * Returns true if a block with the given error level can be used as-is.
+ * The chip corrects up to two errors per block; anything above that is
+ * not reliable.
+ */
+bool RdsDecoder::isBlockTrusted(RDA5807M::RdsBlockErrors errors)
+{
+    return errors == RDA5807M::RdsBlockErrors::ZERO_ERRORS ||
+           errors == RDA5807M::RdsBlockErrors::ONE_TO_TWO_ERRORS;
+}
+
+/**
+ * Returns the group's index in a GROUP_TYPE_COUNT sized table: the group
+ * type code times two, plus one for version B groups.
+ */
+uint8_t RdsDecoder::getGroupIndex(uint16_t blockB)
+{
+    return static_cast<uint8_t>((Util::valueFromReg(blockB, GROUP_TYPE) << 1) |
+                                Util::valueFromReg(blockB, VERSION_CODE));
+}
+
+/**
+ * Decodes a single group. Returns false if block B was too damaged to
+ * tell what kind of group it is, in which case nothing is updated.
+ */
+bool RdsDecoder::processGroup(const RDA5807M::RdsGroup& group)
+{
+    ++counters.blockAErrors[static_cast<int>(group.errorsA)];
+    ++counters.blockBErrors[static_cast<int>(group.errorsB)];
+
+    if (!isBlockTrusted(group.errorsB))
+    {
+        ++counters.groupsRejected;
+        return false;
+    }
+
+    uint16_t blockB = group.blocks[1];
+    uint8_t groupIndex = getGroupIndex(blockB);
+    ++counters.groupsDecoded;
+    ++counters.groupsByType[groupIndex];
+
+    if (isBlockTrusted(group.errorsA))
+    {
+        data.piCode = group.blocks[0];
+    }
+
+    data.programType = static_cast<uint8_t>(Util::valueFromReg(blockB, PROGRAM_TYPE));
+    data.trafficProgram = Util::valueFromReg(blockB, TRAFFIC_PROGRAM) != 0;
+
+    (this->*GROUP_DECODERS[GROUP_DECODER_INDEX[groupIndex]])(group);
+
+    return true;
+}
+
+void RdsDecoder::ignoreGroup(const RDA5807M::RdsGroup& group)
+{
+    (void) group;
+}
+
+/**
+ * Group 0A/0B: TA, M/S and two characters of the program service name,
+ * which always arrive in block D.
+ */
+void RdsDecoder::decodeBasicTuning(const RDA5807M::RdsGroup& group)
+{
+    uint16_t blockB = group.blocks[1];
+    uint16_t blockD = group.blocks[3];
+
+    data.trafficAnnouncement = Util::valueFromReg(blockB, TRAFFIC_ANNOUNCEMENT) != 0;
+    data.music = Util::valueFromReg(blockB, MUSIC_SPEECH) != 0;
+
+    uint8_t segment = static_cast<uint8_t>(Util::valueFromReg(blockB, PS_SEGMENT_ADDRESS));
+    data.programService[segment * 2] = static_cast<char>(Util::valueFromReg(blockD, UINT16_UPPER_BYTE));
+    data.programService[segment * 2 + 1] = static_cast<char>(Util::valueFromReg(blockD, UINT16_LOWER_BYTE));
+    data.psSegmentMask |= static_cast<uint8_t>(1 << segment);
+}
+
+/**
+ * Group 2A carries four characters per group in blocks C and D; group 2B
+ * carries two characters in block D only.
+ */
+void RdsDecoder::decodeRadioText(const RDA5807M::RdsGroup& group)
+{
+    uint16_t blockB = group.blocks[1];
+    bool abFlag = Util::valueFromReg(blockB, RT_AB_FLAG) != 0;
+
+    if (abFlag != data.rtAbFlag)
+    {
+        clearRadioText();
+        data.rtAbFlag = abFlag;
+    }
+
+    uint8_t segment = static_cast<uint8_t>(Util::valueFromReg(blockB, RT_SEGMENT_ADDRESS));
+    char chars[4];
+    uint8_t charCount = 0;
+
+    if (Util::valueFromReg(blockB, VERSION_CODE) == 0)
+    {
+        chars[charCount++] = static_cast<char>(Util::valueFromReg(group.blocks[2], UINT16_UPPER_BYTE));
+        chars[charCount++] = static_cast<char>(Util::valueFromReg(group.blocks[2], UINT16_LOWER_BYTE));
+    }
+    chars[charCount++] = static_cast<char>(Util::valueFromReg(group.blocks[3], UINT16_UPPER_BYTE));
+    chars[charCount++] = static_cast<char>(Util::valueFromReg(group.blocks[3], UINT16_LOWER_BYTE));
+
+    uint8_t position = segment * charCount;
+    for (uint8_t idx = 0; idx < charCount && (position + idx) < RT_LENGTH; ++idx)
+    {
+        // A carriage return marks the end of a message shorter than 64 chars
+        if (chars[idx] == '\r')
+        {
+            data.radioText[position + idx] = '\0';
+            data.rtTerminated = true;
+            break;
+        }
+        data.radioText[position + idx] = chars[idx];
+    }
+    data.rtSegmentMask |= static_cast<uint16_t>(1 << segment);
+}
+
+void RdsDecoder::clearRadioText()
+{
+    std::memset(data.radioText, ' ', RT_LENGTH);
+    data.radioText[RT_LENGTH] = '\0';
+    data.rtSegmentMask = 0;
+    data.rtTerminated = false;
+}
+
+const RdsDecoder::RdsData& RdsDecoder::getData() const
+{
+    return data;
+}
+
+const RdsDecoder::Counters& RdsDecoder::getCounters() const
+{
+    return counters;
+}
+
+bool RdsDecoder::isProgramServiceComplete() const
+{
+    return (data.psSegmentMask & PS_COMPLETE_MASK) == PS_COMPLETE_MASK;
+}
+
+/**
+ * Returns true once every segment up to the terminating carriage return
+ * (or all 16 segments) has been received.
+ */
+bool RdsDecoder::isRadioTextComplete() const
+{
+    if (data.rtSegmentMask == RT_COMPLETE_MASK)
+    {
+        return true;
+    }
+
+    if (!data.rtTerminated)
+    {
+        return false;
+    }
+
+    // All segments below the highest received one must be present
+    uint16_t mask = data.rtSegmentMask;
+    return (mask & (mask + 1)) == 0;
+}
@@ -0,0 +1,120 @@
+/**************************************************
+ * RdsDecoder.hpp - Header for the RDS/RBDS group decoder
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDSDECODER_HPP
+#define RDSDECODER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Turns the raw groups read from the radio into station information
+ * (PI, PTY, TP/TA, PS and RadioText). All storage is fixed-size so the
+ * decoder can be placed in shared memory snapshots and used without a heap.
+ */
+class RdsDecoder
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t PS_LENGTH = 8;
+    static const uint8_t RT_LENGTH = 64;
+
+    // 16 group types, each with an A and B version
+    static const uint8_t GROUP_TYPE_COUNT = 32;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct RdsData
+    {
+        uint16_t piCode;
+        uint8_t programType;
+        bool trafficProgram;
+        bool trafficAnnouncement;
+        bool music;
+
+        // Null-terminated. Segments that haven't been received are spaces.
+        char programService[PS_LENGTH + 1];
+        char radioText[RT_LENGTH + 1];
+
+        // One bit per received PS (2 char) and RT (4 char) segment
+        uint8_t psSegmentMask;
+        uint16_t rtSegmentMask;
+
+        // The RadioText A/B flag; a toggle means the text should be cleared
+        bool rtAbFlag;
+
+        // Set once a carriage return terminates the RadioText
+        bool rtTerminated;
+    };
+
+    struct Counters
+    {
+        uint32_t groupsDecoded;
+        uint32_t groupsRejected;
+        uint32_t groupsByType[GROUP_TYPE_COUNT];
+        uint32_t blockAErrors[4];
+        uint32_t blockBErrors[4];
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RdsDecoder();
+
+    void reset();
+
+    bool processGroup(const RDA5807M::RdsGroup& group);
+
+    const RdsData& getData() const;
+
+    const Counters& getCounters() const;
+
+    bool isProgramServiceComplete() const;
+
+    bool isRadioTextComplete() const;
+
+    static uint8_t getGroupIndex(uint16_t blockB);
+
+    static bool isBlockTrusted(RDA5807M::RdsBlockErrors errors);
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint8_t PS_COMPLETE_MASK = 0x0F;
+    static const uint16_t RT_COMPLETE_MASK = 0xFFFF;
+
+    // Groups are dispatched through GROUP_DECODER_INDEX, a flat table by
+    // group index (see getGroupIndex()), into GROUP_DECODERS. Two levels
+    // keep the 32-entry table to bytes; member function pointers are 16
+    // bytes each and need relocating, which costs static RAM in the
+    // freestanding profile. Open Data Applications are left to OdaRegistry.
+    typedef void (RdsDecoder::*GroupDecoder)(const RDA5807M::RdsGroup& group);
+    static const uint8_t GROUP_DECODER_COUNT = 3;
+    static const GroupDecoder GROUP_DECODERS[GROUP_DECODER_COUNT];
+    static const uint8_t GROUP_DECODER_INDEX[GROUP_TYPE_COUNT];
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void ignoreGroup(const RDA5807M::RdsGroup& group);
+    void decodeBasicTuning(const RDA5807M::RdsGroup& group);
+    void decodeRadioText(const RDA5807M::RdsGroup& group);
+    void clearRadioText();
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RdsData data;
+    Counters counters;
+};
+
+#endif  // ifndef RDSDECODER_HPP
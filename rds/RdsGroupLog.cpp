@@ -0,0 +1,205 @@
+/**************************************************
+ * RdsGroupLog.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsGroupLog.hpp"
+
+using RdsGroupLogFormat::Entry;
+using RdsGroupLogFormat::FileHeader;
+
+RdsGroupLogWriter::RdsGroupLogWriter() : fd(-1), entryCount(0)
+{
+}
+
+RdsGroupLogWriter::~RdsGroupLogWriter()
+{
+    close();
+}
+
+/**
+ * Opens path for appending, creating it (or starting it over, if
+ * truncate is set) as needed. A partial trailing entry left by a crash is
+ * cut off. Returns false if path exists but isn't a group log.
+ */
+bool RdsGroupLogWriter::open(const char* path, bool truncate)
+{
+    close();
+
+    // Logs live in a world-writable directory; don't follow a link
+    // someone else put there
+    fd = ::open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close();
+        return false;
+    }
+
+    FileHeader header;
+    if (info.st_size == 0)
+    {
+        std::memset(&header, 0, sizeof(header));
+        header.magic = RdsGroupLogFormat::FILE_MAGIC;
+        header.formatVersion = RdsGroupLogFormat::FORMAT_VERSION;
+        if (write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)))
+        {
+            close();
+            return false;
+        }
+        entryCount = 0;
+        return true;
+    }
+
+    if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != RdsGroupLogFormat::FILE_MAGIC || header.formatVersion != RdsGroupLogFormat::FORMAT_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    entryCount = (static_cast<uint64_t>(info.st_size) - sizeof(header)) / sizeof(Entry);
+    off_t end = static_cast<off_t>(sizeof(header) + entryCount * sizeof(Entry));
+    if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RdsGroupLogWriter::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    entryCount = 0;
+}
+
+bool RdsGroupLogWriter::isOpen() const
+{
+    return fd >= 0;
+}
+
+bool RdsGroupLogWriter::append(const RDA5807M::RdsGroup& group, uint64_t timestampUs)
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    Entry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.timestampUs = timestampUs;
+    std::memcpy(entry.blocks, group.blocks, sizeof(entry.blocks));
+    entry.errorsA = static_cast<uint8_t>(group.errorsA);
+    entry.errorsB = static_cast<uint8_t>(group.errorsB);
+
+    if (write(fd, &entry, sizeof(entry)) != static_cast<ssize_t>(sizeof(entry)))
+    {
+        return false;
+    }
+    ++entryCount;
+    return true;
+}
+
+uint64_t RdsGroupLogWriter::getEntryCount() const
+{
+    return entryCount;
+}
+
+RdsGroupLogReader::RdsGroupLogReader() : mapping(nullptr), mappingSize(0)
+{
+}
+
+RdsGroupLogReader::~RdsGroupLogReader()
+{
+    close();
+}
+
+bool RdsGroupLogReader::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    void* result = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (result == MAP_FAILED)
+    {
+        mappingSize = 0;
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(result);
+
+    FileHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (header.magic != RdsGroupLogFormat::FILE_MAGIC || header.formatVersion != RdsGroupLogFormat::FORMAT_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // Logs are replayed in one pass
+    madvise(const_cast<uint8_t*>(mapping), mappingSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void RdsGroupLogReader::close()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(mapping), mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+size_t RdsGroupLogReader::getEntryCount() const
+{
+    return (mapping == nullptr) ? 0 : (mappingSize - sizeof(FileHeader)) / sizeof(Entry);
+}
+
+const Entry* RdsGroupLogReader::getEntries() const
+{
+    return (mapping == nullptr) ? nullptr : reinterpret_cast<const Entry*>(mapping + sizeof(FileHeader));
+}
+
+RDA5807M::RdsGroup RdsGroupLogReader::toGroup(const Entry& entry)
+{
+    RDA5807M::RdsGroup group;
+    std::memcpy(group.blocks, entry.blocks, sizeof(group.blocks));
+    group.errorsA = static_cast<RDA5807M::RdsBlockErrors>(entry.errorsA & 0x3);
+    group.errorsB = static_cast<RDA5807M::RdsBlockErrors>(entry.errorsB & 0x3);
+    return group;
+}
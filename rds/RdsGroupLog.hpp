@@ -0,0 +1,100 @@
+/**************************************************
+ * RdsGroupLog.hpp - Recorded streams of raw RDS groups
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDSGROUPLOG_HPP
+#define RDSGROUPLOG_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * A group log is a FileHeader followed by fixed-size Entries, one per
+ * group as read from the chip, in the order they were received. Logs are
+ * only ever appended to, so a log cut short by a crash is still valid up
+ * to its last whole entry. All fields are host byte order.
+ */
+namespace RdsGroupLogFormat
+{
+    static const uint32_t FILE_MAGIC = 0x47534452; // "RDSG"
+    static const uint16_t FORMAT_VERSION = 1;
+
+    // Where RDSRECORD records to and the TMC benchmark replays from
+    static const char* const DEFAULT_PATH = "/var/tmp/rda5807m_groups.rdslog";
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint16_t formatVersion;
+        uint16_t reserved;
+    };
+
+    struct Entry
+    {
+        uint64_t timestampUs;
+        uint16_t blocks[4];
+        uint8_t errorsA;
+        uint8_t errorsB;
+        uint16_t reserved;
+    };
+}
+
+class RdsGroupLogWriter
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RdsGroupLogWriter();
+    ~RdsGroupLogWriter();
+
+    bool open(const char* path, bool truncate = false);
+    void close();
+    bool isOpen() const;
+
+    bool append(const RDA5807M::RdsGroup& group, uint64_t timestampUs);
+
+    uint64_t getEntryCount() const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    int fd;
+    uint64_t entryCount;
+};
+
+/**
+ * Maps a whole log read-only
+ */
+class RdsGroupLogReader
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RdsGroupLogReader();
+    ~RdsGroupLogReader();
+
+    bool open(const char* path);
+    void close();
+
+    size_t getEntryCount() const;
+    const RdsGroupLogFormat::Entry* getEntries() const;
+
+    static RDA5807M::RdsGroup toGroup(const RdsGroupLogFormat::Entry& entry);
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const uint8_t* mapping;
+    size_t mappingSize;
+};
+
+#endif  // ifndef RDSGROUPLOG_HPP
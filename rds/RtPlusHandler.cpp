@@ -0,0 +1,134 @@
+/**************************************************
+ * RtPlusHandler.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "RtPlusHandler.hpp"
+
+namespace
+{
+    // 3A message (block C)
+    const uint16_t TEMPLATE_NUMBER_MASK = 0x00FF;
+
+    // RT+ group block B
+    const uint16_t ITEM_TOGGLE = 0x0010;
+    const uint16_t ITEM_RUNNING = 0x0008;
+
+    // RadioText characters per 2A segment
+    const uint8_t CHARS_PER_SEGMENT = 4;
+}
+
+RtPlusHandler::RtPlusHandler()
+{
+    reset();
+}
+
+void RtPlusHandler::processAnnouncement(uint16_t message)
+{
+    tags.templateNumber = static_cast<uint8_t>(message & TEMPLATE_NUMBER_MASK);
+}
+
+/**
+ * An RT+ group carries two tags, split across blocks B-D:
+ *   B[2:0] C[15:13]  content type 1 (6 bits)
+ *   C[12:7]          start marker 1
+ *   C[6:1]           length marker 1 (6 bits)
+ *   C[0] D[15:11]    content type 2 (6 bits)
+ *   D[10:5]          start marker 2
+ *   D[4:0]           length marker 2 (5 bits)
+ * A length marker is the item length minus one.
+ */
+void RtPlusHandler::processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder)
+{
+    uint16_t blockB = group.blocks[1];
+    uint16_t blockC = group.blocks[2];
+    uint16_t blockD = group.blocks[3];
+
+    bool itemToggle = (blockB & ITEM_TOGGLE) != 0;
+    if (haveToggle && itemToggle != tags.itemToggle)
+    {
+        tags.title[0] = '\0';
+        tags.artist[0] = '\0';
+        ++tags.itemChanges;
+    }
+    tags.itemToggle = itemToggle;
+    tags.itemRunning = (blockB & ITEM_RUNNING) != 0;
+    haveToggle = true;
+    ++tags.tagGroups;
+
+    uint8_t contentType1 = static_cast<uint8_t>(((blockB & 0x0007) << 3) | (blockC >> 13));
+    uint8_t start1 = static_cast<uint8_t>((blockC >> 7) & 0x3F);
+    uint8_t length1 = static_cast<uint8_t>((blockC >> 1) & 0x3F);
+    uint8_t contentType2 = static_cast<uint8_t>(((blockC & 0x0001) << 5) | (blockD >> 11));
+    uint8_t start2 = static_cast<uint8_t>((blockD >> 5) & 0x3F);
+    uint8_t length2 = static_cast<uint8_t>(blockD & 0x1F);
+
+    const RdsDecoder::RdsData& rds = decoder.getData();
+    applyTag(contentType1, start1, length1, rds);
+    applyTag(contentType2, start2, length2, rds);
+}
+
+void RtPlusHandler::reset()
+{
+    std::memset(&tags, 0, sizeof(tags));
+    haveToggle = false;
+}
+
+const RtPlusHandler::Tags& RtPlusHandler::getTags() const
+{
+    return tags;
+}
+
+/**
+ * Copies the tagged part of the RadioText into title or artist, without
+ * trailing spaces. Tags pointing at text not yet received are skipped;
+ * the station repeats them.
+ */
+void RtPlusHandler::applyTag(uint8_t contentType, uint8_t start, uint8_t lengthMarker,
+                             const RdsDecoder::RdsData& rds)
+{
+    char* destination = nullptr;
+    if (contentType == CONTENT_TYPE_TITLE)
+    {
+        destination = tags.title;
+    }
+    else if (contentType == CONTENT_TYPE_ARTIST)
+    {
+        destination = tags.artist;
+    }
+
+    uint8_t length = static_cast<uint8_t>(lengthMarker + 1);
+    if (destination == nullptr || start + length > RdsDecoder::RT_LENGTH)
+    {
+        return;
+    }
+
+    for (uint8_t segment = start / CHARS_PER_SEGMENT; segment <= (start + length - 1) / CHARS_PER_SEGMENT;
+         ++segment)
+    {
+        if ((rds.rtSegmentMask & (1 << segment)) == 0)
+        {
+            return;
+        }
+    }
+
+    // The text may end (at a carriage return) inside the tag
+    uint8_t copied = 0;
+    while (copied < length && rds.radioText[start + copied] != '\0')
+    {
+        destination[copied] = rds.radioText[start + copied];
+        ++copied;
+    }
+    while (copied > 0 && destination[copied - 1] == ' ')
+    {
+        --copied;
+    }
+    destination[copied] = '\0';
+}
@@ -0,0 +1,77 @@
+/**************************************************
+ * RtPlusHandler.hpp - RadioText Plus (RT+) ODA decoder
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RTPLUSHANDLER_HPP
+#define RTPLUSHANDLER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "OdaHandler.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+
+/**
+ * Picks the title and artist out of the RadioText using the RT+ tags
+ * (start and length of each item within the text). A tag is only applied
+ * once every character it covers has been received, and tags are cleared
+ * when the station toggles the item (a new song).
+ */
+class RtPlusHandler : public OdaHandler
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint16_t AID = 0x4BD7;
+
+    // RT+ content types used here (there are 64)
+    static const uint8_t CONTENT_TYPE_TITLE = 1;
+    static const uint8_t CONTENT_TYPE_ARTIST = 4;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Tags
+    {
+        // Null-terminated; empty until the tag is seen
+        char title[RdsDecoder::RT_LENGTH + 1];
+        char artist[RdsDecoder::RT_LENGTH + 1];
+
+        // Set while the station says the item is playing
+        bool itemRunning;
+        bool itemToggle;
+
+        uint8_t templateNumber;
+        uint32_t tagGroups;
+        uint32_t itemChanges;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RtPlusHandler();
+
+    void processAnnouncement(uint16_t message) override;
+    void processGroup(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder) override;
+    void reset() override;
+
+    const Tags& getTags() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void applyTag(uint8_t contentType, uint8_t start, uint8_t lengthMarker, const RdsDecoder::RdsData& rds);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    Tags tags;
+    bool haveToggle;
+};
+
+#endif  // ifndef RTPLUSHANDLER_HPP
@@ -0,0 +1,495 @@
+/**************************************************
+ * TmcDecoder.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "TmcDecoder.hpp"
+#include "TmcTableFormat.hpp"
+#include "TmcTables.hpp"
+
+namespace
+{
+    const uint8_t TMC_GROUP_INDEX = 16; // 8A
+
+    // Block B
+    const uint16_t TUNING_INFORMATION = 0x0010;
+    const uint16_t SINGLE_GROUP = 0x0008;
+    const uint16_t DP_OR_CI_MASK = 0x0007;
+
+    // Block C
+    const uint16_t FIRST_GROUP = 0x8000;
+    const uint16_t DIVERSION = 0x8000;
+    const uint16_t DIRECTION = 0x4000;
+    const uint16_t SECOND_GROUP = 0x4000;
+    const uint16_t EXTENT_MASK = 0x3800;
+    const uint8_t EXTENT_SHIFT = 11;
+    const uint16_t EVENT_MASK = 0x07FF;
+    const uint16_t SEQUENCE_MASK = 0x3000;
+    const uint8_t SEQUENCE_SHIFT = 12;
+    const uint16_t OPTIONAL_BITS_IN_C = 0x0FFF;
+
+    // Length of the data after each optional content label
+    const uint8_t LABEL_DATA_BITS[16] = { 3, 3, 5, 5, 5, 8, 8, 8, 8, 11, 16, 16, 16, 16, 0, 0 };
+
+    // Persistence in minutes by DP (ISO 14819-1 table 5). END_OF_DAY and
+    // END_OF_NEXT_DAY stand in for "until midnight".
+    const int32_t END_OF_DAY = -1;
+    const int32_t END_OF_NEXT_DAY = -2;
+    const int32_t DYNAMIC_PERSISTENCE_MINUTES[8] = { 15, 15, 30, 60, 120, 180, 240, END_OF_DAY };
+    const int32_t LONG_LASTING_PERSISTENCE_MINUTES[8] =
+        { 60, 120, END_OF_DAY, END_OF_NEXT_DAY, END_OF_NEXT_DAY, END_OF_NEXT_DAY, END_OF_NEXT_DAY, END_OF_NEXT_DAY };
+
+    const uint64_t MICROS_IN_MINUTE = 60000000ULL;
+
+    // Reads count (<= 16) bits at bitPos of an MSB-first bit string
+    uint16_t readBits(const uint8_t* bits, uint8_t bitPos, uint8_t count)
+    {
+        uint16_t value = 0;
+        for (uint8_t idx = 0; idx < count; ++idx)
+        {
+            uint8_t bit = static_cast<uint8_t>(bitPos + idx);
+            value = static_cast<uint16_t>((value << 1) | ((bits[bit >> 3] >> (7 - (bit & 0x7))) & 0x1));
+        }
+        return value;
+    }
+
+    bool areRemainingBitsZero(const uint8_t* bits, uint8_t bitPos, uint8_t bitCount)
+    {
+        for (uint8_t bit = bitPos; bit < bitCount; ++bit)
+        {
+            if ((bits[bit >> 3] >> (7 - (bit & 0x7))) & 0x1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TmcDecoder::TmcDecoder() :
+        tables(nullptr), requireRepetition(true), slots(new Slot[TABLE_CAPACITY])
+{
+    reset();
+}
+
+/**
+ * Forgets every message and any partly assembled ones
+ */
+void TmcDecoder::reset()
+{
+    std::memset(slots.get(), 0, sizeof(Slot) * TABLE_CAPACITY);
+    std::memset(assemblies, 0, sizeof(assemblies));
+    std::memset(lastBlocks, 0, sizeof(lastBlocks));
+    std::memset(&stats, 0, sizeof(stats));
+    activeCount = 0;
+    sweepCursor = 0;
+    dayStartUs = 0;
+    midnightUs[0] = 0;
+    midnightUs[1] = 0;
+    haveLastGroup = false;
+    lastGroupAccepted = false;
+}
+
+/**
+ * Messages already stored keep the key they were stored under, so set
+ * the tables before decoding
+ */
+void TmcDecoder::setTables(const TmcTables* tablesParam)
+{
+    tables = tablesParam;
+}
+
+void TmcDecoder::setRequireRepetition(bool requireRepetitionParam)
+{
+    requireRepetition = requireRepetitionParam;
+}
+
+/**
+ * Processes group if it is an 8A group. Returns true if it completed a
+ * message (new, replacing or refreshing one). timestampUs is wall-clock
+ * time and drives expiry.
+ */
+bool TmcDecoder::processGroup(const RDA5807M::RdsGroup& group, uint64_t timestampUs)
+{
+    if (RdsDecoder::getGroupIndex(group.blocks[1]) != TMC_GROUP_INDEX)
+    {
+        return false;
+    }
+
+    ++stats.groups;
+    expireSome(timestampUs);
+
+    if (!RdsDecoder::isBlockTrusted(group.errorsB))
+    {
+        ++stats.groupsRejected;
+        return false;
+    }
+
+    bool repeat = haveLastGroup && std::memcmp(lastBlocks, &group.blocks[1], sizeof(lastBlocks)) == 0;
+    if (repeat && lastGroupAccepted)
+    {
+        ++stats.repeatsSuppressed;
+        return false;
+    }
+
+    std::memcpy(lastBlocks, &group.blocks[1], sizeof(lastBlocks));
+    haveLastGroup = true;
+    lastGroupAccepted = repeat || !requireRepetition;
+    if (!lastGroupAccepted)
+    {
+        return false;
+    }
+
+    uint32_t completedBefore = stats.singleGroupMessages + stats.multiGroupMessages;
+    processMessageGroup(group.blocks[1], group.blocks[2], group.blocks[3], timestampUs);
+    return stats.singleGroupMessages + stats.multiGroupMessages != completedBefore;
+}
+
+/**
+ * Returns the number of messages held, including any that have expired
+ * but haven't been swept yet
+ */
+uint32_t TmcDecoder::getActiveMessageCount() const
+{
+    return activeCount;
+}
+
+/**
+ * Copies out every message that hasn't expired by nowUs, in no
+ * particular order
+ */
+void TmcDecoder::getActiveMessages(std::vector<Message>& messages, uint64_t nowUs) const
+{
+    messages.clear();
+    for (uint32_t slotIdx = 0; slotIdx < TABLE_CAPACITY; ++slotIdx)
+    {
+        if (slots[slotIdx].key != 0 && slots[slotIdx].message.expiresUs > nowUs)
+        {
+            messages.push_back(slots[slotIdx].message);
+        }
+    }
+}
+
+const TmcDecoder::Stats& TmcDecoder::getStats() const
+{
+    return stats;
+}
+
+/**
+ * Walks the optional content of a multi-group message and returns the
+ * data of the first field with the given label
+ */
+bool TmcDecoder::findOptionalField(const Message& message, uint8_t label, uint16_t& value)
+{
+    uint8_t bitPos = 0;
+    while (bitPos + 4 <= message.optionalBitCount &&
+           !areRemainingBitsZero(message.optionalContent, bitPos, message.optionalBitCount))
+    {
+        uint8_t fieldLabel = static_cast<uint8_t>(readBits(message.optionalContent, bitPos, 4));
+        uint8_t dataBits = LABEL_DATA_BITS[fieldLabel];
+        bitPos = static_cast<uint8_t>(bitPos + 4);
+
+        if (bitPos + dataBits > message.optionalBitCount)
+        {
+            return false;
+        }
+
+        if (fieldLabel == label)
+        {
+            value = readBits(message.optionalContent, bitPos, dataBits);
+            return true;
+        }
+        bitPos = static_cast<uint8_t>(bitPos + dataBits);
+    }
+    return false;
+}
+
+void TmcDecoder::processMessageGroup(uint16_t blockB, uint16_t blockC, uint16_t blockD, uint64_t timestampUs)
+{
+    if (blockB & TUNING_INFORMATION)
+    {
+        ++stats.tuningGroups;
+        return;
+    }
+
+    if (blockB & SINGLE_GROUP)
+    {
+        Message message;
+        startMessage(message, blockC, blockD, timestampUs);
+        message.diversion = (blockC & DIVERSION) != 0;
+        message.durationPersistence = static_cast<uint8_t>(blockB & DP_OR_CI_MASK);
+
+        ++stats.singleGroupMessages;
+        store(message, timestampUs);
+        return;
+    }
+
+    uint8_t continuityIndex = static_cast<uint8_t>(blockB & DP_OR_CI_MASK);
+    if (continuityIndex == 0 || continuityIndex == 7)
+    {
+        ++stats.assemblyErrors;
+        return;
+    }
+
+    Assembly& assembly = assemblies[continuityIndex];
+    if (blockC & FIRST_GROUP)
+    {
+        // A first group always starts over, abandoning anything unfinished
+        if (assembly.active)
+        {
+            ++stats.assemblyErrors;
+        }
+        startMessage(assembly.message, blockC, blockD, timestampUs);
+        assembly.active = true;
+        assembly.secondReceived = false;
+        return;
+    }
+
+    continueMessage(assembly, blockC, blockD, timestampUs);
+}
+
+/**
+ * Fills message from the fields shared by single groups and the first
+ * group of a multi-group message
+ */
+void TmcDecoder::startMessage(Message& message, uint16_t blockC, uint16_t blockD, uint64_t timestampUs)
+{
+    std::memset(&message, 0, sizeof(message));
+    message.directionNegative = (blockC & DIRECTION) != 0;
+    message.extent = static_cast<uint8_t>((blockC & EXTENT_MASK) >> EXTENT_SHIFT);
+    message.eventCode = static_cast<uint16_t>(blockC & EVENT_MASK);
+    message.locationCode = blockD;
+    message.groupCount = 1;
+    message.firstReceivedUs = timestampUs;
+}
+
+/**
+ * Adds a subsequent group to assembly. The second group gives the number
+ * of groups still to come; each one after counts down to 0, which
+ * completes the message.
+ */
+void TmcDecoder::continueMessage(Assembly& assembly, uint16_t blockC, uint16_t blockD, uint64_t timestampUs)
+{
+    bool second = (blockC & SECOND_GROUP) != 0;
+    uint8_t sequence = static_cast<uint8_t>((blockC & SEQUENCE_MASK) >> SEQUENCE_SHIFT);
+
+    bool inOrder = assembly.active &&
+                   (second ? !assembly.secondReceived
+                           : (assembly.secondReceived && sequence + 1 == assembly.expectedSequence)) &&
+                   assembly.message.groupCount < MAX_GROUPS_PER_MESSAGE;
+    if (!inOrder)
+    {
+        ++stats.assemblyErrors;
+        assembly.active = false;
+        return;
+    }
+
+    assembly.secondReceived = true;
+    assembly.expectedSequence = sequence;
+
+    Message& message = assembly.message;
+    uint32_t bits = (static_cast<uint32_t>(blockC & OPTIONAL_BITS_IN_C) << 16) | blockD;
+    for (int8_t bit = OPTIONAL_BITS_PER_GROUP - 1; bit >= 0; --bit)
+    {
+        uint8_t bitPos = message.optionalBitCount++;
+        if ((bits >> bit) & 0x1)
+        {
+            message.optionalContent[bitPos >> 3] |= static_cast<uint8_t>(0x80 >> (bitPos & 0x7));
+        }
+    }
+    ++message.groupCount;
+
+    if (sequence != 0)
+    {
+        return;
+    }
+
+    uint16_t duration = 0;
+    if (findOptionalField(message, LABEL_DURATION, duration))
+    {
+        message.durationPersistence = static_cast<uint8_t>(duration);
+    }
+
+    assembly.active = false;
+    ++stats.multiGroupMessages;
+    store(message, timestampUs);
+}
+
+/**
+ * Adds message, or refreshes or replaces the message it updates
+ */
+void TmcDecoder::store(Message& message, uint64_t timestampUs)
+{
+    message.lastReceivedUs = timestampUs;
+    message.expiresUs = computeExpiry(message, timestampUs);
+    message.receptions = 1;
+
+    uint64_t key = makeKey(message);
+    uint32_t slotIdx = homeSlot(key);
+    while (slots[slotIdx].key != 0 && slots[slotIdx].key != key)
+    {
+        slotIdx = (slotIdx + 1) & (TABLE_CAPACITY - 1);
+    }
+
+    Slot& slot = slots[slotIdx];
+    if (slot.key == key)
+    {
+        Message& existing = slot.message;
+        bool identical = existing.eventCode == message.eventCode && existing.extent == message.extent &&
+                         existing.diversion == message.diversion &&
+                         existing.durationPersistence == message.durationPersistence &&
+                         existing.optionalBitCount == message.optionalBitCount &&
+                         std::memcmp(existing.optionalContent, message.optionalContent,
+                                     sizeof(message.optionalContent)) == 0;
+        if (identical)
+        {
+            ++stats.messagesRefreshed;
+            existing.lastReceivedUs = timestampUs;
+            existing.expiresUs = message.expiresUs;
+            ++existing.receptions;
+        }
+        else
+        {
+            ++stats.messagesReplaced;
+            existing = message;
+        }
+        return;
+    }
+
+    if (activeCount >= MAX_MESSAGES)
+    {
+        ++stats.messagesDropped;
+        return;
+    }
+
+    slot.key = key;
+    slot.message = message;
+    ++activeCount;
+    ++stats.messagesAdded;
+}
+
+/**
+ * Empties slotIdx, shifting later entries of the probe run back so that
+ * lookups never need tombstones
+ */
+void TmcDecoder::removeSlot(uint32_t slotIdx)
+{
+    uint32_t hole = slotIdx;
+    uint32_t next = hole;
+
+    while (true)
+    {
+        next = (next + 1) & (TABLE_CAPACITY - 1);
+        if (slots[next].key == 0)
+        {
+            break;
+        }
+
+        // An entry can fill the hole if its home isn't cyclically in (hole, next]
+        uint32_t home = homeSlot(slots[next].key);
+        bool homeInRange = (hole <= next) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeInRange)
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+
+    slots[hole].key = 0;
+    --activeCount;
+}
+
+void TmcDecoder::expireSome(uint64_t nowUs)
+{
+    for (uint8_t checked = 0; checked < EXPIRY_SLOTS_PER_GROUP; ++checked)
+    {
+        Slot& slot = slots[sweepCursor];
+        if (slot.key != 0 && slot.message.expiresUs <= nowUs)
+        {
+            // Check the slot again, something may have shifted into it
+            removeSlot(sweepCursor);
+            ++stats.messagesExpired;
+            continue;
+        }
+        sweepCursor = (sweepCursor + 1) & (TABLE_CAPACITY - 1);
+    }
+}
+
+/**
+ * Messages replace each other if they share a location, direction and
+ * update class. Without tables the event code stands in for the class.
+ * Bit 63 is always set so that no key is 0.
+ */
+uint64_t TmcDecoder::makeKey(const Message& message) const
+{
+    uint64_t kind = message.eventCode;
+    const TmcTableFormat::EventEntry* event = (tables != nullptr) ? tables->findEvent(message.eventCode) : nullptr;
+    if (event != nullptr)
+    {
+        kind = 0x10000ULL | event->updateClass;
+    }
+
+    return (1ULL << 63) | (static_cast<uint64_t>(message.locationCode) << 32) |
+           (static_cast<uint64_t>(message.directionNegative) << 31) | kind;
+}
+
+uint64_t TmcDecoder::computeExpiry(const Message& message, uint64_t timestampUs)
+{
+    const TmcTableFormat::EventEntry* event = (tables != nullptr) ? tables->findEvent(message.eventCode) : nullptr;
+    bool longLasting = (event != nullptr) && (event->flags & TmcTableFormat::EVENT_LONG_LASTING) != 0;
+
+    int32_t minutes = (longLasting ? LONG_LASTING_PERSISTENCE_MINUTES
+                                   : DYNAMIC_PERSISTENCE_MINUTES)[message.durationPersistence & 0x7];
+    switch (minutes)
+    {
+        case END_OF_DAY:
+            updateMidnights(timestampUs);
+            return midnightUs[0];
+        case END_OF_NEXT_DAY:
+            updateMidnights(timestampUs);
+            return midnightUs[1];
+        default:
+            return timestampUs + static_cast<uint64_t>(minutes) * MICROS_IN_MINUTE;
+    }
+}
+
+void TmcDecoder::updateMidnights(uint64_t timestampUs)
+{
+    if (timestampUs >= dayStartUs && timestampUs < midnightUs[0])
+    {
+        return;
+    }
+
+    time_t seconds = static_cast<time_t>(timestampUs / 1000000);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+
+    struct tm day = local;
+    dayStartUs = static_cast<uint64_t>(mktime(&day)) * 1000000ULL;
+    for (int dayIdx = 0; dayIdx < 2; ++dayIdx)
+    {
+        day = local;
+        day.tm_mday += dayIdx + 1;
+        midnightUs[dayIdx] = static_cast<uint64_t>(mktime(&day)) * 1000000ULL;
+    }
+}
+
+uint32_t TmcDecoder::homeSlot(uint64_t key)
+{
+    // Fibonacci hashing; TABLE_CAPACITY is 2^13
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - 13)) & (TABLE_CAPACITY - 1);
+}
@@ -0,0 +1,182 @@
+/**************************************************
+ * TmcDecoder.hpp - RDS-TMC (group 8A) traffic message decoder
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TMCDECODER_HPP
+#define TMCDECODER_HPP
+
+// System includes
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "TmcTables.hpp"
+
+/**
+ * Decodes ISO 14819-1 traffic messages from group 8A: single-group
+ * messages, and multi-group messages of up to five groups assembled per
+ * continuity index. Tuning and system information groups are counted
+ * but not decoded.
+ *
+ * The chip reports no error level for blocks C and D, so a group only
+ * counts once it has been received twice in a row, the way TMC services
+ * transmit them; further identical copies are suppressed.
+ *
+ * Active messages live in an open-addressed hash table keyed by location,
+ * direction and update class (or event code without tables), so a new
+ * message replaces the one it updates and repeats only refresh it. Each
+ * group does O(1) work: one table probe plus a fixed number of expiry
+ * checks.
+ */
+class TmcDecoder
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // Hash table slots; must be a power of two
+    static const uint32_t TABLE_CAPACITY = 8192;
+
+    // Kept below the capacity so probes stay short
+    static const uint32_t MAX_MESSAGES = TABLE_CAPACITY * 3 / 4;
+
+    static const uint8_t MAX_GROUPS_PER_MESSAGE = 5;
+
+    // Each subsequent group of a multi-group message carries 28 bits
+    static const uint8_t OPTIONAL_BITS_PER_GROUP = 28;
+    static const uint8_t MAX_OPTIONAL_BITS = (MAX_GROUPS_PER_MESSAGE - 1) * OPTIONAL_BITS_PER_GROUP;
+
+    // Slots checked for expiry per group processed
+    static const uint8_t EXPIRY_SLOTS_PER_GROUP = 8;
+
+    // Optional content labels (ISO 14819-1 5.5)
+    static const uint8_t LABEL_DURATION = 0;
+    static const uint8_t LABEL_ADDITIONAL_EVENT = 9;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Message
+    {
+        uint16_t locationCode;
+        uint16_t eventCode;
+        uint8_t extent;
+        bool directionNegative;
+        bool diversion;
+
+        // DP from the group, or the duration label of a multi-group message
+        uint8_t durationPersistence;
+        uint8_t groupCount;
+
+        // Raw free-format content of a multi-group message, MSB first
+        uint8_t optionalBitCount;
+        uint8_t optionalContent[(MAX_OPTIONAL_BITS + 7) / 8];
+
+        uint64_t firstReceivedUs;
+        uint64_t lastReceivedUs;
+        uint64_t expiresUs;
+        uint32_t receptions;
+    };
+
+    struct Stats
+    {
+        uint32_t groups;
+        uint32_t groupsRejected;
+        uint32_t repeatsSuppressed;
+        uint32_t tuningGroups;
+        uint32_t singleGroupMessages;
+        uint32_t multiGroupMessages;
+        uint32_t assemblyErrors;
+        uint32_t messagesAdded;
+        uint32_t messagesRefreshed;
+        uint32_t messagesReplaced;
+        uint32_t messagesExpired;
+        uint32_t messagesDropped;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TmcDecoder();
+
+    void reset();
+
+    // tablesParam must outlive the decoder; nullptr disables lookups
+    void setTables(const TmcTables* tablesParam);
+
+    // On by default; turn off for services that send each group once
+    void setRequireRepetition(bool requireRepetitionParam);
+
+    bool processGroup(const RDA5807M::RdsGroup& group, uint64_t timestampUs);
+
+    uint32_t getActiveMessageCount() const;
+    void getActiveMessages(std::vector<Message>& messages, uint64_t nowUs) const;
+
+    const Stats& getStats() const;
+
+    static bool findOptionalField(const Message& message, uint8_t label, uint16_t& value);
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Slot
+    {
+        // 0 marks an empty slot
+        uint64_t key;
+        Message message;
+    };
+
+    struct Assembly
+    {
+        bool active;
+        bool secondReceived;
+        uint8_t expectedSequence;
+        Message message;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void processMessageGroup(uint16_t blockB, uint16_t blockC, uint16_t blockD, uint64_t timestampUs);
+    void startMessage(Message& message, uint16_t blockC, uint16_t blockD, uint64_t timestampUs);
+    void continueMessage(Assembly& assembly, uint16_t blockC, uint16_t blockD, uint64_t timestampUs);
+    void store(Message& message, uint64_t timestampUs);
+    void removeSlot(uint32_t slotIdx);
+    void expireSome(uint64_t nowUs);
+    uint64_t makeKey(const Message& message) const;
+    uint64_t computeExpiry(const Message& message, uint64_t timestampUs);
+    void updateMidnights(uint64_t timestampUs);
+    static uint32_t homeSlot(uint64_t key);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const TmcTables* tables;
+    bool requireRepetition;
+
+    std::unique_ptr<Slot[]> slots;
+    uint32_t activeCount;
+    uint32_t sweepCursor;
+
+    // Local midnights ending the day of the last message and the day
+    // after, worked out once a day since mktime() is slow
+    uint64_t dayStartUs;
+    uint64_t midnightUs[2];
+
+    // Indexed by continuity index; 0 and 7 aren't used for messages
+    Assembly assemblies[8];
+
+    // Blocks B-D of the last 8A group, to confirm and suppress repeats
+    uint16_t lastBlocks[3];
+    bool haveLastGroup;
+    bool lastGroupAccepted;
+
+    Stats stats;
+};
+
+#endif  // ifndef TMCDECODER_HPP
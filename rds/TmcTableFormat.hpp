@@ -0,0 +1,74 @@
+/**************************************************
+ * TmcTableFormat.hpp - Layout of compiled TMC event/location tables
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TMCTABLEFORMAT_HPP
+#define TMCTABLEFORMAT_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * A table file is a FileHeader, then EVENT_CODE_COUNT EventEntries
+ * indexed directly by event code, then locationCount LocationEntries
+ * sorted by location code, then stringsSize bytes of NUL-terminated
+ * strings that the entries point into. Everything is used in place from
+ * a read-only mapping. Files are made by tools/TmcTableCompile.
+ */
+namespace TmcTableFormat
+{
+    static const uint32_t FILE_MAGIC = 0x54434D54; // "TMCT"
+    static const uint16_t FORMAT_VERSION = 1;
+
+    // Where the radio and RDA5807M-bench look for the tables
+    static const char* const DEFAULT_PATH = "/var/tmp/rda5807m_tmc.tbl";
+
+    // Event codes are 11 bits
+    static const uint16_t EVENT_CODE_COUNT = 2048;
+
+    // EventEntry::flags
+    static const uint8_t EVENT_DEFINED = 0x01;
+
+    // Long-lasting events use the longer persistence table
+    static const uint8_t EVENT_LONG_LASTING = 0x02;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint16_t formatVersion;
+
+        // Location table number (LTN) the locations belong to
+        uint16_t locationTableNumber;
+        uint32_t locationCount;
+        uint32_t stringsSize;
+    };
+
+    struct EventEntry
+    {
+        uint32_t textOffset;
+
+        // Messages for the same location and direction in the same update
+        // class replace each other (ISO 14819-2)
+        uint8_t updateClass;
+        uint8_t flags;
+        uint16_t reserved;
+    };
+
+    struct LocationEntry
+    {
+        uint16_t locationCode;
+        uint8_t locationType;
+        uint8_t reserved;
+
+        // Neighbouring locations, used to walk the extent; 0 if none
+        uint16_t negativeOffset;
+        uint16_t positiveOffset;
+        uint32_t nameOffset;
+    };
+}
+
+#endif  // ifndef TMCTABLEFORMAT_HPP
@@ -0,0 +1,158 @@
+/**************************************************
+ * TmcTables.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Project includes
+#include "TmcTableFormat.hpp"
+#include "TmcTables.hpp"
+
+using TmcTableFormat::EventEntry;
+using TmcTableFormat::FileHeader;
+using TmcTableFormat::LocationEntry;
+
+TmcTables::TmcTables() :
+        mapping(nullptr), mappingSize(0), header(nullptr), events(nullptr), locations(nullptr), strings(nullptr)
+{
+}
+
+TmcTables::~TmcTables()
+{
+    close();
+}
+
+/**
+ * Maps path. Returns false if it isn't a complete table file of this
+ * format version.
+ */
+bool TmcTables::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    void* result = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (result == MAP_FAILED)
+    {
+        mappingSize = 0;
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(result);
+    header = reinterpret_cast<const FileHeader*>(mapping);
+
+    size_t eventsOffset = sizeof(FileHeader);
+    size_t locationsOffset = eventsOffset + TmcTableFormat::EVENT_CODE_COUNT * sizeof(EventEntry);
+    size_t stringsOffset = locationsOffset + static_cast<size_t>(header->locationCount) * sizeof(LocationEntry);
+
+    if (header->magic != TmcTableFormat::FILE_MAGIC || header->formatVersion != TmcTableFormat::FORMAT_VERSION ||
+        stringsOffset + header->stringsSize != mappingSize || header->stringsSize == 0 ||
+        mapping[mappingSize - 1] != '\0')
+    {
+        close();
+        return false;
+    }
+
+    events = reinterpret_cast<const EventEntry*>(mapping + eventsOffset);
+    locations = reinterpret_cast<const LocationEntry*>(mapping + locationsOffset);
+    strings = reinterpret_cast<const char*>(mapping + stringsOffset);
+    return true;
+}
+
+void TmcTables::close()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(mapping), mappingSize);
+    }
+
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    events = nullptr;
+    locations = nullptr;
+    strings = nullptr;
+}
+
+bool TmcTables::isOpen() const
+{
+    return mapping != nullptr;
+}
+
+uint16_t TmcTables::getLocationTableNumber() const
+{
+    return isOpen() ? header->locationTableNumber : 0;
+}
+
+uint32_t TmcTables::getLocationCount() const
+{
+    return isOpen() ? header->locationCount : 0;
+}
+
+const EventEntry* TmcTables::findEvent(uint16_t eventCode) const
+{
+    if (!isOpen() || eventCode >= TmcTableFormat::EVENT_CODE_COUNT ||
+        (events[eventCode].flags & TmcTableFormat::EVENT_DEFINED) == 0)
+    {
+        return nullptr;
+    }
+    return &events[eventCode];
+}
+
+const LocationEntry* TmcTables::findLocation(uint16_t locationCode) const
+{
+    if (!isOpen())
+    {
+        return nullptr;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = header->locationCount;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        if (locations[mid].locationCode < locationCode)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    if (low < header->locationCount && locations[low].locationCode == locationCode)
+    {
+        return &locations[low];
+    }
+    return nullptr;
+}
+
+const char* TmcTables::getString(uint32_t offset) const
+{
+    if (!isOpen() || offset >= header->stringsSize)
+    {
+        return "";
+    }
+    return strings + offset;
+}
@@ -0,0 +1,57 @@
+/**************************************************
+ * TmcTables.hpp - Memory-mapped TMC event and location tables
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TMCTABLES_HPP
+#define TMCTABLES_HPP
+
+// System includes
+#include <cstddef>
+#include <cstdint>
+
+// Project includes
+#include "TmcTableFormat.hpp"
+
+/**
+ * Read-only view of a compiled table file (see TmcTableFormat). Event
+ * lookups index straight into the mapping; location lookups are a binary
+ * search. Only the pages actually looked at are ever read in.
+ */
+class TmcTables
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TmcTables();
+    ~TmcTables();
+
+    bool open(const char* path);
+    void close();
+    bool isOpen() const;
+
+    uint16_t getLocationTableNumber() const;
+    uint32_t getLocationCount() const;
+
+    // nullptr if the code isn't defined
+    const TmcTableFormat::EventEntry* findEvent(uint16_t eventCode) const;
+    const TmcTableFormat::LocationEntry* findLocation(uint16_t locationCode) const;
+
+    // "" if offset is outside the string area
+    const char* getString(uint32_t offset) const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const uint8_t* mapping;
+    size_t mappingSize;
+
+    const TmcTableFormat::FileHeader* header;
+    const TmcTableFormat::EventEntry* events;
+    const TmcTableFormat::LocationEntry* locations;
+    const char* strings;
+};
+
+#endif  // ifndef TMCTABLES_HPP
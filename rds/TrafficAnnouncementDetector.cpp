@@ -0,0 +1,327 @@
+/**************************************************
+ * TrafficAnnouncementDetector.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "TrafficAnnouncementDetector.hpp"
+#include "TrafficAnnouncementListener.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    // Group indices (see RdsDecoder::getGroupIndex())
+    const uint8_t GROUP_0A = 0;
+    const uint8_t GROUP_0B = 1;
+    const uint8_t GROUP_14A = 28;
+    const uint8_t GROUP_14B = 29;
+    const uint8_t GROUP_15B = 31;
+
+    // 14A variants carrying PS segments 0-3, and PTY/TA
+    const uint8_t EON_VARIANT_PS_SEGMENTS = 4;
+    const uint8_t EON_VARIANT_PTY_TA = 13;
+
+    // Votes a block B casts, by RDA5807M::RdsBlockErrors
+    const uint8_t BLOCK_B_VOTES[] = { 2, 1, 0, 0 };
+
+    // Blocks C and D have no error level
+    const uint8_t UNCHECKED_BLOCK_VOTES = 1;
+}
+
+TrafficAnnouncementDetector::TrafficAnnouncementDetector() : listener(nullptr)
+{
+    clearNetwork(tuned, 0);
+    otherNetworkCount = 0;
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+void TrafficAnnouncementDetector::setListener(TrafficAnnouncementListener* listenerParam)
+{
+    listener = listenerParam;
+}
+
+/**
+ * Votes with the group's TP, and TA if it carries one, and tells the
+ * listener before returning if that starts or ends an announcement. A
+ * new PI on block A means another station: whatever the old one was
+ * announcing ends first.
+ */
+void TrafficAnnouncementDetector::processGroup(const RDA5807M::RdsGroup& group, uint64_t readUs)
+{
+    ++stats.groups;
+
+    if (RdsDecoder::isBlockTrusted(group.errorsA))
+    {
+        if (tuned.piCodeKnown && group.blocks[0] != tuned.piCode)
+        {
+            endAll(readUs);
+            clearNetwork(tuned, 0);
+            otherNetworkCount = 0;
+        }
+        tuned.piCode = group.blocks[0];
+        tuned.piCodeKnown = true;
+    }
+
+    uint8_t weight = BLOCK_B_VOTES[static_cast<uint8_t>(group.errorsB)];
+    if (weight == 0)
+    {
+        ++stats.groupsIgnored;
+        return;
+    }
+    ++tuned.groups;
+    tuned.lastHeardUs = readUs;
+
+    uint16_t blockB = group.blocks[1];
+    uint8_t groupIndex = RdsDecoder::getGroupIndex(blockB);
+    uint64_t firstSeenUs = readUs;
+
+    bool changed = vote(tuned.trafficProgram, (blockB & TRAFFIC_PROGRAM) != 0, weight, readUs, firstSeenUs);
+    if (groupIndex == GROUP_0A || groupIndex == GROUP_0B || groupIndex == GROUP_15B)
+    {
+        changed |= vote(tuned.trafficAnnouncement, (blockB & TRAFFIC_ANNOUNCEMENT) != 0, weight, readUs,
+                        firstSeenUs);
+    }
+    if (changed)
+    {
+        updateActive(tuned, false, readUs, firstSeenUs);
+    }
+
+    if (groupIndex == GROUP_14A || groupIndex == GROUP_14B)
+    {
+        processOtherNetwork(group, readUs);
+    }
+}
+
+void TrafficAnnouncementDetector::endAnnouncements()
+{
+    endAll(Util::getMonotonicTimeUs());
+}
+
+void TrafficAnnouncementDetector::reset()
+{
+    endAnnouncements();
+    clearNetwork(tuned, 0);
+    otherNetworkCount = 0;
+}
+
+const TrafficAnnouncementDetector::Network& TrafficAnnouncementDetector::getTunedNetwork() const
+{
+    return tuned;
+}
+
+uint8_t TrafficAnnouncementDetector::getOtherNetworkCount() const
+{
+    return otherNetworkCount;
+}
+
+const TrafficAnnouncementDetector::Network& TrafficAnnouncementDetector::getOtherNetwork(uint8_t index) const
+{
+    return otherNetworks[index];
+}
+
+const TrafficAnnouncementDetector::Stats& TrafficAnnouncementDetector::getStats() const
+{
+    return stats;
+}
+
+void TrafficAnnouncementDetector::clearNetwork(Network& network, uint16_t piCode)
+{
+    std::memset(&network, 0, sizeof(network));
+    network.piCode = piCode;
+    network.piCodeKnown = (piCode != 0);
+    std::memset(network.programService, ' ', RdsDecoder::PS_LENGTH);
+    network.programService[RdsDecoder::PS_LENGTH] = '\0';
+}
+
+/**
+ * Casts weight votes if observed differs from the flag's value, and
+ * returns true once that confirms the change. firstSeenUs is lowered to
+ * when a confirmed change first showed.
+ */
+bool TrafficAnnouncementDetector::vote(Flag& flag, bool observed, uint8_t weight, uint64_t readUs,
+                                       uint64_t& firstSeenUs)
+{
+    if (observed == flag.value)
+    {
+        if (flag.votes > 0)
+        {
+            ++stats.glitchesSuppressed;
+            flag.votes = 0;
+        }
+        return false;
+    }
+
+    if (flag.votes == 0)
+    {
+        flag.firstSeenUs = readUs;
+    }
+    flag.votes = static_cast<uint8_t>(flag.votes + weight);
+    if (flag.votes < CONFIRM_VOTES)
+    {
+        return false;
+    }
+
+    flag.value = observed;
+    flag.votes = 0;
+    if (flag.firstSeenUs < firstSeenUs)
+    {
+        firstSeenUs = flag.firstSeenUs;
+    }
+    return true;
+}
+
+/**
+ * 14A and 14B name the other network's PI in block D. A 14B whose block C
+ * isn't the tuned station's PI, as the standard has it, is too damaged to
+ * use.
+ */
+void TrafficAnnouncementDetector::processOtherNetwork(const RDA5807M::RdsGroup& group, uint64_t readUs)
+{
+    uint16_t blockB = group.blocks[1];
+    uint16_t blockC = group.blocks[2];
+    uint16_t otherPiCode = group.blocks[3];
+    bool versionB = (blockB & VERSION_CODE) != 0;
+
+    if (otherPiCode == 0 || (tuned.piCodeKnown && otherPiCode == tuned.piCode) ||
+        (versionB && tuned.piCodeKnown && blockC != tuned.piCode))
+    {
+        return;
+    }
+    ++stats.eonGroups;
+
+    Network& network = findOtherNetwork(otherPiCode, readUs);
+    ++network.groups;
+    network.lastHeardUs = readUs;
+
+    uint64_t firstSeenUs = readUs;
+    bool changed = vote(network.trafficProgram, (blockB & EON_TRAFFIC_PROGRAM) != 0, UNCHECKED_BLOCK_VOTES, readUs,
+                        firstSeenUs);
+
+    if (versionB)
+    {
+        changed |= vote(network.trafficAnnouncement, (blockB & EON_TRAFFIC_ANNOUNCEMENT_B) != 0,
+                        UNCHECKED_BLOCK_VOTES, readUs, firstSeenUs);
+    }
+    else
+    {
+        uint8_t variant = static_cast<uint8_t>(blockB & EON_VARIANT_CODE);
+        if (variant < EON_VARIANT_PS_SEGMENTS)
+        {
+            network.programService[variant * 2] = static_cast<char>(Util::valueFromReg(blockC, UINT16_UPPER_BYTE));
+            network.programService[variant * 2 + 1] = static_cast<char>(Util::valueFromReg(blockC,
+                                                                                            UINT16_LOWER_BYTE));
+        }
+        else if (variant == EON_VARIANT_PTY_TA)
+        {
+            network.programType = static_cast<uint8_t>(Util::valueFromReg(blockC, EON_PROGRAM_TYPE));
+            changed |= vote(network.trafficAnnouncement, (blockC & EON_TRAFFIC_ANNOUNCEMENT_A) != 0,
+                            UNCHECKED_BLOCK_VOTES, readUs, firstSeenUs);
+        }
+    }
+
+    if (changed)
+    {
+        updateActive(network, true, readUs, firstSeenUs);
+    }
+}
+
+/**
+ * The entry for piCode, taking a new one, or the least recently heard
+ * one's, if it has none
+ */
+TrafficAnnouncementDetector::Network& TrafficAnnouncementDetector::findOtherNetwork(uint16_t piCode,
+                                                                                    uint64_t readUs)
+{
+    uint8_t oldestIdx = 0;
+    for (uint8_t idx = 0; idx < otherNetworkCount; ++idx)
+    {
+        if (otherNetworks[idx].piCode == piCode)
+        {
+            return otherNetworks[idx];
+        }
+        if (otherNetworks[idx].lastHeardUs < otherNetworks[oldestIdx].lastHeardUs)
+        {
+            oldestIdx = idx;
+        }
+    }
+
+    Network* network = nullptr;
+    if (otherNetworkCount < MAX_OTHER_NETWORKS)
+    {
+        network = &otherNetworks[otherNetworkCount++];
+    }
+    else
+    {
+        // A network forgotten mid-announcement still has it ended
+        network = &otherNetworks[oldestIdx];
+        if (network->active)
+        {
+            network->trafficAnnouncement.value = false;
+            updateActive(*network, true, readUs, readUs);
+        }
+    }
+
+    clearNetwork(*network, piCode);
+    return *network;
+}
+
+void TrafficAnnouncementDetector::updateActive(Network& network, bool otherNetwork, uint64_t readUs,
+                                               uint64_t firstSeenUs)
+{
+    bool active = network.trafficProgram.value && network.trafficAnnouncement.value;
+    if (active == network.active)
+    {
+        return;
+    }
+    network.active = active;
+
+    if (otherNetwork)
+    {
+        ++stats.otherNetworkEdges;
+    }
+    else
+    {
+        ++stats.edges;
+    }
+
+    if (listener != nullptr)
+    {
+        TrafficAnnouncementListener::Edge edge;
+        edge.piCode = network.piCode;
+        edge.otherNetwork = otherNetwork;
+        edge.active = active;
+        edge.trafficProgram = network.trafficProgram.value;
+        edge.confirmedUs = readUs;
+        edge.firstSeenUs = firstSeenUs;
+        listener->onTrafficAnnouncement(edge);
+    }
+}
+
+/**
+ * Ends the tuned station's announcement, and any other network's, as of
+ * nowUs
+ */
+void TrafficAnnouncementDetector::endAll(uint64_t nowUs)
+{
+    if (tuned.active)
+    {
+        tuned.trafficAnnouncement.value = false;
+        updateActive(tuned, false, nowUs, nowUs);
+    }
+
+    for (uint8_t idx = 0; idx < otherNetworkCount; ++idx)
+    {
+        if (otherNetworks[idx].active)
+        {
+            otherNetworks[idx].trafficAnnouncement.value = false;
+            updateActive(otherNetworks[idx], true, nowUs, nowUs);
+        }
+    }
+}
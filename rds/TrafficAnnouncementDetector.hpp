@@ -0,0 +1,140 @@
+/**************************************************
+ * TrafficAnnouncementDetector.hpp - Debounced TA/TP edges, own and EON
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TRAFFICANNOUNCEMENTDETECTOR_HPP
+#define TRAFFICANNOUNCEMENTDETECTOR_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "TrafficAnnouncementListener.hpp"
+
+/**
+ * Follows the TP and TA flags of the tuned station and of the other
+ * networks its EON groups describe, and tells a listener the moment an
+ * announcement starts or ends.
+ *
+ * The raw flags are debounced against block B's error level rather than
+ * by waiting a fixed number of groups. Each group showing a flag changed
+ * votes for the change: two votes from a clean block B, one from a
+ * corrected one and none from a damaged one. CONFIRM_VOTES confirm it, so
+ * a clean group acts on its own, within the group period it arrived in,
+ * while a corrected one needs another group to agree. A group showing the
+ * old value again throws the votes away.
+ *
+ * TP comes from every group; TA from 0A, 0B and 15B. Other networks are
+ * learned from 14A (PS segments, and PTY/TA in variant 13) and from the
+ * 14B bursts stations send when another network's TA switches. The chip
+ * reports no error level for blocks C and D, which carry the other
+ * network's PI and TA, so their groups only ever cast one vote.
+ *
+ * Not thread-safe; call from the acquisition thread.
+ */
+class TrafficAnnouncementDetector
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t CONFIRM_VOTES = 2;
+
+    // Least recently heard networks are forgotten beyond this
+    static const uint8_t MAX_OTHER_NETWORKS = 8;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Flag
+    {
+        bool value;
+
+        // Cast for the opposite of value since it last showed
+        uint8_t votes;
+
+        // When the first group showing the latest change, confirmed or
+        // pending, was read
+        uint64_t firstSeenUs;
+    };
+
+    struct Network
+    {
+        uint16_t piCode;
+        bool piCodeKnown;
+
+        Flag trafficProgram;
+        Flag trafficAnnouncement;
+        bool active;
+
+        // Other networks only: from 14A, spaces until received
+        char programService[RdsDecoder::PS_LENGTH + 1];
+        uint8_t programType;
+        uint32_t groups;
+        uint64_t lastHeardUs;
+    };
+
+    struct Stats
+    {
+        uint64_t groups;
+
+        // Block B too damaged to vote
+        uint64_t groupsIgnored;
+        uint64_t eonGroups;
+
+        // Changes that showed in a group but were gone before they were
+        // confirmed
+        uint64_t glitchesSuppressed;
+        uint32_t edges;
+        uint32_t otherNetworkEdges;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TrafficAnnouncementDetector();
+
+    // listener may be nullptr
+    void setListener(TrafficAnnouncementListener* listenerParam);
+
+    // readUs is when the group came off the chip, on the monotonic clock
+    void processGroup(const RDA5807M::RdsGroup& group, uint64_t readUs);
+
+    // Ends any announcement in progress, telling the listener, for when
+    // groups stop being followed. The next group showing TA starts it
+    // again.
+    void endAnnouncements();
+
+    // Ends announcements and forgets everything, after a retune
+    void reset();
+
+    const Network& getTunedNetwork() const;
+    uint8_t getOtherNetworkCount() const;
+    const Network& getOtherNetwork(uint8_t index) const;
+    const Stats& getStats() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    static void clearNetwork(Network& network, uint16_t piCode);
+    bool vote(Flag& flag, bool observed, uint8_t weight, uint64_t readUs, uint64_t& firstSeenUs);
+    void processOtherNetwork(const RDA5807M::RdsGroup& group, uint64_t readUs);
+    Network& findOtherNetwork(uint16_t piCode, uint64_t readUs);
+    void updateActive(Network& network, bool otherNetwork, uint64_t readUs, uint64_t firstSeenUs);
+    void endAll(uint64_t nowUs);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    TrafficAnnouncementListener* listener;
+    Network tuned;
+    Network otherNetworks[MAX_OTHER_NETWORKS];
+    uint8_t otherNetworkCount;
+    Stats stats;
+};
+
+#endif  // ifndef TRAFFICANNOUNCEMENTDETECTOR_HPP
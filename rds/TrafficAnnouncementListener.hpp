@@ -0,0 +1,55 @@
+/**************************************************
+ * TrafficAnnouncementListener.hpp - Interface for acting on traffic announcements
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TRAFFICANNOUNCEMENTLISTENER_HPP
+#define TRAFFICANNOUNCEMENTLISTENER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * Told by a TrafficAnnouncementDetector when an announcement starts or
+ * ends, on the tuned station or on another network it links to through
+ * EON.
+ */
+class TrafficAnnouncementListener
+{
+public:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Edge
+    {
+        uint16_t piCode;
+
+        // Learned through EON (groups 14A/14B) rather than from the tuned
+        // station itself
+        bool otherNetwork;
+
+        // An announcement is on: TP and TA are both set
+        bool active;
+        bool trafficProgram;
+
+        // When the group confirming the edge was read, and when the first
+        // group showing it was. They differ when the confirming group had
+        // to wait for a second one.
+        uint64_t confirmedUs;
+        uint64_t firstSeenUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    virtual ~TrafficAnnouncementListener() {};
+
+    // Called from the detector's processGroup() as soon as the edge is
+    // confirmed, so whatever the listener does counts toward its latency
+    virtual void onTrafficAnnouncement(const Edge& edge) = 0;
+};
+
+#endif  // ifndef TRAFFICANNOUNCEMENTLISTENER_HPP
@@ -0,0 +1,269 @@
+/**************************************************
+ * ParallelSurvey.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BusArbiter.hpp"
+#include "BusTrace.hpp"
+#include "ParallelSurvey.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "Util.hpp"
+
+ParallelSurvey::ParallelSurvey(const std::vector<RDA5807M*>& tunersParam) :
+        tuners(tunersParam), queues(tunersParam.size()), settleTimeMs(DEFAULT_SETTLE_TIME_MS),
+        rdsTimeoutMs(DEFAULT_RDS_TIMEOUT_MS)
+{
+    stats.wallTimeUs = 0;
+    stats.channelsSurveyed = 0;
+    stats.steals = 0;
+}
+
+/**
+ * Sets how long to wait after tuning before sampling RSSI
+ */
+void ParallelSurvey::setSettleTime(uint32_t settleTimeMsParam)
+{
+    settleTimeMs = settleTimeMsParam;
+}
+
+/**
+ * Sets the longest time to wait for RDS on a channel that carries a
+ * station. Channels without a station are never waited on.
+ */
+void ParallelSurvey::setRdsTimeout(uint32_t rdsTimeoutMsParam)
+{
+    rdsTimeoutMs = rdsTimeoutMsParam;
+}
+
+const ParallelSurvey::Stats& ParallelSurvey::getStats() const
+{
+    return stats;
+}
+
+/**
+ * Surveys the whole band and returns the per-channel results keyed by
+ * frequency in kHz.
+ */
+std::map<uint32_t, ParallelSurvey::ChannelResult> ParallelSurvey::run(bool detectRds)
+{
+    std::map<uint32_t, ChannelResult> merged;
+    if (tuners.empty())
+    {
+        return merged;
+    }
+
+    // All tuners must agree on the channel raster
+    RDA5807M::Band band = tuners[0]->getBand();
+    bool fiftyMhzMode = tuners[0]->getFiftyMhzMode();
+    RDA5807M::ChannelSpacing spacing = tuners[0]->getChannelSpacing();
+    for (size_t idx = 1; idx < tuners.size(); ++idx)
+    {
+        tuners[idx]->setBand(band, false);
+        tuners[idx]->setFiftyMhzMode(fiftyMhzMode);
+        tuners[idx]->setChannelSpacing(spacing);
+    }
+
+    // The first tuner may be the one playing; put it back afterwards
+    RDA5807M& mainTuner = *tuners[0];
+    uint16_t reg02 = mainTuner.getLocalRegisterContent(RDA5807M::Register::REG_0x02);
+    bool wasMuted = (reg02 & DMUTE) == 0;
+    bool rdsWasEnabled = (reg02 & RDS_EN) != 0;
+    uint32_t previousKhz = mainTuner.getReadFrequencyKhz();
+
+    // Hand out contiguous chunks of the channel table so each tuner starts
+    // on its own part of the band
+    const ChannelPlanner& planner = tuners[0]->getChannelPlanner();
+    const uint32_t* channelTable = planner.getChannelTable();
+    size_t channelCount = planner.getChannelCount();
+    size_t chunkSize = (channelCount + tuners.size() - 1) / tuners.size();
+    for (size_t idx = 0; idx < channelCount; ++idx)
+    {
+        queues[idx / chunkSize].frequencies.push_back(channelTable[idx]);
+    }
+
+    stats.channelsSurveyed = 0;
+    stats.steals = 0;
+    stats.channelsPerTuner.assign(tuners.size(), 0);
+    stats.busyTimeUsPerTuner.assign(tuners.size(), 0);
+
+    std::vector<std::vector<ChannelResult>> results(tuners.size());
+    std::vector<std::thread> threads;
+    uint64_t start = Util::getMonotonicTimeUs();
+
+    for (size_t idx = 0; idx < tuners.size(); ++idx)
+    {
+        threads.emplace_back(&ParallelSurvey::worker, this, static_cast<uint8_t>(idx), detectRds,
+                             BusTrace::getCurrentCommand(), BusTrace::getCurrentSpan(), std::ref(results[idx]));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    stats.wallTimeUs = Util::getMonotonicTimeUs() - start;
+
+    if (previousKhz != 0)
+    {
+        mainTuner.setFrequencyKhz(previousKhz, false);
+        mainTuner.setTune(true);
+    }
+    mainTuner.setRdsMode(rdsWasEnabled);
+    mainTuner.setMute(wasMuted);
+
+    for (const std::vector<ChannelResult>& tunerResults : results)
+    {
+        for (const ChannelResult& result : tunerResults)
+        {
+            merged[result.frequencyKhz] = result;
+        }
+    }
+    stats.channelsSurveyed = static_cast<uint32_t>(merged.size());
+
+    return merged;
+}
+
+void ParallelSurvey::worker(uint8_t tunerIdx, bool detectRds, uint16_t traceCommand, uint32_t traceSpan,
+                            std::vector<ChannelResult>& results)
+{
+    // Bus traffic on this thread belongs to whichever command started the survey
+    BusTrace::CommandScope traceScope{traceCommand, traceSpan};
+    BusArbiter::ClassScope busClass{BusArbiter::TrafficClass::BACKGROUND_SCAN};
+
+    RDA5807M& tuner = *tuners[tunerIdx];
+    uint32_t channelsDone = 0;
+    uint64_t busyStart = Util::getMonotonicTimeUs();
+
+    tuner.setMute(true);
+
+    uint32_t frequencyKhz = 0;
+    while (takeOwnWork(tunerIdx, frequencyKhz) || stealWork(tunerIdx, frequencyKhz))
+    {
+        ChannelResult result = surveyChannel(tuner, frequencyKhz, detectRds);
+        result.tunerIdx = tunerIdx;
+        results.push_back(result);
+        ++channelsDone;
+    }
+
+    std::lock_guard<std::mutex> guard(statsLock);
+    stats.channelsPerTuner[tunerIdx] = channelsDone;
+    stats.busyTimeUsPerTuner[tunerIdx] = Util::getMonotonicTimeUs() - busyStart;
+}
+
+bool ParallelSurvey::takeOwnWork(uint8_t tunerIdx, uint32_t& frequencyKhz)
+{
+    WorkQueue& queue = queues[tunerIdx];
+    std::lock_guard<std::mutex> guard(queue.lock);
+
+    if (queue.frequencies.empty())
+    {
+        return false;
+    }
+
+    frequencyKhz = queue.frequencies.front();
+    queue.frequencies.pop_front();
+    return true;
+}
+
+/**
+ * Takes the last channel of whichever other tuner has the most channels
+ * left. Returns false once there is nothing left anywhere.
+ */
+bool ParallelSurvey::stealWork(uint8_t thiefIdx, uint32_t& frequencyKhz)
+{
+    while (true)
+    {
+        size_t victimIdx = queues.size();
+        size_t mostRemaining = 0;
+
+        // Sizes are only a hint; the victim is re-checked under its lock
+        for (size_t idx = 0; idx < queues.size(); ++idx)
+        {
+            if (idx == thiefIdx)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(queues[idx].lock);
+            if (queues[idx].frequencies.size() > mostRemaining)
+            {
+                mostRemaining = queues[idx].frequencies.size();
+                victimIdx = idx;
+            }
+        }
+
+        if (victimIdx == queues.size())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> guard(queues[victimIdx].lock);
+        if (!queues[victimIdx].frequencies.empty())
+        {
+            frequencyKhz = queues[victimIdx].frequencies.back();
+            queues[victimIdx].frequencies.pop_back();
+
+            std::lock_guard<std::mutex> statsGuard(statsLock);
+            ++stats.steals;
+            return true;
+        }
+    }
+}
+
+/**
+ * Tunes to frequency, waits for the tuner to settle and samples RSSI and
+ * FM_TRUE. If detectRds is set and the channel carries a station, waits
+ * up to the RDS timeout for the decoder to synchronize and picks up the PI
+ * code.
+ */
+ParallelSurvey::ChannelResult ParallelSurvey::surveyChannel(RDA5807M& tuner, uint32_t frequencyKhz, bool detectRds)
+{
+    static const uint32_t RDS_POLL_INTERVAL_MS = 10;
+    static const uint32_t MICROS_IN_MILLIS = 1000;
+
+    ChannelResult result = {};
+    result.frequencyKhz = frequencyKhz;
+
+    tuner.setFrequencyKhz(frequencyKhz, false);
+    tuner.setTune(true);
+    {
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        usleep(settleTimeMs * MICROS_IN_MILLIS);
+    }
+
+    result.rssi = tuner.getRssi();
+    result.fmTrue = tuner.isFmTrue();
+
+    if (!detectRds || !result.fmTrue)
+    {
+        return result;
+    }
+
+    // Restart RDS so sync reflects this channel only
+    tuner.setRdsMode(false);
+    tuner.setRdsMode(true);
+
+    for (uint32_t waited = 0; waited < rdsTimeoutMs; waited += RDS_POLL_INTERVAL_MS)
+    {
+        RDA5807M::RdsGroup group;
+        if (tuner.readRdsGroup(group) && group.errorsA == RDA5807M::RdsBlockErrors::ZERO_ERRORS)
+        {
+            result.rdsSynchronized = true;
+            result.piCode = group.blocks[0];
+            break;
+        }
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        usleep(RDS_POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+    }
+
+    return result;
+}
@@ -0,0 +1,111 @@
+/**************************************************
+ * ParallelSurvey.hpp - Band survey spread over several tuners
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef PARALLELSURVEY_HPP
+#define PARALLELSURVEY_HPP
+
+// System includes
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Surveys every channel of the band using any number of tuners, each on
+ * its own bus, with one thread per tuner. The channel range is split into
+ * contiguous chunks, one per tuner. A tuner that runs out of channels
+ * steals from the back of the fullest remaining chunk, so a tuner that
+ * gets held up waiting for RDS on several stations doesn't hold up the
+ * whole survey.
+ *
+ * The first tuner's band, 50 MHz mode and channel spacing are applied to
+ * all tuners. The first tuner is put back on its channel afterwards, with
+ * its mute and RDS settings as they were.
+ */
+class ParallelSurvey
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t DEFAULT_SETTLE_TIME_MS = 120;
+    static const uint32_t DEFAULT_RDS_TIMEOUT_MS = 1000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct ChannelResult
+    {
+        uint32_t frequencyKhz;
+        uint8_t rssi;
+        bool fmTrue;
+        bool rdsSynchronized;
+        uint16_t piCode;
+
+        // Index of the tuner that surveyed the channel
+        uint8_t tunerIdx;
+    };
+
+    struct Stats
+    {
+        uint64_t wallTimeUs;
+        uint32_t channelsSurveyed;
+        uint32_t steals;
+
+        // Per tuner, in the order the tuners were given
+        std::vector<uint32_t> channelsPerTuner;
+        std::vector<uint64_t> busyTimeUsPerTuner;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    ParallelSurvey(const std::vector<RDA5807M*>& tunersParam);
+
+    void setSettleTime(uint32_t settleTimeMsParam);
+    void setRdsTimeout(uint32_t rdsTimeoutMsParam);
+
+    std::map<uint32_t, ChannelResult> run(bool detectRds);
+
+    const Stats& getStats() const;
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+
+    // The channels still to be surveyed by one tuner. The owner takes from
+    // the front, thieves take from the back.
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<uint32_t> frequencies;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void worker(uint8_t tunerIdx, bool detectRds, uint16_t traceCommand, uint32_t traceSpan,
+                std::vector<ChannelResult>& results);
+    bool takeOwnWork(uint8_t tunerIdx, uint32_t& frequencyKhz);
+    bool stealWork(uint8_t thiefIdx, uint32_t& frequencyKhz);
+    ChannelResult surveyChannel(RDA5807M& tuner, uint32_t frequencyKhz, bool detectRds);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::vector<RDA5807M*> tuners;
+    std::vector<WorkQueue> queues;
+    uint32_t settleTimeMs;
+    uint32_t rdsTimeoutMs;
+    Stats stats;
+    std::mutex statsLock;
+};
+
+#endif  // ifndef PARALLELSURVEY_HPP
@@ -0,0 +1,283 @@
+/**************************************************
+ * TargetedSearch.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BusTrace.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "TargetedSearch.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    const uint32_t POLL_INTERVAL_MS = 5;
+    const uint32_t MICROS_IN_MILLIS = 1000;
+
+    const char* const OUTCOME_TO_STRING[] = { "match", "no station", "PI mismatch", "PTY mismatch", "no RDS" };
+
+    // Rank of a channel in the search order, lowest first
+    enum ChannelRank
+    {
+        KNOWN_MATCH = 0,
+        SEEN = 1,
+        UNSEEN = 2,
+        KNOWN_MISMATCH = 3
+    };
+
+    struct Candidate
+    {
+        uint32_t frequencyKhz;
+        ChannelRank rank;
+        uint8_t rssi;
+    };
+}
+
+TargetedSearch::TargetedSearch(RDA5807M& tunerParam) :
+        tuner(tunerParam), rdsTimeoutMs(DEFAULT_RDS_TIMEOUT_MS)
+{
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+void TargetedSearch::setRdsTimeout(uint32_t rdsTimeoutMsParam)
+{
+    rdsTimeoutMs = rdsTimeoutMsParam;
+}
+
+/**
+ * Runs query over the current band, learning into history as it goes.
+ * The tuner is muted while the search passes over the band. It is left on
+ * the first hit, or put back on the channel it was on if there was none,
+ * and its mute and RDS settings are put back as they were.
+ */
+std::vector<TargetedSearch::Hit> TargetedSearch::run(const Query& query, History& history)
+{
+    std::memset(&stats, 0, sizeof(stats));
+    std::vector<Hit> hits;
+
+    if (!query.matchPiCode && !query.matchProgramType)
+    {
+        return hits;
+    }
+
+    uint64_t start = Util::getMonotonicTimeUs();
+    std::vector<uint32_t> order = orderChannels(query, history);
+
+    uint16_t reg02 = tuner.getLocalRegisterContent(RDA5807M::Register::REG_0x02);
+    bool wasMuted = (reg02 & DMUTE) == 0;
+    bool rdsWasEnabled = (reg02 & RDS_EN) != 0;
+    uint32_t previousKhz = tuner.getReadFrequencyKhz();
+    tuner.setMute(true);
+
+    for (uint32_t frequencyKhz : order)
+    {
+        uint64_t channelStart = Util::getMonotonicTimeUs();
+
+        // Start from what was known, so a timeout doesn't forget the PI
+        ChannelHistory learned = {};
+        History::const_iterator known = history.find(frequencyKhz);
+        if (known != history.end())
+        {
+            learned = known->second;
+        }
+
+        Outcome outcome = tryChannel(query, frequencyKhz, learned);
+        history[frequencyKhz] = learned;
+
+        ++stats.channelsTried;
+        ++stats.outcomes[static_cast<int>(outcome)];
+
+        uint64_t now = Util::getMonotonicTimeUs();
+        if (outcome != Outcome::MATCH)
+        {
+            stats.rejectTimeUs += now - channelStart;
+            continue;
+        }
+
+        Hit hit;
+        hit.frequencyKhz = frequencyKhz;
+        hit.piCode = learned.piCode;
+        hit.programType = learned.programType;
+        hit.rssi = learned.rssi;
+        hit.timeToHitUs = now - start;
+        hits.push_back(hit);
+
+        if (!query.findAll)
+        {
+            break;
+        }
+    }
+
+    uint32_t finalKhz = hits.empty() ? previousKhz : hits.front().frequencyKhz;
+    if (finalKhz != 0)
+    {
+        tune(finalKhz);
+    }
+    tuner.setRdsMode(rdsWasEnabled);
+    tuner.setMute(wasMuted);
+
+    stats.wallTimeUs = Util::getMonotonicTimeUs() - start;
+    return hits;
+}
+
+const TargetedSearch::Stats& TargetedSearch::getStats() const
+{
+    return stats;
+}
+
+const char* TargetedSearch::outcomeToString(Outcome outcome)
+{
+    return OUTCOME_TO_STRING[static_cast<int>(outcome)];
+}
+
+/**
+ * Returns every channel of the band, most promising first
+ */
+std::vector<uint32_t> TargetedSearch::orderChannels(const Query& query, const History& history) const
+{
+    const ChannelPlanner& planner = tuner.getChannelPlanner();
+    const uint32_t* channelTable = planner.getChannelTable();
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(planner.getChannelCount());
+
+    for (uint16_t chan = 0; chan < planner.getChannelCount(); ++chan)
+    {
+        Candidate candidate = { channelTable[chan], UNSEEN, 0 };
+
+        History::const_iterator known = history.find(candidate.frequencyKhz);
+        if (known != history.end())
+        {
+            const ChannelHistory& entry = known->second;
+            candidate.rssi = entry.rssi;
+            candidate.rank = SEEN;
+
+            bool piDecided = query.matchPiCode && entry.piCodeKnown;
+            bool ptyDecided = query.matchProgramType && entry.programTypeKnown;
+            bool piMatches = !query.matchPiCode || (entry.piCodeKnown && entry.piCode == query.piCode);
+            bool ptyMatches = !query.matchProgramType ||
+                              (entry.programTypeKnown && entry.programType == query.programType);
+
+            if ((piDecided && entry.piCode != query.piCode) ||
+                (ptyDecided && entry.programType != query.programType) || !entry.fmTrue)
+            {
+                candidate.rank = KNOWN_MISMATCH;
+            }
+            else if (piMatches && ptyMatches)
+            {
+                candidate.rank = KNOWN_MATCH;
+            }
+        }
+
+        candidates.push_back(candidate);
+    }
+
+    // Stable, so channels of equal rank and RSSI stay in band order
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& left, const Candidate& right)
+                     {
+                         if (left.rank != right.rank)
+                         {
+                             return left.rank < right.rank;
+                         }
+                         return left.rssi > right.rssi;
+                     });
+
+    std::vector<uint32_t> order;
+    order.reserve(candidates.size());
+    for (const Candidate& candidate : candidates)
+    {
+        order.push_back(candidate.frequencyKhz);
+    }
+    return order;
+}
+
+/**
+ * Tunes to frequencyKhz and reads groups until they either confirm every
+ * part of the query or a trusted block contradicts one. learned is
+ * updated with everything observed.
+ */
+TargetedSearch::Outcome TargetedSearch::tryChannel(const Query& query, uint32_t frequencyKhz, ChannelHistory& learned)
+{
+    tune(frequencyKhz);
+
+    learned.rssi = tuner.getRssi();
+    learned.fmTrue = tuner.isFmTrue();
+    if (!learned.fmTrue)
+    {
+        return Outcome::NO_STATION;
+    }
+
+    // Restart RDS so nothing from the previous channel is read
+    tuner.setRdsMode(false);
+    tuner.setRdsMode(true);
+
+    bool piConfirmed = !query.matchPiCode;
+    bool ptyConfirmed = !query.matchProgramType;
+
+    for (uint32_t waited = 0; waited < rdsTimeoutMs; waited += POLL_INTERVAL_MS)
+    {
+        RDA5807M::RdsGroup group;
+        if (!tuner.readRdsGroup(group))
+        {
+            BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+            usleep(POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+            continue;
+        }
+
+        if (RdsDecoder::isBlockTrusted(group.errorsA))
+        {
+            learned.piCodeKnown = true;
+            learned.piCode = group.blocks[0];
+
+            if (query.matchPiCode && learned.piCode != query.piCode)
+            {
+                return Outcome::PI_MISMATCH;
+            }
+            piConfirmed = true;
+        }
+
+        if (RdsDecoder::isBlockTrusted(group.errorsB))
+        {
+            learned.programTypeKnown = true;
+            learned.programType = static_cast<uint8_t>(Util::valueFromReg(group.blocks[1], PROGRAM_TYPE));
+
+            if (query.matchProgramType && learned.programType != query.programType)
+            {
+                return Outcome::PTY_MISMATCH;
+            }
+            ptyConfirmed = true;
+        }
+
+        if (piConfirmed && ptyConfirmed)
+        {
+            return Outcome::MATCH;
+        }
+    }
+
+    return Outcome::NO_RDS;
+}
+
+/**
+ * Tunes to frequencyKhz and waits up to TUNE_TIMEOUT_MS for STC
+ */
+void TargetedSearch::tune(uint32_t frequencyKhz)
+{
+    tuner.setFrequencyKhz(frequencyKhz, false);
+    tuner.setTune(true);
+
+    for (uint32_t waited = 0; waited < TUNE_TIMEOUT_MS && !tuner.isStcComplete(); waited += POLL_INTERVAL_MS)
+    {
+        BusTrace::Span sleepSpan{BusTraceFormat::Op::SLEEP};
+        usleep(POLL_INTERVAL_MS * MICROS_IN_MILLIS);
+    }
+}
@@ -0,0 +1,126 @@
+/**************************************************
+ * TargetedSearch.hpp - Finds a station by PI code or program type
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TARGETEDSEARCH_HPP
+#define TARGETEDSEARCH_HPP
+
+// System includes
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Searches the band for stations carrying a given PI code and/or program
+ * type. Channels are tried most promising first: those already known to
+ * match, then by the strongest RSSI seen before, then channels never
+ * seen, and channels known not to match last.
+ *
+ * Each channel is left as soon as its answer is known: immediately if
+ * there is no station, and on the first trusted block A (PI) or block B
+ * (PTY) that disagrees with the query. Trust in a block is decided by
+ * RdsDecoder::isBlockTrusted() from the chip's error level for it.
+ *
+ * What is learned about every channel tried is written back to the
+ * history, so later searches get faster.
+ */
+class TargetedSearch
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // Longest wait for STC after starting a tune
+    static const uint32_t TUNE_TIMEOUT_MS = 100;
+
+    // Longest wait for a verdict from RDS on a channel with a station
+    static const uint32_t DEFAULT_RDS_TIMEOUT_MS = 1000;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Outcome {MATCH, NO_STATION, PI_MISMATCH, PTY_MISMATCH, NO_RDS};
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Query
+    {
+        bool matchPiCode;
+        uint16_t piCode;
+        bool matchProgramType;
+        uint8_t programType;
+
+        // Keep going after the first hit
+        bool findAll;
+    };
+
+    // What is known about a channel from earlier surveys and searches
+    struct ChannelHistory
+    {
+        uint8_t rssi;
+        bool fmTrue;
+        bool piCodeKnown;
+        uint16_t piCode;
+        bool programTypeKnown;
+        uint8_t programType;
+    };
+
+    using History = std::map<uint32_t, ChannelHistory>;
+
+    struct Hit
+    {
+        uint32_t frequencyKhz;
+        uint16_t piCode;
+        uint8_t programType;
+        uint8_t rssi;
+
+        // From the start of the search
+        uint64_t timeToHitUs;
+    };
+
+    struct Stats
+    {
+        uint64_t wallTimeUs;
+        uint32_t channelsTried;
+        uint32_t outcomes[5];
+
+        // Time spent on channels that turned out not to match
+        uint64_t rejectTimeUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TargetedSearch(RDA5807M& tunerParam);
+
+    void setRdsTimeout(uint32_t rdsTimeoutMsParam);
+
+    std::vector<Hit> run(const Query& query, History& history);
+
+    const Stats& getStats() const;
+
+    static const char* outcomeToString(Outcome outcome);
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    std::vector<uint32_t> orderChannels(const Query& query, const History& history) const;
+    Outcome tryChannel(const Query& query, uint32_t frequencyKhz, ChannelHistory& learned);
+    void tune(uint32_t frequencyKhz);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& tuner;
+    uint32_t rdsTimeoutMs;
+    Stats stats;
+};
+
+#endif  // ifndef TARGETEDSEARCH_HPP
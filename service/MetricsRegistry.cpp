@@ -0,0 +1,334 @@
+/**************************************************
+ * MetricsRegistry.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Project includes
+#include "MetricsRegistry.hpp"
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "Util.hpp"
+
+// Static initialization
+const uint64_t MetricsRegistry::HISTOGRAM_BOUNDS_US[HISTOGRAM_BUCKET_COUNT] =
+{
+    100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 60000000
+};
+
+namespace
+{
+    const char* const BLOCK_ERROR_LEVEL_LABELS[] = { "0", "1-2", "3-5", "6+" };
+    const char* const NETWORK_LABELS[] = { "tuned", "other" };
+    const char* const EDGE_LABELS[] = { "end", "start" };
+
+    void appendLine(std::string& output, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    void appendLine(std::string& output, const char* format, ...)
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        output.append(buffer);
+    }
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+    frequencyKhz.store(0, std::memory_order_relaxed);
+    rssi.store(0, std::memory_order_relaxed);
+    stereo.store(false, std::memory_order_relaxed);
+    fmTrue.store(false, std::memory_order_relaxed);
+    rdsSynchronized.store(false, std::memory_order_relaxed);
+    tunerUpdatedUs.store(0, std::memory_order_relaxed);
+
+    for (std::atomic<uint64_t>& counter : groupsByType)
+    {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (uint8_t level = 0; level < BLOCK_ERROR_LEVEL_COUNT; ++level)
+    {
+        blockAErrors[level].store(0, std::memory_order_relaxed);
+        blockBErrors[level].store(0, std::memory_order_relaxed);
+    }
+
+    resetHistogram(scanDurations);
+
+    trafficAnnouncementActive.store(false, std::memory_order_relaxed);
+    for (uint8_t network = 0; network < 2; ++network)
+    {
+        trafficAnnouncementEdges[network][0].store(0, std::memory_order_relaxed);
+        trafficAnnouncementEdges[network][1].store(0, std::memory_order_relaxed);
+        resetHistogram(trafficAnnouncementLatencies[network]);
+    }
+    resetHistogram(trafficAnnouncementDebounce);
+
+    for (uint8_t idx = 0; idx < MAX_COMMANDS; ++idx)
+    {
+        commandNames[idx].store(nullptr, std::memory_order_relaxed);
+        resetHistogram(commandLatencies[idx]);
+    }
+}
+
+void MetricsRegistry::setTunerState(uint32_t frequencyKhzParam, uint8_t rssiParam, bool stereoParam,
+                                    bool fmTrueParam, bool rdsSynchronizedParam)
+{
+    frequencyKhz.store(frequencyKhzParam, std::memory_order_relaxed);
+    rssi.store(rssiParam, std::memory_order_relaxed);
+    stereo.store(stereoParam, std::memory_order_relaxed);
+    fmTrue.store(fmTrueParam, std::memory_order_relaxed);
+    rdsSynchronized.store(rdsSynchronizedParam, std::memory_order_relaxed);
+    tunerUpdatedUs.store(Util::getRealtimeUs(), std::memory_order_relaxed);
+}
+
+/**
+ * Counts group by type and the error levels of blocks A and B. The type
+ * is counted even if block B was damaged; the error counters say how far
+ * to trust it.
+ */
+void MetricsRegistry::recordGroup(const RDA5807M::RdsGroup& group)
+{
+    groupsByType[RdsDecoder::getGroupIndex(group.blocks[1])].fetch_add(1, std::memory_order_relaxed);
+    blockAErrors[static_cast<uint8_t>(group.errorsA)].fetch_add(1, std::memory_order_relaxed);
+    blockBErrors[static_cast<uint8_t>(group.errorsB)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::recordScanDuration(uint64_t durationUs)
+{
+    observe(scanDurations, durationUs);
+}
+
+/**
+ * Finds command's slot by pointer, claiming a free one the first time the
+ * command is seen
+ */
+void MetricsRegistry::recordCommandLatency(const char* command, uint64_t durationUs)
+{
+    for (uint8_t idx = 0; idx < MAX_COMMANDS; ++idx)
+    {
+        const char* name = commandNames[idx].load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            const char* expected = nullptr;
+            if (commandNames[idx].compare_exchange_strong(expected, command, std::memory_order_acq_rel))
+            {
+                name = command;
+            }
+            else
+            {
+                name = expected;
+            }
+        }
+
+        if (name == command)
+        {
+            observe(commandLatencies[idx], durationUs);
+            return;
+        }
+    }
+}
+
+void MetricsRegistry::recordTrafficAnnouncement(bool otherNetwork, bool active, uint64_t actionLatencyUs,
+                                                uint64_t debounceUs)
+{
+    uint8_t network = otherNetwork ? 1 : 0;
+    if (!otherNetwork)
+    {
+        trafficAnnouncementActive.store(active, std::memory_order_relaxed);
+    }
+    trafficAnnouncementEdges[network][active ? 1 : 0].fetch_add(1, std::memory_order_relaxed);
+    observe(trafficAnnouncementLatencies[network], actionLatencyUs);
+    observe(trafficAnnouncementDebounce, debounceUs);
+}
+
+/**
+ * Renders every metric in the Prometheus text exposition format (0.0.4)
+ */
+std::string MetricsRegistry::format(const RDA5807M::BusStats& busStats) const
+{
+    std::string output;
+    output.reserve(16384);
+
+    output.append("# HELP rda5807m_frequency_hz Frequency the tuner reports it is on\n"
+                  "# TYPE rda5807m_frequency_hz gauge\n");
+    appendLine(output, "rda5807m_frequency_hz %llu\n",
+               static_cast<unsigned long long>(frequencyKhz.load(std::memory_order_relaxed)) * 1000ULL);
+
+    output.append("# HELP rda5807m_rssi Received signal strength, 0-127\n"
+                  "# TYPE rda5807m_rssi gauge\n");
+    appendLine(output, "rda5807m_rssi %u\n", rssi.load(std::memory_order_relaxed));
+
+    output.append("# HELP rda5807m_stereo 1 if the tuner is receiving stereo\n"
+                  "# TYPE rda5807m_stereo gauge\n");
+    appendLine(output, "rda5807m_stereo %d\n", stereo.load(std::memory_order_relaxed) ? 1 : 0);
+
+    output.append("# HELP rda5807m_fm_true 1 if the current channel is a station\n"
+                  "# TYPE rda5807m_fm_true gauge\n");
+    appendLine(output, "rda5807m_fm_true %d\n", fmTrue.load(std::memory_order_relaxed) ? 1 : 0);
+
+    output.append("# HELP rda5807m_rds_synchronized 1 if the RDS decoder is synchronized\n"
+                  "# TYPE rda5807m_rds_synchronized gauge\n");
+    appendLine(output, "rda5807m_rds_synchronized %d\n", rdsSynchronized.load(std::memory_order_relaxed) ? 1 : 0);
+
+    output.append("# HELP rda5807m_tuner_state_timestamp_seconds When the tuner state above was read\n"
+                  "# TYPE rda5807m_tuner_state_timestamp_seconds gauge\n");
+    uint64_t updatedUs = tunerUpdatedUs.load(std::memory_order_relaxed);
+    appendLine(output, "rda5807m_tuner_state_timestamp_seconds %llu.%06llu\n",
+               static_cast<unsigned long long>(updatedUs / 1000000),
+               static_cast<unsigned long long>(updatedUs % 1000000));
+
+    output.append("# HELP rda5807m_i2c_transactions_total I2C transactions issued by the driver\n"
+                  "# TYPE rda5807m_i2c_transactions_total counter\n");
+    appendLine(output, "rda5807m_i2c_transactions_total{op=\"read\"} %u\n", busStats.reads);
+    appendLine(output, "rda5807m_i2c_transactions_total{op=\"write\"} %u\n", busStats.writes);
+
+    output.append("# HELP rda5807m_i2c_errors_total I2C transactions that failed\n"
+                  "# TYPE rda5807m_i2c_errors_total counter\n");
+    appendLine(output, "rda5807m_i2c_errors_total{op=\"read\"} %u\n", busStats.readErrors);
+    appendLine(output, "rda5807m_i2c_errors_total{op=\"write\"} %u\n", busStats.writeErrors);
+
+    output.append("# HELP rda5807m_rds_groups_total RDS groups read, by group type\n"
+                  "# TYPE rda5807m_rds_groups_total counter\n");
+    for (uint8_t groupIdx = 0; groupIdx < GROUP_TYPE_COUNT; ++groupIdx)
+    {
+        uint64_t count = groupsByType[groupIdx].load(std::memory_order_relaxed);
+        if (count > 0)
+        {
+            appendLine(output, "rda5807m_rds_groups_total{type=\"%u%c\"} %llu\n", groupIdx >> 1,
+                       (groupIdx & 0x1) ? 'B' : 'A', static_cast<unsigned long long>(count));
+        }
+    }
+
+    output.append("# HELP rda5807m_rds_block_errors_total RDS blocks read, by the chip's error level\n"
+                  "# TYPE rda5807m_rds_block_errors_total counter\n");
+    for (uint8_t level = 0; level < BLOCK_ERROR_LEVEL_COUNT; ++level)
+    {
+        appendLine(output, "rda5807m_rds_block_errors_total{block=\"A\",errors=\"%s\"} %llu\n",
+                   BLOCK_ERROR_LEVEL_LABELS[level],
+                   static_cast<unsigned long long>(blockAErrors[level].load(std::memory_order_relaxed)));
+        appendLine(output, "rda5807m_rds_block_errors_total{block=\"B\",errors=\"%s\"} %llu\n",
+                   BLOCK_ERROR_LEVEL_LABELS[level],
+                   static_cast<unsigned long long>(blockBErrors[level].load(std::memory_order_relaxed)));
+    }
+
+    output.append("# HELP rda5807m_scan_duration_seconds Wall time of band surveys and waterfall sweeps\n"
+                  "# TYPE rda5807m_scan_duration_seconds histogram\n");
+    formatHistogram(output, "rda5807m_scan_duration_seconds", "", scanDurations);
+
+    output.append("# HELP rda5807m_traffic_announcement 1 while the tuned station is announcing\n"
+                  "# TYPE rda5807m_traffic_announcement gauge\n");
+    appendLine(output, "rda5807m_traffic_announcement %d\n",
+               trafficAnnouncementActive.load(std::memory_order_relaxed) ? 1 : 0);
+
+    output.append("# HELP rda5807m_traffic_announcement_edges_total Debounced announcement starts and ends\n"
+                  "# TYPE rda5807m_traffic_announcement_edges_total counter\n");
+    for (uint8_t network = 0; network < 2; ++network)
+    {
+        for (uint8_t edge = 0; edge < 2; ++edge)
+        {
+            appendLine(output, "rda5807m_traffic_announcement_edges_total{network=\"%s\",edge=\"%s\"} %llu\n",
+                       NETWORK_LABELS[network], EDGE_LABELS[edge],
+                       static_cast<unsigned long long>(
+                               trafficAnnouncementEdges[network][edge].load(std::memory_order_relaxed)));
+        }
+    }
+
+    output.append("# HELP rda5807m_traffic_announcement_action_seconds From reading the group confirming an "
+                  "announcement edge to acting on it\n"
+                  "# TYPE rda5807m_traffic_announcement_action_seconds histogram\n");
+    for (uint8_t network = 0; network < 2; ++network)
+    {
+        char labels[32];
+        std::snprintf(labels, sizeof(labels), "network=\"%s\"", NETWORK_LABELS[network]);
+        formatHistogram(output, "rda5807m_traffic_announcement_action_seconds", labels,
+                        trafficAnnouncementLatencies[network]);
+    }
+
+    output.append("# HELP rda5807m_traffic_announcement_debounce_seconds From the first group showing an "
+                  "announcement edge to the one confirming it\n"
+                  "# TYPE rda5807m_traffic_announcement_debounce_seconds histogram\n");
+    formatHistogram(output, "rda5807m_traffic_announcement_debounce_seconds", "", trafficAnnouncementDebounce);
+
+    output.append("# HELP rda5807m_command_duration_seconds Time to execute a command, by command\n"
+                  "# TYPE rda5807m_command_duration_seconds histogram\n");
+    for (uint8_t idx = 0; idx < MAX_COMMANDS; ++idx)
+    {
+        const char* name = commandNames[idx].load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            break;
+        }
+
+        char labels[64];
+        std::snprintf(labels, sizeof(labels), "command=\"%s\"", name);
+        formatHistogram(output, "rda5807m_command_duration_seconds", labels, commandLatencies[idx]);
+    }
+
+    return output;
+}
+
+void MetricsRegistry::resetHistogram(Histogram& histogram)
+{
+    for (std::atomic<uint64_t>& bucket : histogram.buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    histogram.sumUs.store(0, std::memory_order_relaxed);
+    histogram.count.store(0, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::observe(Histogram& histogram, uint64_t valueUs)
+{
+    uint8_t bucketIdx = 0;
+    while (bucketIdx < HISTOGRAM_BUCKET_COUNT && valueUs > HISTOGRAM_BOUNDS_US[bucketIdx])
+    {
+        ++bucketIdx;
+    }
+
+    histogram.buckets[bucketIdx].fetch_add(1, std::memory_order_relaxed);
+    histogram.sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Appends the cumulative _bucket series and _sum/_count of histogram.
+ * labels, if not empty, are prepended to each series' own labels.
+ */
+void MetricsRegistry::formatHistogram(std::string& output, const char* name, const char* labels,
+                                      const Histogram& histogram)
+{
+    const char* separator = (labels[0] != '\0') ? "," : "";
+    uint64_t cumulative = 0;
+
+    for (uint8_t bucketIdx = 0; bucketIdx <= HISTOGRAM_BUCKET_COUNT; ++bucketIdx)
+    {
+        cumulative += histogram.buckets[bucketIdx].load(std::memory_order_relaxed);
+
+        if (bucketIdx < HISTOGRAM_BUCKET_COUNT)
+        {
+            appendLine(output, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, separator,
+                       static_cast<double>(HISTOGRAM_BOUNDS_US[bucketIdx]) / 1e6,
+                       static_cast<unsigned long long>(cumulative));
+        }
+        else
+        {
+            appendLine(output, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator,
+                       static_cast<unsigned long long>(cumulative));
+        }
+    }
+
+    const char* braceOpen = (labels[0] != '\0') ? "{" : "";
+    const char* braceClose = (labels[0] != '\0') ? "}" : "";
+    appendLine(output, "%s_sum%s%s%s %.6f\n", name, braceOpen, labels, braceClose,
+               static_cast<double>(histogram.sumUs.load(std::memory_order_relaxed)) / 1e6);
+    appendLine(output, "%s_count%s%s%s %llu\n", name, braceOpen, labels, braceClose,
+               static_cast<unsigned long long>(histogram.count.load(std::memory_order_relaxed)));
+}
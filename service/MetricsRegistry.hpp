@@ -0,0 +1,116 @@
+/**************************************************
+ * MetricsRegistry.hpp - Lock-free tuner, bus and decoder metrics
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef METRICSREGISTRY_HPP
+#define METRICSREGISTRY_HPP
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Project includes
+#include "RDA5807M.hpp"
+
+/**
+ * Counters and gauges updated from the bus thread with relaxed atomic
+ * stores and increments, and rendered in the Prometheus text format from
+ * any other thread. Recording never takes a lock or allocates, so it can
+ * sit on the acquisition path.
+ *
+ * Values are read one at a time, so a histogram rendered while it is
+ * being updated may have a count one off from its buckets. Scrapers
+ * don't mind.
+ */
+class MetricsRegistry
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+
+    // Group types 0A-15B
+    static const uint8_t GROUP_TYPE_COUNT = 32;
+
+    // One per RDA5807M::RdsBlockErrors level
+    static const uint8_t BLOCK_ERROR_LEVEL_COUNT = 4;
+
+    // Commands beyond this many distinct names aren't timed
+    static const uint8_t MAX_COMMANDS = 96;
+
+    // Upper bounds of the histogram buckets, in microseconds. There is an
+    // implicit +Inf bucket after the last one.
+    static const uint8_t HISTOGRAM_BUCKET_COUNT = 12;
+    static const uint64_t HISTOGRAM_BOUNDS_US[HISTOGRAM_BUCKET_COUNT];
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    MetricsRegistry();
+
+    void setTunerState(uint32_t frequencyKhz, uint8_t rssi, bool stereo, bool fmTrue, bool rdsSynchronized);
+    void recordGroup(const RDA5807M::RdsGroup& group);
+    void recordScanDuration(uint64_t durationUs);
+
+    // command must stay valid for the life of the registry (e.g. a name
+    // from a static command table)
+    void recordCommandLatency(const char* command, uint64_t durationUs);
+
+    // A traffic announcement edge: the time from the group confirming it
+    // being read to the action taken being done, and from the first group
+    // showing it to the confirming one
+    void recordTrafficAnnouncement(bool otherNetwork, bool active, uint64_t actionLatencyUs, uint64_t debounceUs);
+
+    std::string format(const RDA5807M::BusStats& busStats) const;
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Histogram
+    {
+        // The last entry is the +Inf bucket. Buckets aren't cumulative
+        // here; format() sums them.
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKET_COUNT + 1];
+        std::atomic<uint64_t> sumUs;
+        std::atomic<uint64_t> count;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    static void resetHistogram(Histogram& histogram);
+    static void observe(Histogram& histogram, uint64_t valueUs);
+    static void formatHistogram(std::string& output, const char* name, const char* labels,
+                                const Histogram& histogram);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::atomic<uint32_t> frequencyKhz;
+    std::atomic<uint32_t> rssi;
+    std::atomic<bool> stereo;
+    std::atomic<bool> fmTrue;
+    std::atomic<bool> rdsSynchronized;
+    std::atomic<uint64_t> tunerUpdatedUs;
+
+    std::atomic<uint64_t> groupsByType[GROUP_TYPE_COUNT];
+    std::atomic<uint64_t> blockAErrors[BLOCK_ERROR_LEVEL_COUNT];
+    std::atomic<uint64_t> blockBErrors[BLOCK_ERROR_LEVEL_COUNT];
+
+    Histogram scanDurations;
+
+    // Tuned station, then other networks
+    std::atomic<bool> trafficAnnouncementActive;
+    std::atomic<uint64_t> trafficAnnouncementEdges[2][2];
+    Histogram trafficAnnouncementLatencies[2];
+    Histogram trafficAnnouncementDebounce;
+
+    // A slot is claimed by storing its command name, once
+    std::atomic<const char*> commandNames[MAX_COMMANDS];
+    Histogram commandLatencies[MAX_COMMANDS];
+};
+
+#endif  // ifndef METRICSREGISTRY_HPP
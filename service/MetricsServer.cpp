@@ -0,0 +1,197 @@
+/**************************************************
+ * MetricsServer.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+// Project includes
+#include "MetricsRegistry.hpp"
+#include "MetricsServer.hpp"
+#include "RDA5807M.hpp"
+
+namespace
+{
+    const char* const METRICS_PATH = "/metrics";
+
+    /**
+     * Sends all of data, giving up if the client stops reading
+     */
+    void sendFully(int fd, const char* data, size_t length)
+    {
+        while (length > 0)
+        {
+            ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+            if (sent <= 0)
+            {
+                return;
+            }
+            data += sent;
+            length -= static_cast<size_t>(sent);
+        }
+    }
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry& registryParam, const RDA5807M& radioParam) :
+        registry(registryParam), radio(radioParam), listenFd(-1), port(0)
+{
+    stopRequested.store(false);
+    scrapeCount.store(0);
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+/**
+ * Starts serving on 127.0.0.1:portParam. Returns false if the port can't
+ * be bound.
+ */
+bool MetricsServer::start(uint16_t portParam)
+{
+    stop();
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(portParam);
+
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, 8) != 0)
+    {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    port = portParam;
+    stopRequested.store(false);
+    serverThread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (serverThread.joinable())
+    {
+        stopRequested.store(true);
+        serverThread.join();
+    }
+
+    if (listenFd >= 0)
+    {
+        ::close(listenFd);
+        listenFd = -1;
+    }
+    port = 0;
+}
+
+bool MetricsServer::isRunning() const
+{
+    return listenFd >= 0;
+}
+
+uint16_t MetricsServer::getPort() const
+{
+    return port;
+}
+
+uint64_t MetricsServer::getScrapeCount() const
+{
+    return scrapeCount.load(std::memory_order_relaxed);
+}
+
+void MetricsServer::serve()
+{
+    struct pollfd pfd = { listenFd, POLLIN, 0 };
+
+    while (!stopRequested.load())
+    {
+        if (poll(&pfd, 1, STOP_POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd >= 0)
+        {
+            handleClient(clientFd);
+            ::close(clientFd);
+        }
+    }
+}
+
+/**
+ * Reads the request line and answers it. Headers are ignored; only GET
+ * /metrics is served.
+ */
+void MetricsServer::handleClient(int clientFd)
+{
+    // Don't let a client that stops reading hold the server forever
+    struct timeval sendTimeout = { REQUEST_TIMEOUT_MS / 1000, 0 };
+    setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+    char request[512];
+    size_t received = 0;
+    struct pollfd pfd = { clientFd, POLLIN, 0 };
+
+    while (received < sizeof(request) - 1 && std::memchr(request, '\n', received) == nullptr)
+    {
+        if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0)
+        {
+            return;
+        }
+
+        ssize_t bytes = recv(clientFd, request + received, sizeof(request) - 1 - received, 0);
+        if (bytes <= 0)
+        {
+            return;
+        }
+        received += static_cast<size_t>(bytes);
+    }
+    request[received] = '\0';
+
+    char method[8] = {0};
+    char path[64] = {0};
+    if (std::sscanf(request, "%7s %63s", method, path) != 2 || std::strcmp(method, "GET") != 0 ||
+        std::strcmp(path, METRICS_PATH) != 0)
+    {
+        const char* notFound = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n"
+                               "Content-Length: 10\r\nConnection: close\r\n\r\nNot found\n";
+        sendFully(clientFd, notFound, std::strlen(notFound));
+        return;
+    }
+
+    std::string body = registry.format(radio.getBusStats());
+
+    char header[160];
+    int headerLength = std::snprintf(header, sizeof(header),
+                                     "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: %zu\r\nConnection: close\r\n\r\n", body.size());
+    sendFully(clientFd, header, static_cast<size_t>(headerLength));
+    sendFully(clientFd, body.data(), body.size());
+
+    scrapeCount.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+/**************************************************
+ * MetricsServer.hpp - Serves MetricsRegistry over HTTP for scraping
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef METRICSSERVER_HPP
+#define METRICSSERVER_HPP
+
+// System includes
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Project includes
+#include "MetricsRegistry.hpp"
+#include "RDA5807M.hpp"
+
+/**
+ * A minimal HTTP/1.0 server on the loopback interface answering
+ * GET /metrics. It runs on its own thread and only reads atomics (the
+ * registry and the driver's bus counters), so a slow or stuck scraper
+ * never holds up the bus thread.
+ */
+class MetricsServer
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint16_t DEFAULT_PORT = 9105;
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    MetricsServer(const MetricsRegistry& registryParam, const RDA5807M& radioParam);
+    ~MetricsServer();
+
+    bool start(uint16_t port = DEFAULT_PORT);
+    void stop();
+    bool isRunning() const;
+    uint16_t getPort() const;
+
+    uint64_t getScrapeCount() const;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+
+    // How often the server thread checks whether it should stop
+    static const int STOP_POLL_INTERVAL_MS = 200;
+
+    // A client gets this long to send its request line
+    static const int REQUEST_TIMEOUT_MS = 1000;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void serve();
+    void handleClient(int clientFd);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const MetricsRegistry& registry;
+    const RDA5807M& radio;
+
+    int listenFd;
+    uint16_t port;
+    std::atomic<bool> stopRequested;
+    std::atomic<uint64_t> scrapeCount;
+    std::thread serverThread;
+};
+
+#endif  // ifndef METRICSSERVER_HPP
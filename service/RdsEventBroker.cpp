@@ -0,0 +1,400 @@
+/**************************************************
+ * RdsEventBroker.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "RdsEventBroker.hpp"
+#include "RdsEventProtocol.hpp"
+#include "Util.hpp"
+
+using RdsEventProtocol::Event;
+using RdsEventProtocol::EventType;
+
+RdsEventBroker::RdsEventBroker() : listenFd(-1), head(0)
+{
+    std::memset(socketPath, 0, sizeof(socketPath));
+    std::memset(ring, 0, sizeof(ring));
+    std::memset(&stats, 0, sizeof(stats));
+
+    for (Subscriber& subscriber : subscribers)
+    {
+        subscriber.fd = -1;
+    }
+
+    lastProgramService[0] = '\0';
+    lastRadioText[0] = '\0';
+    lastTrafficAnnouncement = false;
+    lastTrafficProgram = false;
+    lastPiCode = RdsEventProtocol::ANY_PI_CODE;
+}
+
+RdsEventBroker::~RdsEventBroker()
+{
+    close();
+}
+
+/**
+ * Starts listening on socketPath, replacing any stale socket left there
+ */
+bool RdsEventBroker::open(const char* socketPathParam)
+{
+    close();
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(socketPathParam) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPathParam);
+
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        return false;
+    }
+
+    unlink(socketPathParam);
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, MAX_SUBSCRIBERS) != 0)
+    {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    std::strcpy(socketPath, socketPathParam);
+    return true;
+}
+
+void RdsEventBroker::close()
+{
+    for (Subscriber& subscriber : subscribers)
+    {
+        if (subscriber.fd >= 0)
+        {
+            disconnect(subscriber);
+        }
+    }
+
+    if (listenFd >= 0)
+    {
+        ::close(listenFd);
+        unlink(socketPath);
+        listenFd = -1;
+    }
+}
+
+bool RdsEventBroker::isOpen() const
+{
+    return listenFd >= 0;
+}
+
+/**
+ * Adds group to the ring, along with events for any PS, RT or TA change
+ * the decoder reports after processing it. Only touches memory; sending
+ * happens in service().
+ */
+void RdsEventBroker::publish(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder)
+{
+    const RdsDecoder::RdsData& data = decoder.getData();
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+
+    Event& groupEvent = appendEvent(EventType::GROUP, group.blocks[0], nowUs);
+    groupEvent.groupIndex = RdsDecoder::getGroupIndex(group.blocks[1]);
+    std::memcpy(groupEvent.blocks, group.blocks, sizeof(groupEvent.blocks));
+    groupEvent.errorsA = static_cast<uint8_t>(group.errorsA);
+    groupEvent.errorsB = static_cast<uint8_t>(group.errorsB);
+
+    // A new station starts from a clean slate rather than reporting
+    // the old station's text as having changed
+    if (data.piCode != lastPiCode)
+    {
+        lastPiCode = data.piCode;
+        lastProgramService[0] = '\0';
+        lastRadioText[0] = '\0';
+        lastTrafficAnnouncement = data.trafficAnnouncement;
+        lastTrafficProgram = data.trafficProgram;
+    }
+
+    if (decoder.isProgramServiceComplete() && std::strcmp(data.programService, lastProgramService) != 0)
+    {
+        std::strcpy(lastProgramService, data.programService);
+        Event& event = appendEvent(EventType::PS_CHANGED, data.piCode, nowUs);
+        std::strcpy(event.text, data.programService);
+    }
+
+    if (decoder.isRadioTextComplete() && std::strcmp(data.radioText, lastRadioText) != 0)
+    {
+        std::strcpy(lastRadioText, data.radioText);
+        Event& event = appendEvent(EventType::RT_CHANGED, data.piCode, nowUs);
+        std::strcpy(event.text, data.radioText);
+    }
+
+    if (data.trafficAnnouncement != lastTrafficAnnouncement || data.trafficProgram != lastTrafficProgram)
+    {
+        lastTrafficAnnouncement = data.trafficAnnouncement;
+        lastTrafficProgram = data.trafficProgram;
+        Event& event = appendEvent(EventType::TA_CHANGED, data.piCode, nowUs);
+        event.trafficAnnouncement = data.trafficAnnouncement;
+        event.trafficProgram = data.trafficProgram;
+    }
+}
+
+/**
+ * Adds a traffic announcement edge to the ring. Call service() straight
+ * after to have it sent without waiting for the rest of the loop.
+ */
+void RdsEventBroker::publishTrafficAnnouncement(uint16_t piCode, bool active, bool trafficProgram, bool otherNetwork)
+{
+    Event& event = appendEvent(EventType::ANNOUNCEMENT, piCode, Util::getMonotonicTimeUs());
+    event.trafficAnnouncement = active;
+    event.trafficProgram = trafficProgram;
+    event.otherNetwork = otherNetwork;
+}
+
+/**
+ * Overwrites the oldest ring slot. Subscribers never lag by more than
+ * MAX_QUEUE_DEPTH, so the slot is never one still waiting to be sent.
+ */
+Event& RdsEventBroker::appendEvent(EventType type, uint16_t piCode, uint64_t timestampUs)
+{
+    Event& event = ring[head % RING_CAPACITY];
+    std::memset(&event, 0, sizeof(event));
+    event.sequence = head;
+    event.timestampUs = timestampUs;
+    event.type = type;
+    event.piCode = piCode;
+
+    ++head;
+    ++stats.eventsPublished;
+    return event;
+}
+
+/**
+ * Accepts new subscribers, picks up filter changes and sends whatever
+ * each subscriber can take without blocking
+ */
+void RdsEventBroker::service()
+{
+    if (!isOpen())
+    {
+        return;
+    }
+
+    acceptSubscribers();
+
+    uint64_t nowUs = Util::getMonotonicTimeUs();
+    for (Subscriber& subscriber : subscribers)
+    {
+        if (subscriber.fd < 0)
+        {
+            continue;
+        }
+
+        readSubscribeRequests(subscriber);
+        if (subscriber.fd >= 0 && subscriber.subscribed)
+        {
+            flushSubscriber(subscriber, nowUs);
+        }
+    }
+}
+
+void RdsEventBroker::acceptSubscribers()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        Subscriber* freeSlot = nullptr;
+        for (Subscriber& subscriber : subscribers)
+        {
+            if (subscriber.fd < 0)
+            {
+                freeSlot = &subscriber;
+                break;
+            }
+        }
+
+        if (freeSlot == nullptr)
+        {
+            ::close(fd);
+            continue;
+        }
+
+        freeSlot->fd = fd;
+        freeSlot->subscribed = false;
+        freeSlot->unreportedDrops = 0;
+        ++stats.subscribers;
+        ++stats.subscribersAccepted;
+    }
+}
+
+/**
+ * Takes the latest of any queued requests. The first one starts the
+ * subscriber at the current head of the ring.
+ */
+void RdsEventBroker::readSubscribeRequests(Subscriber& subscriber)
+{
+    RdsEventProtocol::SubscribeRequest request;
+    while (true)
+    {
+        ssize_t received = recv(subscriber.fd, &request, sizeof(request), MSG_DONTWAIT);
+        if (received == 0)
+        {
+            disconnect(subscriber);
+            return;
+        }
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                disconnect(subscriber);
+            }
+            return;
+        }
+
+        if (received != sizeof(request) || request.magic != RdsEventProtocol::SUBSCRIBE_MAGIC ||
+            request.protocolVersion != RdsEventProtocol::PROTOCOL_VERSION)
+        {
+            disconnect(subscriber);
+            return;
+        }
+
+        if (!subscriber.subscribed)
+        {
+            subscriber.cursor = head;
+            subscriber.lastProgressUs = Util::getMonotonicTimeUs();
+            subscriber.subscribed = true;
+        }
+        subscriber.filter = request;
+    }
+}
+
+bool RdsEventBroker::matches(const Subscriber& subscriber, const Event& event)
+{
+    const RdsEventProtocol::SubscribeRequest& filter = subscriber.filter;
+
+    if ((filter.eventMask & (1 << static_cast<uint8_t>(event.type))) == 0)
+    {
+        return false;
+    }
+
+    if (filter.piCode != RdsEventProtocol::ANY_PI_CODE && filter.piCode != event.piCode)
+    {
+        return false;
+    }
+
+    return event.type != EventType::GROUP || (filter.groupTypeMask & (1UL << event.groupIndex)) != 0;
+}
+
+/**
+ * Sends matching events in batches until the subscriber is caught up or
+ * its socket is full
+ */
+void RdsEventBroker::flushSubscriber(Subscriber& subscriber, uint64_t nowUs)
+{
+    // Bound the queue by dropping the oldest events
+    if (head - subscriber.cursor > MAX_QUEUE_DEPTH)
+    {
+        uint64_t skipped = head - subscriber.cursor - MAX_QUEUE_DEPTH;
+        subscriber.cursor += skipped;
+        subscriber.unreportedDrops += static_cast<uint32_t>(skipped);
+        stats.eventsDropped += skipped;
+
+        if (nowUs - subscriber.lastProgressUs > SLOW_CONSUMER_TIMEOUT_MS * 1000ULL)
+        {
+            ++stats.slowConsumersDisconnected;
+            disconnect(subscriber);
+            return;
+        }
+    }
+
+    while (true)
+    {
+        struct iovec iov[SEND_BATCH];
+        uint8_t iovCount = 0;
+        uint64_t scan = subscriber.cursor;
+
+        if (subscriber.unreportedDrops > 0)
+        {
+            std::memset(&subscriber.dropNotice, 0, sizeof(subscriber.dropNotice));
+            subscriber.dropNotice.sequence = subscriber.cursor;
+            subscriber.dropNotice.timestampUs = nowUs;
+            subscriber.dropNotice.type = EventType::DROPPED;
+            subscriber.dropNotice.droppedEvents = subscriber.unreportedDrops;
+            iov[iovCount].iov_base = &subscriber.dropNotice;
+            iov[iovCount].iov_len = sizeof(Event);
+            ++iovCount;
+        }
+
+        for (; scan < head && iovCount < SEND_BATCH; ++scan)
+        {
+            Event& event = ring[scan % RING_CAPACITY];
+            if (matches(subscriber, event))
+            {
+                iov[iovCount].iov_base = &event;
+                iov[iovCount].iov_len = sizeof(Event);
+                ++iovCount;
+            }
+        }
+
+        if (iovCount == 0)
+        {
+            subscriber.cursor = scan;
+            subscriber.lastProgressUs = nowUs;
+            return;
+        }
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = iovCount;
+
+        // SOCK_SEQPACKET sends the whole batch or nothing
+        if (sendmsg(subscriber.fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+            {
+                disconnect(subscriber);
+            }
+            return;
+        }
+
+        stats.eventsDelivered += iovCount - (subscriber.unreportedDrops > 0 ? 1 : 0);
+        subscriber.unreportedDrops = 0;
+        subscriber.cursor = scan;
+        subscriber.lastProgressUs = nowUs;
+    }
+}
+
+void RdsEventBroker::disconnect(Subscriber& subscriber)
+{
+    ::close(subscriber.fd);
+    subscriber.fd = -1;
+    subscriber.subscribed = false;
+    --stats.subscribers;
+}
+
+RdsEventBroker::Stats RdsEventBroker::getStats() const
+{
+    return stats;
+}
@@ -0,0 +1,129 @@
+/**************************************************
+ * RdsEventBroker.hpp - Fans RDS groups and events out to local subscribers
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDSEVENTBROKER_HPP
+#define RDSEVENTBROKER_HPP
+
+// System includes
+#include <cstdint>
+#include <sys/uio.h>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "RdsEventProtocol.hpp"
+
+/**
+ * Every published group, every PS, RT and TA change it causes, and every
+ * debounced traffic announcement edge, is written once into a shared ring
+ * of events. Each subscriber only keeps a cursor into the ring; service()
+ * sends the events matching its filter straight out of the ring slots
+ * with one non-blocking sendmsg() per batch, so nothing is copied per
+ * subscriber and nothing ever blocks the acquisition loop.
+ *
+ * A subscriber more than MAX_QUEUE_DEPTH events behind loses the oldest
+ * ones and is sent a DROPPED notice. One that makes no progress at all
+ * for SLOW_CONSUMER_TIMEOUT_MS while overflowing is disconnected.
+ *
+ * Single threaded: publish() and service() must be called from the same
+ * thread.
+ */
+class RdsEventBroker
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t RING_CAPACITY = 1024;
+    static const uint32_t MAX_QUEUE_DEPTH = 256;
+    static const uint8_t MAX_SUBSCRIBERS = 64;
+    static const uint32_t SLOW_CONSUMER_TIMEOUT_MS = 5000;
+
+    // Events per sendmsg()
+    static const uint8_t SEND_BATCH = 32;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint64_t eventsPublished;
+        uint64_t eventsDelivered;
+        uint64_t eventsDropped;
+        uint32_t subscribers;
+        uint32_t subscribersAccepted;
+        uint32_t slowConsumersDisconnected;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    RdsEventBroker();
+    ~RdsEventBroker();
+
+    bool open(const char* socketPath = RdsEventProtocol::DEFAULT_SOCKET_PATH);
+    void close();
+    bool isOpen() const;
+
+    void publish(const RDA5807M::RdsGroup& group, const RdsDecoder& decoder);
+    void publishTrafficAnnouncement(uint16_t piCode, bool active, bool trafficProgram, bool otherNetwork);
+
+    void service();
+
+    Stats getStats() const;
+
+private:
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Subscriber
+    {
+        int fd;
+        bool subscribed;
+        RdsEventProtocol::SubscribeRequest filter;
+
+        // Sequence number of the next event to look at
+        uint64_t cursor;
+        uint64_t lastProgressUs;
+
+        // Events dropped and not yet reported in a DROPPED notice
+        uint32_t unreportedDrops;
+        RdsEventProtocol::Event dropNotice;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    RdsEventProtocol::Event& appendEvent(RdsEventProtocol::EventType type, uint16_t piCode, uint64_t timestampUs);
+    void acceptSubscribers();
+    void readSubscribeRequests(Subscriber& subscriber);
+    void flushSubscriber(Subscriber& subscriber, uint64_t nowUs);
+    void disconnect(Subscriber& subscriber);
+    static bool matches(const Subscriber& subscriber, const RdsEventProtocol::Event& event);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    int listenFd;
+    char socketPath[108];
+
+    RdsEventProtocol::Event ring[RING_CAPACITY];
+
+    // Sequence number the next event will get
+    uint64_t head;
+
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+
+    // What the last published PS/RT/TA were, to detect changes
+    char lastProgramService[RdsDecoder::PS_LENGTH + 1];
+    char lastRadioText[RdsDecoder::RT_LENGTH + 1];
+    bool lastTrafficAnnouncement;
+    bool lastTrafficProgram;
+    uint16_t lastPiCode;
+
+    Stats stats;
+};
+
+#endif  // ifndef RDSEVENTBROKER_HPP
@@ -0,0 +1,99 @@
+/**************************************************
+ * RdsEventProtocol.hpp - Wire format of the RDS event socket
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef RDSEVENTPROTOCOL_HPP
+#define RDSEVENTPROTOCOL_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RdsDecoder.hpp"
+
+/**
+ * Clients connect to the broker's SOCK_SEQPACKET Unix socket and send a
+ * SubscribeRequest; sending another one replaces the filter. From then on
+ * every message they receive is one or more whole Events.
+ *
+ * All fields are host byte order; the socket is local only. Bump
+ * PROTOCOL_VERSION whenever a structure changes.
+ */
+namespace RdsEventProtocol
+{
+    static const char* const DEFAULT_SOCKET_PATH = "/tmp/rda5807m_rds.sock";
+
+    static const uint32_t SUBSCRIBE_MAGIC = 0x53534452; // "RDSS"
+    static const uint16_t PROTOCOL_VERSION = 2;
+
+    enum class EventType : uint8_t
+    {
+        GROUP = 0,
+        PS_CHANGED = 1,
+        RT_CHANGED = 2,
+        TA_CHANGED = 3,
+
+        // The subscriber fell behind; droppedEvents were skipped
+        DROPPED = 4,
+
+        // A debounced traffic announcement started or ended, on the tuned
+        // station or, with otherNetwork set, on one it links to
+        ANNOUNCEMENT = 5
+    };
+
+    // Bits of SubscribeRequest::eventMask, one per EventType. DROPPED
+    // notices are always sent.
+    static const uint16_t EVENT_MASK_GROUP = 1 << static_cast<uint8_t>(EventType::GROUP);
+    static const uint16_t EVENT_MASK_PS_CHANGED = 1 << static_cast<uint8_t>(EventType::PS_CHANGED);
+    static const uint16_t EVENT_MASK_RT_CHANGED = 1 << static_cast<uint8_t>(EventType::RT_CHANGED);
+    static const uint16_t EVENT_MASK_TA_CHANGED = 1 << static_cast<uint8_t>(EventType::TA_CHANGED);
+    static const uint16_t EVENT_MASK_ANNOUNCEMENT = 1 << static_cast<uint8_t>(EventType::ANNOUNCEMENT);
+    static const uint16_t EVENT_MASK_ALL = 0x002F;
+
+    // PI code value that matches every station
+    static const uint16_t ANY_PI_CODE = 0x0000;
+
+    struct SubscribeRequest
+    {
+        uint32_t magic;
+        uint16_t protocolVersion;
+        uint16_t eventMask;
+
+        // Only events from this PI, or ANY_PI_CODE
+        uint16_t piCode;
+        uint16_t reserved;
+
+        // Bit n set passes GROUP events of RdsDecoder::getGroupIndex() n.
+        // Decoded events aren't filtered by group type.
+        uint32_t groupTypeMask;
+    };
+
+    struct Event
+    {
+        uint64_t sequence;
+        uint64_t timestampUs;
+        EventType type;
+        uint8_t groupIndex;
+        uint16_t piCode;
+
+        // GROUP: raw blocks and error levels (RDA5807M::RdsBlockErrors)
+        uint16_t blocks[4];
+        uint8_t errorsA;
+        uint8_t errorsB;
+
+        // TA_CHANGED: the new TA and TP flags. ANNOUNCEMENT: whether the
+        // announcement is on, TP, and whether it is on another network.
+        bool trafficAnnouncement;
+        bool trafficProgram;
+        bool otherNetwork;
+
+        // DROPPED: number of events skipped
+        uint32_t droppedEvents;
+
+        // PS_CHANGED / RT_CHANGED: the new text, null-terminated
+        char text[RdsDecoder::RT_LENGTH + 4];
+    };
+};
+
+#endif  // ifndef RDSEVENTPROTOCOL_HPP
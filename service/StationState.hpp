@@ -0,0 +1,76 @@
+/**************************************************
+ * StationState.hpp - Shared memory layout of the published tuner state
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef STATIONSTATE_HPP
+#define STATIONSTATE_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RdsDecoder.hpp"
+#include "SeqLock.hpp"
+
+/**
+ * Everything here is shared between processes, so it must stay trivially
+ * copyable and must not contain pointers. Bump LAYOUT_VERSION
+ * whenever the layout changes.
+ */
+namespace StationStateLayout
+{
+    // Default name passed to shm_open()
+    static const char* const DEFAULT_SHM_NAME = "/rda5807m_station_state";
+
+    static const uint32_t SEGMENT_MAGIC = 0x52444135; // "RDA5"
+    static const uint32_t LAYOUT_VERSION = 3;
+
+    // Number of raw groups kept in the history ring
+    static const uint32_t GROUP_HISTORY_LENGTH = 32;
+}
+
+struct GroupRecord
+{
+    // CLOCK_REALTIME at the time the group was read
+    uint64_t timestampNs;
+    uint16_t blocks[4];
+    uint8_t errorsA;
+    uint8_t errorsB;
+};
+
+struct StationState
+{
+    // CLOCK_REALTIME at the time of publication
+    uint64_t timestampNs;
+
+    // Status snapshot. The raw registers 0x0A and 0x0B are kept alongside
+    // the fields derived from them.
+    uint16_t statusRegisters[2];
+    uint32_t frequencyKhz;
+    uint8_t rssi;
+    bool stcComplete;
+    bool stereo;
+    bool fmTrue;
+    bool fmReady;
+    bool rdsSynchronized;
+
+    // Decoded RDS fields and decoder counters
+    RdsDecoder::RdsData rds;
+    RdsDecoder::Counters rdsCounters;
+
+    // Total number of groups ever recorded. The newest group lives at
+    // groupHistory[(groupHistoryCount - 1) % GROUP_HISTORY_LENGTH]
+    uint32_t groupHistoryCount;
+    GroupRecord groupHistory[StationStateLayout::GROUP_HISTORY_LENGTH];
+};
+
+struct StationStateSegment
+{
+    uint32_t magic;
+    uint32_t layoutVersion;
+    uint32_t segmentSize;
+    SeqLock<StationState> state;
+};
+
+#endif  // ifndef STATIONSTATE_HPP
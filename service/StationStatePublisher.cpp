@@ -0,0 +1,186 @@
+/**************************************************
+ * StationStatePublisher.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsDecoder.hpp"
+#include "StationState.hpp"
+#include "StationStatePublisher.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    uint64_t realtimeNs()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+    }
+}
+
+StationStatePublisher::StationStatePublisher(const char* shmNameParam) :
+        shmName(shmNameParam), segment(nullptr), publishCount(0)
+{
+    std::memset(&working, 0, sizeof(working));
+}
+
+StationStatePublisher::~StationStatePublisher()
+{
+    close();
+}
+
+/**
+ * Creates (or reuses) the shared memory segment and maps it. Returns false
+ * if the segment could not be created or mapped.
+ *
+ * A segment left by an earlier publisher with the same layout is taken
+ * over as it is: readers may still be attached to it, and resetting its
+ * sequence under them could let one accept a torn copy. They keep seeing
+ * the last published state until the first publish().
+ */
+bool StationStatePublisher::open()
+{
+    if (segment != nullptr)
+    {
+        return true;
+    }
+
+    int fd = shm_open(shmName, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    bool rightSize = info.st_size == static_cast<off_t>(sizeof(StationStateSegment));
+
+    if (!rightSize && ftruncate(fd, sizeof(StationStateSegment)) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(StationStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    StationStateSegment* existing = static_cast<StationStateSegment*>(mapping);
+    if (rightSize && __atomic_load_n(&existing->magic, __ATOMIC_ACQUIRE) == StationStateLayout::SEGMENT_MAGIC &&
+        existing->layoutVersion == StationStateLayout::LAYOUT_VERSION &&
+        existing->segmentSize == sizeof(StationStateSegment))
+    {
+        segment = existing;
+        return true;
+    }
+
+    // New, or not a segment readers would accept. Readers check the magic
+    // number last, so clear it first and only set it once the segment is
+    // fully constructed.
+    __atomic_store_n(&existing->magic, 0, __ATOMIC_RELEASE);
+    segment = new (mapping) StationStateSegment();
+    segment->layoutVersion = StationStateLayout::LAYOUT_VERSION;
+    segment->segmentSize = sizeof(StationStateSegment);
+    segment->state.store(working);
+    __atomic_store_n(&segment->magic, StationStateLayout::SEGMENT_MAGIC, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Unmaps the segment. The segment itself is left in place so readers keep
+ * seeing the last published state.
+ */
+void StationStatePublisher::close()
+{
+    if (segment != nullptr)
+    {
+        munmap(segment, sizeof(StationStateSegment));
+        segment = nullptr;
+    }
+}
+
+bool StationStatePublisher::isOpen() const
+{
+    return segment != nullptr;
+}
+
+/**
+ * Copies the status registers (0x0A and 0x0B) out of the radio's *LOCAL*
+ * register map. Nothing is read from the device.
+ */
+void StationStatePublisher::updateStatus(RDA5807M& radio)
+{
+    uint16_t regA = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0A);
+    uint16_t regB = radio.getLocalRegisterContent(RDA5807M::Register::REG_0x0B);
+
+    working.statusRegisters[0] = regA;
+    working.statusRegisters[1] = regB;
+    working.frequencyKhz = radio.getChannelPlanner().channelToKhz(Util::valueFromReg(regA, READCHAN));
+    working.rssi = static_cast<uint8_t>(Util::valueFromReg(regB, RSSI));
+    working.stcComplete = Util::valueFromReg(regA, STC) != 0;
+    working.stereo = Util::valueFromReg(regA, ST) != 0;
+    working.fmTrue = Util::valueFromReg(regB, FM_TRUE) != 0;
+    working.fmReady = Util::valueFromReg(regB, FM_READY) != 0;
+    working.rdsSynchronized = Util::valueFromReg(regA, RDSS) != 0;
+}
+
+void StationStatePublisher::updateRds(const RdsDecoder& decoder)
+{
+    working.rds = decoder.getData();
+    working.rdsCounters = decoder.getCounters();
+}
+
+/**
+ * Appends group to the history ring
+ */
+void StationStatePublisher::recordGroup(const RDA5807M::RdsGroup& group)
+{
+    GroupRecord& record = working.groupHistory[working.groupHistoryCount % StationStateLayout::GROUP_HISTORY_LENGTH];
+    record.timestampNs = realtimeNs();
+    std::memcpy(record.blocks, group.blocks, sizeof(record.blocks));
+    record.errorsA = static_cast<uint8_t>(group.errorsA);
+    record.errorsB = static_cast<uint8_t>(group.errorsB);
+
+    ++working.groupHistoryCount;
+}
+
+/**
+ * Makes the working copy visible to readers. Never blocks.
+ */
+void StationStatePublisher::publish()
+{
+    if (segment == nullptr)
+    {
+        return;
+    }
+
+    working.timestampNs = realtimeNs();
+    segment->state.store(working);
+    ++publishCount;
+}
+
+uint32_t StationStatePublisher::getPublishCount() const
+{
+    return publishCount;
+}
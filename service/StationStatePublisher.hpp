@@ -0,0 +1,54 @@
+/**************************************************
+ * StationStatePublisher.hpp - Publishes tuner state to shared memory
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef STATIONSTATEPUBLISHER_HPP
+#define STATIONSTATEPUBLISHER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807M.hpp"
+#include "RdsDecoder.hpp"
+#include "StationState.hpp"
+
+/**
+ * Owns the POSIX shared memory segment that other processes read with
+ * StationStateReader. There must only be one publisher per segment name.
+ * The update* functions only modify a private working copy; nothing is
+ * visible to readers until publish() is called.
+ */
+class StationStatePublisher
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    StationStatePublisher(const char* shmNameParam = StationStateLayout::DEFAULT_SHM_NAME);
+    ~StationStatePublisher();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    void updateStatus(RDA5807M& radio);
+    void updateRds(const RdsDecoder& decoder);
+    void recordGroup(const RDA5807M::RdsGroup& group);
+
+    void publish();
+
+    uint32_t getPublishCount() const;
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const char* shmName;
+    StationStateSegment* segment;
+    StationState working;
+    uint32_t publishCount;
+};
+
+#endif  // ifndef STATIONSTATEPUBLISHER_HPP
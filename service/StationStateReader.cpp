@@ -0,0 +1,128 @@
+/**************************************************
+ * StationStateReader.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Project includes
+#include "StationState.hpp"
+#include "StationStateReader.hpp"
+
+StationStateReader::StationStateReader(const char* shmNameParam) :
+        shmName(shmNameParam), segment(nullptr)
+{
+}
+
+StationStateReader::~StationStateReader()
+{
+    close();
+}
+
+/**
+ * Maps the segment read-only. Returns false if the segment doesn't exist
+ * (yet), or if it was created by an incompatible publisher.
+ */
+bool StationStateReader::open()
+{
+    if (segment != nullptr)
+    {
+        return true;
+    }
+
+    int fd = shm_open(shmName, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(StationStateSegment)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(StationStateSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const StationStateSegment* candidate = static_cast<const StationStateSegment*>(mapping);
+    if (__atomic_load_n(&candidate->magic, __ATOMIC_ACQUIRE) != StationStateLayout::SEGMENT_MAGIC ||
+        candidate->layoutVersion != StationStateLayout::LAYOUT_VERSION ||
+        candidate->segmentSize != sizeof(StationStateSegment))
+    {
+        munmap(mapping, sizeof(StationStateSegment));
+        return false;
+    }
+
+    segment = candidate;
+    return true;
+}
+
+void StationStateReader::close()
+{
+    if (segment != nullptr)
+    {
+        munmap(const_cast<StationStateSegment*>(segment), sizeof(StationStateSegment));
+        segment = nullptr;
+    }
+}
+
+bool StationStateReader::isOpen() const
+{
+    return segment != nullptr;
+}
+
+/**
+ * Makes a single, wait-free attempt at copying out the current state.
+ * Returns false if not open or if the attempt raced with a publish.
+ */
+bool StationStateReader::tryRead(StationState& out) const
+{
+    if (segment == nullptr)
+    {
+        return false;
+    }
+    return segment->state.tryLoad(out);
+}
+
+/**
+ * Copies out the current state, retrying if the copy raced with a publish.
+ */
+bool StationStateReader::read(StationState& out) const
+{
+    if (segment == nullptr)
+    {
+        return false;
+    }
+
+    for (uint32_t attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+    {
+        if (segment->state.tryLoad(out))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns the number of states published so far. Cheap enough to poll.
+ */
+uint32_t StationStateReader::getVersion() const
+{
+    if (segment == nullptr)
+    {
+        return 0;
+    }
+    return segment->state.getVersion();
+}
@@ -0,0 +1,54 @@
+/**************************************************
+ * StationStateReader.hpp - Reads tuner state published in shared memory
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef STATIONSTATEREADER_HPP
+#define STATIONSTATEREADER_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "StationState.hpp"
+
+/**
+ * Read-only view of a segment created by StationStatePublisher. Any number
+ * of readers, in any number of processes, may be attached at once. Reading
+ * never touches the I2C bus and never blocks the publisher.
+ */
+class StationStateReader
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    StationStateReader(const char* shmNameParam = StationStateLayout::DEFAULT_SHM_NAME);
+    ~StationStateReader();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    bool tryRead(StationState& out) const;
+    bool read(StationState& out) const;
+
+    uint32_t getVersion() const;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+
+    // A reader gives up after this many consecutive torn reads. This can
+    // only happen if the publisher died mid-store.
+    static const uint32_t MAX_READ_ATTEMPTS = 1000;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const char* shmName;
+    const StationStateSegment* segment;
+};
+
+#endif  // ifndef STATIONSTATEREADER_HPP
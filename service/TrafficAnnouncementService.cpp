@@ -0,0 +1,136 @@
+/**************************************************
+ * TrafficAnnouncementService.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <cstdint>
+
+// Project includes
+#include "MetricsRegistry.hpp"
+#include "RDA5807M.hpp"
+#include "RDA5807MRegDefines.hpp"
+#include "RdsEventBroker.hpp"
+#include "StreamingStats.hpp"
+#include "TrafficAnnouncementListener.hpp"
+#include "TrafficAnnouncementService.hpp"
+#include "Util.hpp"
+
+TrafficAnnouncementService::TrafficAnnouncementService(RDA5807M& radioParam, RdsEventBroker& brokerParam,
+                                                       MetricsRegistry& metricsParam) :
+        radio(radioParam), broker(brokerParam), metrics(metricsParam), mode(Mode::SWITCH_AUDIO),
+        announcementVolume(DEFAULT_ANNOUNCEMENT_VOLUME), audioSwitched(false), savedVolume(0), savedMute(false)
+{
+    stats.edges = 0;
+    stats.otherNetworkEdges = 0;
+    stats.lateActions = 0;
+    stats.maxActionLatencyUs = 0;
+}
+
+/**
+ * Leaving SWITCH_AUDIO mid-announcement puts the audio back
+ */
+void TrafficAnnouncementService::setMode(Mode modeParam)
+{
+    if (modeParam != Mode::SWITCH_AUDIO && audioSwitched)
+    {
+        switchAudio(false);
+    }
+    mode = modeParam;
+}
+
+TrafficAnnouncementService::Mode TrafficAnnouncementService::getMode() const
+{
+    return mode;
+}
+
+void TrafficAnnouncementService::setAnnouncementVolume(uint8_t volume)
+{
+    announcementVolume = (volume > RDA5807M::MAX_VOLUME) ? RDA5807M::MAX_VOLUME : volume;
+}
+
+uint8_t TrafficAnnouncementService::getAnnouncementVolume() const
+{
+    return announcementVolume;
+}
+
+bool TrafficAnnouncementService::isAudioSwitched() const
+{
+    return audioSwitched;
+}
+
+/**
+ * Switches the audio for the tuned station's edges, then signals
+ * subscribers, and records how long that took from when the group
+ * confirming the edge was read
+ */
+void TrafficAnnouncementService::onTrafficAnnouncement(const Edge& edge)
+{
+    if (!edge.otherNetwork && mode == Mode::SWITCH_AUDIO && edge.active != audioSwitched)
+    {
+        switchAudio(edge.active);
+    }
+
+    broker.publishTrafficAnnouncement(edge.piCode, edge.active, edge.trafficProgram, edge.otherNetwork);
+    broker.service();
+
+    uint64_t latencyUs = Util::getMonotonicTimeUs() - edge.confirmedUs;
+    uint64_t debounceUs = edge.confirmedUs - edge.firstSeenUs;
+    metrics.recordTrafficAnnouncement(edge.otherNetwork, edge.active, latencyUs, debounceUs);
+
+    if (edge.otherNetwork)
+    {
+        ++stats.otherNetworkEdges;
+        return;
+    }
+
+    ++stats.edges;
+    stats.actionLatencyUs.add(static_cast<double>(latencyUs));
+    stats.maxActionLatencyUs = std::max(stats.maxActionLatencyUs, latencyUs);
+    stats.debounceUs.add(static_cast<double>(debounceUs));
+    if (latencyUs > GROUP_PERIOD_US)
+    {
+        ++stats.lateActions;
+    }
+}
+
+const TrafficAnnouncementService::Stats& TrafficAnnouncementService::getStats() const
+{
+    return stats;
+}
+
+/**
+ * Unmutes and raises the volume for an announcement, remembering what
+ * they were, or puts them back afterwards. Each is one register write.
+ */
+void TrafficAnnouncementService::switchAudio(bool announcement)
+{
+    if (announcement)
+    {
+        savedVolume = static_cast<uint8_t>(
+                Util::valueFromReg(radio.getLocalRegisterContent(RDA5807M::Register::REG_0x05), VOLUME));
+        savedMute = (radio.getLocalRegisterContent(RDA5807M::Register::REG_0x02) & DMUTE) == 0;
+
+        if (savedMute)
+        {
+            radio.setMute(false);
+        }
+        if (savedVolume < announcementVolume)
+        {
+            radio.setVolume(announcementVolume);
+        }
+    }
+    else
+    {
+        if (savedVolume < announcementVolume)
+        {
+            radio.setVolume(savedVolume);
+        }
+        if (savedMute)
+        {
+            radio.setMute(true);
+        }
+    }
+    audioSwitched = announcement;
+}
@@ -0,0 +1,109 @@
+/**************************************************
+ * TrafficAnnouncementService.hpp - Switches audio and signals on traffic announcements
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef TRAFFICANNOUNCEMENTSERVICE_HPP
+#define TRAFFICANNOUNCEMENTSERVICE_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "MetricsRegistry.hpp"
+#include "RDA5807M.hpp"
+#include "RdsEventBroker.hpp"
+#include "StreamingStats.hpp"
+#include "TrafficAnnouncementListener.hpp"
+
+/**
+ * Acts on the edges a TrafficAnnouncementDetector reports. Every edge is
+ * published to RDS event socket subscribers and sent at once, rather than
+ * on the acquisition loop's next service(). In SWITCH_AUDIO mode an
+ * announcement on the tuned station also unmutes it and raises the volume
+ * to at least the announcement volume, and its end puts both back.
+ *
+ * Other networks' announcements are only signalled: following one means
+ * retuning, which is the consumer's call.
+ *
+ * The latency of each action, from the group confirming the edge being
+ * read to the action being done, goes to the metrics registry. It should
+ * stay well under GROUP_PERIOD_US, so the action is done before the next
+ * group is due.
+ */
+class TrafficAnnouncementService : public TrafficAnnouncementListener
+{
+public:
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Mode : uint8_t {SIGNAL_ONLY = 0, SWITCH_AUDIO = 1};
+
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t DEFAULT_ANNOUNCEMENT_VOLUME = 10;
+
+    // One group is 104 bits at 1187.5 bits/s
+    static const uint32_t GROUP_PERIOD_US = 87579;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint32_t edges;
+        uint32_t otherNetworkEdges;
+
+        // Actions that took longer than a group period
+        uint32_t lateActions;
+
+        // Tuned station only, in microseconds
+        RunningVariance actionLatencyUs;
+        uint64_t maxActionLatencyUs;
+        RunningVariance debounceUs;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    TrafficAnnouncementService(RDA5807M& radioParam, RdsEventBroker& brokerParam, MetricsRegistry& metricsParam);
+
+    void setMode(Mode modeParam);
+    Mode getMode() const;
+
+    void setAnnouncementVolume(uint8_t volume);
+    uint8_t getAnnouncementVolume() const;
+
+    // True while the audio is switched for an announcement
+    bool isAudioSwitched() const;
+
+    void onTrafficAnnouncement(const Edge& edge) override;
+
+    const Stats& getStats() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void switchAudio(bool announcement);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    RDA5807M& radio;
+    RdsEventBroker& broker;
+    MetricsRegistry& metrics;
+
+    Mode mode;
+    uint8_t announcementVolume;
+
+    // What the audio was before it was switched
+    bool audioSwitched;
+    uint8_t savedVolume;
+    bool savedMute;
+
+    Stats stats;
+};
+
+#endif  // ifndef TRAFFICANNOUNCEMENTSERVICE_HPP
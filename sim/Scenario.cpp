@@ -0,0 +1,470 @@
+/**************************************************
+ * Scenario.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Project includes
+#include "Scenario.hpp"
+
+namespace
+{
+    const uint8_t MAX_RSSI = 127;
+
+    // Copies a value up to the end of the token into destination, which
+    // holds size bytes. Returns the position after the token.
+    const char* readValue(const char* position, char* destination, size_t size)
+    {
+        size_t length = 0;
+        if (*position == '"')
+        {
+            ++position;
+            while (*position != '\0' && *position != '"')
+            {
+                if (length + 1 < size)
+                {
+                    destination[length++] = *position;
+                }
+                ++position;
+            }
+            if (*position == '"')
+            {
+                ++position;
+            }
+        }
+        else
+        {
+            while (*position != '\0' && !std::isspace(static_cast<unsigned char>(*position)))
+            {
+                if (length + 1 < size)
+                {
+                    destination[length++] = *position;
+                }
+                ++position;
+            }
+        }
+        destination[length] = '\0';
+        return position;
+    }
+
+    // Numbers may be decimal or 0x-prefixed hex
+    bool parseNumber(const char* text, uint32_t maximum, uint32_t& value)
+    {
+        char* end = nullptr;
+        unsigned long parsed = std::strtoul(text, &end, 0);
+        if (end == text || *end != '\0' || parsed > maximum)
+        {
+            return false;
+        }
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    void copyText(char* destination, size_t size, const char* text)
+    {
+        size_t length = 0;
+        while (length + 1 < size && text[length] != '\0')
+        {
+            destination[length] = text[length];
+            ++length;
+        }
+        destination[length] = '\0';
+    }
+
+    uint32_t nextRandom(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+Scenario::Scenario()
+{
+    clear();
+}
+
+void Scenario::clear()
+{
+    std::memset(stations, 0, sizeof(stations));
+    stationCount = 0;
+    seed = 1;
+}
+
+/**
+ * A station with the behavior SimulatedBus always had: a steady RSSI, no
+ * block errors and, if it has a PI code, nothing but PS (0A) groups.
+ */
+Scenario::Station Scenario::makeStation(uint32_t frequencyKhz, uint8_t rssi, uint16_t piCode, uint8_t programType,
+                                        const char* programService)
+{
+    Station station;
+    std::memset(&station, 0, sizeof(station));
+    station.frequencyKhz = frequencyKhz;
+    station.piCode = piCode;
+    station.programType = programType;
+    copyText(station.programService, sizeof(station.programService), programService);
+    station.groupMix[static_cast<uint8_t>(GroupKind::BASIC_TUNING)] = 1;
+    station.rssi.mean = rssi;
+    return station;
+}
+
+/**
+ * Returns false if the station table is full or a station already uses
+ * the frequency.
+ */
+bool Scenario::addStation(const Station& station)
+{
+    if (stationCount >= MAX_STATIONS || findStation(station.frequencyKhz) >= 0)
+    {
+        return false;
+    }
+
+    stations[stationCount++] = station;
+    return true;
+}
+
+/**
+ * Replaces the scenario with the one in the file at path (see the class
+ * comment for the format). On failure errorLine is the offending line, or
+ * 0 if the file couldn't be read, and the scenario is left empty.
+ */
+bool Scenario::load(const char* path, uint32_t& errorLine)
+{
+    clear();
+    errorLine = 0;
+
+    FILE* in = std::fopen(path, "r");
+    if (in == nullptr)
+    {
+        return false;
+    }
+
+    char line[512];
+    uint32_t lineNumber = 0;
+    bool success = true;
+    while (success && std::fgets(line, sizeof(line), in) != nullptr)
+    {
+        ++lineNumber;
+
+        char* comment = std::strchr(line, '#');
+        if (comment != nullptr)
+        {
+            *comment = '\0';
+        }
+
+        char directive[16];
+        const char* position = line;
+        while (std::isspace(static_cast<unsigned char>(*position)))
+        {
+            ++position;
+        }
+        position = readValue(position, directive, sizeof(directive));
+
+        if (directive[0] == '\0')
+        {
+            continue;
+        }
+        else if (std::strcmp(directive, "seed") == 0)
+        {
+            char value[16];
+            while (std::isspace(static_cast<unsigned char>(*position)))
+            {
+                ++position;
+            }
+            readValue(position, value, sizeof(value));
+            success = parseNumber(value, UINT32_MAX, seed);
+        }
+        else if (std::strcmp(directive, "station") == 0)
+        {
+            Station station;
+            success = parseStation(position, station) && addStation(station);
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    std::fclose(in);
+
+    if (!success)
+    {
+        errorLine = lineNumber;
+        clear();
+    }
+    return success;
+}
+
+/**
+ * Fills the US/Europe band with a typical mix of strong and weak stations,
+ * about half of which transmit RDS.
+ */
+void Scenario::populateDemoBand()
+{
+    addStation(makeStation(88100, 52, 0x1A01, 10, "KXPR    "));
+    addStation(makeStation(88900, 31));
+    addStation(makeStation(89700, 45, 0x1A02, 3, "NPR 89.7"));
+    addStation(makeStation(91300, 28));
+    addStation(makeStation(92500, 60, 0x1A03, 5, "ROCK 925"));
+    addStation(makeStation(93700, 38));
+    addStation(makeStation(94900, 55, 0x1A04, 1, "NEWS 949"));
+    addStation(makeStation(96100, 25));
+    addStation(makeStation(97300, 47, 0x1A05, 7, "HITS 973"));
+    addStation(makeStation(98500, 58, 0x1A06, 10, "KOOL985 "));
+    addStation(makeStation(99900, 33));
+    addStation(makeStation(100700, 49, 0x1A07, 11, "JAZZ1007"));
+    addStation(makeStation(102100, 41));
+    addStation(makeStation(103500, 62, 0x1A08, 5, "ALT 1035"));
+    addStation(makeStation(104300, 36, 0x1A09, 1, "TALK1043"));
+    addStation(makeStation(105900, 27));
+    addStation(makeStation(106700, 53, 0x1A0A, 10, "COUNTRY "));
+    addStation(makeStation(107900, 30));
+}
+
+/**
+ * Replaces the scenario with a crowded city band: a station every 300 or
+ * 400 kHz from 87.7 MHz, most with full RDS (RadioText, clock time, RT+,
+ * some with TMC), weak ones fading deeper and losing more blocks. The same
+ * seed always gives the same band.
+ */
+void Scenario::populateDenseUrban(uint32_t seedParam)
+{
+    clear();
+    seed = (seedParam != 0) ? seedParam : 1;
+    uint32_t state = seed;
+
+    for (uint32_t frequencyKhz = 87700; frequencyKhz <= 107900 && stationCount < MAX_STATIONS;
+         frequencyKhz += 300 + (nextRandom(state) % 2) * 100)
+    {
+        uint8_t rssi = static_cast<uint8_t>(15 + nextRandom(state) % 50);
+        Station station = makeStation(frequencyKhz, rssi);
+
+        station.rssi.fadeDepth = static_cast<uint8_t>(nextRandom(state) % (rssi < 30 ? 20 : 8));
+        station.rssi.fadePeriodMs = 2000 + nextRandom(state) % 8000;
+        station.rssi.noise = static_cast<uint8_t>(2 + nextRandom(state) % 3);
+
+        if (nextRandom(state) % 100 < 85)
+        {
+            station.piCode = static_cast<uint16_t>(0x5000 + stationCount);
+            station.programType = static_cast<uint8_t>(1 + nextRandom(state) % 31);
+            std::snprintf(station.programService, sizeof(station.programService), "URB%3u.%u",
+                          frequencyKhz / 1000, (frequencyKhz / 100) % 10);
+            std::snprintf(station.radioText, sizeof(station.radioText), "Artist %u - Title %u",
+                          nextRandom(state) % 1000, nextRandom(state) % 1000);
+
+            station.groupMix[static_cast<uint8_t>(GroupKind::BASIC_TUNING)] = 4;
+            station.groupMix[static_cast<uint8_t>(GroupKind::RADIO_TEXT)] = 3;
+            station.groupMix[static_cast<uint8_t>(GroupKind::CLOCK_TIME)] = 1;
+            if (nextRandom(state) % 2 == 0)
+            {
+                station.groupMix[static_cast<uint8_t>(GroupKind::RT_PLUS)] = 1;
+            }
+            if (nextRandom(state) % 5 == 0)
+            {
+                station.groupMix[static_cast<uint8_t>(GroupKind::TMC)] = 2;
+                station.trafficProgram = true;
+            }
+
+            uint16_t blockErrors = static_cast<uint16_t>(rssi < 45 ? (45 - rssi) * 4 : 0);
+            for (uint8_t block = 0; block < 4; ++block)
+            {
+                station.errors.uncorrectable[block] = blockErrors;
+            }
+            station.errors.corrected = 30;
+        }
+
+        addStation(station);
+    }
+}
+
+uint8_t Scenario::getStationCount() const
+{
+    return stationCount;
+}
+
+const Scenario::Station& Scenario::getStation(uint8_t index) const
+{
+    return stations[index];
+}
+
+/**
+ * Returns the index of the station on frequencyKhz, or -1 if there is none
+ */
+int Scenario::findStation(uint32_t frequencyKhz) const
+{
+    for (uint8_t idx = 0; idx < stationCount; ++idx)
+    {
+        if (stations[idx].frequencyKhz == frequencyKhz)
+        {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Returns the index of the first station with RDS PI code piCode, or -1
+ */
+int Scenario::findStationByPiCode(uint16_t piCode) const
+{
+    for (uint8_t idx = 0; idx < stationCount; ++idx)
+    {
+        if (piCode != 0 && stations[idx].piCode == piCode)
+        {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+void Scenario::setSeed(uint32_t seedParam)
+{
+    seed = seedParam;
+}
+
+uint32_t Scenario::getSeed() const
+{
+    return seed;
+}
+
+/**
+ * Parses the rest of a station line: the frequency, then key=value pairs
+ */
+bool Scenario::parseStation(const char* line, Station& station)
+{
+    char token[RT_LENGTH + 16];
+    const char* position = line;
+    while (std::isspace(static_cast<unsigned char>(*position)))
+    {
+        ++position;
+    }
+    position = readValue(position, token, sizeof(token));
+
+    uint32_t value = 0;
+    if (!parseNumber(token, UINT32_MAX, value) || value == 0)
+    {
+        return false;
+    }
+    station = makeStation(value, 0);
+
+    while (true)
+    {
+        while (std::isspace(static_cast<unsigned char>(*position)))
+        {
+            ++position;
+        }
+        if (*position == '\0')
+        {
+            return true;
+        }
+
+        char key[16];
+        size_t keyLength = 0;
+        while (*position != '\0' && *position != '=' && !std::isspace(static_cast<unsigned char>(*position)))
+        {
+            if (keyLength + 1 >= sizeof(key))
+            {
+                return false;
+            }
+            key[keyLength++] = *position++;
+        }
+        key[keyLength] = '\0';
+        if (*position != '=')
+        {
+            return false;
+        }
+        position = readValue(position + 1, token, sizeof(token));
+
+        if (std::strcmp(key, "ps") == 0)
+        {
+            copyText(station.programService, sizeof(station.programService), token);
+            continue;
+        }
+        if (std::strcmp(key, "rt") == 0)
+        {
+            copyText(station.radioText, sizeof(station.radioText), token);
+            continue;
+        }
+
+        if (!parseNumber(token, UINT16_MAX, value))
+        {
+            return false;
+        }
+
+        if (std::strcmp(key, "pi") == 0)
+        {
+            station.piCode = static_cast<uint16_t>(value);
+        }
+        else if (std::strcmp(key, "pty") == 0 && value < 32)
+        {
+            station.programType = static_cast<uint8_t>(value);
+        }
+        else if (std::strcmp(key, "tp") == 0)
+        {
+            station.trafficProgram = value != 0;
+        }
+        else if (std::strcmp(key, "ta") == 0)
+        {
+            station.trafficAnnouncement = value != 0;
+        }
+        else if (std::strcmp(key, "taperiodms") == 0)
+        {
+            station.trafficAnnouncementPeriodMs = value;
+        }
+        else if (std::strcmp(key, "eon") == 0)
+        {
+            station.eonPiCode = static_cast<uint16_t>(value);
+        }
+        else if (std::strcmp(key, "rssi") == 0 && value <= MAX_RSSI)
+        {
+            station.rssi.mean = static_cast<uint8_t>(value);
+        }
+        else if (std::strcmp(key, "fade") == 0 && value <= MAX_RSSI)
+        {
+            station.rssi.fadeDepth = static_cast<uint8_t>(value);
+        }
+        else if (std::strcmp(key, "fadems") == 0)
+        {
+            station.rssi.fadePeriodMs = value;
+        }
+        else if (std::strcmp(key, "noise") == 0 && value <= MAX_RSSI)
+        {
+            station.rssi.noise = static_cast<uint8_t>(value);
+        }
+        else if (std::strncmp(key, "mix", 3) == 0 && value <= UINT8_MAX)
+        {
+            static const char* const MIX_KEYS[GROUP_KIND_COUNT] = {"0a", "2a", "4a", "rtplus", "tmc", "eon"};
+            uint8_t kind = 0;
+            while (kind < GROUP_KIND_COUNT && std::strcmp(key + 3, MIX_KEYS[kind]) != 0)
+            {
+                ++kind;
+            }
+            if (kind == GROUP_KIND_COUNT)
+            {
+                return false;
+            }
+            station.groupMix[kind] = static_cast<uint8_t>(value);
+        }
+        else if (std::strncmp(key, "bler", 4) == 0 && key[4] >= 'a' && key[4] <= 'd' && key[5] == '\0' &&
+                 value <= 1000)
+        {
+            station.errors.uncorrectable[key[4] - 'a'] = static_cast<uint16_t>(value);
+        }
+        else if (std::strcmp(key, "corrected") == 0 && value <= 1000)
+        {
+            station.errors.corrected = static_cast<uint16_t>(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+}
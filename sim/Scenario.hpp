@@ -0,0 +1,144 @@
+/**************************************************
+ * Scenario.hpp - Station descriptions for the simulated tuner
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * What a simulated band sounds like: the stations on it, what each one
+ * transmits, how its signal fades and how often its RDS blocks arrive
+ * damaged. A Scenario is plain data; ScenarioGenerator turns it into
+ * groups and RSSI readings, and SimulatedBus into register contents.
+ *
+ * Scenarios can be built in code or loaded from a text file, one
+ * directive per line, # starting a comment:
+ *
+ *   seed 42
+ *   station 98500 pi=0x1A06 pty=10 ps="KOOL985" rt="Artist - Title"
+ *           rssi=55 fade=20 fadems=4000 noise=3 tp=1 ta=0 taperiodms=0
+ *           eon=0x1B02 mix0a=4 mix2a=4 mix4a=1 mixrtplus=1 mixtmc=0 mixeon=0
+ *           blera=0 blerb=5 blerc=5 blerd=5 corrected=50
+ *
+ * (a station is a single line). Every key is optional. pi=0 makes a
+ * station without RDS; the mix weights give the relative share of PS
+ * (0A), RadioText (2A), clock time (4A), RT+ (3A/11A), TMC (8A) and EON
+ * (14A) groups. bler* are per-mille chances of an uncorrectable error in
+ * each block and corrected the per-mille chance of a corrected one.
+ *
+ * A non-zero taperiodms makes the station announce (TA) for the second
+ * half of every period instead of following ta. eon gives the PI of
+ * another station in the scenario that 14A groups describe; when that
+ * station's TA changes, a burst of 14B groups goes out straight away.
+ */
+class Scenario
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t MAX_STATIONS = 64;
+    static const uint8_t PS_LENGTH = 8;
+    static const uint8_t RT_LENGTH = 64;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class GroupKind {BASIC_TUNING = 0, RADIO_TEXT = 1, CLOCK_TIME = 2, RT_PLUS = 3, TMC = 4, EON = 5};
+    static const uint8_t GROUP_KIND_COUNT = 6;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct RssiProfile
+    {
+        uint8_t mean;
+
+        // Slow fading: the RSSI dips by up to fadeDepth over fadePeriodMs.
+        // A period of 0 disables it.
+        uint8_t fadeDepth;
+        uint32_t fadePeriodMs;
+
+        // Uniform jitter of up to +/- noise on every reading
+        uint8_t noise;
+    };
+
+    struct ErrorProfile
+    {
+        // Per mille, per block (A-D)
+        uint16_t uncorrectable[4];
+        uint16_t corrected;
+    };
+
+    struct Station
+    {
+        uint32_t frequencyKhz;
+
+        // 0 means the station doesn't transmit RDS
+        uint16_t piCode;
+        uint8_t programType;
+        bool trafficProgram;
+        bool trafficAnnouncement;
+
+        // TA toggles every half period when non-zero
+        uint32_t trafficAnnouncementPeriodMs;
+
+        // Station the EON groups describe, 0 for none
+        uint16_t eonPiCode;
+
+        // Null-terminated, padded by the generator
+        char programService[PS_LENGTH + 1];
+        char radioText[RT_LENGTH + 1];
+
+        uint8_t groupMix[GROUP_KIND_COUNT];
+
+        RssiProfile rssi;
+        ErrorProfile errors;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    Scenario();
+
+    void clear();
+
+    static Station makeStation(uint32_t frequencyKhz, uint8_t rssi, uint16_t piCode = 0, uint8_t programType = 0,
+                               const char* programService = "");
+    bool addStation(const Station& station);
+
+    bool load(const char* path, uint32_t& errorLine);
+
+    void populateDemoBand();
+    void populateDenseUrban(uint32_t seedParam);
+
+    uint8_t getStationCount() const;
+    const Station& getStation(uint8_t index) const;
+    int findStation(uint32_t frequencyKhz) const;
+    int findStationByPiCode(uint16_t piCode) const;
+
+    void setSeed(uint32_t seedParam);
+    uint32_t getSeed() const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    bool parseStation(const char* line, Station& station);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    Station stations[MAX_STATIONS];
+    uint8_t stationCount;
+    uint32_t seed;
+};
+
+#endif  // ifndef SCENARIO_HPP
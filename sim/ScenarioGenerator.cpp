@@ -0,0 +1,433 @@
+/**************************************************
+ * ScenarioGenerator.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "ScenarioGenerator.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    const double TWO_PI = 6.283185307179586;
+
+    // Block B fields shared by every group type
+    const uint16_t TRAFFIC_PROGRAM = 0x0400;
+    const uint8_t PROGRAM_TYPE_SHIFT = 5;
+
+    // Group 0A
+    const uint16_t TRAFFIC_ANNOUNCEMENT = 0x0010;
+    const uint16_t MUSIC = 0x0008;
+    const uint16_t NO_ALTERNATIVE_FREQUENCIES = 0xE0CD;
+
+    // Group 3A announcing RT+ carried in 11A
+    const uint16_t RT_PLUS_AID = 0x4BD7;
+    const uint16_t RT_PLUS_APPLICATION_GROUP = (11 << 1) | 0;
+    const uint16_t RT_PLUS_ITEM_RUNNING = 0x0008;
+    const uint8_t RT_PLUS_TITLE = 1;
+    const uint8_t RT_PLUS_ARTIST = 4;
+
+    // One in this many RT+ groups is the 3A announcement
+    const uint8_t RT_PLUS_ANNOUNCEMENT_INTERVAL = 4;
+
+    // Group 8A single-group message
+    const uint16_t TMC_SINGLE_GROUP = 0x0008;
+    const uint16_t TMC_FIRST_LOCATION = 1000;
+
+    // Groups 14A and 14B (enhanced other networks)
+    const uint16_t EON_VERSION_B = 0x0800;
+    const uint16_t EON_TRAFFIC_PROGRAM = 0x0010;
+    const uint16_t EON_TRAFFIC_ANNOUNCEMENT = 0x0008;
+    const uint8_t EON_VARIANT_PS_SEGMENTS = 4;
+    const uint8_t EON_VARIANT_PTY_TA = 13;
+    const uint8_t EON_PTY_SHIFT = 11;
+
+    // Modified Julian Day of 1970-01-01
+    const uint32_t MJD_UNIX_EPOCH = 40587;
+    const uint64_t US_PER_MINUTE = 60ULL * 1000000ULL;
+
+    // Extra per-mille block error rate per dB below WEAK_SIGNAL_RSSI
+    const uint16_t WEAK_SIGNAL_ERRORS_PER_DB = 25;
+
+    uint16_t commonBlockB(const Scenario::Station& station)
+    {
+        return static_cast<uint16_t>((station.trafficProgram ? TRAFFIC_PROGRAM : 0) |
+                                     (station.programType << PROGRAM_TYPE_SHIFT));
+    }
+
+    // Characters past the end of text are spaces
+    uint16_t textPair(const char* text, size_t length, size_t position)
+    {
+        uint8_t first = (position < length) ? static_cast<uint8_t>(text[position]) : ' ';
+        uint8_t second = (position + 1 < length) ? static_cast<uint8_t>(text[position + 1]) : ' ';
+        return static_cast<uint16_t>((first << 8) | second);
+    }
+}
+
+ScenarioGenerator::ScenarioGenerator(const Scenario& scenarioParam) : scenario(scenarioParam)
+{
+    reset();
+}
+
+/**
+ * Starts every station from its first group and reseeds from the
+ * scenario, so that the same calls produce the same output again
+ */
+void ScenarioGenerator::reset()
+{
+    std::memset(states, 0, sizeof(states));
+    std::memset(&counters, 0, sizeof(counters));
+    randomState = 0x9E3779B97F4A7C15ULL ^ scenario.getSeed();
+    utcOffsetUs = Util::getRealtimeUs() - Util::getMonotonicTimeUs();
+}
+
+/**
+ * Fills group with what station stationIndex transmits next, at simulated
+ * time timeUs. Stations without RDS get an all-zero group.
+ */
+void ScenarioGenerator::nextGroup(uint8_t stationIndex, uint64_t timeUs, Group& group)
+{
+    const Scenario::Station& station = scenario.getStation(stationIndex);
+    StationState& state = states[stationIndex];
+
+    std::memset(&group, 0, sizeof(group));
+    if (station.piCode == 0)
+    {
+        return;
+    }
+
+    group.blocks[0] = station.piCode;
+
+    // A change of the other network's TA preempts the mix, as it does on
+    // air
+    Scenario::GroupKind kind = updateEon(station, state, timeUs) ? Scenario::GroupKind::EON
+                                                                  : chooseKind(station, state);
+    switch (kind)
+    {
+        case Scenario::GroupKind::RADIO_TEXT:
+            buildRadioText(station, state, group);
+            break;
+        case Scenario::GroupKind::CLOCK_TIME:
+            buildClockTime(timeUs, group);
+            break;
+        case Scenario::GroupKind::RT_PLUS:
+            buildRtPlus(station, state, group);
+            break;
+        case Scenario::GroupKind::TMC:
+            buildTmc(state, group);
+            break;
+        case Scenario::GroupKind::EON:
+            buildEon(station, state, group);
+            break;
+        default:
+            buildBasicTuning(station, state, timeUs, group);
+            break;
+    }
+
+    // Block B's fixed fields go in after the group-specific bits
+    group.blocks[1] |= commonBlockB(station);
+
+    ++counters.groups;
+    ++counters.groupsByKind[static_cast<uint8_t>(kind)];
+
+    injectErrors(station, getRssi(stationIndex, timeUs), group);
+}
+
+/**
+ * The station's RSSI at timeUs: its mean, less the slow fade at that
+ * point of the fade period, plus noise
+ */
+uint8_t ScenarioGenerator::getRssi(uint8_t stationIndex, uint64_t timeUs)
+{
+    const Scenario::RssiProfile& profile = scenario.getStation(stationIndex).rssi;
+
+    int32_t rssi = profile.mean;
+    if (profile.fadePeriodMs != 0 && profile.fadeDepth != 0)
+    {
+        uint64_t periodUs = static_cast<uint64_t>(profile.fadePeriodMs) * 1000;
+        double phase = static_cast<double>(timeUs % periodUs) / static_cast<double>(periodUs);
+        rssi -= static_cast<int32_t>(profile.fadeDepth * (1.0 - std::cos(TWO_PI * phase)) / 2.0 + 0.5);
+    }
+    if (profile.noise != 0)
+    {
+        rssi += static_cast<int32_t>(nextRandom() % (2U * profile.noise + 1)) - profile.noise;
+    }
+
+    if (rssi < 0)
+    {
+        return 0;
+    }
+    return static_cast<uint8_t>(rssi > 127 ? 127 : rssi);
+}
+
+const ScenarioGenerator::Counters& ScenarioGenerator::getCounters() const
+{
+    return counters;
+}
+
+/**
+ * Smooth weighted round-robin over the group mix. Kinds the station has
+ * nothing to send for (no RadioText) don't take part, and a station with
+ * no usable weight sends PS groups.
+ */
+Scenario::GroupKind ScenarioGenerator::chooseKind(const Scenario::Station& station, StationState& state)
+{
+    int16_t total = 0;
+    int8_t chosen = -1;
+    for (uint8_t kind = 0; kind < Scenario::GROUP_KIND_COUNT; ++kind)
+    {
+        uint8_t weight = station.groupMix[kind];
+        bool needsText = kind == static_cast<uint8_t>(Scenario::GroupKind::RADIO_TEXT) ||
+                         kind == static_cast<uint8_t>(Scenario::GroupKind::RT_PLUS);
+        bool needsEon = kind == static_cast<uint8_t>(Scenario::GroupKind::EON);
+        if (weight == 0 || (needsText && station.radioText[0] == '\0') || (needsEon && station.eonPiCode == 0))
+        {
+            continue;
+        }
+
+        state.credits[kind] = static_cast<int16_t>(state.credits[kind] + weight);
+        total = static_cast<int16_t>(total + weight);
+        if (chosen < 0 || state.credits[kind] > state.credits[chosen])
+        {
+            chosen = static_cast<int8_t>(kind);
+        }
+    }
+
+    if (chosen < 0)
+    {
+        return Scenario::GroupKind::BASIC_TUNING;
+    }
+    state.credits[chosen] = static_cast<int16_t>(state.credits[chosen] - total);
+    return static_cast<Scenario::GroupKind>(chosen);
+}
+
+/**
+ * The station's TA flag at timeUs: on for the second half of every
+ * announcement period, or fixed if it has none
+ */
+bool ScenarioGenerator::isAnnouncing(const Scenario::Station& station, uint64_t timeUs) const
+{
+    if (station.trafficAnnouncementPeriodMs == 0)
+    {
+        return station.trafficAnnouncement;
+    }
+
+    uint64_t periodUs = static_cast<uint64_t>(station.trafficAnnouncementPeriodMs) * 1000;
+    return timeUs % periodUs >= periodUs / 2;
+}
+
+void ScenarioGenerator::buildBasicTuning(const Scenario::Station& station, StationState& state, uint64_t timeUs,
+                                         Group& group)
+{
+    size_t length = std::strlen(station.programService);
+    group.blocks[1] = static_cast<uint16_t>((isAnnouncing(station, timeUs) ? TRAFFIC_ANNOUNCEMENT : 0) | MUSIC |
+                                            state.psSegment);
+    group.blocks[2] = NO_ALTERNATIVE_FREQUENCIES;
+    group.blocks[3] = textPair(station.programService, length, state.psSegment * 2U);
+    state.psSegment = (state.psSegment + 1) % 4;
+}
+
+/**
+ * Group 2A. Text shorter than 64 characters ends with a carriage return
+ * and only the segments up to it are sent.
+ */
+void ScenarioGenerator::buildRadioText(const Scenario::Station& station, StationState& state, Group& group)
+{
+    size_t length = std::strlen(station.radioText);
+    uint8_t segmentCount = static_cast<uint8_t>(length < Scenario::RT_LENGTH ? length / 4 + 1 : 16);
+
+    char segment[4];
+    for (uint8_t idx = 0; idx < 4; ++idx)
+    {
+        size_t position = state.rtSegment * 4U + idx;
+        segment[idx] = (position < length) ? station.radioText[position] : (position == length ? '\r' : ' ');
+    }
+
+    group.blocks[1] = static_cast<uint16_t>((2 << 12) | state.rtSegment);
+    group.blocks[2] = textPair(segment, 4, 0);
+    group.blocks[3] = textPair(segment, 4, 2);
+    state.rtSegment = static_cast<uint8_t>((state.rtSegment + 1) % segmentCount);
+}
+
+/**
+ * Group 4A for the UTC minute containing timeUs, with a zero local offset
+ */
+void ScenarioGenerator::buildClockTime(uint64_t timeUs, Group& group)
+{
+    uint64_t minutes = (timeUs + utcOffsetUs) / US_PER_MINUTE;
+    uint32_t modifiedJulianDay = static_cast<uint32_t>(MJD_UNIX_EPOCH + minutes / (24 * 60));
+    uint32_t hour = static_cast<uint32_t>((minutes / 60) % 24);
+    uint32_t minute = static_cast<uint32_t>(minutes % 60);
+
+    group.blocks[1] = static_cast<uint16_t>((4 << 12) | ((modifiedJulianDay >> 15) & 0x3));
+    group.blocks[2] = static_cast<uint16_t>(((modifiedJulianDay & 0x7FFF) << 1) | (hour >> 4));
+    group.blocks[3] = static_cast<uint16_t>(((hour & 0xF) << 12) | (minute << 6));
+}
+
+/**
+ * Either the 3A announcement or an 11A tag group. RadioText of the form
+ * "artist - title" is tagged as such; other text gets a group with dummy
+ * tags, as stations send between items.
+ */
+void ScenarioGenerator::buildRtPlus(const Scenario::Station& station, StationState& state, Group& group)
+{
+    if (state.rtPlusSequence++ % RT_PLUS_ANNOUNCEMENT_INTERVAL == 0)
+    {
+        group.blocks[1] = static_cast<uint16_t>((3 << 12) | RT_PLUS_APPLICATION_GROUP);
+        group.blocks[2] = 0;
+        group.blocks[3] = RT_PLUS_AID;
+        return;
+    }
+
+    uint8_t artistType = 0, artistStart = 0, artistLength = 0;
+    uint8_t titleType = 0, titleStart = 0, titleLength = 0;
+    const char* separator = std::strstr(station.radioText, " - ");
+    if (separator != nullptr && separator != station.radioText)
+    {
+        size_t length = std::strlen(station.radioText);
+        size_t artistEnd = static_cast<size_t>(separator - station.radioText);
+        size_t titleBegin = artistEnd + 3;
+        if (titleBegin < length && artistEnd <= 64 && length - titleBegin <= 32)
+        {
+            artistType = RT_PLUS_ARTIST;
+            artistLength = static_cast<uint8_t>(artistEnd - 1);
+            titleType = RT_PLUS_TITLE;
+            titleStart = static_cast<uint8_t>(titleBegin);
+            titleLength = static_cast<uint8_t>(length - titleBegin - 1);
+        }
+    }
+
+    group.blocks[1] = static_cast<uint16_t>((11 << 12) | RT_PLUS_ITEM_RUNNING | (artistType >> 3));
+    group.blocks[2] = static_cast<uint16_t>(((artistType & 0x7) << 13) | (artistStart << 7) | (artistLength << 1) |
+                                            (titleType >> 5));
+    group.blocks[3] = static_cast<uint16_t>(((titleType & 0x1F) << 11) | (titleStart << 5) | titleLength);
+}
+
+/**
+ * Single-group 8A messages from a fixed set, each sent twice in a row as
+ * TMC services do so that receivers can confirm them
+ */
+void ScenarioGenerator::buildTmc(StationState& state, Group& group)
+{
+    uint8_t message = state.tmcMessage;
+
+    group.blocks[1] = static_cast<uint16_t>((8 << 12) | TMC_SINGLE_GROUP | (message % 8));
+    group.blocks[2] = static_cast<uint16_t>(((message & 0x1) << 14) | ((message % 8) << 11) |
+                                            (1 + (message * 37) % 2047));
+    group.blocks[3] = static_cast<uint16_t>(TMC_FIRST_LOCATION + message);
+
+    if (state.tmcRepeat)
+    {
+        state.tmcMessage = (state.tmcMessage + 1) % TMC_MESSAGE_COUNT;
+    }
+    state.tmcRepeat = !state.tmcRepeat;
+}
+
+/**
+ * Starts a burst of 14B groups when the other network's TA has changed
+ * since the last group. Returns true while the burst lasts.
+ */
+bool ScenarioGenerator::updateEon(const Scenario::Station& station, StationState& state, uint64_t timeUs)
+{
+    int otherIdx = scenario.findStationByPiCode(station.eonPiCode);
+    if (otherIdx < 0)
+    {
+        return false;
+    }
+
+    bool announcing = isAnnouncing(scenario.getStation(static_cast<uint8_t>(otherIdx)), timeUs);
+    if (announcing != state.eonTrafficAnnouncement)
+    {
+        state.eonTrafficAnnouncement = announcing;
+        state.eonSwitchGroupsLeft = EON_SWITCH_GROUPS;
+    }
+    return state.eonSwitchGroupsLeft > 0;
+}
+
+/**
+ * A 14B group during a TA switching burst, otherwise a 14A group cycling
+ * through the other network's PS segments and its PTY/TA variant
+ */
+void ScenarioGenerator::buildEon(const Scenario::Station& station, StationState& state, Group& group)
+{
+    int otherIdx = scenario.findStationByPiCode(station.eonPiCode);
+    const Scenario::Station* other = (otherIdx >= 0) ? &scenario.getStation(static_cast<uint8_t>(otherIdx))
+                                                     : nullptr;
+    uint16_t otherTrafficProgram = (other != nullptr && other->trafficProgram) ? EON_TRAFFIC_PROGRAM : 0;
+    group.blocks[3] = station.eonPiCode;
+
+    if (state.eonSwitchGroupsLeft > 0)
+    {
+        --state.eonSwitchGroupsLeft;
+        group.blocks[1] = static_cast<uint16_t>((14 << 12) | EON_VERSION_B | otherTrafficProgram |
+                                                (state.eonTrafficAnnouncement ? EON_TRAFFIC_ANNOUNCEMENT : 0));
+        group.blocks[2] = station.piCode;
+        return;
+    }
+
+    uint8_t variant = state.eonVariant;
+    state.eonVariant = static_cast<uint8_t>((state.eonVariant + 1) % (EON_VARIANT_PS_SEGMENTS + 1));
+    if (variant < EON_VARIANT_PS_SEGMENTS)
+    {
+        const char* programService = (other != nullptr) ? other->programService : "";
+        group.blocks[1] = static_cast<uint16_t>((14 << 12) | otherTrafficProgram | variant);
+        group.blocks[2] = textPair(programService, std::strlen(programService), variant * 2U);
+        return;
+    }
+
+    uint8_t otherProgramType = (other != nullptr) ? other->programType : 0;
+    group.blocks[1] = static_cast<uint16_t>((14 << 12) | otherTrafficProgram | EON_VARIANT_PTY_TA);
+    group.blocks[2] = static_cast<uint16_t>((otherProgramType << EON_PTY_SHIFT) |
+                                            (state.eonTrafficAnnouncement ? 1 : 0));
+}
+
+/**
+ * Decides, block by block, whether the receiver got it clean, corrected
+ * it or lost it. Lost blocks are flipped to garbage so that a decoder
+ * ignoring the error levels notices. Weak signals add errors on top of
+ * the station's profile.
+ */
+void ScenarioGenerator::injectErrors(const Scenario::Station& station, uint8_t rssi, Group& group)
+{
+    uint16_t weakSignalErrors = 0;
+    if (rssi < WEAK_SIGNAL_RSSI)
+    {
+        weakSignalErrors = static_cast<uint16_t>((WEAK_SIGNAL_RSSI - rssi) * WEAK_SIGNAL_ERRORS_PER_DB);
+    }
+
+    for (uint8_t block = 0; block < 4; ++block)
+    {
+        uint32_t uncorrectable = station.errors.uncorrectable[block] + weakSignalErrors;
+        if (uncorrectable == 0 && station.errors.corrected == 0)
+        {
+            continue;
+        }
+
+        uint32_t roll = nextRandom() % 1000;
+        if (roll < uncorrectable)
+        {
+            group.blocks[block] ^= static_cast<uint16_t>(nextRandom() | 0x1);
+            group.errors[block] = 3;
+            ++counters.blocksCorrupted;
+        }
+        else if (roll < uncorrectable + station.errors.corrected)
+        {
+            group.errors[block] = static_cast<uint8_t>(1 + (roll & 0x1));
+            ++counters.blocksCorrected;
+        }
+    }
+}
+
+// xorshift64*
+uint32_t ScenarioGenerator::nextRandom()
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return static_cast<uint32_t>((randomState * 0x2545F4914F6CDD1DULL) >> 32);
+}
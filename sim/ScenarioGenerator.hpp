@@ -0,0 +1,122 @@
+/**************************************************
+ * ScenarioGenerator.hpp - RDS groups and signal levels from a Scenario
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SCENARIOGENERATOR_HPP
+#define SCENARIOGENERATOR_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "Scenario.hpp"
+
+/**
+ * Produces what each station of a Scenario transmits: the next RDS group,
+ * with errors injected per block as the receiver would report them, and
+ * the RSSI at a given moment. Output is a function of the scenario seed
+ * and the order of calls only, so runs are repeatable.
+ *
+ * Group types follow the station's mix using smooth weighted round-robin,
+ * which spreads each type evenly rather than in bursts. Not thread-safe.
+ */
+class ScenarioGenerator
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    // One group is 104 bits at 1187.5 bits/s
+    static const uint32_t GROUP_PERIOD_US = 87579;
+
+    // Below this RSSI a station loses blocks beyond its error profile
+    static const uint8_t WEAK_SIGNAL_RSSI = 20;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Group
+    {
+        uint16_t blocks[4];
+
+        // Per block, as in BLERA/BLERB: 0 none, 1 one or two corrected,
+        // 2 three to five corrected, 3 uncorrectable (the data is damaged)
+        uint8_t errors[4];
+    };
+
+    struct Counters
+    {
+        uint64_t groups;
+        uint64_t groupsByKind[Scenario::GROUP_KIND_COUNT];
+        uint64_t blocksCorrupted;
+        uint64_t blocksCorrected;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    explicit ScenarioGenerator(const Scenario& scenarioParam);
+
+    void reset();
+
+    void nextGroup(uint8_t stationIndex, uint64_t timeUs, Group& group);
+
+    uint8_t getRssi(uint8_t stationIndex, uint64_t timeUs);
+
+    const Counters& getCounters() const;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint8_t TMC_MESSAGE_COUNT = 32;
+
+    // 14B groups sent when the other network's TA changes
+    static const uint8_t EON_SWITCH_GROUPS = 4;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct StationState
+    {
+        int16_t credits[Scenario::GROUP_KIND_COUNT];
+        uint8_t psSegment;
+        uint8_t rtSegment;
+        uint8_t rtPlusSequence;
+        uint8_t tmcMessage;
+        bool tmcRepeat;
+        uint8_t eonVariant;
+        bool eonTrafficAnnouncement;
+        uint8_t eonSwitchGroupsLeft;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    Scenario::GroupKind chooseKind(const Scenario::Station& station, StationState& state);
+    bool isAnnouncing(const Scenario::Station& station, uint64_t timeUs) const;
+    void buildBasicTuning(const Scenario::Station& station, StationState& state, uint64_t timeUs, Group& group);
+    void buildRadioText(const Scenario::Station& station, StationState& state, Group& group);
+    void buildClockTime(uint64_t timeUs, Group& group);
+    void buildRtPlus(const Scenario::Station& station, StationState& state, Group& group);
+    void buildTmc(StationState& state, Group& group);
+    bool updateEon(const Scenario::Station& station, StationState& state, uint64_t timeUs);
+    void buildEon(const Scenario::Station& station, StationState& state, Group& group);
+    void injectErrors(const Scenario::Station& station, uint8_t rssi, Group& group);
+    uint32_t nextRandom();
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    const Scenario& scenario;
+    StationState states[Scenario::MAX_STATIONS];
+    uint64_t randomState;
+
+    // Added to simulated time to give UTC for clock-time groups
+    uint64_t utcOffsetUs;
+
+    Counters counters;
+};
+
+#endif  // ifndef SCENARIOGENERATOR_HPP
@@ -0,0 +1,480 @@
+/**************************************************
+ * SimulatedBus.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstring>
+
+// Project includes
+#include "RDA5807MRegDefines.hpp"
+#include "SimulatedBus.hpp"
+#include "Util.hpp"
+
+// Static variable initialization
+const uint16_t SimulatedBus::POWER_ON_REGISTERS[] = {
+        /* Reg 0x00 */0x5804,
+        /* Reg 0x01 */0x0000,
+        /* Reg 0x02 */0x0000,
+        /* Reg 0x03 */0x0000,
+        /* Reg 0x04 */0x0200,
+        /* Reg 0x05 */0x880F,
+        /* Reg 0x06 */0x0000,
+        /* Reg 0x07 */0x4202,
+        /* Reg 0x08 */0x0000,
+        /* Reg 0x09 */0x0000,
+        /* Reg 0x0A */0x0000,
+        /* Reg 0x0B */0x0000,
+        /* Reg 0x0C */0x0000,
+        /* Reg 0x0D */0x0000,
+        /* Reg 0x0E */0x0000,
+        /* Reg 0x0F */0x0000 };
+
+SimulatedBus::SimulatedBus() :
+        generator(scenario), skipToEvents(true), currentStation(-1), tuneTimeUs(DEFAULT_TUNE_TIME_US),
+        rdsSyncTimeUs(DEFAULT_RDS_SYNC_TIME_US), tuning(false), seeking(false), operationStartUs(0),
+        rdsRunning(false), nextGroupUs(0), nextRssiUs(0), clockRate(ClockRate::STANDARD),
+        overclockedTransactions(0), overclockedReads(0)
+{
+    std::memcpy(registers, POWER_ON_REGISTERS, sizeof(registers));
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Adds a station with a steady signal that transmits only its PS name.
+ * Returns false if the station table is full.
+ */
+bool SimulatedBus::addStation(uint32_t frequencyKhz, uint8_t rssi, uint16_t piCode, uint8_t programType,
+                              const char* programService)
+{
+    return scenario.addStation(Scenario::makeStation(frequencyKhz, rssi, piCode, programType, programService));
+}
+
+void SimulatedBus::populateDemoBand()
+{
+    scenario.populateDemoBand();
+}
+
+/**
+ * Replaces the stations. The chip loses the station it was on, as if it
+ * had been switched off and on again.
+ */
+void SimulatedBus::setScenario(const Scenario& scenarioParam)
+{
+    scenario = scenarioParam;
+    generator.reset();
+    simulatePowerLoss();
+}
+
+const Scenario& SimulatedBus::getScenario() const
+{
+    return scenario;
+}
+
+const ScenarioGenerator::Counters& SimulatedBus::getGeneratorCounters() const
+{
+    return generator.getCounters();
+}
+
+SimulationClock& SimulatedBus::getClock()
+{
+    return clock;
+}
+
+/**
+ * Whether polling 0x0A moves a stepped clock on to the next event (on by
+ * default)
+ */
+void SimulatedBus::setSkipToEvents(bool skipToEventsParam)
+{
+    skipToEvents = skipToEventsParam;
+}
+
+const SimulatedBus::Stats& SimulatedBus::getStats() const
+{
+    return stats;
+}
+
+void SimulatedBus::setTuneTime(uint32_t tuneTimeUsParam)
+{
+    tuneTimeUs = tuneTimeUsParam;
+}
+
+void SimulatedBus::setRdsSyncTime(uint32_t rdsSyncTimeUsParam)
+{
+    rdsSyncTimeUs = rdsSyncTimeUsParam;
+}
+
+/**
+ * Behaves like a brownout: every register goes back to its power-on value.
+ */
+void SimulatedBus::simulatePowerLoss()
+{
+    std::memcpy(registers, POWER_ON_REGISTERS, sizeof(registers));
+    currentStation = -1;
+    tuning = false;
+    seeking = false;
+    rdsRunning = false;
+}
+
+/**
+ * Returns the frequency the simulated chip is tuned to, as opposed to the
+ * one the driver thinks it is tuned to.
+ */
+uint32_t SimulatedBus::getTunedFrequencyKhz() const
+{
+    return channelToKhz(static_cast<uint16_t>(Util::valueFromReg(registers[0x0A], READCHAN)));
+}
+
+bool SimulatedBus::writeRegister(uint8_t reg, uint16_t value)
+{
+    if (reg > 0x0F || dropOverclockedTransaction())
+    {
+        return false;
+    }
+
+    applyWrite(reg, value);
+    return true;
+}
+
+bool SimulatedBus::writeRegistersSequential(const uint16_t* values, uint8_t count)
+{
+    if (SEQUENTIAL_WRITE_BASE_REG + count > 0x08 || dropOverclockedTransaction())
+    {
+        return false;
+    }
+
+    for (uint8_t idx = 0; idx < count; ++idx)
+    {
+        applyWrite(SEQUENTIAL_WRITE_BASE_REG + idx, values[idx]);
+    }
+    return true;
+}
+
+bool SimulatedBus::readRegister(uint8_t reg, uint16_t& value)
+{
+    if (reg > 0x0F || dropOverclockedTransaction())
+    {
+        return false;
+    }
+
+    if (reg == 0x0A && clock.isStepped() && skipToEvents)
+    {
+        advanceToNextEvent();
+    }
+
+    update();
+    value = registers[reg];
+
+    if (clockRate == ClockRate::HIGH_SPEED && ++overclockedReads % OVERCLOCKED_CORRUPTION_INTERVAL == 0)
+    {
+        value ^= static_cast<uint16_t>(1U << (overclockedReads % 16));
+    }
+
+    // Reading the last RDS block consumes the group
+    if (reg == 0x0F)
+    {
+        registers[0x0A] &= ~RDSR;
+    }
+    return true;
+}
+
+bool SimulatedBus::setClockRate(ClockRate rate)
+{
+    clockRate = rate;
+    return true;
+}
+
+/**
+ * Only registers 0x02-0x07 are writable. Setting TUNE or SEEK starts the
+ * corresponding operation, SOFT_RESET resets the chip and toggling RDS_EN
+ * restarts RDS synchronization.
+ */
+void SimulatedBus::applyWrite(uint8_t reg, uint16_t value)
+{
+    if (reg < 0x02 || reg > 0x07)
+    {
+        return;
+    }
+
+    uint16_t previous = registers[reg];
+    registers[reg] = value;
+
+    if (reg == 0x02)
+    {
+        if ((value & SOFT_RESET) != 0)
+        {
+            simulatePowerLoss();
+            return;
+        }
+
+        if ((value & ENABLE) == 0)
+        {
+            registers[0x0A] = 0;
+            registers[0x0B] = 0;
+            currentStation = -1;
+            rdsRunning = false;
+            return;
+        }
+
+        if ((value & RDS_EN) == 0)
+        {
+            rdsRunning = false;
+            registers[0x0A] &= ~(RDSR | RDSS);
+        }
+        else if ((previous & RDS_EN) == 0 && currentStation >= 0 &&
+                 scenario.getStation(static_cast<uint8_t>(currentStation)).piCode != 0)
+        {
+            rdsRunning = true;
+            nextGroupUs = clock.nowUs() + rdsSyncTimeUs;
+        }
+
+        if ((value & SEEK) != 0 && (previous & SEEK) == 0)
+        {
+            seeking = true;
+            tuning = false;
+            operationStartUs = clock.nowUs();
+            registers[0x0A] &= ~(STC | SF | RDSR | RDSS);
+            rdsRunning = false;
+        }
+    }
+    else if (reg == 0x03 && (value & TUNE) != 0 && (registers[0x02] & ENABLE) != 0)
+    {
+        tuning = true;
+        seeking = false;
+        operationStartUs = clock.nowUs();
+        registers[0x0A] &= ~(STC | SF | RDSR | RDSS);
+        rdsRunning = false;
+    }
+}
+
+/**
+ * Advances everything that depends on time: tune/seek completion, the
+ * arrival of RDS groups and the signal level.
+ */
+void SimulatedBus::update()
+{
+    uint64_t now = clock.nowUs();
+
+    if (tuning && (now - operationStartUs) >= tuneTimeUs)
+    {
+        completeTune();
+    }
+    else if (seeking && (now - operationStartUs) >= static_cast<uint64_t>(tuneTimeUs) * SEEK_TIME_MULTIPLIER)
+    {
+        completeSeek();
+    }
+
+    if (rdsRunning && now >= nextGroupUs)
+    {
+        sendNextGroup(now);
+    }
+
+    if (currentStation >= 0 && now >= nextRssiUs)
+    {
+        refreshRssi(now);
+    }
+}
+
+void SimulatedBus::completeTune()
+{
+    tuning = false;
+    registers[0x03] &= ~TUNE;
+    settleOnChannel(static_cast<uint16_t>(Util::valueFromReg(registers[0x03], CHAN)));
+}
+
+/**
+ * Moves to the next station above the seek threshold in the seek
+ * direction, wrapping or stopping at the band edge according to SKMODE.
+ */
+void SimulatedBus::completeSeek()
+{
+    seeking = false;
+    registers[0x02] &= ~SEEK;
+
+    uint32_t spacing = getSpacingKhz();
+    uint32_t bottom = getBandBottomKhz();
+    uint32_t top = getBandTopKhz();
+    uint32_t channelCount = (top - bottom) / spacing + 1;
+    uint32_t startChannel = Util::valueFromReg(registers[0x0A], READCHAN);
+    bool seekUp = (registers[0x02] & SEEKUP) != 0;
+    bool wrap = (registers[0x02] & SKMODE) == 0;
+    uint8_t threshold = static_cast<uint8_t>(Util::valueFromReg(registers[0x05], SEEKTH));
+
+    int32_t channel = static_cast<int32_t>(startChannel);
+    for (uint32_t step = 1; step < channelCount; ++step)
+    {
+        channel += seekUp ? 1 : -1;
+        if (channel < 0 || channel >= static_cast<int32_t>(channelCount))
+        {
+            if (!wrap)
+            {
+                break;
+            }
+            channel = (channel < 0) ? static_cast<int32_t>(channelCount) - 1 : 0;
+        }
+
+        int station = scenario.findStation(channelToKhz(static_cast<uint16_t>(channel)));
+        if (station >= 0 && generator.getRssi(static_cast<uint8_t>(station), operationStartUs) > threshold)
+        {
+            registers[0x03] = static_cast<uint16_t>((registers[0x03] & ~CHAN) | (channel << 6));
+            settleOnChannel(static_cast<uint16_t>(channel));
+            return;
+        }
+    }
+
+    settleOnChannel(static_cast<uint16_t>(startChannel));
+    registers[0x0A] |= SF;
+}
+
+void SimulatedBus::settleOnChannel(uint16_t channel)
+{
+    uint64_t now = clock.nowUs();
+    currentStation = scenario.findStation(channelToKhz(channel));
+
+    registers[0x0A] = static_cast<uint16_t>((registers[0x0A] & ~(READCHAN | RDSR | RDSS | ST | SF)) | STC |
+                                            (channel & READCHAN));
+    registers[0x0B] = static_cast<uint16_t>((8 << 9) | FM_READY);
+
+    if (currentStation >= 0)
+    {
+        refreshRssi(now);
+        registers[0x0B] |= FM_TRUE;
+        if ((registers[0x02] & DMONO) == 0)
+        {
+            registers[0x0A] |= ST;
+        }
+    }
+
+    rdsRunning = (currentStation >= 0) && (scenario.getStation(static_cast<uint8_t>(currentStation)).piCode != 0) &&
+                 ((registers[0x02] & RDS_EN) != 0);
+    nextGroupUs = now + rdsSyncTimeUs;
+}
+
+/**
+ * Places the station's next group in the block registers along with its
+ * block error levels. If the reader fell behind, the groups it missed are
+ * simply lost, as on the real chip.
+ */
+void SimulatedBus::sendNextGroup(uint64_t now)
+{
+    ScenarioGenerator::Group group;
+    generator.nextGroup(static_cast<uint8_t>(currentStation), nextGroupUs, group);
+
+    registers[0x0C] = group.blocks[0];
+    registers[0x0D] = group.blocks[1];
+    registers[0x0E] = group.blocks[2];
+    registers[0x0F] = group.blocks[3];
+
+    if ((registers[0x0A] & RDSR) != 0)
+    {
+        ++stats.groupsLost;
+    }
+    ++stats.groupsReceived;
+
+    registers[0x0A] |= RDSR | RDSS;
+    registers[0x0B] = static_cast<uint16_t>((registers[0x0B] & ~(BLERA | BLERB)) | (group.errors[0] << 2) |
+                                            group.errors[1]);
+
+    nextGroupUs += RDS_GROUP_PERIOD_US;
+    while (nextGroupUs <= now)
+    {
+        ++stats.groupsReceived;
+        ++stats.groupsLost;
+        nextGroupUs += RDS_GROUP_PERIOD_US;
+    }
+}
+
+/**
+ * The chip's RSSI reading follows the station's profile, updated once per
+ * group period
+ */
+void SimulatedBus::refreshRssi(uint64_t now)
+{
+    uint8_t rssi = generator.getRssi(static_cast<uint8_t>(currentStation), now);
+    registers[0x0B] = static_cast<uint16_t>((registers[0x0B] & ~RSSI) | (rssi << 9));
+    nextRssiUs = now + RDS_GROUP_PERIOD_US;
+}
+
+/**
+ * For stepped clocks: moves time to whatever the driver is waiting for,
+ * if anything
+ */
+void SimulatedBus::advanceToNextEvent()
+{
+    if (tuning)
+    {
+        clock.advanceTo(operationStartUs + tuneTimeUs);
+    }
+    else if (seeking)
+    {
+        clock.advanceTo(operationStartUs + static_cast<uint64_t>(tuneTimeUs) * SEEK_TIME_MULTIPLIER);
+    }
+    else if (rdsRunning && (registers[0x0A] & RDSR) == 0)
+    {
+        clock.advanceTo(nextGroupUs);
+    }
+}
+
+uint32_t SimulatedBus::getBandBottomKhz() const
+{
+    switch (Util::valueFromReg(registers[0x03], BAND))
+    {
+        case 0:
+            return 87000;
+        case 1:
+        case 2:
+            return 76000;
+        default:
+            return (registers[0x07] & R_65M_50M_MODE) != 0 ? 65000 : 50000;
+    }
+}
+
+uint32_t SimulatedBus::getBandTopKhz() const
+{
+    switch (Util::valueFromReg(registers[0x03], BAND))
+    {
+        case 0:
+            return 108000;
+        case 1:
+            return 91000;
+        case 2:
+            return 108000;
+        default:
+            return 76000;
+    }
+}
+
+uint32_t SimulatedBus::getSpacingKhz() const
+{
+    switch (Util::valueFromReg(registers[0x03], SPACE))
+    {
+        case 0:
+            return 100;
+        case 1:
+            return 200;
+        case 2:
+            return 50;
+        default:
+            return 25;
+    }
+}
+
+uint32_t SimulatedBus::channelToKhz(uint16_t channel) const
+{
+    return getBandBottomKhz() + channel * getSpacingKhz();
+}
+
+/**
+ * Counts a transaction made at high speed, and returns true if it is one
+ * of the ones that fail
+ */
+bool SimulatedBus::dropOverclockedTransaction()
+{
+    if (clockRate != ClockRate::HIGH_SPEED)
+    {
+        return false;
+    }
+    return ++overclockedTransactions % OVERCLOCKED_FAILURE_INTERVAL == 0;
+}
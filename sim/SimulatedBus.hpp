@@ -0,0 +1,156 @@
+/**************************************************
+ * SimulatedBus.hpp - Simulated RDA5807M behind the RDA5807MBus interface
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SIMULATEDBUS_HPP
+#define SIMULATEDBUS_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "RDA5807MBus.hpp"
+#include "Scenario.hpp"
+#include "ScenarioGenerator.hpp"
+#include "SimulationClock.hpp"
+
+/**
+ * Models the register-level behavior of an RDA5807M closely enough to run
+ * the driver, the wrapper and the scan code without hardware: tuning and
+ * seeking take time and set STC, the stations of a Scenario come in with
+ * their RSSI and transmit RDS at the real group rate (see
+ * ScenarioGenerator), block errors show in BLERA/BLERB, and writing
+ * SOFT_RESET resets the registers.
+ *
+ * Timing follows a SimulationClock, real time unless sped up. With a
+ * stepped clock, polling the status register (0x0A) while a tune, seek or
+ * RDS group is pending jumps time straight to it, so a reader gets a new
+ * group on every poll; turn that off with setSkipToEvents() to drive the
+ * clock from outside and see what a reader polling at its own pace gets. A SimulatedBus is not thread-safe; give each
+ * simulated tuner its own instance.
+ *
+ * Like the chip, it works at the standard and fast clock rates. Clocked
+ * at high speed, which it isn't rated for, a fixed share of transactions
+ * fail and of reads come back with a bit flipped, so that clock
+ * calibration has a rate to reject.
+ */
+class SimulatedBus : public RDA5807MBus
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t MAX_STATIONS = Scenario::MAX_STATIONS;
+    static const uint32_t RDS_GROUP_PERIOD_US = ScenarioGenerator::GROUP_PERIOD_US;
+
+    static const uint32_t DEFAULT_TUNE_TIME_US = 20000;
+    static const uint32_t DEFAULT_RDS_SYNC_TIME_US = 250000;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint64_t groupsReceived;
+
+        // Groups overwritten by the next one before the reader got to them
+        uint64_t groupsLost;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    SimulatedBus();
+
+    bool addStation(uint32_t frequencyKhz, uint8_t rssi, uint16_t piCode = 0, uint8_t programType = 0,
+                    const char* programService = "");
+    void populateDemoBand();
+
+    void setScenario(const Scenario& scenarioParam);
+    const Scenario& getScenario() const;
+    const ScenarioGenerator::Counters& getGeneratorCounters() const;
+
+    SimulationClock& getClock();
+    void setSkipToEvents(bool skipToEventsParam);
+
+    const Stats& getStats() const;
+
+    void setTuneTime(uint32_t tuneTimeUsParam);
+    void setRdsSyncTime(uint32_t rdsSyncTimeUsParam);
+
+    void simulatePowerLoss();
+
+    uint32_t getTunedFrequencyKhz() const;
+
+    bool writeRegister(uint8_t reg, uint16_t value) override;
+
+    bool writeRegistersSequential(const uint16_t* values, uint8_t count) override;
+
+    bool readRegister(uint8_t reg, uint16_t& value) override;
+
+    bool setClockRate(ClockRate rate) override;
+
+private:
+    /////////////////////////////
+    // Private class Constants //
+    /////////////////////////////
+    static const uint16_t POWER_ON_REGISTERS[0x10];
+
+    // Seeking covers many channels, so it takes longer than a tune
+    static const uint8_t SEEK_TIME_MULTIPLIER = 4;
+
+    // At high speed, one transaction in this many fails, and one read in
+    // this many that gets through is corrupted
+    static const uint8_t OVERCLOCKED_FAILURE_INTERVAL = 16;
+    static const uint8_t OVERCLOCKED_CORRUPTION_INTERVAL = 11;
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void applyWrite(uint8_t reg, uint16_t value);
+    void update();
+    void completeTune();
+    void completeSeek();
+    void settleOnChannel(uint16_t channel);
+    void sendNextGroup(uint64_t now);
+    void refreshRssi(uint64_t now);
+    void advanceToNextEvent();
+    bool dropOverclockedTransaction();
+
+    uint32_t getBandBottomKhz() const;
+    uint32_t getBandTopKhz() const;
+    uint32_t getSpacingKhz() const;
+    uint32_t channelToKhz(uint16_t channel) const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    uint16_t registers[0x10];
+
+    Scenario scenario;
+    ScenarioGenerator generator;
+    SimulationClock clock;
+    bool skipToEvents;
+    Stats stats;
+
+    // Index of the station the chip is currently tuned to, or -1
+    int currentStation;
+
+    uint32_t tuneTimeUs;
+    uint32_t rdsSyncTimeUs;
+
+    bool tuning;
+    bool seeking;
+    uint64_t operationStartUs;
+
+    bool rdsRunning;
+    uint64_t nextGroupUs;
+    uint64_t nextRssiUs;
+
+    ClockRate clockRate;
+    uint32_t overclockedTransactions;
+    uint32_t overclockedReads;
+};
+
+#endif  // ifndef SIMULATEDBUS_HPP
@@ -0,0 +1,55 @@
+/**************************************************
+ * SimulationClock.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+
+// Project includes
+#include "SimulationClock.hpp"
+#include "Util.hpp"
+
+/**
+ * Starts in real time at the current monotonic time, so that simulated
+ * and real timestamps can be compared until the speed-up changes
+ */
+SimulationClock::SimulationClock() : speedUp(1)
+{
+    realBaseUs = Util::getMonotonicTimeUs();
+    simulatedBaseUs = realBaseUs;
+}
+
+void SimulationClock::setSpeedUp(uint32_t speedUpParam)
+{
+    simulatedBaseUs = nowUs();
+    realBaseUs = Util::getMonotonicTimeUs();
+    speedUp = speedUpParam;
+}
+
+uint32_t SimulationClock::getSpeedUp() const
+{
+    return speedUp;
+}
+
+bool SimulationClock::isStepped() const
+{
+    return speedUp == 0;
+}
+
+uint64_t SimulationClock::nowUs() const
+{
+    if (speedUp == 0)
+    {
+        return simulatedBaseUs;
+    }
+    return simulatedBaseUs + (Util::getMonotonicTimeUs() - realBaseUs) * speedUp;
+}
+
+void SimulationClock::advanceTo(uint64_t timeUs)
+{
+    if (speedUp == 0 && timeUs > simulatedBaseUs)
+    {
+        simulatedBaseUs = timeUs;
+    }
+}
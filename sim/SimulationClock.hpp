@@ -0,0 +1,52 @@
+/**************************************************
+ * SimulationClock.hpp - Time source for simulated tuners
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SIMULATIONCLOCK_HPP
+#define SIMULATIONCLOCK_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * Simulated time in microseconds. At a speed-up of 1 it follows the
+ * monotonic clock; at N it runs N times faster. At a speed-up of 0 it is
+ * stepped: time stands still until the simulation advances it, which
+ * SimulatedBus does whenever the driver is waiting for something, so a
+ * reader polling flat out sees a new event on every poll.
+ */
+class SimulationClock
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    SimulationClock();
+
+    // Simulated time carries on from where it is
+    void setSpeedUp(uint32_t speedUpParam);
+    uint32_t getSpeedUp() const;
+    bool isStepped() const;
+
+    uint64_t nowUs() const;
+
+    // Stepped clocks only; never moves time backwards
+    void advanceTo(uint64_t timeUs);
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    uint32_t speedUp;
+
+    // Simulated time at realBaseUs, for scaled clocks, or the current
+    // simulated time for stepped clocks
+    uint64_t simulatedBaseUs;
+    uint64_t realBaseUs;
+};
+
+#endif  // ifndef SIMULATIONCLOCK_HPP
@@ -0,0 +1,60 @@
+/**************************************************
+ * BusTraceConvert.cpp - Converts bus trace dumps offline
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdio>
+#include <cstring>
+
+// Project includes
+#include "BusTraceReader.hpp"
+
+/**
+ * Usage: bustrace-convert <dump> [text|chrome] [output]
+ * Writes to stdout if no output file is given.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        std::fprintf(stderr, "Usage: %s <dump> [text|chrome] [output]\n", argv[0]);
+        return 2;
+    }
+
+    bool chrome = (argc >= 3) && std::strcmp(argv[2], "chrome") == 0;
+    if (argc >= 3 && !chrome && std::strcmp(argv[2], "text") != 0)
+    {
+        std::fprintf(stderr, "Unknown format %s\n", argv[2]);
+        return 2;
+    }
+
+    BusTraceReader reader;
+    if (!reader.load(argv[1]))
+    {
+        std::fprintf(stderr, "%s is not a bus trace dump\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = (argc == 4) ? std::fopen(argv[3], "w") : stdout;
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "Unable to write %s\n", argv[3]);
+        return 1;
+    }
+
+    if (chrome)
+    {
+        reader.writeChromeTrace(out);
+    }
+    else
+    {
+        reader.writeText(out);
+    }
+
+    if (out != stdout)
+    {
+        std::fclose(out);
+    }
+    return 0;
+}
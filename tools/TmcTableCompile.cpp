@@ -0,0 +1,181 @@
+/**************************************************
+ * TmcTableCompile.cpp - Builds TMC table files from text
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "TmcTableFormat.hpp"
+
+namespace
+{
+    // Splits line on ';' into at most maxFields fields; the last one keeps
+    // any further separators
+    std::vector<std::string> splitFields(const std::string& line, size_t maxFields)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (fields.size() + 1 < maxFields)
+        {
+            size_t end = line.find(';', start);
+            if (end == std::string::npos)
+            {
+                break;
+            }
+            fields.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        fields.push_back(line.substr(start));
+        return fields;
+    }
+
+    uint32_t addString(std::string& strings, const std::string& text)
+    {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(text);
+        strings.push_back('\0');
+        return offset;
+    }
+
+    bool readLines(const char* path, std::vector<std::string>& lines)
+    {
+        FILE* in = std::fopen(path, "r");
+        if (in == nullptr)
+        {
+            return false;
+        }
+
+        char buffer[512];
+        while (std::fgets(buffer, sizeof(buffer), in) != nullptr)
+        {
+            std::string line(buffer);
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#')
+            {
+                lines.push_back(line);
+            }
+        }
+
+        std::fclose(in);
+        return true;
+    }
+}
+
+/**
+ * Usage: tmc-table-compile <ltn> <events.txt> <locations.txt> <output>
+ *
+ * Event lines are "code;updateClass;flags;text", where flags is empty or
+ * L for long-lasting. Location lines are
+ * "code;type;negativeOffset;positiveOffset;name". Lines starting with #
+ * are ignored.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc != 5)
+    {
+        std::fprintf(stderr, "Usage: %s <ltn> <events.txt> <locations.txt> <output>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> eventLines, locationLines;
+    if (!readLines(argv[2], eventLines) || !readLines(argv[3], locationLines))
+    {
+        std::fprintf(stderr, "Unable to read input\n");
+        return 1;
+    }
+
+    std::string strings;
+    addString(strings, "");
+
+    std::vector<TmcTableFormat::EventEntry> events(TmcTableFormat::EVENT_CODE_COUNT);
+    std::memset(events.data(), 0, events.size() * sizeof(TmcTableFormat::EventEntry));
+
+    for (const std::string& line : eventLines)
+    {
+        std::vector<std::string> fields = splitFields(line, 4);
+        unsigned long code = std::strtoul(fields[0].c_str(), nullptr, 10);
+        if (fields.size() != 4 || code >= TmcTableFormat::EVENT_CODE_COUNT)
+        {
+            std::fprintf(stderr, "Bad event line: %s\n", line.c_str());
+            return 1;
+        }
+
+        TmcTableFormat::EventEntry& event = events[code];
+        event.updateClass = static_cast<uint8_t>(std::strtoul(fields[1].c_str(), nullptr, 10));
+        event.flags = TmcTableFormat::EVENT_DEFINED;
+        if (fields[2].find('L') != std::string::npos)
+        {
+            event.flags |= TmcTableFormat::EVENT_LONG_LASTING;
+        }
+        event.textOffset = addString(strings, fields[3]);
+    }
+
+    std::vector<TmcTableFormat::LocationEntry> locations;
+    for (const std::string& line : locationLines)
+    {
+        std::vector<std::string> fields = splitFields(line, 5);
+        unsigned long code = std::strtoul(fields[0].c_str(), nullptr, 10);
+        if (fields.size() != 5 || code == 0 || code > 0xFFFF)
+        {
+            std::fprintf(stderr, "Bad location line: %s\n", line.c_str());
+            return 1;
+        }
+
+        TmcTableFormat::LocationEntry location;
+        std::memset(&location, 0, sizeof(location));
+        location.locationCode = static_cast<uint16_t>(code);
+        location.locationType = static_cast<uint8_t>(std::strtoul(fields[1].c_str(), nullptr, 10));
+        location.negativeOffset = static_cast<uint16_t>(std::strtoul(fields[2].c_str(), nullptr, 10));
+        location.positiveOffset = static_cast<uint16_t>(std::strtoul(fields[3].c_str(), nullptr, 10));
+        location.nameOffset = addString(strings, fields[4]);
+        locations.push_back(location);
+    }
+
+    std::sort(locations.begin(), locations.end(),
+              [](const TmcTableFormat::LocationEntry& lhs, const TmcTableFormat::LocationEntry& rhs)
+              { return lhs.locationCode < rhs.locationCode; });
+
+    TmcTableFormat::FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = TmcTableFormat::FILE_MAGIC;
+    header.formatVersion = TmcTableFormat::FORMAT_VERSION;
+    header.locationTableNumber = static_cast<uint16_t>(std::strtoul(argv[1], nullptr, 10));
+    header.locationCount = static_cast<uint32_t>(locations.size());
+    header.stringsSize = static_cast<uint32_t>(strings.size());
+
+    FILE* out = std::fopen(argv[4], "wb");
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "Unable to write %s\n", argv[4]);
+        return 1;
+    }
+
+    bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   std::fwrite(events.data(), sizeof(TmcTableFormat::EventEntry), events.size(), out) ==
+                       events.size() &&
+                   std::fwrite(locations.data(), sizeof(TmcTableFormat::LocationEntry), locations.size(), out) ==
+                       locations.size() &&
+                   std::fwrite(strings.data(), 1, strings.size(), out) == strings.size();
+    written = (std::fclose(out) == 0) && written;
+
+    if (!written)
+    {
+        std::fprintf(stderr, "Unable to write %s\n", argv[4]);
+        return 1;
+    }
+
+    std::printf("%zu events, %zu locations, %zu bytes of strings\n", eventLines.size(), locations.size(),
+                strings.size());
+    return 0;
+}
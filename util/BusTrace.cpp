@@ -0,0 +1,542 @@
+/**************************************************
+ * BusTrace.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Project includes
+#include "BusTrace.hpp"
+#include "BusTraceFormat.hpp"
+
+using BusTraceFormat::Record;
+
+namespace
+{
+    static_assert((BusTrace::RING_CAPACITY & (BusTrace::RING_CAPACITY - 1)) == 0,
+                  "RING_CAPACITY must be a power of two");
+
+    // A span ID is the thread's ring number, plus one, above a count of
+    // the spans the thread has started
+    const uint8_t SPAN_COUNTER_BITS = 27;
+    static_assert(BusTrace::MAX_THREADS < (1u << (32 - SPAN_COUNTER_BITS)), "Ring numbers must fit in a span ID");
+
+    const char* const PHASE_TO_STRING[] = { "TOTAL", "PARSE", "BUS", "SLEEP", "FORMAT", "OTHER" };
+
+    struct ThreadRing
+    {
+        // Claimed by a thread for its lifetime, then handed on with its
+        // records intact
+        std::atomic<bool> inUse;
+
+        // Records ever written; the latest RING_CAPACITY are kept
+        std::atomic<uint64_t> head;
+
+        Record records[BusTrace::RING_CAPACITY];
+    };
+
+    // Releases the thread's ring when the thread exits
+    struct RingOwner
+    {
+        ThreadRing* ring = nullptr;
+        bool claimAttempted = false;
+        uint32_t threadId = 0;
+        uint32_t spanBase = 0;
+        uint32_t spansStarted = 0;
+
+        ~RingOwner()
+        {
+            if (ring != nullptr)
+            {
+                ring->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    struct PhaseCounters
+    {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> totalNs;
+        std::atomic<uint64_t> maxNs;
+        std::atomic<uint64_t> buckets[BusTrace::HISTOGRAM_BUCKETS];
+    };
+
+    ThreadRing rings[BusTrace::MAX_THREADS];
+
+    // Interned command names; a command's ID is its index plus one
+    std::atomic<const char*> commandNames[BusTrace::MAX_COMMANDS];
+
+    // Indexed by command ID minus one
+    PhaseCounters phaseCounters[BusTrace::MAX_COMMANDS][BusTrace::PHASE_COUNT];
+
+    thread_local RingOwner ringOwner;
+    thread_local uint16_t currentCommand = BusTraceFormat::NO_COMMAND;
+    thread_local uint32_t currentSpan = BusTraceFormat::NO_SPAN;
+    thread_local BusTrace::CommandScope* currentScope = nullptr;
+
+    /**
+     * Returns the calling thread's ring, claiming a free one the first
+     * time. Returns nullptr if every ring is taken.
+     */
+    ThreadRing* getThreadRing()
+    {
+        if (!ringOwner.claimAttempted)
+        {
+            ringOwner.claimAttempted = true;
+            ringOwner.threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+
+            for (uint32_t ringIdx = 0; ringIdx < BusTrace::MAX_THREADS; ++ringIdx)
+            {
+                bool expected = false;
+                if (rings[ringIdx].inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                {
+                    ringOwner.ring = &rings[ringIdx];
+                    ringOwner.spanBase = (ringIdx + 1) << SPAN_COUNTER_BITS;
+                    break;
+                }
+            }
+        }
+
+        return ringOwner.ring;
+    }
+
+    uint16_t internCommand(const char* name)
+    {
+        for (uint16_t idx = 0; idx < BusTrace::MAX_COMMANDS; ++idx)
+        {
+            const char* slotName = commandNames[idx].load(std::memory_order_acquire);
+            if (slotName == nullptr)
+            {
+                const char* expected = nullptr;
+                commandNames[idx].compare_exchange_strong(expected, name, std::memory_order_acq_rel);
+                slotName = (expected == nullptr) ? name : expected;
+            }
+
+            if (slotName == name)
+            {
+                return static_cast<uint16_t>(idx + 1);
+            }
+        }
+
+        return BusTraceFormat::NO_COMMAND;
+    }
+
+    /**
+     * Appends the records of ring still intact at the end of the copy to
+     * out, and returns how many records the ring has lost
+     */
+    uint64_t collectRing(const ThreadRing& ring, std::vector<Record>& out)
+    {
+        uint64_t headBefore = ring.head.load(std::memory_order_acquire);
+        uint64_t first = (headBefore > BusTrace::RING_CAPACITY) ? headBefore - BusTrace::RING_CAPACITY : 0;
+
+        size_t outStart = out.size();
+        for (uint64_t seq = first; seq < headBefore; ++seq)
+        {
+            out.push_back(ring.records[seq & (BusTrace::RING_CAPACITY - 1)]);
+        }
+
+        // The owner may have lapped the copy; anything at or below
+        // headAfter - RING_CAPACITY may have been overwritten mid-copy
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t headAfter = ring.head.load(std::memory_order_relaxed);
+        uint64_t firstIntact = (headAfter >= BusTrace::RING_CAPACITY) ? headAfter - BusTrace::RING_CAPACITY + 1 : 0;
+
+        if (firstIntact > first)
+        {
+            uint64_t torn = std::min(firstIntact, headBefore) - first;
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(outStart),
+                      out.begin() + static_cast<std::ptrdiff_t>(outStart + torn));
+            first += torn;
+        }
+
+        return first;
+    }
+
+    uint8_t getBucket(uint64_t durationNs)
+    {
+        uint64_t durationUs = durationNs / 1000;
+        uint8_t bucket = 0;
+        while (durationUs > 0 && bucket < BusTrace::HISTOGRAM_BUCKETS - 1)
+        {
+            durationUs >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+}
+
+uint64_t BusTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/**
+ * Records an operation that started at startNs (from now()) and has just
+ * finished
+ */
+void BusTrace::record(BusTraceFormat::Op op, uint8_t reg, uint16_t value, bool success, uint64_t startNs)
+{
+    append(op, reg, value, success, startNs, nextSpanId(), currentSpan);
+}
+
+uint16_t BusTrace::getCurrentCommand()
+{
+    return currentCommand;
+}
+
+uint32_t BusTrace::getCurrentSpan()
+{
+    return currentSpan;
+}
+
+/**
+ * Writes the records of every thread, merged by timestamp, to path.
+ * Returns false if the file can't be written.
+ */
+bool BusTrace::dump(const char* path, uint32_t& recordsWritten)
+{
+    std::vector<Record> records;
+    records.reserve(RING_CAPACITY * 2);
+
+    uint64_t recordsLost = 0;
+    for (const ThreadRing& ring : rings)
+    {
+        recordsLost += collectRing(ring, records);
+    }
+
+    std::stable_sort(records.begin(), records.end(),
+                     [](const Record& left, const Record& right)
+                     {
+                         return left.timestampNs < right.timestampNs;
+                     });
+
+    std::vector<BusTraceFormat::CommandEntry> commands;
+    for (uint16_t idx = 0; idx < MAX_COMMANDS; ++idx)
+    {
+        const char* name = commandNames[idx].load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            break;
+        }
+
+        BusTraceFormat::CommandEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.commandId = static_cast<uint16_t>(idx + 1);
+        entry.nameLength = static_cast<uint8_t>(std::min<size_t>(std::strlen(name),
+                                                                 BusTraceFormat::MAX_COMMAND_NAME_LENGTH));
+        std::memcpy(entry.name, name, entry.nameLength);
+        commands.push_back(entry);
+    }
+
+    BusTraceFormat::FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = BusTraceFormat::FILE_MAGIC;
+    header.formatVersion = BusTraceFormat::FORMAT_VERSION;
+    header.commandCount = static_cast<uint16_t>(commands.size());
+    header.recordCount = static_cast<uint32_t>(records.size());
+    header.recordsLost = recordsLost;
+
+    // The dump goes to a world-writable directory; don't follow a link
+    // someone else put there
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    FILE* file = fdopen(fd, "wb");
+    if (file == nullptr)
+    {
+        close(fd);
+        return false;
+    }
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(commands.data(), sizeof(BusTraceFormat::CommandEntry), commands.size(), file) == commands.size() &&
+                   std::fwrite(records.data(), sizeof(Record), records.size(), file) == records.size();
+    written = (std::fclose(file) == 0) && written;
+
+    recordsWritten = written ? header.recordCount : 0;
+    return written;
+}
+
+/**
+ * Returns a copy of the histograms of every command that has finished at
+ * least once. Commands still running meanwhile may be half counted.
+ */
+std::vector<BusTrace::CommandStats> BusTrace::getCommandStats()
+{
+    std::vector<CommandStats> stats;
+    for (uint16_t idx = 0; idx < MAX_COMMANDS; ++idx)
+    {
+        const char* name = commandNames[idx].load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            break;
+        }
+        if (phaseCounters[idx][static_cast<int>(Phase::TOTAL)].count.load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+
+        CommandStats command;
+        command.name = name;
+        for (uint8_t phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            const PhaseCounters& counters = phaseCounters[idx][phase];
+            PhaseStats& phaseStats = command.phases[phase];
+            phaseStats.count = counters.count.load(std::memory_order_relaxed);
+            phaseStats.totalNs = counters.totalNs.load(std::memory_order_relaxed);
+            phaseStats.maxNs = counters.maxNs.load(std::memory_order_relaxed);
+            for (uint8_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+            {
+                phaseStats.buckets[bucket] = counters.buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+        stats.push_back(command);
+    }
+    return stats;
+}
+
+void BusTrace::resetCommandStats()
+{
+    for (auto& command : phaseCounters)
+    {
+        for (PhaseCounters& counters : command)
+        {
+            counters.count.store(0, std::memory_order_relaxed);
+            counters.totalNs.store(0, std::memory_order_relaxed);
+            counters.maxNs.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& bucket : counters.buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/**
+ * Returns the upper bound of the bucket holding the given percentile, or
+ * the maximum if that is lower. 0 if nothing has been counted.
+ */
+uint64_t BusTrace::getPercentileUs(const PhaseStats& stats, uint32_t percent)
+{
+    if (stats.count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t maxUs = (stats.maxNs + 999) / 1000;
+    uint64_t rank = std::max<uint64_t>((stats.count * percent + 99) / 100, 1);
+    uint64_t seen = 0;
+    for (uint8_t bucket = 0; bucket < HISTOGRAM_BUCKETS - 1; ++bucket)
+    {
+        seen += stats.buckets[bucket];
+        if (seen >= rank)
+        {
+            return std::min<uint64_t>(1ULL << bucket, maxUs);
+        }
+    }
+    return maxUs;
+}
+
+const char* BusTrace::phaseToCString(Phase phase)
+{
+    return PHASE_TO_STRING[static_cast<int>(phase)];
+}
+
+/**
+ * Returns a new span ID for the calling thread, or NO_SPAN if it isn't
+ * traced
+ */
+uint32_t BusTrace::nextSpanId()
+{
+    if (getThreadRing() == nullptr)
+    {
+        return BusTraceFormat::NO_SPAN;
+    }
+
+    ringOwner.spansStarted = (ringOwner.spansStarted + 1) & ((1u << SPAN_COUNTER_BITS) - 1);
+    return ringOwner.spanBase | ringOwner.spansStarted;
+}
+
+/**
+ * Appends a record of an operation that started at startNs and has just
+ * finished to the thread's ring, counts it in the command being executed,
+ * and returns the time it finished
+ */
+uint64_t BusTrace::append(BusTraceFormat::Op op, uint8_t reg, uint16_t value, bool success, uint64_t startNs,
+                          uint32_t spanId, uint32_t parentSpanId)
+{
+    uint64_t endNs = now();
+    if (currentScope != nullptr)
+    {
+        currentScope->account(op, startNs, endNs);
+    }
+
+    ThreadRing* ring = getThreadRing();
+    if (ring == nullptr)
+    {
+        return endNs;
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+    Record& entry = ring->records[head & (RING_CAPACITY - 1)];
+    entry.timestampNs = startNs;
+    entry.durationNs = static_cast<uint32_t>(std::min<uint64_t>(endNs - startNs, UINT32_MAX));
+    entry.spanId = spanId;
+    entry.parentSpanId = parentSpanId;
+    entry.value = value;
+    entry.commandId = currentCommand;
+    entry.op = op;
+    entry.reg = reg;
+    entry.success = success ? 1 : 0;
+    entry.reserved = 0;
+    entry.threadId = ringOwner.threadId;
+
+    ring->head.store(head + 1, std::memory_order_release);
+    return endNs;
+}
+
+/**
+ * Adds one execution of commandId, phaseNs[phase] long in each phase, to
+ * its histograms
+ */
+void BusTrace::observe(uint16_t commandId, const uint64_t (&phaseNs)[PHASE_COUNT])
+{
+    if (commandId == BusTraceFormat::NO_COMMAND || commandId > MAX_COMMANDS)
+    {
+        return;
+    }
+
+    for (uint8_t phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        PhaseCounters& counters = phaseCounters[commandId - 1][phase];
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        counters.totalNs.fetch_add(phaseNs[phase], std::memory_order_relaxed);
+        counters.buckets[getBucket(phaseNs[phase])].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t maxNs = counters.maxNs.load(std::memory_order_relaxed);
+        while (phaseNs[phase] > maxNs &&
+               !counters.maxNs.compare_exchange_weak(maxNs, phaseNs[phase], std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+BusTrace::CommandScope::CommandScope(const char* name, uint64_t startNsParam) :
+        outer(currentScope), previousCommand(currentCommand), previousSpan(currentSpan), parentSpan(currentSpan),
+        commandId(internCommand(name)), spanId(nextSpanId()), startNs(startNsParam != 0 ? startNsParam : now()),
+        adopted(false), phaseNs{}, busEndNs(0)
+{
+    currentScope = this;
+    currentCommand = commandId;
+    currentSpan = spanId;
+}
+
+BusTrace::CommandScope::CommandScope(uint16_t commandIdParam, uint32_t parentSpanParam) :
+        outer(currentScope), previousCommand(currentCommand), previousSpan(currentSpan), parentSpan(parentSpanParam),
+        commandId(commandIdParam),
+        spanId(nextSpanId()), startNs(now()), adopted(true), phaseNs{}, busEndNs(0)
+{
+    currentScope = this;
+    currentCommand = commandId;
+    currentSpan = spanId;
+}
+
+/**
+ * Records the command's span and, unless it was adopted, its phases. A
+ * nested command's phases count in the command around it too.
+ */
+BusTrace::CommandScope::~CommandScope()
+{
+    uint64_t endNs = append(BusTraceFormat::Op::COMMAND, 0, 0, true, startNs, spanId, parentSpan);
+
+    phaseNs[static_cast<int>(Phase::TOTAL)] = endNs - startNs;
+    uint64_t accountedNs = 0;
+    for (Phase phase : { Phase::PARSE, Phase::BUS, Phase::SLEEP, Phase::FORMAT })
+    {
+        accountedNs += phaseNs[static_cast<int>(phase)];
+    }
+    phaseNs[static_cast<int>(Phase::OTHER)] = (endNs - startNs > accountedNs) ? endNs - startNs - accountedNs : 0;
+
+    if (!adopted)
+    {
+        observe(commandId, phaseNs);
+    }
+
+    if (outer != nullptr)
+    {
+        for (Phase phase : { Phase::PARSE, Phase::BUS, Phase::SLEEP, Phase::FORMAT })
+        {
+            outer->phaseNs[static_cast<int>(phase)] += phaseNs[static_cast<int>(phase)];
+        }
+        outer->busEndNs = std::max(outer->busEndNs, busEndNs);
+    }
+
+    currentScope = outer;
+    currentCommand = previousCommand;
+    currentSpan = previousSpan;
+}
+
+/**
+ * Counts an operation on this thread that ran from startNs to endNs in
+ * the phase it belongs to. Operations a single submission carried out
+ * share its time, so bus time only counts what the latest bus operation
+ * adds past the end of the one before.
+ */
+void BusTrace::CommandScope::account(BusTraceFormat::Op op, uint64_t opStartNs, uint64_t opEndNs)
+{
+    switch (op)
+    {
+        case BusTraceFormat::Op::READ:
+        case BusTraceFormat::Op::WRITE:
+        case BusTraceFormat::Op::WRITE_SEQUENTIAL:
+        {
+            uint64_t fromNs = std::max(opStartNs, busEndNs);
+            if (opEndNs > fromNs)
+            {
+                phaseNs[static_cast<int>(Phase::BUS)] += opEndNs - fromNs;
+                busEndNs = opEndNs;
+            }
+            break;
+        }
+        case BusTraceFormat::Op::PARSE:
+            phaseNs[static_cast<int>(Phase::PARSE)] += opEndNs - opStartNs;
+            break;
+        case BusTraceFormat::Op::SLEEP:
+            phaseNs[static_cast<int>(Phase::SLEEP)] += opEndNs - opStartNs;
+            break;
+        case BusTraceFormat::Op::FORMAT:
+            phaseNs[static_cast<int>(Phase::FORMAT)] += opEndNs - opStartNs;
+            break;
+        default:
+            break;
+    }
+}
+
+BusTrace::Span::Span(BusTraceFormat::Op opParam) :
+        op(opParam), previousSpan(currentSpan), spanId(nextSpanId()), startNs(now())
+{
+    currentSpan = spanId;
+}
+
+BusTrace::Span::~Span()
+{
+    append(op, 0, 0, true, startNs, spanId, previousSpan);
+    currentSpan = previousSpan;
+}
@@ -0,0 +1,180 @@
+/**************************************************
+ * BusTrace.hpp - Always-on per-thread trace of bus operations
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSTRACE_HPP
+#define BUSTRACE_HPP
+
+// System includes
+#include <cstdint>
+#ifndef RDA5807M_FREESTANDING
+#include <vector>
+#endif
+
+// Project includes
+#include "BusTraceFormat.hpp"
+
+/**
+ * Every bus operation the driver performs is recorded in a ring owned by
+ * the calling thread. Recording costs two clock reads and a few stores:
+ * no locks, no allocation, no system calls. Each thread only keeps its
+ * last RING_CAPACITY records.
+ *
+ * Records are tagged with the command the thread is executing (see
+ * CommandScope), so a dump shows which command caused which traffic.
+ * dump() can run on any thread while others keep recording; records that
+ * are overwritten while it copies are left out.
+ *
+ * Commands and the parts of them marked with a Span are recorded too,
+ * each record naming the span it happened in, so a dump is a tree of
+ * what each command did and how long it took. As each command finishes,
+ * the time it spent in each Phase is also added to per-command latency
+ * histograms, which getCommandStats() reads.
+ *
+ * The freestanding profile compiles all of this away.
+ */
+class BusTrace
+{
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint32_t RING_CAPACITY = 4096;
+
+    // Threads beyond this many aren't traced
+    static const uint8_t MAX_THREADS = 16;
+
+    static const uint16_t MAX_COMMANDS = 128;
+
+    // Bucket 0 counts durations under 1 us and bucket b those from
+    // 2^(b-1) us up to 2^b us, except the last, which counts the rest
+    static const uint8_t HISTOGRAM_BUCKETS = 24;
+
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+
+    // Where a command's time went. OTHER is whatever the wrapper and the
+    // driver did outside the bus and sleeps, building the response of a
+    // command that returns text included.
+    enum class Phase : uint8_t {TOTAL = 0, PARSE = 1, BUS = 2, SLEEP = 3, FORMAT = 4, OTHER = 5};
+    static const uint8_t PHASE_COUNT = 6;
+
+#ifndef RDA5807M_FREESTANDING
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct PhaseStats
+    {
+        // Every execution counts in every phase, zero or not
+        uint64_t count;
+        uint64_t totalNs;
+        uint64_t maxNs;
+        uint64_t buckets[HISTOGRAM_BUCKETS];
+    };
+
+    struct CommandStats
+    {
+        const char* name;
+        PhaseStats phases[PHASE_COUNT];
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    static uint64_t now();
+
+    static void record(BusTraceFormat::Op op, uint8_t reg, uint16_t value, bool success, uint64_t startNs);
+
+    static uint16_t getCurrentCommand();
+    static uint32_t getCurrentSpan();
+
+    static bool dump(const char* path, uint32_t& recordsWritten);
+
+    // Commands that have run to completion at least once
+    static std::vector<CommandStats> getCommandStats();
+    static void resetCommandStats();
+
+    static uint64_t getPercentileUs(const PhaseStats& stats, uint32_t percent);
+
+    static const char* phaseToCString(Phase phase);
+
+    /**
+     * Attributes bus traffic on this thread to a command for the life of
+     * the scope, then records the command's own span. Scopes nest.
+     */
+    class CommandScope
+    {
+    public:
+        // name must outlive the trace (e.g. a static command table entry).
+        // The span starts at startNsParam, if given, so that work done before
+        // the command was known, such as parsing it, can be counted in it.
+        explicit CommandScope(const char* name, uint64_t startNsParam = 0);
+
+        // Adopts a command running on another thread, e.g. in a worker
+        // started by that command, inside the given span of that command. Its
+        // time isn't added to the command's histograms.
+        explicit CommandScope(uint16_t commandId, uint32_t parentSpanParam = BusTraceFormat::NO_SPAN);
+
+        ~CommandScope();
+
+    private:
+        friend class BusTrace;
+
+        void account(BusTraceFormat::Op op, uint64_t startNs, uint64_t endNs);
+
+        CommandScope* outer;
+        uint16_t previousCommand;
+        uint32_t previousSpan;
+        uint32_t parentSpan;
+        uint16_t commandId;
+        uint32_t spanId;
+        uint64_t startNs;
+        bool adopted;
+
+        // Time spent so far in each phase, and the end of the latest bus
+        // operation, so that overlapping ones are only counted once
+        uint64_t phaseNs[PHASE_COUNT];
+        uint64_t busEndNs;
+    };
+
+    /**
+     * Records a span of type op over the life of the scope, which
+     * operations recorded on this thread meanwhile fall within
+     */
+    class Span
+    {
+    public:
+        explicit Span(BusTraceFormat::Op op);
+        ~Span();
+
+    private:
+        BusTraceFormat::Op op;
+        uint32_t previousSpan;
+        uint32_t spanId;
+        uint64_t startNs;
+    };
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    static uint32_t nextSpanId();
+    static uint64_t append(BusTraceFormat::Op op, uint8_t reg, uint16_t value, bool success, uint64_t startNs,
+                       uint32_t spanId, uint32_t parentSpanId);
+    static void observe(uint16_t commandId, const uint64_t (&phaseNs)[PHASE_COUNT]);
+#else
+    static uint64_t now() { return 0; }
+
+    static void record(BusTraceFormat::Op, uint8_t, uint16_t, bool, uint64_t) {}
+
+    class Span
+    {
+    public:
+        explicit Span(BusTraceFormat::Op) {}
+    };
+#endif
+};
+
+#endif  // ifndef BUSTRACE_HPP
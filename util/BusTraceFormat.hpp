@@ -0,0 +1,99 @@
+/**************************************************
+ * BusTraceFormat.hpp - Layout of bus trace records and dump files
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSTRACEFORMAT_HPP
+#define BUSTRACEFORMAT_HPP
+
+// System includes
+#include <cstdint>
+
+// Project includes
+//<none>
+
+/**
+ * A dump file is a FileHeader followed by commandCount CommandEntries
+ * and recordCount Records sorted by timestamp. All fields are host byte order. Bump FORMAT_VERSION
+ * whenever a structure changes.
+ */
+namespace BusTraceFormat
+{
+    static const uint32_t FILE_MAGIC = 0x43525442; // "BTRC"
+    static const uint16_t FORMAT_VERSION = 2;
+
+    // Command ID of bus traffic not issued by any command
+    static const uint16_t NO_COMMAND = 0;
+
+    // Parent span ID of a record that isn't inside any span
+    static const uint32_t NO_SPAN = 0;
+
+    static const uint8_t MAX_COMMAND_NAME_LENGTH = 29;
+
+    enum class Op : uint8_t
+    {
+        READ = 0,
+        WRITE = 1,
+
+        // reg is the first register written, value the register count
+        WRITE_SEQUENTIAL = 2,
+
+        // Spans the execution of commandId; reg and value are unused
+        COMMAND = 3,
+
+        // Parts of a command, each inside its COMMAND span: parsing and
+        // looking the command up, the wrapper method it runs, time spent
+        // asleep waiting on the chip, and turning the result into a
+        // response. reg and value are unused.
+        PARSE = 4,
+        WRAPPER = 5,
+        SLEEP = 6,
+        FORMAT = 7
+    };
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint16_t formatVersion;
+        uint16_t commandCount;
+        uint32_t recordCount;
+        uint32_t reserved;
+
+        // Records overwritten before the dump, over all threads
+        uint64_t recordsLost;
+    };
+
+    struct CommandEntry
+    {
+        uint16_t commandId;
+        uint8_t nameLength;
+        char name[MAX_COMMAND_NAME_LENGTH];
+    };
+
+    struct Record
+    {
+        // CLOCK_MONOTONIC at the start of the operation
+        uint64_t timestampNs;
+        uint32_t durationNs;
+
+        // Unique among the records of a dump, barring wraparound; a
+        // record lies within the span of the record whose spanId is its
+        // parentSpanId
+        uint32_t spanId;
+        uint32_t parentSpanId;
+
+        uint16_t value;
+        uint16_t commandId;
+        Op op;
+        uint8_t reg;
+        uint8_t success;
+        uint8_t reserved;
+
+        // Kernel thread ID of the thread that did the operation
+        uint32_t threadId;
+    };
+
+    static_assert(sizeof(Record) == 32, "Records must stay compact");
+}
+
+#endif  // ifndef BUSTRACEFORMAT_HPP
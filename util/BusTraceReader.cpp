@@ -0,0 +1,187 @@
+/**************************************************
+ * BusTraceReader.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "BusTraceFormat.hpp"
+#include "BusTraceReader.hpp"
+
+using BusTraceFormat::Op;
+using BusTraceFormat::Record;
+
+namespace
+{
+    const char* const OP_TO_STRING[] = { "READ", "WRITE", "WRITESEQ", "COMMAND", "PARSE", "WRAPPER", "SLEEP",
+                                         "FORMAT" };
+
+    const char* opToString(Op op)
+    {
+        uint8_t opIdx = static_cast<uint8_t>(op);
+        return (opIdx <= static_cast<uint8_t>(Op::FORMAT)) ? OP_TO_STRING[opIdx] : "?";
+    }
+
+    bool isBusOp(Op op)
+    {
+        return op == Op::READ || op == Op::WRITE || op == Op::WRITE_SEQUENTIAL;
+    }
+}
+
+/**
+ * Loads the dump at path, replacing anything loaded before. Returns false
+ * if it isn't a readable dump of this format version.
+ */
+bool BusTraceReader::load(const char* path)
+{
+    records.clear();
+    commandNames.clear();
+    recordsLost = 0;
+
+    FILE* file = std::fopen(path, "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    BusTraceFormat::FileHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == BusTraceFormat::FILE_MAGIC &&
+                 header.formatVersion == BusTraceFormat::FORMAT_VERSION;
+
+    if (valid)
+    {
+        commandNames.resize(header.commandCount + 1u, "");
+        for (uint16_t idx = 0; valid && idx < header.commandCount; ++idx)
+        {
+            BusTraceFormat::CommandEntry entry;
+            valid = std::fread(&entry, sizeof(entry), 1, file) == 1 && entry.commandId <= header.commandCount &&
+                    entry.nameLength <= BusTraceFormat::MAX_COMMAND_NAME_LENGTH;
+            if (valid)
+            {
+                commandNames[entry.commandId].assign(entry.name, entry.nameLength);
+            }
+        }
+    }
+
+    if (valid)
+    {
+        records.resize(header.recordCount);
+        valid = std::fread(records.data(), sizeof(Record), records.size(), file) == records.size();
+        recordsLost = header.recordsLost;
+    }
+
+    std::fclose(file);
+
+    if (!valid)
+    {
+        records.clear();
+        commandNames.clear();
+    }
+    return valid;
+}
+
+uint32_t BusTraceReader::getRecordCount() const
+{
+    return static_cast<uint32_t>(records.size());
+}
+
+uint64_t BusTraceReader::getRecordsLost() const
+{
+    return recordsLost;
+}
+
+/**
+ * One line per record, with times relative to the first record:
+ *   start (ms)  thread  span  parent span  command  op  register/value
+ *   result  duration (us)
+ */
+void BusTraceReader::writeText(FILE* out) const
+{
+    std::fprintf(out, "# %u records, %llu lost before the dump\n", getRecordCount(),
+                 static_cast<unsigned long long>(recordsLost));
+    std::fprintf(out, "# %12s %7s %10s %10s %-16s %-8s %-16s %-4s %10s\n", "start_ms", "thread", "span", "parent",
+                 "command", "op", "reg/value", "ok", "dur_us");
+
+    uint64_t originNs = records.empty() ? 0 : records.front().timestampNs;
+    for (const Record& record : records)
+    {
+        char operand[24] = "";
+        switch (record.op)
+        {
+            case Op::READ:
+            case Op::WRITE:
+                std::snprintf(operand, sizeof(operand), "0x%02x = 0x%04x", record.reg, record.value);
+                break;
+            case Op::WRITE_SEQUENTIAL:
+                std::snprintf(operand, sizeof(operand), "0x%02x x%u", record.reg, record.value);
+                break;
+            default:
+                break;
+        }
+
+        std::fprintf(out, "%14.6f %7u %10x %10x %-16s %-8s %-16s %-4s %10.1f\n",
+                     static_cast<double>(record.timestampNs - originNs) / 1e6, record.threadId, record.spanId,
+                     record.parentSpanId, getCommandName(record.commandId), opToString(record.op), operand,
+                     record.success ? "ok" : "FAIL", static_cast<double>(record.durationNs) / 1e3);
+    }
+}
+
+/**
+ * Chrome trace event format: one complete ("X") event per record, with
+ * commands, their other spans and bus operations in separate categories
+ * so any of them can be filtered out. Every event carries its span and
+ * parent span IDs.
+ */
+void BusTraceReader::writeChromeTrace(FILE* out) const
+{
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    uint64_t originNs = records.empty() ? 0 : records.front().timestampNs;
+    for (size_t idx = 0; idx < records.size(); ++idx)
+    {
+        const Record& record = records[idx];
+        double startUs = static_cast<double>(record.timestampNs - originNs) / 1e3;
+        double durationUs = static_cast<double>(record.durationNs) / 1e3;
+        const char* separator = (idx + 1 < records.size()) ? "," : "";
+
+        if (record.op == Op::COMMAND)
+        {
+            std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"command\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                              "\"pid\":1,\"tid\":%u,\"args\":{\"span\":%u,\"parent\":%u}}%s\n",
+                         getCommandName(record.commandId), startUs, durationUs, record.threadId, record.spanId,
+                         record.parentSpanId, separator);
+        }
+        else if (!isBusOp(record.op))
+        {
+            std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                              "\"pid\":1,\"tid\":%u,\"args\":{\"span\":%u,\"parent\":%u,\"command\":\"%s\"}}%s\n",
+                         opToString(record.op), startUs, durationUs, record.threadId, record.spanId,
+                         record.parentSpanId, getCommandName(record.commandId), separator);
+        }
+        else
+        {
+            std::fprintf(out, "{\"name\":\"%s 0x%02x\",\"cat\":\"i2c\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                              "\"pid\":1,\"tid\":%u,\"args\":{\"value\":\"0x%04x\",\"ok\":%s,\"command\":\"%s\","
+                              "\"span\":%u,\"parent\":%u}}%s\n",
+                         opToString(record.op), record.reg, startUs, durationUs, record.threadId, record.value,
+                         record.success ? "true" : "false", getCommandName(record.commandId), record.spanId,
+                         record.parentSpanId, separator);
+        }
+    }
+
+    std::fprintf(out, "]}\n");
+}
+
+const char* BusTraceReader::getCommandName(uint16_t commandId) const
+{
+    if (commandId == BusTraceFormat::NO_COMMAND || commandId >= commandNames.size())
+    {
+        return "-";
+    }
+    return commandNames[commandId].c_str();
+}
@@ -0,0 +1,55 @@
+/**************************************************
+ * BusTraceReader.hpp - Loads bus trace dumps and converts them
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef BUSTRACEREADER_HPP
+#define BUSTRACEREADER_HPP
+
+// System includes
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "BusTraceFormat.hpp"
+
+/**
+ * Reads a file written by BusTrace::dump() and renders it either as one
+ * line of text per operation or as a Chrome trace (chrome://tracing,
+ * Perfetto) with each command as a span over the spans and bus
+ * operations it caused.
+ */
+class BusTraceReader
+{
+public:
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    bool load(const char* path);
+
+    uint32_t getRecordCount() const;
+    uint64_t getRecordsLost() const;
+
+    void writeText(FILE* out) const;
+    void writeChromeTrace(FILE* out) const;
+
+private:
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    const char* getCommandName(uint16_t commandId) const;
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::vector<BusTraceFormat::Record> records;
+
+    // Indexed by command ID
+    std::vector<std::string> commandNames;
+
+    uint64_t recordsLost = 0;
+};
+
+#endif  // ifndef BUSTRACEREADER_HPP
@@ -0,0 +1,441 @@
+/**************************************************
+ * Log.cpp
+ * Author: Ben Sherman
+ *************************************************/
+
+// System includes
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Project includes
+#include "Log.hpp"
+
+namespace
+{
+    static_assert((Log::QUEUE_CAPACITY & (Log::QUEUE_CAPACITY - 1)) == 0, "QUEUE_CAPACITY must be a power of two");
+
+    const char* const LEVEL_TO_STRING[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+    // Length modifiers, which are replaced when an argument is formatted
+    bool isLengthModifier(char c)
+    {
+        return std::strchr("hlLqjzt", c) != nullptr;
+    }
+}
+
+Log::Log(FILE* outputParam) :
+        slots(new Slot[QUEUE_CAPACITY]), enqueuePos(0), dequeuePos(0), recordsDropped(0), recordsWritten(0),
+        batchesWritten(0), bytesWritten(0), output(outputParam), ownedOutput(nullptr), flushRequested(false),
+        stopping(false)
+{
+    for (uint32_t slotIdx = 0; slotIdx < QUEUE_CAPACITY; ++slotIdx)
+    {
+        slots[slotIdx].sequence.store(slotIdx, std::memory_order_relaxed);
+    }
+
+    writer = std::thread(&Log::runWriter, this);
+}
+
+Log::~Log()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    if (ownedOutput != nullptr)
+    {
+        std::fclose(ownedOutput);
+    }
+}
+
+Log& Log::get()
+{
+    static Log log{stdout};
+    return log;
+}
+
+/**
+ * Anything already queued may still go to the previous output. Returns
+ * false, leaving the output as it was, if path can't be opened.
+ */
+bool Log::redirect(const char* path)
+{
+    FILE* file = std::fopen(path, "a");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (ownedOutput != nullptr)
+    {
+        std::fclose(ownedOutput);
+    }
+    ownedOutput = file;
+    output = file;
+    return true;
+}
+
+void Log::flush()
+{
+    uint64_t target = enqueuePos.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> guard(lock);
+    flushRequested = true;
+    wake.notify_one();
+    written.wait(guard, [this, target]()
+    {
+        return recordsWritten.load(std::memory_order_acquire) >= target;
+    });
+}
+
+Log::Stats Log::getStats() const
+{
+    Stats stats;
+    stats.recordsDropped = recordsDropped.load(std::memory_order_relaxed);
+    stats.recordsLogged = recordsWritten.load(std::memory_order_relaxed);
+    stats.batchesWritten = batchesWritten.load(std::memory_order_relaxed);
+    stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const char* Log::levelToCString(Level level)
+{
+    return LEVEL_TO_STRING[static_cast<int>(level)];
+}
+
+/**
+ * Stamps a record and copies the arguments into it, walking the format to
+ * find what each one is. Stops at the first conversion it can't store,
+ * which the writer then prints as it stands.
+ */
+void Log::write(Level level, const char* format, va_list args)
+{
+    Slot* slot = claimSlot();
+    if (slot == nullptr)
+    {
+        return;
+    }
+
+    Record& record = slot->record;
+    record.timestampNs = now();
+    record.format = format;
+    record.level = level;
+    record.argCount = 0;
+    record.textUsed = 0;
+
+    for (const char* c = format; *c != '\0' && record.argCount < MAX_ARGS; ++c)
+    {
+        if (*c != '%')
+        {
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            ++c;
+            continue;
+        }
+
+        // Widths and precisions given as arguments aren't supported
+        ++c;
+        while (*c != '\0' && std::strchr("-+ #0123456789.", *c) != nullptr)
+        {
+            ++c;
+        }
+        uint8_t longCount = 0;
+        char size = '\0';
+        for (; isLengthModifier(*c); ++c)
+        {
+            if (*c == 'l')
+            {
+                ++longCount;
+            }
+            else if (*c != 'h')
+            {
+                size = *c;
+            }
+        }
+
+        if (*c == 's')
+        {
+            encode(record, va_arg(args, const char*));
+            continue;
+        }
+
+        bool isSigned = (*c == 'd' || *c == 'i');
+        uint64_t value;
+        if (*c == 'c')
+        {
+            isSigned = true;
+            value = static_cast<uint64_t>(va_arg(args, int));
+        }
+        else if (*c == 'p')
+        {
+            value = reinterpret_cast<uintptr_t>(va_arg(args, void*));
+        }
+        else if (std::strchr("diouxX", *c) == nullptr || *c == '\0')
+        {
+            break;
+        }
+        else if (size == 'j')
+        {
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, intmax_t)) : va_arg(args, uintmax_t);
+        }
+        else if (size == 'z')
+        {
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, ptrdiff_t)) : va_arg(args, size_t);
+        }
+        else if (size == 't')
+        {
+            value = static_cast<uint64_t>(va_arg(args, ptrdiff_t));
+        }
+        else if (longCount >= 2 || size == 'q')
+        {
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, long long)) : va_arg(args, unsigned long long);
+        }
+        else if (longCount == 1)
+        {
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, long)) : va_arg(args, unsigned long);
+        }
+        else
+        {
+            value = isSigned ? static_cast<uint64_t>(va_arg(args, int)) : va_arg(args, unsigned int);
+        }
+
+        record.argTypes[record.argCount] = isSigned ? ArgType::INT : ArgType::UINT;
+        record.args[record.argCount++] = value;
+    }
+
+    publish(slot);
+}
+
+/**
+ * Copies text into the record, as much of it as fits
+ */
+void Log::encode(Record& record, const char* text)
+{
+    uint8_t offset = record.textUsed;
+    uint8_t length = 0;
+    if (text != nullptr)
+    {
+        while (offset + length < TEXT_CAPACITY - 1 && text[length] != '\0')
+        {
+            record.text[offset + length] = text[length];
+            ++length;
+        }
+    }
+    record.text[offset + length] = '\0';
+    record.textUsed = static_cast<uint8_t>(offset + length + (offset + length < TEXT_CAPACITY - 1 ? 1 : 0));
+
+    record.argTypes[record.argCount] = ArgType::TEXT;
+    record.args[record.argCount++] = offset;
+}
+
+uint64_t Log::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Claims the next free slot for the calling thread, or returns nullptr,
+ * counting a dropped record, if the writer hasn't freed it yet
+ */
+Log::Slot* Log::claimSlot()
+{
+    uint64_t position = enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot* slot = &slots[position & (QUEUE_CAPACITY - 1)];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == position)
+        {
+            if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                return slot;
+            }
+        }
+        else if (sequence < position)
+        {
+            recordsDropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            position = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Log::publish(Slot* slot)
+{
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+/**
+ * Writes whatever is queued every WRITER_PERIOD_MS, or right away when
+ * asked to flush, until the log is destroyed
+ */
+void Log::runWriter()
+{
+    std::string batch;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        bool withTimeAndLevel = (output != stdout);
+        guard.unlock();
+        batch.clear();
+        uint32_t drained = 0;
+        bool more = drain(batch, withTimeAndLevel, drained);
+
+        guard.lock();
+        if (!batch.empty())
+        {
+            std::fwrite(batch.data(), 1, batch.size(), output);
+            std::fflush(output);
+            batchesWritten.fetch_add(1, std::memory_order_relaxed);
+            bytesWritten.fetch_add(batch.size(), std::memory_order_relaxed);
+            recordsWritten.fetch_add(drained, std::memory_order_release);
+        }
+        written.notify_all();
+
+        if (more)
+        {
+            continue;
+        }
+        if (stopping)
+        {
+            break;
+        }
+
+        wake.wait_for(guard, std::chrono::milliseconds(static_cast<int64_t>(WRITER_PERIOD_MS)), [this]()
+        {
+            return flushRequested || stopping;
+        });
+        flushRequested = false;
+    }
+}
+
+/**
+ * Formats queued records into batch, up to a queue's worth, counting them
+ * in drained. Returns true if it stopped with records left over.
+ */
+bool Log::drain(std::string& batch, bool withTimeAndLevel, uint32_t& drained)
+{
+    for (drained = 0; drained < QUEUE_CAPACITY; ++drained)
+    {
+        Slot& slot = slots[dequeuePos & (QUEUE_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+        {
+            return false;
+        }
+
+        formatRecord(slot.record, withTimeAndLevel, batch);
+        slot.sequence.store(dequeuePos + QUEUE_CAPACITY, std::memory_order_release);
+        ++dequeuePos;
+    }
+    return true;
+}
+
+/**
+ * Appends the record as a line, substituting its arguments into its
+ * format one conversion at a time
+ */
+void Log::formatRecord(const Record& record, bool withTimeAndLevel, std::string& batch)
+{
+    char buffer[128];
+    if (withTimeAndLevel)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%llu.%06llu %-5s ",
+                      static_cast<unsigned long long>(record.timestampNs / 1000000000ULL),
+                      static_cast<unsigned long long>((record.timestampNs / 1000) % 1000000),
+                      levelToCString(record.level));
+        batch.append(buffer);
+    }
+
+    uint8_t argIdx = 0;
+    for (const char* c = record.format; *c != '\0'; ++c)
+    {
+        if (*c != '%')
+        {
+            batch.push_back(*c);
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            batch.push_back('%');
+            ++c;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are
+        // replaced to suit the argument
+        char spec[16] = "%";
+        size_t specLength = 1;
+        const char* end = c + 1;
+        while (*end != '\0' && std::strchr("diouxXcsp", *end) == nullptr)
+        {
+            if (!isLengthModifier(*end) && specLength < sizeof(spec) - 4)
+            {
+                spec[specLength++] = *end;
+            }
+            ++end;
+        }
+        if (*end == '\0' || argIdx >= record.argCount)
+        {
+            batch.append(c, static_cast<size_t>(end - c));
+            c = end - 1;
+            continue;
+        }
+
+        char conversion = *end;
+        ArgType type = record.argTypes[argIdx];
+        uint64_t value = record.args[argIdx++];
+        if (type == ArgType::TEXT)
+        {
+            spec[specLength++] = 's';
+            spec[specLength] = '\0';
+            std::snprintf(buffer, sizeof(buffer), spec, &record.text[value]);
+        }
+        else if (conversion == 'c')
+        {
+            spec[specLength++] = 'c';
+            spec[specLength] = '\0';
+            std::snprintf(buffer, sizeof(buffer), spec, static_cast<int>(value));
+        }
+        else
+        {
+            if (conversion == 's' || conversion == 'p')
+            {
+                conversion = (type == ArgType::INT) ? 'd' : 'u';
+            }
+            spec[specLength++] = 'l';
+            spec[specLength++] = 'l';
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            if (type == ArgType::INT)
+            {
+                std::snprintf(buffer, sizeof(buffer), spec, static_cast<long long>(value));
+            }
+            else
+            {
+                std::snprintf(buffer, sizeof(buffer), spec, static_cast<unsigned long long>(value));
+            }
+        }
+        batch.append(buffer);
+        c = end;
+    }
+    batch.push_back('\n');
+}
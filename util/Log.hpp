@@ -0,0 +1,277 @@
+/**************************************************
+ * Log.hpp - Asynchronous buffered logger
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef LOG_HPP
+#define LOG_HPP
+
+// System includes
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#ifndef RDA5807M_FREESTANDING
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#endif
+
+// Project includes
+//<none>
+
+// Messages below this level are dropped without being recorded: 0 DEBUG, 1 INFO, 2 WARN,
+// 3 ERROR, 4 nothing
+#ifndef RDA5807M_LOG_LEVEL
+#define RDA5807M_LOG_LEVEL 1
+#endif
+
+/**
+ * Takes log output off the threads that produce it. A log call checks the
+ * level at compile time, stamps the time and copies the printf-style
+ * format pointer and the arguments into a fixed-size record in a
+ * lock-free queue, without formatting anything, taking a lock or making
+ * a system call. A background thread formats the records and writes them
+ * out in batches.
+ *
+ * Formats must be string literals, or otherwise outlive the log, and are
+ * checked against their arguments like printf's. Integer, character and
+ * string conversions are supported, and the arguments are taken in the
+ * order the format names them; strings are copied, up to TEXT_CAPACITY
+ * bytes per record in all. A record that finds the queue full is dropped
+ * and counted rather than waiting.
+ *
+ * Lines go out as they were logged on stdout, and with the time and level
+ * in front of them in a file. The freestanding profile prints them
+ * synchronously instead.
+ */
+class Log
+{
+public:
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class Level : uint8_t {DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3};
+
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const uint8_t COMPILED_LEVEL = RDA5807M_LOG_LEVEL;
+
+#ifndef RDA5807M_FREESTANDING
+    static const uint32_t QUEUE_CAPACITY = 4096;
+    static const uint8_t MAX_ARGS = 6;
+    static const uint8_t TEXT_CAPACITY = 48;
+
+    // How often the writer looks for records when nobody asks it to flush
+    static const uint32_t WRITER_PERIOD_MS = 20;
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Stats
+    {
+        uint64_t recordsLogged;
+        uint64_t recordsDropped;
+        uint64_t batchesWritten;
+        uint64_t bytesWritten;
+    };
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+
+    // Writes to output, which is left open
+    explicit Log(FILE* outputParam);
+
+    // Flushes what is queued
+    ~Log();
+
+    // The log the application writes to, on stdout unless redirected
+    static Log& get();
+
+    // Writes to path, appending, from the next batch on
+    bool redirect(const char* path);
+
+    __attribute__((format(printf, 2, 3))) void debug(const char* format, ...)
+    {
+        if (static_cast<uint8_t>(Level::DEBUG) >= COMPILED_LEVEL)
+        {
+            va_list args;
+            va_start(args, format);
+            write(Level::DEBUG, format, args);
+            va_end(args);
+        }
+    }
+
+    __attribute__((format(printf, 2, 3))) void info(const char* format, ...)
+    {
+        if (static_cast<uint8_t>(Level::INFO) >= COMPILED_LEVEL)
+        {
+            va_list args;
+            va_start(args, format);
+            write(Level::INFO, format, args);
+            va_end(args);
+        }
+    }
+
+    __attribute__((format(printf, 2, 3))) void warn(const char* format, ...)
+    {
+        if (static_cast<uint8_t>(Level::WARN) >= COMPILED_LEVEL)
+        {
+            va_list args;
+            va_start(args, format);
+            write(Level::WARN, format, args);
+            va_end(args);
+        }
+    }
+
+    __attribute__((format(printf, 2, 3))) void error(const char* format, ...)
+    {
+        if (static_cast<uint8_t>(Level::ERROR) >= COMPILED_LEVEL)
+        {
+            va_list args;
+            va_start(args, format);
+            write(Level::ERROR, format, args);
+            va_end(args);
+        }
+    }
+
+    // Blocks until everything logged so far has been written
+    void flush();
+
+    Stats getStats() const;
+
+    static const char* levelToCString(Level level);
+
+private:
+    //////////////////////
+    // Enum Definitions //
+    //////////////////////
+    enum class ArgType : uint8_t {INT = 0, UINT = 1, TEXT = 2};
+
+    ///////////////////////////
+    // Structure Definitions //
+    ///////////////////////////
+    struct Record
+    {
+        uint64_t timestampNs;
+        const char* format;
+
+        // TEXT arguments hold their offset into text
+        uint64_t args[MAX_ARGS];
+        ArgType argTypes[MAX_ARGS];
+        uint8_t argCount;
+        uint8_t textUsed;
+        Level level;
+        char text[TEXT_CAPACITY];
+    };
+
+    struct Slot
+    {
+        // Ready for the producer of position p when it is p, and for the
+        // writer when it is p + 1
+        std::atomic<uint64_t> sequence;
+        Record record;
+    };
+
+    /////////////////////////////////
+    // Private interface functions //
+    /////////////////////////////////
+    void write(Level level, const char* format, va_list args);
+    static void encode(Record& record, const char* text);
+
+    static uint64_t now();
+
+    Slot* claimSlot();
+    void publish(Slot* slot);
+
+    void runWriter();
+    bool drain(std::string& batch, bool withTimeAndLevel, uint32_t& drained);
+    static void formatRecord(const Record& record, bool withTimeAndLevel, std::string& batch);
+
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::unique_ptr<Slot[]> slots;
+
+    // Positions of the next record to be claimed and to be formatted
+    std::atomic<uint64_t> enqueuePos;
+    uint64_t dequeuePos;
+
+    std::atomic<uint64_t> recordsDropped;
+
+    // Records out of the queue and written to the output
+    std::atomic<uint64_t> recordsWritten;
+    std::atomic<uint64_t> batchesWritten;
+    std::atomic<uint64_t> bytesWritten;
+
+    // Guards output and the writer's wake-ups
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable written;
+    FILE* output;
+    FILE* ownedOutput;
+    bool flushRequested;
+    bool stopping;
+
+    std::thread writer;
+#else
+    static Log& get()
+    {
+        static Log log;
+        return log;
+    }
+
+    __attribute__((format(printf, 2, 3))) void debug(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        write(Level::DEBUG, format, args);
+        va_end(args);
+    }
+
+    __attribute__((format(printf, 2, 3))) void info(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        write(Level::INFO, format, args);
+        va_end(args);
+    }
+
+    __attribute__((format(printf, 2, 3))) void warn(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        write(Level::WARN, format, args);
+        va_end(args);
+    }
+
+    __attribute__((format(printf, 2, 3))) void error(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        write(Level::ERROR, format, args);
+        va_end(args);
+    }
+
+    void flush()
+    {
+        std::fflush(stdout);
+    }
+
+private:
+    void write(Level level, const char* format, va_list args)
+    {
+        if (static_cast<uint8_t>(level) >= COMPILED_LEVEL)
+        {
+            std::vprintf(format, args);
+            std::putchar('\n');
+        }
+    }
+#endif
+};
+
+#endif  // ifndef LOG_HPP
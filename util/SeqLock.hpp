@@ -0,0 +1,174 @@
+/**************************************************
+ * SeqLock.hpp - Single-writer sequence lock
+ * Author: Ben Sherman
+ *************************************************/
+
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+// System includes
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Project includes
+//<none>
+
+/**
+ * Publishes a trivially copyable value from a single writer to any number
+ * of readers. The writer never blocks; readers never block the writer or
+ * each other, they simply retry if they raced with a write. The layout is
+ * position-independent, so a SeqLock can live in shared memory.
+ *
+ * The value is held as an array of Words, each an atomic accessed relaxed,
+ * so a reader that overlaps a write reads stale or mixed words rather than
+ * racing with the writer; the sequence check then throws the copy away.
+ * A writer that updates the value a piece at a time, rather than storing
+ * all of it, brackets its updates with beginWrite() and endWrite() and
+ * goes through loadWord() and storeWord() in between.
+ */
+template<typename T, typename Word = uint32_t>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payloads must be trivially copyable");
+    static_assert(std::is_unsigned<Word>::value, "SeqLock words must be unsigned integers");
+
+public:
+    /////////////////////
+    // Class Constants //
+    /////////////////////
+    static const size_t WORD_COUNT = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    ////////////////////////////////
+    // Public interface functions //
+    ////////////////////////////////
+    SeqLock() : sequence(0)
+    {
+        for (size_t wordIdx = 0; wordIdx < WORD_COUNT; ++wordIdx)
+        {
+            words[wordIdx].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Publishes value. Must only be called from the single writer.
+     */
+    void store(const T& value)
+    {
+        Word buffer[WORD_COUNT] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        beginWrite();
+        for (size_t wordIdx = 0; wordIdx < WORD_COUNT; ++wordIdx)
+        {
+            words[wordIdx].store(buffer[wordIdx], std::memory_order_relaxed);
+        }
+        endWrite();
+    }
+
+    /**
+     * Makes a single attempt to copy out a consistent value. Returns false
+     * (and leaves out as it was) if a write was in progress.
+     */
+    bool tryLoad(T& out) const
+    {
+        uint32_t version;
+        return tryLoad(out, version);
+    }
+
+    /**
+     * As above, also giving the number of completed stores the value
+     * came from
+     */
+    bool tryLoad(T& out, uint32_t& version) const
+    {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if ((before & 0x1) != 0)
+        {
+            return false;
+        }
+
+        Word buffer[WORD_COUNT];
+        for (size_t wordIdx = 0; wordIdx < WORD_COUNT; ++wordIdx)
+        {
+            buffer[wordIdx] = words[wordIdx].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before != sequence.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        std::memcpy(&out, buffer, sizeof(T));
+        version = before / 2;
+        return true;
+    }
+
+    /**
+     * Copies out a consistent value, retrying until one is obtained.
+     * Returns the number of attempts that were needed.
+     */
+    uint32_t load(T& out) const
+    {
+        uint32_t attempts = 1;
+        while (!tryLoad(out))
+        {
+            ++attempts;
+        }
+        return attempts;
+    }
+
+    /**
+     * Returns the number of completed stores. Readers can compare this
+     * against a previously seen value to detect updates without copying.
+     */
+    uint32_t getVersion() const
+    {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    /**
+     * Starts an update made a word at a time. Readers retry until the
+     * matching endWrite(). Writer only; the calls must not nest.
+     */
+    void beginWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite()
+    {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Writer only, between beginWrite() and endWrite()
+     */
+    void storeWord(size_t wordIdx, Word value)
+    {
+        words[wordIdx].store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * The writer reads back what it stored. Any other thread gets a value
+     * that was stored at some point, but one that need not be consistent
+     * with the other words.
+     */
+    Word loadWord(size_t wordIdx) const
+    {
+        return words[wordIdx].load(std::memory_order_acquire);
+    }
+
+private:
+    //////////////////////////////
+    // Private member variables //
+    //////////////////////////////
+    std::atomic<uint32_t> sequence;
+    std::atomic<Word> words[WORD_COUNT];
+};
+
+#endif  // ifndef SEQLOCK_HPP
@@ -5,6 +5,7 @@
 
 // System includes
 #include <cstdint>
+#include <time.h>
 
 // Project includes
 #include "Util.hpp"
@@ -61,3 +62,24 @@ bool Util::boolFromInteger(int val)
     }
 }
 
+/**
+ * Returns the time in microseconds since an arbitrary, fixed point in the
+ * past. Only useful for measuring intervals.
+ */
+uint64_t Util::getMonotonicTimeUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000ULL;
+}
+
+/**
+ * Returns wall-clock time in microseconds since the Unix epoch, for
+ * timestamps that have to mean something after a restart.
+ */
+uint64_t Util::getRealtimeUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000ULL;
+}
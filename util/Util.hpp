@@ -17,6 +17,8 @@ namespace Util
     uint16_t valueFromReg(uint16_t regContent, uint16_t mask);
     uint16_t boolToInteger(bool boolean);
     bool boolFromInteger(int val);
+    uint64_t getMonotonicTimeUs();
+    uint64_t getRealtimeUs();
 };
 
 #endif	// ifndef UTIL_HPP